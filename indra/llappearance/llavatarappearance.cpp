@@ -49,6 +49,17 @@ using namespace LLAvatarAppearanceDefines;
 const std::string AVATAR_DEFAULT_CHAR = "avatar";
 const LLColor4 DUMMY_COLOR = LLColor4(0.5,0.5,0.5,1.0);
 
+// Where the parsed tree of a character definition file is kept between
+// sessions, empty if there is no cache to keep it in.
+static std::string character_cache_path(const std::string& file_name)
+{
+	if (gDirUtilp->getCacheDir().empty())
+	{
+		return LLStringUtil::null;
+	}
+	return gDirUtilp->getExpandedFilename(LL_PATH_CACHE, gDirUtilp->getBaseFileName(file_name) + ".bin");
+}
+
 /*********************************************************************************
  **                                                                             **
  ** Begin private LLAvatarAppearance Support classes
@@ -104,13 +115,32 @@ public:
 	BOOL parseXml(LLXmlTreeNode* node);
 	S32 getNumBones() const { return mNumBones; }
 	S32 getNumCollisionVolumes() const { return mNumCollisionVolumes; }
+
+	// flatten the bone tree into mBoneSetups
+	void buildBoneSetups();
 	
 private:
+	void addBoneSetup(const LLAvatarBoneInfo* info, S32 parent, S32& joint_num, S32& volume_num);
+
 	S32 mNumBones;
 	S32 mNumCollisionVolumes;
     LLAvatarAppearance::joint_alias_map_t mJointAliasMap;
 	typedef std::vector<LLAvatarBoneInfo*> bone_info_list_t;
 	bone_info_list_t mBoneInfoList;
+
+	// A bone as buildSkeleton() sets it up for every avatar, parents before
+	// children, with joints and collision volumes numbered in that order.
+	struct BoneSetup
+	{
+		const LLAvatarBoneInfo* mInfo;
+		// index of the parent's setup, -1 for none
+		S32 mParent;
+		// joint number, or collision volume number
+		S32 mIndex;
+		LLQuaternion mRot;
+	};
+	typedef std::vector<BoneSetup> bone_setup_list_t;
+	bone_setup_list_t mBoneSetups;
 };
 
 //-----------------------------------------------------------------------------
@@ -331,7 +361,7 @@ void LLAvatarAppearance::initClass(const std::string& avatar_file_name_arg, cons
         avatar_file_name = gDirUtilp->getExpandedFilename(LL_PATH_CHARACTER,AVATAR_DEFAULT_CHAR + "_lad.xml");
     }
 	LLXmlTree xml_tree;
-	BOOL success = xml_tree.parseFile( avatar_file_name, FALSE );
+	BOOL success = xml_tree.parseFileCached( avatar_file_name, character_cache_path(avatar_file_name), FALSE );
 	if (!success)
 	{
 		LL_ERRS() << "Problem reading avatar configuration file:" << avatar_file_name << LL_ENDL;
@@ -434,6 +464,29 @@ void LLAvatarAppearance::initClass(const std::string& avatar_file_name_arg, cons
 	{
 		LL_ERRS() << "Error parsing skeleton node in avatar XML file: " << skeleton_path << LL_ENDL;
 	}
+
+	// every avatar builds its skeleton from these
+	sAvatarSkeletonInfo->buildBoneSetups();
+
+	for (LLAvatarBoneInfo* bone_info : sAvatarSkeletonInfo->mBoneInfoList)
+	{
+		makeJointAliases(bone_info, sAvatarSkeletonInfo->mJointAliasMap);
+	}
+
+	for (LLAvatarXmlInfo::LLAvatarAttachmentInfo* info : sAvatarXmlInfo->mAttachmentInfoList)
+	{
+		std::string bone_name = info->mName;
+
+		// Also accept the name with spaces substituted with
+		// underscores. This gives a mechanism for referencing such joints
+		// in daes, which don't allow spaces.
+		std::string sub_space_to_underscore = bone_name;
+		LLStringUtil::replaceChar(sub_space_to_underscore, ' ', '_');
+		if (sub_space_to_underscore != bone_name)
+		{
+			sAvatarSkeletonInfo->mJointAliasMap[sub_space_to_underscore] = bone_name;
+		}
+	}
 }
 
 void LLAvatarAppearance::cleanupClass()
@@ -566,7 +619,7 @@ BOOL LLAvatarAppearance::parseSkeletonFile(const std::string& filename, LLXmlTre
 	//-------------------------------------------------------------------------
 	// parse the file
 	//-------------------------------------------------------------------------
-	BOOL parsesuccess = skeleton_xml_tree.parseFile( filename, FALSE );
+	BOOL parsesuccess = skeleton_xml_tree.parseFileCached( filename, character_cache_path(filename), FALSE );
 
 	if (!parsesuccess)
 	{
@@ -599,81 +652,6 @@ BOOL LLAvatarAppearance::parseSkeletonFile(const std::string& filename, LLXmlTre
 	return TRUE;
 }
 
-//-----------------------------------------------------------------------------
-// setupBone()
-//-----------------------------------------------------------------------------
-BOOL LLAvatarAppearance::setupBone(const LLAvatarBoneInfo* info, LLJoint* parent, S32 &volume_num, S32 &joint_num)
-{
-	LLJoint* joint = NULL;
-
-    LL_DEBUGS("BVH") << "bone info: name " << info->mName
-                     << " isJoint " << info->mIsJoint
-                     << " volume_num " << volume_num
-                     << " joint_num " << joint_num
-                     << LL_ENDL;
-
-	if (info->mIsJoint)
-	{
-		joint = getCharacterJoint(joint_num);
-		if (!joint)
-		{
-			LL_WARNS() << "Too many bones" << LL_ENDL;
-			return FALSE;
-		}
-		joint->setName( info->mName );
-	}
-	else // collision volume
-	{
-		if (volume_num >= (S32)mNumCollisionVolumes)
-		{
-			LL_WARNS() << "Too many collision volumes" << LL_ENDL;
-			return FALSE;
-		}
-		joint = (&mCollisionVolumes[volume_num]);
-		joint->setName( info->mName );
-	}
-
-	// add to parent
-	if (parent && (joint->getParent()!=parent))
-	{
-		parent->addChild( joint );
-	}
-
-	// SL-315
-	joint->setPosition(info->mPos);
-    joint->setDefaultPosition(info->mPos);
-	joint->setRotation(mayaQ(info->mRot.mV[VX], info->mRot.mV[VY],
-							 info->mRot.mV[VZ], LLQuaternion::XYZ));
-	joint->setScale(info->mScale);
-	joint->setDefaultScale(info->mScale);
-    joint->setSupport(info->mSupport);
-	joint->setEnd(info->mEnd);
-
-	if (info->mIsJoint)
-	{
-		joint->setSkinOffset( info->mPivot );
-        joint->setJointNum(joint_num);
-		joint_num++;
-	}
-	else // collision volume
-	{
-        joint->setJointNum(mNumBones+volume_num);
-		volume_num++;
-	}
-
-
-	// setup children
-	for (LLAvatarBoneInfo* child_info : info->mChildren)
-	{
-		if (!setupBone(child_info, joint, volume_num, joint_num))
-		{
-			return FALSE;
-		}
-	}
-
-	return TRUE;
-}
-
 //-----------------------------------------------------------------------------
 // allocateCharacterJoints()
 //-----------------------------------------------------------------------------
@@ -714,15 +692,71 @@ BOOL LLAvatarAppearance::buildSkeleton(const LLAvatarSkeletonInfo *info)
 		}
 	}
 
-	S32 current_joint_num = 0;
-	S32 current_volume_num = 0;
-	for (LLAvatarBoneInfo* bone_info : info->mBoneInfoList)
+	// joints set up so far, by setup
+	std::vector<LLJoint*> joints(info->mBoneSetups.size(), NULL);
+
+	for (U32 i = 0; i < info->mBoneSetups.size(); ++i)
 	{
-		if (!setupBone(bone_info, NULL, current_volume_num, current_joint_num))
+		const LLAvatarSkeletonInfo::BoneSetup& setup = info->mBoneSetups[i];
+		const LLAvatarBoneInfo* bone_info = setup.mInfo;
+
+		LL_DEBUGS("BVH") << "bone info: name " << bone_info->mName
+						 << " isJoint " << bone_info->mIsJoint
+						 << " index " << setup.mIndex
+						 << LL_ENDL;
+
+		LLJoint* joint = NULL;
+		if (bone_info->mIsJoint)
+		{
+			joint = getCharacterJoint(setup.mIndex);
+			if (!joint)
+			{
+				LL_WARNS() << "Too many bones" << LL_ENDL;
+			}
+		}
+		else if (setup.mIndex < (S32)mNumCollisionVolumes)
+		{
+			joint = &mCollisionVolumes[setup.mIndex];
+		}
+		else
+		{
+			LL_WARNS() << "Too many collision volumes" << LL_ENDL;
+		}
+
+		if (!joint)
 		{
 			LL_ERRS() << "Error parsing bone in skeleton file" << LL_ENDL;
 			return FALSE;
 		}
+		joint->setName( bone_info->mName );
+
+		// add to parent
+		LLJoint* parent = setup.mParent >= 0 ? joints[setup.mParent] : NULL;
+		if (parent && (joint->getParent()!=parent))
+		{
+			parent->addChild( joint );
+		}
+
+		// SL-315
+		joint->setPosition(bone_info->mPos);
+		joint->setDefaultPosition(bone_info->mPos);
+		joint->setRotation(setup.mRot);
+		joint->setScale(bone_info->mScale);
+		joint->setDefaultScale(bone_info->mScale);
+		joint->setSupport(bone_info->mSupport);
+		joint->setEnd(bone_info->mEnd);
+
+		if (bone_info->mIsJoint)
+		{
+			joint->setSkinOffset( bone_info->mPivot );
+			joint->setJointNum(setup.mIndex);
+		}
+		else // collision volume
+		{
+			joint->setJointNum(mNumBones+setup.mIndex);
+		}
+
+		joints[i] = joint;
 	}
 
 	return TRUE;
@@ -897,9 +931,6 @@ BOOL LLAvatarAppearance::loadAvatar()
 		return FALSE;
 	}
 
-	// initialize mJointAliasMap
-	getJointAliases();
-
 	// avatar_lad.xml : <skeleton>
 	if( !loadSkeletonNode() )
 	{
@@ -1351,6 +1382,26 @@ BOOL LLAvatarAppearance::isValid() const
 	return TRUE;
 }
 
+void LLAvatarAppearance::beginDeferredMorphs()
+{
+	for (polymesh_map_t::value_type& mesh_pair : mPolyMeshes)
+	{
+		mesh_pair.second->setDeferMorphs(true);
+	}
+}
+
+void LLAvatarAppearance::endDeferredMorphs(std::vector<LLPolyMesh*>& meshes)
+{
+	for (polymesh_map_t::value_type& mesh_pair : mPolyMeshes)
+	{
+		LLPolyMesh* mesh = mesh_pair.second;
+		mesh->setDeferMorphs(false);
+		if (mesh->hasDeferredMorphs())
+		{
+			meshes.push_back(mesh);
+		}
+	}
+}
 
 // adds a morph mask to the appropriate baked texture structure
 void LLAvatarAppearance::addMaskedMorph(EBakedTextureIndex index, LLVisualParam* morph_target, BOOL invert, std::string layer)
@@ -1666,8 +1717,42 @@ BOOL LLAvatarSkeletonInfo::parseXml(LLXmlTreeNode* node)
 	return TRUE;
 }
 
+//-----------------------------------------------------------------------------
+// LLAvatarSkeletonInfo::buildBoneSetups()
+//-----------------------------------------------------------------------------
+void LLAvatarSkeletonInfo::buildBoneSetups()
+{
+	mBoneSetups.clear();
+
+	S32 joint_num = 0;
+	S32 volume_num = 0;
+	for (LLAvatarBoneInfo* bone_info : mBoneInfoList)
+	{
+		addBoneSetup(bone_info, -1, joint_num, volume_num);
+	}
+}
+
+void LLAvatarSkeletonInfo::addBoneSetup(const LLAvatarBoneInfo* info, S32 parent, S32& joint_num, S32& volume_num)
+{
+	BoneSetup setup;
+	setup.mInfo = info;
+	setup.mParent = parent;
+	setup.mIndex = info->mIsJoint ? joint_num++ : volume_num++;
+	setup.mRot = mayaQ(info->mRot.mV[VX], info->mRot.mV[VY],
+					   info->mRot.mV[VZ], LLQuaternion::XYZ);
+
+	S32 index = (S32)mBoneSetups.size();
+	mBoneSetups.push_back(setup);
+
+	for (LLAvatarBoneInfo* child_info : info->mChildren)
+	{
+		addBoneSetup(child_info, index, joint_num, volume_num);
+	}
+}
+
 //Make aliases for joint and push to map.
-void LLAvatarAppearance::makeJointAliases(LLAvatarBoneInfo *bone_info)
+//static
+void LLAvatarAppearance::makeJointAliases(LLAvatarBoneInfo *bone_info, joint_alias_map_t& alias_map)
 {
     if (! bone_info->mIsJoint )
     {
@@ -1675,7 +1760,7 @@ void LLAvatarAppearance::makeJointAliases(LLAvatarBoneInfo *bone_info)
     }
     
     std::string bone_name = bone_info->mName;
-    mJointAliasMap[bone_name] = bone_name; //Actual name is a valid alias.
+    alias_map[bone_name] = bone_name; //Actual name is a valid alias.
     
     std::string aliases = bone_info->mAliases;
     
@@ -1683,48 +1768,22 @@ void LLAvatarAppearance::makeJointAliases(LLAvatarBoneInfo *bone_info)
     boost::tokenizer<boost::char_separator<char> > tok(aliases, sep);
     for(const std::string& i : tok)
     {
-        if ( mJointAliasMap.find(i) != mJointAliasMap.end() )
+        if ( alias_map.find(i) != alias_map.end() )
         {
-            LL_WARNS() << "avatar skeleton:  Joint alias \"" << i << "\" remapped from " << mJointAliasMap[i] << " to " << bone_name << LL_ENDL;
+            LL_WARNS() << "avatar skeleton:  Joint alias \"" << i << "\" remapped from " << alias_map[i] << " to " << bone_name << LL_ENDL;
         }
-        mJointAliasMap[i] = bone_name;
+        alias_map[i] = bone_name;
     }
 
     for (LLAvatarBoneInfo* bone : bone_info->mChildren)
     {
-        makeJointAliases(bone);
+        makeJointAliases(bone, alias_map);
     }
 }
 
 const LLAvatarAppearance::joint_alias_map_t& LLAvatarAppearance::getJointAliases ()
 {
-    LLAvatarAppearance::joint_alias_map_t alias_map;
-    if (mJointAliasMap.empty())
-    {
-        
-        for (LLAvatarBoneInfo* bone_info : sAvatarSkeletonInfo->mBoneInfoList)
-        {
-            //LLAvatarBoneInfo *bone_info = *iter;
-            makeJointAliases(bone_info);
-        }
-
-        for (LLAvatarXmlInfo::LLAvatarAttachmentInfo* info : sAvatarXmlInfo->mAttachmentInfoList)
-        {
-            std::string bone_name = info->mName;
-            
-            // Also accept the name with spaces substituted with
-            // underscores. This gives a mechanism for referencing such joints
-            // in daes, which don't allow spaces.
-            std::string sub_space_to_underscore = bone_name;
-            LLStringUtil::replaceChar(sub_space_to_underscore, ' ', '_');
-            if (sub_space_to_underscore != bone_name)
-            {
-                mJointAliasMap[sub_space_to_underscore] = bone_name;
-            }
-        }
-    }
-
-    return mJointAliasMap;
+    return sAvatarSkeletonInfo->mJointAliasMap;
 } 
 
 
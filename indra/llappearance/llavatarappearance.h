@@ -128,7 +128,6 @@ protected:
 	virtual LLAvatarJoint*	createAvatarJoint() = 0;
     virtual LLAvatarJoint*  createAvatarJoint(S32 joint_num) = 0;
 	virtual LLAvatarJointMesh*	createAvatarJointMesh() = 0;
-    void makeJointAliases(LLAvatarBoneInfo *bone_info);
 
 
 public:
@@ -152,15 +151,16 @@ public:
 	typedef std::vector<LLAvatarJoint*> avatar_joint_list_t;
     const avatar_joint_list_t& getSkeleton() { return mSkeleton; }
     typedef std::map<std::string, std::string> joint_alias_map_t;
+    // the same for every avatar, built once by initClass()
     const joint_alias_map_t& getJointAliases();
 
 
 protected:
 	static BOOL			parseSkeletonFile(const std::string& filename, LLXmlTree& skeleton_xml_tree);
+	static void			makeJointAliases(LLAvatarBoneInfo *bone_info, joint_alias_map_t& alias_map);
 	virtual void		buildCharacter();
 	virtual BOOL		loadAvatar();
 
-	BOOL				setupBone(const LLAvatarBoneInfo* info, LLJoint* parent, S32 &current_volume_num, S32 &current_joint_num);
 	BOOL				allocateCharacterJoints(U32 num);
 	BOOL				buildSkeleton(const LLAvatarSkeletonInfo *info);
 
@@ -168,7 +168,6 @@ protected:
 	BOOL				mIsBuilt; // state of deferred character building
 	avatar_joint_list_t	mSkeleton;
 	LLVector3OverrideMap	mPelvisFixups;
-    joint_alias_map_t   mJointAliasMap;
 
 	//--------------------------------------------------------------------
 	// Pelvis height adjustment members.
@@ -253,6 +252,13 @@ public:
 	virtual void	updateMeshTextures() = 0;
 	virtual void	dirtyMesh() = 0; // Dirty the avatar mesh
 	static const LLAvatarAppearanceDefines::LLAvatarAppearanceDictionary *getDictionary() { return sAvatarDictionary; }
+
+	// Morphs applied between these two calls queue their vertex changes on
+	// their meshes (see LLPolyMesh::deferMorph()).  endDeferredMorphs()
+	// returns the meshes that have some, to be applied with
+	// LLPolyMesh::applyDeferredMorphs(), one mesh per thread at most.
+	void			beginDeferredMorphs();
+	void			endDeferredMorphs(std::vector<LLPolyMesh*>& meshes);
 protected:
 	virtual void	dirtyMesh(S32 priority) = 0; // Dirty the avatar mesh, with priority
 
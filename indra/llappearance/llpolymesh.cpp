@@ -757,6 +757,7 @@ LLPolyMesh::LLPolyMesh(LLPolyMeshSharedData *shared_data, LLPolyMesh *reference_
 	mReferenceMesh = reference_mesh;
 	mAvatarp = NULL;
 	mVertexData = NULL;
+	mDeferMorphs = false;
 
 	mCurVertexCount = 0;
 	mFaceIndexCount = 0;
@@ -913,6 +914,28 @@ void LLPolyMesh::dumpDiagInfo()
         LL_INFOS() << "-----------------------------------------------------" << LL_ENDL;
 }
 
+//-----------------------------------------------------------------------------
+// deferMorph()
+//-----------------------------------------------------------------------------
+void LLPolyMesh::deferMorph(LLPolyMorphTarget* morph, F32 delta_weight)
+{
+	mDeferredMorphs.push_back(std::make_pair(morph, delta_weight));
+}
+
+//-----------------------------------------------------------------------------
+// applyDeferredMorphs()
+//-----------------------------------------------------------------------------
+void LLPolyMesh::applyDeferredMorphs()
+{
+	LL_PROFILE_ZONE_SCOPED;
+
+	for (deferred_morph_list_t::value_type& morph : mDeferredMorphs)
+	{
+		morph.first->applyVertexChanges(morph.second);
+	}
+	mDeferredMorphs.clear();
+}
+
 //-----------------------------------------------------------------------------
 // getWritableCoords()
 //-----------------------------------------------------------------------------
@@ -318,6 +318,17 @@ public:
 
 	BOOL	isLOD() { return mSharedData && mSharedData->isLOD(); }
 
+	// While morphs are deferred, LLPolyMorphTarget::apply() queues the
+	// vertex changes of its morph here instead of making them, and
+	// applyDeferredMorphs() makes them later in the order they were queued.
+	// They touch only this mesh, so meshes can be morphed on different
+	// threads.
+	void	setDeferMorphs(bool defer) { mDeferMorphs = defer; }
+	bool	getDeferMorphs() const { return mDeferMorphs; }
+	void	deferMorph(LLPolyMorphTarget* morph, F32 delta_weight);
+	bool	hasDeferredMorphs() const { return !mDeferredMorphs.empty(); }
+	void	applyDeferredMorphs();
+
 	void setAvatar(LLAvatarAppearance* avatarp) { mAvatarp = avatarp; }
 	LLAvatarAppearance* getAvatar() { return mAvatarp; }
 
@@ -356,6 +367,10 @@ protected:
 	
 	LLPolyMesh				*mReferenceMesh;
 
+	bool					mDeferMorphs;
+	typedef std::vector<std::pair<LLPolyMorphTarget*, F32> > deferred_morph_list_t;
+	deferred_morph_list_t	mDeferredMorphs;
+
 	// global mesh list
 	typedef std::map<std::string, LLPolyMeshSharedData*> LLPolyMeshSharedDataTable; 
 	static LLPolyMeshSharedDataTable sGlobalSharedMeshList;
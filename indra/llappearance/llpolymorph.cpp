@@ -256,7 +256,9 @@ void LLPolyMorphData::freeData()
 // LLPolyMorphTargetInfo()
 //-----------------------------------------------------------------------------
 LLPolyMorphTargetInfo::LLPolyMorphTargetInfo()
-	: mIsClothingMorph(FALSE)
+	: mIsClothingMorph(FALSE),
+	  mResolvedMesh(NULL),
+	  mResolvedMorphData(NULL)
 {
 }
 
@@ -363,37 +365,62 @@ BOOL LLPolyMorphTarget::setInfo(LLPolyMorphTargetInfo* info)
 	setWeight(getDefaultWeight());
 
 	LLAvatarAppearance* avatarp = mMesh->getAvatar();
-	for (LLPolyVolumeMorphInfo& volume_info : getInfo()->mVolumeInfoList)
+	LLPolyMorphTargetInfo* morph_info = getInfo();
+
+	// every avatar has the same meshes and skeleton, only look things up for
+	// the first one
+	if (morph_info->mResolvedMesh != mMesh->getSharedData())
 	{
-		for (S32 i = 0; i < avatarp->mNumCollisionVolumes; i++)
+		morph_info->mResolvedVolumes.clear();
+		for (LLPolyVolumeMorphInfo& volume_info : morph_info->mVolumeInfoList)
 		{
-			if (avatarp->mCollisionVolumes[i].getName() == volume_info.mName)
+			S32 volume = -1;
+			for (S32 i = 0; i < avatarp->mNumCollisionVolumes; i++)
 			{
-				mVolumeMorphs.push_back(
-					LLPolyVolumeMorph(&avatarp->mCollisionVolumes[i],
-														  volume_info.mScale,
-														  volume_info.mPos));
-				break;
+				if (avatarp->mCollisionVolumes[i].getName() == volume_info.mName)
+				{
+					volume = i;
+					break;
+				}
 			}
+			morph_info->mResolvedVolumes.push_back(volume);
 		}
+
+		std::string morph_param_name = morph_info->mMorphName;
+
+		LLPolyMorphData* morph_data = mMesh->getMorphData(morph_param_name);
+		if (!morph_data)
+		{
+			const std::string driven_tag = "_Driven";
+			U32 pos = morph_param_name.find(driven_tag);
+			if (pos > 0)
+			{
+				morph_param_name = morph_param_name.substr(0,pos);
+				morph_data = mMesh->getMorphData(morph_param_name);
+			}
+		}
+
+		morph_info->mResolvedMorphData = morph_data;
+		morph_info->mResolvedMesh = mMesh->getSharedData();
 	}
 
-	std::string morph_param_name = getInfo()->mMorphName;
-	
-	mMorphData = mMesh->getMorphData(morph_param_name);
-	if (!mMorphData)
+	for (U32 i = 0; i < morph_info->mVolumeInfoList.size(); i++)
 	{
-		const std::string driven_tag = "_Driven";
-		U32 pos = morph_param_name.find(driven_tag);
-		if (pos > 0)
+		S32 volume = morph_info->mResolvedVolumes[i];
+		if (volume >= 0 && volume < avatarp->mNumCollisionVolumes)
 		{
-			morph_param_name = morph_param_name.substr(0,pos);
-			mMorphData = mMesh->getMorphData(morph_param_name);
+			LLPolyVolumeMorphInfo& volume_info = morph_info->mVolumeInfoList[i];
+			mVolumeMorphs.push_back(
+				LLPolyVolumeMorph(&avatarp->mCollisionVolumes[volume],
+													  volume_info.mScale,
+													  volume_info.mPos));
 		}
 	}
+
+	mMorphData = morph_info->mResolvedMorphData;
 	if (!mMorphData)
 	{
-		LL_WARNS() << "No morph target named " << morph_param_name << " found in mesh." << LL_ENDL;
+		LL_WARNS() << "No morph target named " << morph_info->mMorphName << " found in mesh." << LL_ENDL;
 		return FALSE;  // Continue, ignoring this tag
 	}
 	return TRUE;
@@ -568,91 +595,109 @@ void LLPolyMorphTarget::apply( ESex avatar_sex )
 	if (delta_weight != 0.f)
 	{
 		llassert(!mMesh->isLOD());
-		LLVector4a *coords = mMesh->getWritableCoords();
-
-		LLVector4a *scaled_normals = mMesh->getScaledNormals();
-		LLVector4a *normals = mMesh->getWritableNormals();
+		if (mMesh->getDeferMorphs())
+		{
+			mMesh->deferMorph(this, delta_weight);
+		}
+		else
+		{
+			applyVertexChanges(delta_weight);
+		}
 
-		LLVector4a *scaled_binormals = mMesh->getScaledBinormals();
-		LLVector4a *binormals = mMesh->getWritableBinormals();
+		applyVolumeChanges(delta_weight);
+	}
 
-		LLVector4a *clothing_weights = mMesh->getWritableClothingWeights();
-		LLVector2 *tex_coords = mMesh->getWritableTexCoords();
+	if (mNext)
+	{
+		mNext->apply(avatar_sex);
+	}
+}
 
-		F32 *maskWeightArray = (mVertMask) ? mVertMask->getMorphMaskWeights() : NULL;
+//-----------------------------------------------------------------------------
+// applyVertexChanges()
+//-----------------------------------------------------------------------------
+void LLPolyMorphTarget::applyVertexChanges(F32 delta_weight)
+{
+	LL_PROFILE_ZONE_SCOPED;
 
-		for(U32 vert_index_morph = 0; vert_index_morph < mMorphData->mNumIndices; vert_index_morph++)
-		{
-			S32 vert_index_mesh = mMorphData->mVertexIndices[vert_index_morph];
+	LLVector4a *coords = mMesh->getWritableCoords();
 
-			F32 maskWeight = 1.f;
-			if (maskWeightArray)
-			{
-				maskWeight = maskWeightArray[vert_index_morph];
-			}
+	LLVector4a *scaled_normals = mMesh->getScaledNormals();
+	LLVector4a *normals = mMesh->getWritableNormals();
 
+	LLVector4a *scaled_binormals = mMesh->getScaledBinormals();
+	LLVector4a *binormals = mMesh->getWritableBinormals();
 
-			LLVector4a pos = mMorphData->mCoords[vert_index_morph];
-			pos.mul(delta_weight*maskWeight);
-			coords[vert_index_mesh].add(pos);
+	LLVector4a *clothing_weights = getInfo()->mIsClothingMorph ? mMesh->getWritableClothingWeights() : NULL;
+	LLVector2 *tex_coords = mMesh->getWritableTexCoords();
 
-			if (getInfo()->mIsClothingMorph && clothing_weights)
-			{
-				LLVector4a clothing_offset = mMorphData->mCoords[vert_index_morph];
-				clothing_offset.mul(delta_weight * maskWeight);
-				LLVector4a* clothing_weight = &clothing_weights[vert_index_mesh];
-				clothing_weight->add(clothing_offset);
-				clothing_weight->getF32ptr()[VW] = maskWeight;
-			}
+	const F32 *mask_weights = (mVertMask) ? mVertMask->getMorphMaskWeights() : NULL;
 
-			// calculate new normals based on half angles
-			LLVector4a norm = mMorphData->mNormals[vert_index_morph];
-			norm.mul(delta_weight*maskWeight*NORMAL_SOFTEN_FACTOR);
-			scaled_normals[vert_index_mesh].add(norm);
-			norm = scaled_normals[vert_index_mesh];
+	const U32 *vertex_indices = mMorphData->mVertexIndices;
+	const LLVector4a *morph_coords = mMorphData->mCoords;
+	const LLVector4a *morph_normals = mMorphData->mNormals;
+	const LLVector4a *morph_binormals = mMorphData->mBinormals;
+	const LLVector2 *morph_tex_coords = mMorphData->mTexCoords;
 
-			// guard against degenerate input data before we create NaNs below!
-			//
-			norm.normalize3fast();
-			normals[vert_index_mesh] = norm;
+	LLVector4a weight;
+	weight.splat(delta_weight);
+	LLVector4a soft_weight;
+	soft_weight.splat(delta_weight * NORMAL_SOFTEN_FACTOR);
+	F32 mask_weight = 1.f;
 
-			// calculate new binormals
-			LLVector4a binorm = mMorphData->mBinormals[vert_index_morph];
+	const U32 num_indices = mMorphData->mNumIndices;
+	for (U32 i = 0; i < num_indices; ++i)
+	{
+		U32 v = vertex_indices[i];
 
-			// guard against degenerate input data before we create NaNs below!
-			//
-			if (!binorm.isFinite3() || (binorm.dot3(binorm).getF32() <= F_APPROXIMATELY_ZERO))
-			{
-				binorm.set(1,0,0,1);
-			}
+		if (mask_weights)
+		{
+			mask_weight = mask_weights[i];
+			weight.splat(delta_weight * mask_weight);
+			soft_weight.splat(delta_weight * mask_weight * NORMAL_SOFTEN_FACTOR);
+		}
 
-			binorm.mul(delta_weight*maskWeight*NORMAL_SOFTEN_FACTOR);
-			scaled_binormals[vert_index_mesh].add(binorm);
-			LLVector4a tangent;
-			tangent.setCross3(scaled_binormals[vert_index_mesh], norm);
-			LLVector4a& normalized_binormal = binormals[vert_index_mesh];
+		LLVector4a pos;
+		pos.setMul(morph_coords[i], weight);
+		coords[v].add(pos);
 
-			normalized_binormal.setCross3(norm, tangent); 
-			normalized_binormal.normalize3fast();
-			
-			tex_coords[vert_index_mesh] += mMorphData->mTexCoords[vert_index_morph] * delta_weight * maskWeight;
+		if (clothing_weights)
+		{
+			clothing_weights[v].add(pos);
+			clothing_weights[v].getF32ptr()[VW] = mask_weight;
 		}
 
-		// now apply volume changes
-		for(LLPolyVolumeMorph& volume_morph : mVolumeMorphs)
+		// calculate new normals based on half angles
+		LLVector4a norm;
+		norm.setMul(morph_normals[i], soft_weight);
+		scaled_normals[v].add(norm);
+		norm = scaled_normals[v];
+
+		// guard against degenerate input data before we create NaNs below!
+		//
+		norm.normalize3fast();
+		normals[v] = norm;
+
+		// calculate new binormals
+		LLVector4a binorm = morph_binormals[i];
+
+		// guard against degenerate input data before we create NaNs below!
+		//
+		if (!binorm.isFinite3() || (binorm.dot3(binorm).getF32() <= F_APPROXIMATELY_ZERO))
 		{
-			LLVector3 scale_delta = volume_morph.mScale * delta_weight;
-			LLVector3 pos_delta = volume_morph.mPos * delta_weight;
-			
-			volume_morph.mVolume->setScale(volume_morph.mVolume->getScale() + scale_delta);
-            // SL-315
-			volume_morph.mVolume->setPosition(volume_morph.mVolume->getPosition() + pos_delta);
+			binorm.set(1,0,0,1);
 		}
-	}
 
-	if (mNext)
-	{
-		mNext->apply(avatar_sex);
+		binorm.mul(soft_weight);
+		scaled_binormals[v].add(binorm);
+		LLVector4a tangent;
+		tangent.setCross3(scaled_binormals[v], norm);
+		LLVector4a& normalized_binormal = binormals[v];
+
+		normalized_binormal.setCross3(norm, tangent);
+		normalized_binormal.normalize3fast();
+
+		tex_coords[v] += morph_tex_coords[i] * (delta_weight * mask_weight);
 	}
 }
 
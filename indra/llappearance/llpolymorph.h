@@ -136,6 +136,13 @@ protected:
 	BOOL			mIsClothingMorph;
 	typedef std::vector<LLPolyVolumeMorphInfo> volume_info_list_t;
 	volume_info_list_t mVolumeInfoList;	
+
+	// What LLPolyMorphTarget::setInfo() looked up by name for the first
+	// avatar, for the others to reuse: the morph data in the mesh, and the
+	// index of the collision volume of each volume morph, -1 if none.
+	LLPolyMeshSharedData*	mResolvedMesh;
+	LLPolyMorphData*		mResolvedMorphData;
+	std::vector<S32>		mResolvedVolumes;
 };
 
 //-----------------------------------------------------------------------------
@@ -174,6 +181,9 @@ public:
 	void	addPendingMorphMask() { mNumMorphMasksPending++; }
 
     void    applyVolumeChanges(F32 delta_weight); // SL-315 - for resetSkeleton()
+    // moves the mesh vertices by delta_weight of the morph; touches no
+    // other mesh or joint, see LLPolyMesh::deferMorph()
+    void    applyVertexChanges(F32 delta_weight);
 
 protected:
 	LLPolyMorphTarget(const LLPolyMorphTarget& pOther);
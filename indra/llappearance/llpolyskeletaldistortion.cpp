@@ -38,10 +38,33 @@
 
 #include "llpolyskeletaldistortion.h"
 
+namespace
+{
+	// joint_num as LLJoint::getJointNum() numbers them: bones, then
+	// collision volumes
+	LLJoint* get_joint_by_num(LLAvatarAppearance* avatar, S32 joint_num)
+	{
+		if (joint_num < 0)
+		{
+			return NULL;
+		}
+		if (joint_num < avatar->mNumBones)
+		{
+			return avatar->getCharacterJoint(joint_num);
+		}
+		if (joint_num < avatar->mNumBones + avatar->mNumCollisionVolumes)
+		{
+			return &avatar->mCollisionVolumes[joint_num - avatar->mNumBones];
+		}
+		return NULL;
+	}
+}
+
 //-----------------------------------------------------------------------------
 // LLPolySkeletalDistortionInfo()
 //-----------------------------------------------------------------------------
 LLPolySkeletalDistortionInfo::LLPolySkeletalDistortionInfo()
+	: mResolved(FALSE)
 {
 }
 
@@ -143,7 +166,54 @@ BOOL LLPolySkeletalDistortion::setInfo(LLPolySkeletalDistortionInfo *info)
     mID = info->mID;
     setWeight(getDefaultWeight());
 
-    for (LLPolySkeletalBoneInfo& bone_info : getInfo()->mBoneInfoList)
+    // every avatar has the same skeleton, only look the joints up by name
+    // for the first one
+    if (!info->mResolved)
+    {
+        return resolveJoints(info);
+    }
+
+    for (U32 i = 0; i < info->mBoneInfoList.size(); ++i)
+    {
+        const LLPolySkeletalBoneInfo& bone_info = info->mBoneInfoList[i];
+        const LLPolySkeletalDistortionInfo::ResolvedBone& resolved = info->mResolvedBones[i];
+
+        LLJoint* joint = get_joint_by_num(mAvatar, resolved.mJoint);
+        if (!joint)
+        {
+            LL_WARNS() << "Joint " << bone_info.mBoneName << " not found." << LL_ENDL;
+            return FALSE;
+        }
+
+        mJointScales[joint] = bone_info.mScaleDeformation;
+
+        for (S32 child_num : resolved.mScaleChildren)
+        {
+            LLJoint* child_joint = get_joint_by_num(mAvatar, child_num);
+            if (child_joint)
+            {
+                LLVector3 childDeformation = LLVector3(child_joint->getScale());
+                childDeformation.scaleVec(bone_info.mScaleDeformation);
+                mJointScales[child_joint] = childDeformation;
+            }
+        }
+
+        if (bone_info.mHasPositionDeformation)
+        {
+            mJointOffsets[joint] = bone_info.mPositionDeformation;
+        }
+    }
+    return TRUE;
+}
+
+// Sets up from the joint names and records the joint numbers in info, if
+// every joint has one to be found by again.
+BOOL LLPolySkeletalDistortion::resolveJoints(LLPolySkeletalDistortionInfo* info)
+{
+    std::vector<LLPolySkeletalDistortionInfo::ResolvedBone> resolved_bones;
+    bool resolved = true;
+
+    for (LLPolySkeletalBoneInfo& bone_info : info->mBoneInfoList)
     {
         LLJoint* joint = mAvatar->getJoint(bone_info.mBoneName);
         if (!joint)
@@ -157,6 +227,10 @@ BOOL LLPolySkeletalDistortion::setInfo(LLPolySkeletalDistortionInfo *info)
         // store it
         mJointScales[joint] = bone_info.mScaleDeformation;
 
+        LLPolySkeletalDistortionInfo::ResolvedBone resolved_bone;
+        resolved_bone.mJoint = joint->getJointNum();
+        resolved = resolved && get_joint_by_num(mAvatar, resolved_bone.mJoint) == joint;
+
         // apply to children that need to inherit it
         for (LLJoint* joint : joint->mChildren)
         {
@@ -166,6 +240,9 @@ BOOL LLPolySkeletalDistortion::setInfo(LLPolySkeletalDistortionInfo *info)
                 LLVector3 childDeformation = LLVector3(child_joint->getScale());
                 childDeformation.scaleVec(bone_info.mScaleDeformation);
                 mJointScales[child_joint] = childDeformation;
+
+                resolved_bone.mScaleChildren.push_back(child_joint->getJointNum());
+                resolved = resolved && get_joint_by_num(mAvatar, child_joint->getJointNum()) == child_joint;
             }
         }
 
@@ -173,6 +250,14 @@ BOOL LLPolySkeletalDistortion::setInfo(LLPolySkeletalDistortionInfo *info)
         {
             mJointOffsets[joint] = bone_info.mPositionDeformation;
         }
+
+        resolved_bones.push_back(resolved_bone);
+    }
+
+    if (resolved)
+    {
+        info->mResolvedBones.swap(resolved_bones);
+        info->mResolved = TRUE;
     }
     return TRUE;
 }
@@ -190,6 +275,11 @@ void LLPolySkeletalDistortion::apply( ESex avatar_sex )
     LL_PROFILE_ZONE_SCOPED;
 
     F32 effective_weight = ( getSex() & avatar_sex ) ? mCurWeight : getDefaultWeight();
+    F32 delta_weight = effective_weight - mLastWeight;
+
+    // the context string is only ever read when debugging joints, don't
+    // format it for every joint otherwise
+    bool debug_joints = !LLJoint::s_debugJointNames.empty();
 
     LLJoint* joint;
 
@@ -198,18 +288,25 @@ void LLPolySkeletalDistortion::apply( ESex avatar_sex )
         joint = scale_pair.first;
         LLVector3 newScale = joint->getScale();
         LLVector3 scaleDelta = scale_pair.second;
-        LLVector3 offset = (effective_weight - mLastWeight) * scaleDelta;
+        LLVector3 offset = delta_weight * scaleDelta;
         newScale = newScale + offset;
         //An aspect of attached mesh objects (which contain joint offsets) that need to be cleaned up when detached
         // needed? 
         // joint->storeScaleForReset( newScale );				
 
-        // BENTO for detailed stack tracing of params.
-        std::stringstream ostr;
-        ostr << "LLPolySkeletalDistortion::apply, id " << getID() << " " << getName() << " effective wt " << effective_weight << " last wt " << mLastWeight << " scaleDelta " << scaleDelta << " offset " << offset;
-        LLScopedContextString str(ostr.str());
+        if (debug_joints)
+        {
+            // BENTO for detailed stack tracing of params.
+            std::stringstream ostr;
+            ostr << "LLPolySkeletalDistortion::apply, id " << getID() << " " << getName() << " effective wt " << effective_weight << " last wt " << mLastWeight << " scaleDelta " << scaleDelta << " offset " << offset;
+            LLScopedContextString str(ostr.str());
 
-        joint->setScale(newScale, true);
+            joint->setScale(newScale, true);
+        }
+        else
+        {
+            joint->setScale(newScale, true);
+        }
     }
 
     for (joint_vec_map_t::value_type& offset_pair : mJointOffsets)
@@ -76,6 +76,17 @@ public:
 protected:
 	typedef std::vector<LLPolySkeletalBoneInfo> bone_info_list_t;
 	bone_info_list_t mBoneInfoList;
+
+	// What LLPolySkeletalDistortion::setInfo() looked up by name for the
+	// first avatar, for the others to reuse: the joint number of each bone
+	// and of its children that inherit its scale.
+	struct ResolvedBone
+	{
+		S32					mJoint;
+		std::vector<S32>	mScaleChildren;
+	};
+	std::vector<ResolvedBone> mResolvedBones;
+	BOOL mResolved;
 };
 
 //-----------------------------------------------------------------------------
@@ -111,6 +122,9 @@ public:
 protected:
 	LLPolySkeletalDistortion(const LLPolySkeletalDistortion& pOther);
 
+	BOOL							resolveJoints(LLPolySkeletalDistortionInfo* info);
+	void							addBone(const LLPolySkeletalBoneInfo& bone_info, LLJoint* joint);
+
 	LL_ALIGN_16(LLVector4a mDefaultVec);
 	typedef std::map<LLJoint*, LLVector3> joint_vec_map_t;
 	joint_vec_map_t mJointScales;
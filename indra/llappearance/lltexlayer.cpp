@@ -33,6 +33,7 @@
 #include "llimagej2c.h"
 #include "llimagetga.h"
 #include "lldir.h"
+#include "lltexlayercomposite.h"
 #include "lltexlayerparams.h"
 #include "lltexturemanagerbridge.h"
 #include "lllocaltextureobject.h"
@@ -528,6 +529,111 @@ void LLTexLayerSet::renderAlphaMaskTextures(S32 x, S32 y, S32 width, S32 height,
 	gGL.setSceneBlendType(LLRender::BT_ALPHA);
 }
 
+BOOL LLTexLayerSet::recordComposite(LLTexLayerComposite& composite)
+{
+	BOOL success = TRUE;
+	mIsVisible = TRUE;
+
+	for (LLTexLayerInterface* layer : mMaskLayerList)
+	{
+		if (layer->isInvisibleAlphaMask())
+		{
+			mIsVisible = FALSE;
+		}
+	}
+
+	// same draws as render(), with the same state
+	composite.setMinimumAlpha(0.f);
+	composite.setColor(LLColor4(0.f, 0.f, 0.f, 1.f));
+	composite.draw(NULL);
+	composite.setMinimumAlpha(0.004f);
+
+	if (mIsVisible)
+	{
+		for (LLTexLayerInterface* layer : mLayerList)
+		{
+			if (layer->getRenderPass() == LLTexLayer::RP_COLOR)
+			{
+				success &= layer->recordComposite(composite);
+			}
+		}
+
+		recordAlphaMaskTextures(composite);
+	}
+	else
+	{
+		composite.setBlend(IMAGE_BLEND_ONE, IMAGE_BLEND_ZERO);
+		composite.setMinimumAlpha(0.f);
+		composite.setColor(LLColor4(0.f, 0.f, 0.f, 0.f));
+		composite.draw(NULL);
+		composite.setBlend(IMAGE_BLEND_SOURCE_ALPHA, IMAGE_BLEND_ONE_MINUS_SOURCE_ALPHA);
+		composite.setMinimumAlpha(0.004f);
+	}
+
+	return success;
+}
+
+void LLTexLayerSet::recordAlphaMaskTextures(LLTexLayerComposite& composite)
+{
+	const LLTexLayerSetInfo *info = getInfo();
+
+	composite.setAlphaOnly(true);
+	composite.setBlend(IMAGE_BLEND_ONE, IMAGE_BLEND_ZERO);
+
+	if (!info->mStaticAlphaFileName.empty())
+	{
+		LLImageRaw* image = LLTexLayerStaticImageList::getInstance()->getImageRaw(info->mStaticAlphaFileName);
+		if (image)
+		{
+			composite.draw(image, true);
+		}
+	}
+	else if (info->mClearAlpha || (mMaskLayerList.size() > 0))
+	{
+		composite.setMinimumAlpha(0.f);
+		composite.setColor(LLColor4(0.f, 0.f, 0.f, 1.f));
+		composite.draw(NULL);
+		composite.setMinimumAlpha(0.004f);
+	}
+
+	if (mMaskLayerList.size() > 0)
+	{
+		composite.setBlend(IMAGE_BLEND_DEST_ALPHA, IMAGE_BLEND_ZERO);
+		for (LLTexLayerInterface* layer : mMaskLayerList)
+		{
+			layer->recordAlphaTexture(composite);
+		}
+	}
+
+	composite.setAlphaOnly(false);
+	composite.setBlend(IMAGE_BLEND_SOURCE_ALPHA, IMAGE_BLEND_ONE_MINUS_SOURCE_ALPHA);
+}
+
+void LLTexLayerSet::applyCompositeMorphMasks(LLTexLayerComposite& composite)
+{
+	const S32 width = composite.getImage()->getWidth();
+	const S32 height = composite.getImage()->getHeight();
+
+	for (LLTexLayerComposite::MorphMask& morph_mask : composite.getMorphMasks())
+	{
+		LLTexLayer* layer = NULL;
+		for (LLTexLayerInterface* ours : mLayerList)
+		{
+			if (ours->ownsLayer(morph_mask.mLayer))
+			{
+				layer = morph_mask.mLayer;
+				break;
+			}
+		}
+
+		if (layer && layer->getMorphMaskCacheIndex() == morph_mask.mCacheIndex)
+		{
+			layer->setMorphMask(morph_mask.mCacheIndex, morph_mask.mData, width, height);
+			morph_mask.mData = NULL;
+		}
+	}
+}
+
 void LLTexLayerSet::applyMorphMask(U8* tex_data, S32 width, S32 height, S32 num_components)
 {
 	mAvatarAppearance->applyMorphMask(tex_data, width, height, num_components, mBakedTexIndex);
@@ -1180,7 +1286,216 @@ BOOL LLTexLayer::render(S32 x, S32 y, S32 width, S32 height, LLRenderTarget* bou
 	return success;
 }
 
-const U8*	LLTexLayer::getAlphaData() const
+BOOL LLTexLayer::recordComposite(LLTexLayerComposite& composite)
+{
+	// the draws render() makes, in the same order and with the same state
+	LLColor4 net_color;
+	BOOL color_specified = findNetColor(&net_color);
+	
+	if (mTexLayerSet->getAvatarAppearance()->mIsDummy)
+	{
+		color_specified = true;
+		net_color = LLAvatarAppearance::getDummyColor();
+	}
+
+	BOOL success = TRUE;
+	
+	if( is_approx_zero( net_color.mV[VW] ) )
+	{
+		return success;
+	}
+
+	BOOL alpha_mask_specified = FALSE;
+	if (!mParamAlphaList.empty())
+	{
+		recordMorphMasks(composite, net_color);
+		alpha_mask_specified = TRUE;
+		composite.setBlend(IMAGE_BLEND_DEST_ALPHA, IMAGE_BLEND_ONE_MINUS_DEST_ALPHA);
+	}
+
+	composite.setColor(net_color);
+
+	if( getInfo()->mWriteAllChannels )
+	{
+		composite.setBlend(IMAGE_BLEND_ONE, IMAGE_BLEND_ZERO);
+	}
+
+	if( (getInfo()->mLocalTexture != -1) && !getInfo()->mUseLocalTextureAlphaOnly )
+	{
+		LLGLTexture* tex = NULL;
+		if (mLocalTextureObject && mLocalTextureObject->getImage())
+		{
+			tex = mLocalTextureObject->getImage();
+			if (mLocalTextureObject->getID() == IMG_DEFAULT_AVATAR)
+			{
+				tex = NULL;
+			}
+		}
+		if( tex )
+		{
+			LLImageRaw* image = mTexLayerSet->getLocalTextureRaw(tex);
+			if (!image)
+			{
+				composite.setMissingSource();
+			}
+			else
+			{
+				bool no_alpha_test = getInfo()->mWriteAllChannels;
+				if (no_alpha_test)
+				{
+					composite.setMinimumAlpha(0.f);
+				}
+				composite.draw(image);
+				if (no_alpha_test)
+				{
+					composite.setMinimumAlpha(0.004f);
+				}
+			}
+		}
+	}
+
+	if( !getInfo()->mStaticImageFileName.empty() )
+	{
+		LLImageRaw* image = LLTexLayerStaticImageList::getInstance()->getImageRaw(getInfo()->mStaticImageFileName);
+		if( image )
+		{
+			composite.draw(image, getInfo()->mStaticImageIsMask);
+		}
+		else
+		{
+			success = FALSE;
+		}
+	}
+
+	if(((-1 == getInfo()->mLocalTexture) ||
+		 getInfo()->mUseLocalTextureAlphaOnly) &&
+		getInfo()->mStaticImageFileName.empty() &&
+		color_specified )
+	{
+		composite.setMinimumAlpha(0.f);
+		composite.setColor(net_color);
+		composite.draw(NULL);
+		composite.setMinimumAlpha(0.004f);
+	}
+
+	if( alpha_mask_specified || getInfo()->mWriteAllChannels )
+	{
+		composite.setBlend(IMAGE_BLEND_SOURCE_ALPHA, IMAGE_BLEND_ONE_MINUS_SOURCE_ALPHA);
+	}
+
+	return success;
+}
+
+void LLTexLayer::recordMorphMasks(LLTexLayerComposite& composite, const LLColor4 &layer_color)
+{
+	// the draws renderMorphMasks() makes with force_render set
+	BOOL success = TRUE;
+
+	composite.setMinimumAlpha(0.f);
+	composite.setAlphaOnly(true);
+
+	LLTexLayerParamAlpha* first_param = *mParamAlphaList.begin();
+	if( !first_param || !first_param->getMultiplyBlend() )
+	{
+		composite.setBlend(IMAGE_BLEND_ONE, IMAGE_BLEND_ZERO);
+		composite.setColor(LLColor4(0.f, 0.f, 0.f, 0.f));
+		composite.draw(NULL);
+	}
+
+	composite.setColor(LLColor4(1.f, 1.f, 1.f, 1.f));
+	for (LLTexLayerParamAlpha* param : mParamAlphaList)
+	{
+		success &= param->recordComposite(composite);
+	}
+
+	composite.setBlend(IMAGE_BLEND_DEST_ALPHA, IMAGE_BLEND_ZERO);
+
+	if( getInfo()->mLocalTexture != -1 && mLocalTextureObject )
+	{
+		LLGLTexture* tex = mLocalTextureObject->getImage();
+		if( tex && (tex->getComponents() == 4) )
+		{
+			LLImageRaw* image = mTexLayerSet->getLocalTextureRaw(tex);
+			if (!image)
+			{
+				composite.setMissingSource();
+			}
+			else
+			{
+				composite.draw(image);
+			}
+		}
+	}
+
+	if( !getInfo()->mStaticImageFileName.empty() && getInfo()->mStaticImageIsMask )
+	{
+		LLImageRaw* image = LLTexLayerStaticImageList::getInstance()->getImageRaw(getInfo()->mStaticImageFileName);
+		if( image && ((image->getComponents() == 4) || (image->getComponents() == 1)) )
+		{
+			composite.draw(image, true);
+		}
+	}
+
+	if ( !is_approx_equal(layer_color.mV[VW], 1.f) )
+	{
+		composite.setColor(layer_color);
+		composite.draw(NULL);
+	}
+
+	composite.setMinimumAlpha(0.004f);
+	composite.setAlphaOnly(false);
+
+	if (hasMorph() && success)
+	{
+		composite.captureMorphMask(this, getMorphMaskCacheIndex());
+	}
+}
+
+/*virtual*/ BOOL LLTexLayer::recordAlphaTexture(LLTexLayerComposite& composite)
+{
+	// the draws blendAlphaTexture() makes
+	BOOL success = TRUE;
+
+	if( !getInfo()->mStaticImageFileName.empty() )
+	{
+		LLImageRaw* image = LLTexLayerStaticImageList::getInstance()->getImageRaw(getInfo()->mStaticImageFileName);
+		if( image )
+		{
+			composite.setMinimumAlpha(0.f);
+			composite.draw(image, getInfo()->mStaticImageIsMask);
+			composite.setMinimumAlpha(0.004f);
+		}
+		else
+		{
+			success = FALSE;
+		}
+	}
+	else
+	{
+		if (getInfo()->mLocalTexture >=0 && getInfo()->mLocalTexture < TEX_NUM_INDICES)
+		{
+			LLGLTexture* tex = mLocalTextureObject->getImage();
+			if (tex)
+			{
+				LLImageRaw* image = mTexLayerSet->getLocalTextureRaw(tex);
+				if (!image)
+				{
+					composite.setMissingSource();
+				}
+				else
+				{
+					composite.setMinimumAlpha(0.f);
+					composite.draw(image);
+					composite.setMinimumAlpha(0.004f);
+				}
+			}
+		}
+	}
+	
+	return success;
+}
+
+U32 LLTexLayer::getMorphMaskCacheIndex() const
 {
 	LLCRC alpha_mask_crc;
 	const LLUUID& uuid = getUUID();
@@ -1193,12 +1508,43 @@ const U8*	LLTexLayer::getAlphaData() const
 		alpha_mask_crc.update((U8*)&param_weight, sizeof(F32));
 	}
 
-	U32 cache_index = alpha_mask_crc.getCRC();
+	return alpha_mask_crc.getCRC();
+}
+
+const U8*	LLTexLayer::getAlphaData() const
+{
+	U32 cache_index = getMorphMaskCacheIndex();
 
 	alpha_cache_t::const_iterator iter2 = mAlphaCache.find(cache_index);
 	return (iter2 == mAlphaCache.end()) ? 0 : iter2->second;
 }
 
+void LLTexLayer::setMorphMask(U32 cache_index, U8* alpha_data, S32 width, S32 height)
+{
+	alpha_cache_t::iterator existing = mAlphaCache.find(cache_index);
+	if (existing != mAlphaCache.end())
+	{
+		ll_aligned_free_32(existing->second);
+		mAlphaCache.erase(existing);
+	}
+
+	// clear out a slot if we have filled our cache
+	S32 max_cache_entries = getTexLayerSet()->getAvatarAppearance()->isSelf() ? 4 : 1;
+	while ((S32)mAlphaCache.size() >= max_cache_entries)
+	{
+		alpha_cache_t::iterator iter2 = mAlphaCache.begin(); // arbitrarily grab the first entry
+		ll_aligned_free_32(iter2->second);
+		mAlphaCache.erase(iter2);
+	}
+
+	mAlphaCache[cache_index] = alpha_data;
+
+	getTexLayerSet()->getAvatarAppearance()->dirtyMesh();
+
+	mMorphMasksValid = TRUE;
+	getTexLayerSet()->applyMorphMask(alpha_data, width, height, 1);
+}
+
 BOOL LLTexLayer::findNetColor(LLColor4* net_color) const
 {
 	// Color is either:
@@ -1388,32 +1734,13 @@ void LLTexLayer::renderMorphMasks(S32 x, S32 y, S32 width, S32 height, const LLC
 	
 	if (hasMorph() && success)
 	{
-		LLCRC alpha_mask_crc;
-		const LLUUID& uuid = getUUID();
-		alpha_mask_crc.update((U8*)(&uuid.mData), UUID_BYTES);
-		
-		for (const LLTexLayerParamAlpha* param : mParamAlphaList)
-		{
-			F32 param_weight = param->getWeight();
-			alpha_mask_crc.update((U8*)&param_weight, sizeof(F32));
-		}
-
-		U32 cache_index = alpha_mask_crc.getCRC();
+		U32 cache_index = getMorphMaskCacheIndex();
 		U8* alpha_data = NULL; 
                 // We believe we need to generate morph masks, do not assume that the cached version is accurate.
                 // We can get bad morph masks during login, on minimize, and occasional gl errors.
                 // We should only be doing this when we believe something has changed with respect to the user's appearance.
 		{
                        LL_DEBUGS("Avatar") << "gl alpha cache of morph mask not found, doing readback: " << getName() << LL_ENDL;
-                        // clear out a slot if we have filled our cache
-			S32 max_cache_entries = getTexLayerSet()->getAvatarAppearance()->isSelf() ? 4 : 1;
-			while ((S32)mAlphaCache.size() >= max_cache_entries)
-			{
-				alpha_cache_t::iterator iter2 = mAlphaCache.begin(); // arbitrarily grab the first entry
-				alpha_data = iter2->second;
-                ll_aligned_free_32(alpha_data);
-				mAlphaCache.erase(iter2);
-			}
 			
             // GPUs tend to be very uptight about memory alignment as the DMA used to convey
             // said data to the card works better when well-aligned so plain old default-aligned heap mem is a no-no
@@ -1474,14 +1801,9 @@ void LLTexLayer::renderMorphMasks(S32 x, S32 y, S32 width, S32 height, const LLC
                 ll_aligned_free_32(alpha_data);
                 alpha_data = nullptr;
             }
-
-            mAlphaCache[cache_index] = alpha_data;
 		}
-		
-		getTexLayerSet()->getAvatarAppearance()->dirtyMesh();
 
-		mMorphMasksValid = TRUE;
-		getTexLayerSet()->applyMorphMask(alpha_data, width, height, 1);
+		setMorphMask(cache_index, alpha_data, width, height);
 	}
 }
 
@@ -1735,6 +2057,66 @@ LLTexLayer* LLTexLayerTemplate::getLayer(U32 i) const
 }
 
 
+/*virtual*/ BOOL LLTexLayerTemplate::recordComposite(LLTexLayerComposite& composite)
+{
+	if(!mInfo)
+	{
+		return FALSE ;
+	}
+
+	BOOL success = TRUE;
+	updateWearableCache();
+	for (LLWearable* wearable : mWearableCache)
+	{
+		LLLocalTextureObject *lto = NULL;
+		LLTexLayer *layer = NULL;
+		if (wearable)
+		{
+			lto = wearable->getLocalTextureObject(mInfo->mLocalTexture);
+		}
+		if (lto)
+		{
+			layer = lto->getTexLayer(getName());
+		}
+		if (layer)
+		{
+			wearable->writeToAvatar(mAvatarAppearance);
+			layer->setLTO(lto);
+			success &= layer->recordComposite(composite);
+		}
+	}
+
+	return success;
+}
+
+/*virtual*/ BOOL LLTexLayerTemplate::recordAlphaTexture(LLTexLayerComposite& composite)
+{
+	BOOL success = TRUE;
+	U32 num_wearables = updateWearableCache();
+	for (U32 i = 0; i < num_wearables; i++)
+	{
+		LLTexLayer *layer = getLayer(i);
+		if (layer)
+		{
+			success &= layer->recordAlphaTexture(composite);
+		}
+	}
+	return success;
+}
+
+/*virtual*/ BOOL LLTexLayerTemplate::ownsLayer(const LLTexLayer* layer) const
+{
+	U32 num_wearables = updateWearableCache();
+	for (U32 i = 0; i < num_wearables; i++)
+	{
+		if (getLayer(i) == layer)
+		{
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
 //-----------------------------------------------------------------------------
 // finds a specific layer based on a passed in name
 //-----------------------------------------------------------------------------
@@ -1784,6 +2166,7 @@ void LLTexLayerSet::cloneTemplates(LLLocalTextureObject *lto, LLAvatarAppearance
 LLTexLayerStaticImageList::LLTexLayerStaticImageList() :
 	mGLBytes(0),
 	mTGABytes(0),
+	mRawBytes(0),
 	mImageNames(16384)
 {
 }
@@ -1797,24 +2180,28 @@ void LLTexLayerStaticImageList::dumpByteCount() const
 {
 	LL_INFOS() << "Avatar Static Textures " <<
 		"KB GL:" << (mGLBytes / 1024) <<
-		"KB TGA:" << (mTGABytes / 1024) << "KB" << LL_ENDL;
+		"KB TGA:" << (mTGABytes / 1024) <<
+		"KB Raw:" << (mRawBytes / 1024) << "KB" << LL_ENDL;
 }
 
 void LLTexLayerStaticImageList::deleteCachedImages()
 {
-	if( mGLBytes || mTGABytes )
+	if( mGLBytes || mTGABytes || mRawBytes )
 	{
 		LL_INFOS() << "Clearing Static Textures " <<
 			"KB GL:" << (mGLBytes / 1024) <<
-			"KB TGA:" << (mTGABytes / 1024) << "KB" << LL_ENDL;
+			"KB TGA:" << (mTGABytes / 1024) <<
+			"KB Raw:" << (mRawBytes / 1024) << "KB" << LL_ENDL;
 
 		//mStaticImageLists uses LLPointers, clear() will cause deletion
 		
 		mStaticImageListTGA.clear();
 		mStaticImageList.clear();
+		mStaticImageListRaw.clear();
 		
 		mGLBytes = 0;
 		mTGABytes = 0;
+		mRawBytes = 0;
 	}
 }
 
@@ -1851,6 +2238,28 @@ LLImageTGA* LLTexLayerStaticImageList::getImageTGA(const std::string& file_name)
 	}
 }
 
+// Returns an LLImageRaw that contains the decoded data from a tga file named file_name,
+// for compositing on the CPU.  Caches the result to speed identical subsequent requests.
+LLImageRaw* LLTexLayerStaticImageList::getImageRaw(const std::string& file_name)
+{
+    LL_PROFILE_ZONE_SCOPED;
+	const char *namekey = mImageNames.addString(file_name);
+	image_raw_map_t::const_iterator iter = mStaticImageListRaw.find(namekey);
+	if( iter != mStaticImageListRaw.end() )
+	{
+		return iter->second;
+	}
+
+	LLPointer<LLImageRaw> image_raw = new LLImageRaw;
+	if( loadImageRaw( file_name, image_raw ) )
+	{
+		mStaticImageListRaw[ namekey ] = image_raw;
+		mRawBytes += image_raw->getDataSize();
+		return image_raw;
+	}
+	return NULL;
+}
+
 // Returns a GL Image (without a backing ImageRaw) that contains the decoded data from a tga file named file_name.
 // Caches the result to speed identical subsequent requests.
 LLGLTexture* LLTexLayerStaticImageList::getTexture(const std::string& file_name, BOOL is_mask)
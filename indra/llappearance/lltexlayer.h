@@ -42,6 +42,8 @@ class LLTexLayerSet;
 class LLTexLayerSetInfo;
 class LLTexLayerInfo;
 class LLTexLayerSetBuffer;
+class LLTexLayer;
+class LLTexLayerComposite;
 class LLWearable;
 class LLViewerVisualParam;
 
@@ -69,6 +71,10 @@ public:
 	virtual void			deleteCaches() = 0;
 	virtual BOOL			blendAlphaTexture(S32 x, S32 y, S32 width, S32 height) = 0;
 	virtual BOOL			isInvisibleAlphaMask() const = 0;
+	// The draws render() and blendAlphaTexture() make, for compositing on the CPU
+	virtual BOOL			recordComposite(LLTexLayerComposite& composite) = 0;
+	virtual BOOL			recordAlphaTexture(LLTexLayerComposite& composite) = 0;
+	virtual BOOL			ownsLayer(const LLTexLayer* layer) const = 0;
 
 	const LLTexLayerInfo* 	getInfo() const 			{ return mInfo; }
 	virtual BOOL			setInfo(const LLTexLayerInfo *info, LLWearable* wearable); // sets mInfo, calls initialization functions
@@ -128,6 +134,9 @@ public:
 	/*virtual*/ void		setHasMorph(BOOL newval);
 	/*virtual*/ void		deleteCaches();
 	/*virtual*/ BOOL		isInvisibleAlphaMask() const;
+	/*virtual*/ BOOL		recordComposite(LLTexLayerComposite& composite);
+	/*virtual*/ BOOL		recordAlphaTexture(LLTexLayerComposite& composite);
+	/*virtual*/ BOOL		ownsLayer(const LLTexLayer* layer) const;
 protected:
 	U32 					updateWearableCache() const;
 	LLTexLayer* 			getLayer(U32 i) const;
@@ -163,6 +172,14 @@ public:
 	void					renderMorphMasks(S32 x, S32 y, S32 width, S32 height, const LLColor4 &layer_color, LLRenderTarget* bound_target, bool force_render);
 	void					addAlphaMask(U8 *data, S32 originX, S32 originY, S32 width, S32 height, LLRenderTarget* bound_target);
 	/*virtual*/ BOOL		isInvisibleAlphaMask() const;
+	/*virtual*/ BOOL		recordComposite(LLTexLayerComposite& composite);
+	/*virtual*/ BOOL		recordAlphaTexture(LLTexLayerComposite& composite);
+	/*virtual*/ BOOL		ownsLayer(const LLTexLayer* layer) const	{ return layer == this; }
+
+	// Identifies the morph mask for the current texture and alpha weights
+	U32						getMorphMaskCacheIndex() const;
+	// Takes alpha_data (ll_aligned_malloc_32) as the morph mask for cache_index and applies it
+	void					setMorphMask(U32 cache_index, U8* alpha_data, S32 width, S32 height);
 
 	void					setLTO(LLLocalTextureObject *lto) 	{ mLocalTextureObject = lto; }
 	LLLocalTextureObject* 	getLTO() 							{ return mLocalTextureObject; }
@@ -171,6 +188,7 @@ public:
 
 	static void 			calculateTexLayerColor(const param_color_list_t &param_list, LLColor4 &net_color);
 protected:
+	void					recordMorphMasks(LLTexLayerComposite& composite, const LLColor4 &layer_color);
 	LLUUID					getUUID() const;
 	typedef std::map<U32, U8*> alpha_cache_t;
 	alpha_cache_t			mAlphaCache;
@@ -202,6 +220,16 @@ public:
 	BOOL						render(S32 x, S32 y, S32 width, S32 height, LLRenderTarget* bound_target = nullptr);
 	void						renderAlphaMaskTextures(S32 x, S32 y, S32 width, S32 height, LLRenderTarget* bound_target = nullptr, bool forceClear = false);
 
+	// Records the draws render() makes into composite, to be made on the CPU
+	// instead.  Marks the composite as missing a source if a local texture
+	// has no decoded pixels to composite with.
+	BOOL						recordComposite(LLTexLayerComposite& composite);
+	// Gives the morph masks a finished composite captured to the layers that
+	// are still ours and still have the same textures and weights.
+	void						applyCompositeMorphMasks(LLTexLayerComposite& composite);
+	// The decoded pixels of a local texture, NULL if there are none to be had
+	virtual LLImageRaw*			getLocalTextureRaw(LLGLTexture* tex)	{ return NULL; }
+
 	BOOL						isBodyRegion(const std::string& region) const;
 	void						applyMorphMask(U8* tex_data, S32 width, S32 height, S32 num_components);
 	BOOL						isMorphValid() const;
@@ -221,6 +249,8 @@ public:
 	static BOOL					sHasCaches;
 
 protected:
+	void						recordAlphaMaskTextures(LLTexLayerComposite& composite);
+
 	typedef std::vector<LLTexLayerInterface *> layer_list_t;
 	layer_list_t				mLayerList;
 	layer_list_t				mMaskLayerList;
@@ -296,6 +326,7 @@ class LLTexLayerStaticImageList : public LLSingleton<LLTexLayerStaticImageList>
 public:
 	LLGLTexture*		getTexture(const std::string& file_name, BOOL is_mask);
 	LLImageTGA*			getImageTGA(const std::string& file_name);
+	LLImageRaw*			getImageRaw(const std::string& file_name);
 	void				deleteCachedImages();
 	void				dumpByteCount() const;
 protected:
@@ -306,8 +337,11 @@ private:
 	texture_map_t 		mStaticImageList;
 	typedef std::map<const char*, LLPointer<LLImageTGA> > image_tga_map_t;
 	image_tga_map_t 	mStaticImageListTGA;
+	typedef std::map<const char*, LLPointer<LLImageRaw> > image_raw_map_t;
+	image_raw_map_t 	mStaticImageListRaw;
 	S32 				mGLBytes;
 	S32 				mTGABytes;
+	S32 				mRawBytes;
 };
 
 #endif  // LL_LLTEXLAYER_H
@@ -0,0 +1,249 @@
+/** 
+ * @file lltexlayercomposite.cpp
+ * @brief Compositing of avatar texture layers on the CPU.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "lltexlayercomposite.h"
+
+#include "llmemory.h"
+#include "llparallelbatch.h"
+
+namespace
+{
+	// rows per band, for the draws to stay in cache while a band is made
+	const S32 BAND_ROWS = 32;
+
+	// image as the RGBA texture GL would make of it, NULL for images already
+	// RGBA, which are drawn from as they are.  The image belongs to the main
+	// thread, so it is only read here, never referenced.
+	LLPointer<LLImageRaw> prepare_source(LLImageRaw* image, bool alpha_texture)
+	{
+		LLPointer<LLImageRaw> rgba;
+		if (image->isBufferInvalid())
+		{
+			return rgba;
+		}
+
+		const S32 components = image->getComponents();
+		if (components != 4)
+		{
+			rgba = new LLImageRaw(image->getWidth(), image->getHeight(), 4);
+			if (rgba->isBufferInvalid())
+			{
+				return LLPointer<LLImageRaw>();
+			}
+
+			const U8* src = image->getData();
+			U8* dst = rgba->getData();
+			const S32 pixels = image->getWidth() * image->getHeight();
+			for (S32 i = 0; i < pixels; ++i, src += components, dst += 4)
+			{
+				switch (components)
+				{
+					case 1:
+						if (alpha_texture)
+						{
+							dst[0] = dst[1] = dst[2] = 0;
+							dst[3] = src[0];
+						}
+						else
+						{ // luminance
+							dst[0] = dst[1] = dst[2] = src[0];
+							dst[3] = 255;
+						}
+						break;
+					case 2: // luminance alpha
+						dst[0] = dst[1] = dst[2] = src[0];
+						dst[3] = src[1];
+						break;
+					default:
+						dst[0] = src[0];
+						dst[1] = src[1];
+						dst[2] = src[2];
+						dst[3] = 255;
+						break;
+				}
+			}
+		}
+		return rgba;
+	}
+}
+
+LLTexLayerComposite::LLTexLayerComposite(S32 width, S32 height) :
+	mWidth(width),
+	mHeight(height),
+	mImage(new LLImageRaw(width, height, 4)),
+	mMissingSource(false),
+	mMinimumAlpha(0.004f),
+	mSrcFactor(IMAGE_BLEND_SOURCE_ALPHA),
+	mDstFactor(IMAGE_BLEND_ONE_MINUS_SOURCE_ALPHA),
+	mAlphaOnly(false),
+	mNumBands((height + BAND_ROWS - 1) / BAND_ROWS)
+{
+	mColor[0] = mColor[1] = mColor[2] = mColor[3] = 1.f;
+}
+
+LLTexLayerComposite::~LLTexLayerComposite()
+{
+	for (MorphMask& morph_mask : mMorphMasks)
+	{
+		if (morph_mask.mData)
+		{
+			ll_aligned_free_32(morph_mask.mData);
+		}
+	}
+}
+
+void LLTexLayerComposite::setColor(const LLColor4& color)
+{
+	// quantized as LLRender::color4f() does, and read back as the shader does
+	for (S32 c = 0; c < 4; ++c)
+	{
+		mColor[c] = (F32) (U8) (llclamp(color.mV[c], 0.f, 1.f) * 255) / 255.f;
+	}
+}
+
+void LLTexLayerComposite::setBlend(EImageBlendFactor src_factor, EImageBlendFactor dst_factor)
+{
+	mSrcFactor = src_factor;
+	mDstFactor = dst_factor;
+}
+
+void LLTexLayerComposite::draw(LLImageRaw* source, bool alpha_texture)
+{
+	Draw draw;
+	memcpy(draw.mColor, mColor, sizeof(mColor));
+	draw.mMinimumAlpha = mMinimumAlpha;
+	draw.mSrcFactor = mSrcFactor;
+	draw.mDstFactor = mDstFactor;
+	draw.mAlphaOnly = mAlphaOnly;
+	draw.mSource = -1;
+	draw.mMorphMask = -1;
+
+	if (source)
+	{
+		if (source->getWidth() != mWidth || source->getHeight() != mHeight)
+		{ // GL would filter it, which isn't reproduced here
+			mMissingSource = true;
+		}
+
+		// only 1 component images care whether they are alpha textures
+		alpha_texture = alpha_texture && source->getComponents() == 1;
+		for (U32 i = 0; i < mSources.size(); ++i)
+		{
+			if (mSources[i].mImage == source && mSources[i].mAlphaTexture == alpha_texture)
+			{
+				draw.mSource = i;
+				break;
+			}
+		}
+		if (draw.mSource < 0)
+		{
+			draw.mSource = mSources.size();
+			mSources.push_back(Source());
+			mSources.back().mImage = source;
+			mSources.back().mAlphaTexture = alpha_texture;
+		}
+	}
+
+	mDraws.push_back(draw);
+}
+
+void LLTexLayerComposite::captureMorphMask(LLTexLayer* layer, U32 cache_index)
+{
+	MorphMask morph_mask;
+	morph_mask.mLayer = layer;
+	morph_mask.mCacheIndex = cache_index;
+	morph_mask.mData = (U8*) ll_aligned_malloc_32(mWidth * mHeight);
+
+	Draw draw;
+	draw.mSource = -1;
+	draw.mMorphMask = mMorphMasks.size();
+	mDraws.push_back(draw);
+
+	mMorphMasks.push_back(morph_mask);
+}
+
+void LLTexLayerComposite::run(U32 helpers)
+{
+	LL_PROFILE_ZONE_SCOPED;
+
+	if (mImage->isBufferInvalid())
+	{
+		return;
+	}
+
+	prepareSources();
+
+	LL::parallelBatch(mNumBands, helpers, [this](U32 band) { runBand(band); });
+}
+
+void LLTexLayerComposite::prepareSources()
+{
+	for (Source& source : mSources)
+	{
+		source.mPrepared = prepare_source(source.mImage, source.mAlphaTexture);
+	}
+}
+
+void LLTexLayerComposite::runBand(S32 band)
+{
+	const S32 first = band * BAND_ROWS * mWidth;
+	const S32 pixels = llmin(BAND_ROWS, mHeight - band * BAND_ROWS) * mWidth;
+	U8* dst = mImage->getData() + first * 4;
+
+	for (const Draw& draw : mDraws)
+	{
+		if (draw.mMorphMask >= 0)
+		{
+			U8* alpha = mMorphMasks[draw.mMorphMask].mData;
+			if (alpha)
+			{
+				for (S32 i = 0; i < pixels; ++i)
+				{
+					alpha[first + i] = dst[i * 4 + 3];
+				}
+			}
+			continue;
+		}
+
+		const U8* src = NULL;
+		if (draw.mSource >= 0)
+		{
+			const Source& from = mSources[draw.mSource];
+			LLImageRaw* source = from.mImage->getComponents() == 4 ? from.mImage.get() : from.mPrepared.get();
+			if (!source || source->isBufferInvalid())
+			{ // couldn't be had, as an unloadable texture draws nothing
+				continue;
+			}
+			src = source->getData() + first * 4;
+		}
+
+		ll_image_blend(dst, src, pixels, draw.mColor, draw.mMinimumAlpha,
+					   draw.mSrcFactor, draw.mDstFactor, draw.mAlphaOnly);
+	}
+}
@@ -0,0 +1,144 @@
+/** 
+ * @file lltexlayercomposite.h
+ * @brief Compositing of avatar texture layers on the CPU.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+
+#ifndef LL_LLTEXLAYERCOMPOSITE_H
+#define LL_LLTEXLAYERCOMPOSITE_H
+
+#include <memory>
+#include <vector>
+#include "llimage.h"
+#include "llimageblend.h"
+#include "llpointer.h"
+#include "v4color.h"
+
+class LLTexLayer;
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// LLTexLayerComposite
+//
+// A layer set's composite made on the CPU rather than with GL.  The layer set
+// records the draws its GL render would make, with the same state, on the
+// main thread (LLTexLayerSet::recordComposite()), and run() makes them into
+// an RGBA image on any thread, in bands of rows spread over the General pool.
+// The blend math is GL's and sources have to be at the composite's size,
+// with no filtering, so the result matches what GL renders byte for byte.
+// The sources are the main thread's images, so the composite is to be
+// destroyed there.
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+class LLTexLayerComposite
+{
+public:
+	LLTexLayerComposite(S32 width, S32 height);
+	~LLTexLayerComposite();
+
+	//--------------------------------------------------------------------
+	// Recording, main thread
+	//--------------------------------------------------------------------
+public:
+	// Draw state, kept from one draw to the next like GL's
+	void					setColor(const LLColor4& color);
+	void					setBlend(EImageBlendFactor src_factor, EImageBlendFactor dst_factor);
+	void					setAlphaOnly(bool alpha_only)		{ mAlphaOnly = alpha_only; }
+	void					setMinimumAlpha(F32 min_alpha)		{ mMinimumAlpha = min_alpha; }
+
+	// A quad over the whole composite with source on it, or just the color
+	// when source is NULL.  1 component sources are alpha textures when
+	// alpha_texture is set and luminance ones otherwise.
+	void					draw(LLImageRaw* source, bool alpha_texture = false);
+	// Keeps a copy of the alpha channel as it is at this point, for layer's
+	// morph masks.
+	void					captureMorphMask(LLTexLayer* layer, U32 cache_index);
+
+	// Set when a texture the layers use has no decoded pixels to draw with,
+	// or isn't at the composite's size, for GL to render the composite
+	void					setMissingSource()					{ mMissingSource = true; }
+	bool					isMissingSource() const				{ return mMissingSource; }
+
+	//--------------------------------------------------------------------
+	// Compositing, any thread
+	//--------------------------------------------------------------------
+public:
+	// Makes the recorded draws, with up to helpers jobs on the General pool
+	// taking bands of rows alongside this thread.
+	void					run(U32 helpers);
+
+	//--------------------------------------------------------------------
+	// Results, main thread
+	//--------------------------------------------------------------------
+public:
+	LLImageRaw*				getImage() const					{ return mImage; }
+
+	struct MorphMask
+	{
+		LLTexLayer*			mLayer;
+		U32					mCacheIndex;
+		U8*					mData;			// width * height, ll_aligned_malloc_32; whoever takes it frees it
+	};
+	typedef std::vector<MorphMask> morph_mask_list_t;
+	morph_mask_list_t&		getMorphMasks()						{ return mMorphMasks; }
+
+private:
+	void					prepareSources();
+	void					runBand(S32 band);
+
+	struct Source
+	{
+		LLPointer<LLImageRaw> mImage;
+		bool				mAlphaTexture;
+		LLPointer<LLImageRaw> mPrepared;	// mImage as 4 components, when it has fewer
+	};
+
+	struct Draw
+	{
+		F32					mColor[4];
+		F32					mMinimumAlpha;
+		EImageBlendFactor	mSrcFactor;
+		EImageBlendFactor	mDstFactor;
+		bool				mAlphaOnly;
+		S32					mSource;		// index into mSources, -1 for none
+		S32					mMorphMask;		// index into mMorphMasks for a capture rather than a draw, else -1
+	};
+
+	const S32				mWidth;
+	const S32				mHeight;
+	LLPointer<LLImageRaw>	mImage;
+	std::vector<Source>		mSources;
+	std::vector<Draw>		mDraws;
+	morph_mask_list_t		mMorphMasks;
+	bool					mMissingSource;
+
+	// current draw state
+	F32						mColor[4];
+	F32						mMinimumAlpha;
+	EImageBlendFactor		mSrcFactor;
+	EImageBlendFactor		mDstFactor;
+	bool					mAlphaOnly;
+
+	U32						mNumBands;
+};
+
+#endif  // LL_LLTEXLAYERCOMPOSITE_H
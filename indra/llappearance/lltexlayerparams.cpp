@@ -32,6 +32,7 @@
 #include "llimagetga.h"
 #include "llquantize.h"
 #include "lltexlayer.h"
+#include "lltexlayercomposite.h"
 #include "lltexturemanagerbridge.h"
 #include "../llui/llui.h"
 #include "llwearable.h"
@@ -289,19 +290,9 @@ BOOL LLTexLayerParamAlpha::render(S32 x, S32 y, S32 width, S32 height)
 
 	if (!info->mStaticImageFileName.empty() && !mStaticImageInvalid)
 	{
-		if (mStaticImageTGA.isNull())
+		if (!loadStaticImage())
 		{
-			// Don't load the image file until we actually need it the first time.  Like now.
-			mStaticImageTGA = LLTexLayerStaticImageList::getInstance()->getImageTGA(info->mStaticImageFileName);  
-			// We now have something in one of our caches
-			LLTexLayerSet::sHasCaches |= mStaticImageTGA.notNull() ? TRUE : FALSE;
-
-			if (mStaticImageTGA.isNull())
-			{
-				LL_WARNS() << "Unable to load static file: " << info->mStaticImageFileName << LL_ENDL;
-				mStaticImageInvalid = TRUE; // don't try again.
-				return FALSE;
-			}
+			return FALSE;
 		}
 
 		const S32 image_tga_width = mStaticImageTGA->getWidth();
@@ -368,6 +359,82 @@ BOOL LLTexLayerParamAlpha::render(S32 x, S32 y, S32 width, S32 height)
 	return success;
 }
 
+BOOL LLTexLayerParamAlpha::loadStaticImage()
+{
+	if (mStaticImageTGA.isNull())
+	{
+		LLTexLayerParamAlphaInfo *info = (LLTexLayerParamAlphaInfo *)getInfo();
+
+		// Don't load the image file until we actually need it the first time.  Like now.
+		mStaticImageTGA = LLTexLayerStaticImageList::getInstance()->getImageTGA(info->mStaticImageFileName);  
+		// We now have something in one of our caches
+		LLTexLayerSet::sHasCaches |= mStaticImageTGA.notNull() ? TRUE : FALSE;
+
+		if (mStaticImageTGA.isNull())
+		{
+			LL_WARNS() << "Unable to load static file: " << info->mStaticImageFileName << LL_ENDL;
+			mStaticImageInvalid = TRUE; // don't try again.
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+BOOL LLTexLayerParamAlpha::recordComposite(LLTexLayerComposite& composite)
+{
+	// the draw render() makes, from the same processed image
+	BOOL success = TRUE;
+
+	if (!mTexLayer)
+	{
+		return success;
+	}
+
+	F32 effective_weight = (mTexLayer->getTexLayerSet()->getAvatarAppearance()->getSex() & getSex()) ? mCurWeight : getDefaultWeight();
+	if (getSkip())
+	{
+		return success;
+	}
+
+	LLTexLayerParamAlphaInfo *info = (LLTexLayerParamAlphaInfo *)getInfo();
+	if (info->mMultiplyBlend)
+	{
+		composite.setBlend(IMAGE_BLEND_DEST_ALPHA, IMAGE_BLEND_ZERO);
+	}
+	else
+	{
+		composite.setBlend(IMAGE_BLEND_ONE, IMAGE_BLEND_ONE);
+	}
+
+	if (!info->mStaticImageFileName.empty() && !mStaticImageInvalid)
+	{
+		if (!loadStaticImage())
+		{
+			return FALSE;
+		}
+
+		if (mStaticImageRaw.isNull() || effective_weight != mCachedEffectiveWeight)
+		{
+			mCachedEffectiveWeight = effective_weight;
+
+			// a new image rather than a changed one, a composite may still be drawing with the old
+			mStaticImageRaw = new LLImageRaw;
+			mStaticImageTGA->decodeAndProcess(mStaticImageRaw, info->mDomain, effective_weight);
+			mNeedsCreateTexture = TRUE;
+		}
+
+		// uploaded as GL_ALPHA8
+		composite.draw(mStaticImageRaw, true);
+	}
+	else
+	{
+		composite.setColor(LLColor4(0.f, 0.f, 0.f, effective_weight));
+		composite.draw(NULL);
+	}
+
+	return success;
+}
+
 //-----------------------------------------------------------------------------
 // LLTexLayerParamAlphaInfo
 //-----------------------------------------------------------------------------
@@ -35,6 +35,7 @@ class LLAvatarAppearance;
 class LLImageRaw;
 class LLImageTGA;
 class LLTexLayer;
+class LLTexLayerComposite;
 class LLTexLayerInterface;
 class LLGLTexture;
 class LLWearable;
@@ -90,6 +91,7 @@ public:
 
 	// New functions
 	BOOL					render( S32 x, S32 y, S32 width, S32 height );
+	BOOL					recordComposite(LLTexLayerComposite& composite); // the draw render() makes, for compositing on the CPU
 	BOOL					getSkip() const;
 	void					deleteCaches();
 	BOOL					getMultiplyBlend() const;
@@ -97,6 +99,8 @@ public:
 private:
 	LLTexLayerParamAlpha(const LLTexLayerParamAlpha& pOther);
 
+	BOOL					loadStaticImage();
+
 	LLPointer<LLGLTexture>	mCachedProcessedTexture;
 	LLPointer<LLImageTGA>	mStaticImageTGA;
 	LLPointer<LLImageRaw>	mStaticImageRaw;
@@ -155,6 +155,10 @@ public:
 	enum e_update_t { NORMAL_UPDATE, HIDDEN_UPDATE, FORCE_UPDATE };
 	void updateMotions(e_update_t update_type);
 
+	// updateMotions() split as in LLMotionController, main thread half first
+	bool beginUpdateMotions(e_update_t update_type);
+	void finishUpdateMotions(e_update_t update_type);
+
 	LLAnimPauseRequest requestPause();
 	BOOL areAnimationsPaused() const { return mMotionController.isPaused(); }
 	void setAnimTimeFactor(F32 factor) { mMotionController.setTimeFactor(factor); }
@@ -37,6 +37,7 @@
 
 S32 LLJoint::sNumUpdates = 0;
 S32 LLJoint::sNumTouches = 0;
+U32 LLJoint::sLastTopologySerial = 0;
 
 template <class T> 
 bool attachment_map_iter_compare_key(const T& a, const T& b)
@@ -111,6 +112,7 @@ void LLJoint::init()
 	mUpdateXform = TRUE;
     mSupport = SUPPORT_BASE;
     mEnd = LLVector3(0.0f, 0.0f, 0.0f);
+	mTopologySerial = ++sLastTopologySerial;
 }
 
 LLJoint::LLJoint() :
@@ -215,6 +217,16 @@ void LLJoint::touch(U32 flags)
 	}
 }
 
+//-----------------------------------------------------------------------------
+// touchTopology()
+// Gives the root of this joint's hierarchy a new topology serial, so
+// flattened copies of the hierarchy (LLJointSkeleton) know to rebuild.
+//-----------------------------------------------------------------------------
+void LLJoint::touchTopology()
+{
+	getRoot()->mTopologySerial = ++sLastTopologySerial;
+}
+
 //-----------------------------------------------------------------------------
 // setJointNum()
 //-----------------------------------------------------------------------------
@@ -273,6 +285,7 @@ void LLJoint::addChild(LLJoint* joint)
 	joint->mXform.setParent(&mXform);
 	joint->mParent = this;	
 	joint->touch();
+	touchTopology();
 }
 
 
@@ -289,6 +302,8 @@ void LLJoint::removeChild(LLJoint* joint)
 		joint->mXform.setParent(NULL);
 		joint->mParent = NULL;
 		joint->touch();
+		joint->touchTopology();
+		touchTopology();
 	}
 }
 
@@ -305,10 +320,12 @@ void LLJoint::removeAllChildren()
 		    joint->mXform.setParent(NULL);
 		    joint->mParent = NULL;
 		    joint->touch();
+		    joint->touchTopology();
             //delete joint;
         }
 	}
     mChildren.clear();
+	touchTopology();
 }
 
 
@@ -90,6 +90,7 @@ LL_ALIGN_PREFIX(16)
 class LLJoint
 {
     LL_ALIGN_NEW
+    friend class LLJointSkeleton;
 public:
 	// priority levels, from highest to lowest
 	enum JointPriority
@@ -148,9 +149,14 @@ public:
 	typedef std::vector<LLJoint*> joints_t;
 	joints_t mChildren;
 
+	// Changes whenever the hierarchy below this joint does, while this
+	// joint is a root.  Values are unique across all joints.
+	U32				mTopologySerial;
+
 	// debug statics
 	static S32		sNumTouches;
 	static S32		sNumUpdates;
+	static U32		sLastTopologySerial;
     typedef std::set<std::string> debug_joint_name_t;
     static debug_joint_name_t s_debugJointNames;
     static void setDebugJointNames(const debug_joint_name_t& names);
@@ -198,6 +204,9 @@ public:
 
 	void touch(U32 flags = ALL_DIRTY);
 
+	// note a change to the hierarchy this joint is part of
+	void touchTopology();
+
 	// get/set name
 	const std::string& getName() const { return mName; }
 	void setName( const std::string &name ) { mName = name; }
@@ -0,0 +1,519 @@
+/**
+ * @file lljointskeleton.cpp
+ * @brief Flattened joint hierarchy with batched world matrix updates.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "lljointskeleton.h"
+
+#include "lljoint.h"
+
+namespace
+{
+    enum
+    {
+        JOINT_CLEAN = 0,    // world transform is current, read it back for the children
+        JOINT_DIRTY = 1,    // world transform to be computed
+        JOINT_SKIP = 2      // left alone along with its descendants, or padding
+    };
+
+    inline void set_lane(LLVector4a& v, U32 lane, F32 value)
+    {
+        v.getF32ptr()[lane] = value;
+    }
+
+    inline F32 get_lane(const LLVector4a& v, U32 lane)
+    {
+        return v.getF32ptr()[lane];
+    }
+}
+
+LLJointSkeleton::LLJointSkeleton()
+:   mRoot(nullptr),
+    mTopologySerial(0)
+{
+}
+
+LLJointSkeleton::~LLJointSkeleton()
+{
+}
+
+void LLJointSkeleton::clear()
+{
+    mRoot = nullptr;
+    mTopologySerial = 0;
+    mJoints.clear();
+    mParents.clear();
+    mLevels.clear();
+    mBlocks.clear();
+    mState.clear();
+}
+
+void LLJointSkeleton::rebuild(LLJoint* root)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+
+    clear();
+    mRoot = root;
+    if (!root)
+    {
+        return;
+    }
+    mTopologySerial = root->mTopologySerial;
+
+    mJoints.push_back(root);
+    mParents.push_back(-1);
+
+    U32 first = 0;
+    while (first < mJoints.size())
+    {
+        U32 end = (U32) mJoints.size();
+
+        // pad each level out to whole blocks so no block spans two levels
+        while (mJoints.size() % 4)
+        {
+            mJoints.push_back(nullptr);
+            mParents.push_back(-1);
+        }
+        mLevels.push_back(first);
+
+        U32 next = (U32) mJoints.size();
+        for (U32 i = first; i < end; ++i)
+        {
+            for (LLJoint* child : mJoints[i]->mChildren)
+            {
+                if (child)
+                {
+                    mJoints.push_back(child);
+                    mParents.push_back((S32) i);
+                }
+            }
+        }
+        first = next;
+    }
+    mLevels.push_back((U32) mJoints.size());
+
+    mBlocks.resize(mJoints.size() / 4);
+    mState.resize(mJoints.size());
+}
+
+void LLJointSkeleton::updateWorldMatrices(LLJoint* root)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+
+    if (root != mRoot || !root || root->mTopologySerial != mTopologySerial)
+    {
+        rebuild(root);
+    }
+
+    if (!root || !root->mUpdateXform)
+    {
+        return;
+    }
+
+    // flag the joints to compute, parents first, and note which levels
+    // have any
+    U32 num_levels = (U32) mLevels.size() - 1;
+    static thread_local std::vector<U8> level_dirty;
+    level_dirty.assign(num_levels + 1, 0);
+
+    bool any_dirty = false;
+    for (U32 level = 0; level < num_levels; ++level)
+    {
+        for (U32 i = mLevels[level]; i < mLevels[level + 1]; ++i)
+        {
+            LLJoint* joint = mJoints[i];
+            S32 parent = mParents[i];
+            if (!joint || !joint->mUpdateXform || (parent >= 0 && mState[parent] == JOINT_SKIP))
+            {
+                mState[i] = JOINT_SKIP;
+            }
+            else if (joint->mDirtyFlags & LLJoint::MATRIX_DIRTY)
+            {
+                mState[i] = JOINT_DIRTY;
+                level_dirty[level] = 1;
+                any_dirty = true;
+            }
+            else
+            {
+                mState[i] = JOINT_CLEAN;
+            }
+        }
+    }
+
+    if (!any_dirty)
+    {
+        return;
+    }
+
+    // the root's parent, if any, is outside the layout and may not even be
+    // a joint (e.g. the object an avatar sits on), leave it to LLXformMatrix
+    if (mState[0] == JOINT_DIRTY)
+    {
+        root->updateWorldMatrix();
+        mState[0] = JOINT_CLEAN;
+        level_dirty[0] = 0;
+    }
+
+    for (U32 level = 0; level < num_levels; ++level)
+    {
+        U32 first = mLevels[level];
+        U32 count = mLevels[level + 1] - first;
+        // a level must be read if it changes or its children do
+        if (level_dirty[level] || level_dirty[level + 1])
+        {
+            gather(first, count);
+        }
+        if (level_dirty[level])
+        {
+            evaluate(first, count);
+        }
+    }
+}
+
+// Fill in the blocks of one level from the joints: local transforms of the
+// joints to be computed, world transforms of the rest.
+void LLJointSkeleton::gather(U32 first, U32 count)
+{
+    for (U32 i = first; i < first + count; ++i)
+    {
+        Block& block = mBlocks[i >> 2];
+        U32 lane = i & 3;
+        LLJoint* joint = mJoints[i];
+
+        LLVector3 scale(1.f, 1.f, 1.f);
+        LLVector3 pos;
+        LLQuaternion rot;
+        LLVector3 world_pos;
+        LLQuaternion world_rot;
+
+        if (joint && mState[i] != JOINT_SKIP)
+        {
+            const LLXformMatrix& xform = joint->mXform;
+            scale = xform.getScale();
+            if (mState[i] == JOINT_DIRTY)
+            {
+                pos = xform.getPosition();
+                rot = xform.getRotation();
+            }
+            else
+            {
+                world_pos = xform.getWorldPosition();
+                world_rot = xform.getWorldRotation();
+            }
+        }
+
+        for (U32 c = 0; c < 3; ++c)
+        {
+            set_lane(block.mPos[c], lane, pos.mV[c]);
+            set_lane(block.mScale[c], lane, scale.mV[c]);
+            set_lane(block.mWorldPos[c], lane, world_pos.mV[c]);
+        }
+        for (U32 c = 0; c < 4; ++c)
+        {
+            set_lane(block.mRot[c], lane, rot.mQ[c]);
+            set_lane(block.mWorldRot[c], lane, world_rot.mQ[c]);
+        }
+    }
+}
+
+// Compute the world transforms of the dirty joints of one level from their
+// parents, four at a time, and hand them back to the joints.  Matches
+// LLXformMatrix::updateMatrix(FALSE) for joints, which scale their child
+// offsets:
+//   world_pos = (pos * parent_scale) * parent_world_rot + parent_world_pos
+//   world_rot = rot * parent_world_rot
+//   world_matrix = initAll(scale, world_rot, world_pos)
+void LLJointSkeleton::evaluate(U32 first, U32 count)
+{
+    const LLVector4a zero(0.f);
+    const LLVector4a one(1.f);
+    const LLVector4a two(2.f);
+
+    for (U32 b = first >> 2; b < (first + count) >> 2; ++b)
+    {
+        Block& block = mBlocks[b];
+        U32 base = b << 2;
+
+        // parent world transforms and scales, identity in unused lanes
+        LLVector4a ppos[3], prot[4], pscale[3];
+        for (U32 c = 0; c < 3; ++c)
+        {
+            ppos[c] = zero;
+            pscale[c] = one;
+        }
+        for (U32 c = 0; c < 3; ++c)
+        {
+            prot[c] = zero;
+        }
+        prot[3] = one;
+
+        U32 dirty_lanes = 0;
+        for (U32 lane = 0; lane < 4; ++lane)
+        {
+            U32 i = base + lane;
+            if (mState[i] != JOINT_DIRTY)
+            {
+                continue;
+            }
+            dirty_lanes |= 1 << lane;
+
+            // the root is never computed here, so every dirty joint has a
+            // parent in the level above
+            S32 parent = mParents[i];
+            const Block& pblock = mBlocks[parent >> 2];
+            U32 plane = parent & 3;
+            for (U32 c = 0; c < 3; ++c)
+            {
+                set_lane(ppos[c], lane, get_lane(pblock.mWorldPos[c], plane));
+                set_lane(pscale[c], lane, get_lane(pblock.mScale[c], plane));
+            }
+            for (U32 c = 0; c < 4; ++c)
+            {
+                set_lane(prot[c], lane, get_lane(pblock.mWorldRot[c], plane));
+            }
+        }
+
+        if (!dirty_lanes)
+        {
+            continue;
+        }
+
+        // offset from the parent, in the parent's scale
+        LLVector4a ax, ay, az;
+        ax.setMul(block.mPos[0], pscale[0]);
+        ay.setMul(block.mPos[1], pscale[1]);
+        az.setMul(block.mPos[2], pscale[2]);
+
+        // rotated by the parent's world rotation, as LLVector3 * LLQuaternion
+        const LLVector4a& qx = prot[0];
+        const LLVector4a& qy = prot[1];
+        const LLVector4a& qz = prot[2];
+        const LLVector4a& qw = prot[3];
+
+        LLVector4a t0, t1;
+        LLVector4a rw, rx, ry, rz;
+        rw.setMul(qx, ax);
+        t0.setMul(qy, ay);
+        rw.add(t0);
+        t0.setMul(qz, az);
+        rw.add(t0);
+        rw.setSub(zero, rw);
+
+        rx.setMul(qw, ax);
+        t0.setMul(qy, az);
+        t1.setMul(qz, ay);
+        rx.add(t0);
+        rx.sub(t1);
+
+        ry.setMul(qw, ay);
+        t0.setMul(qz, ax);
+        t1.setMul(qx, az);
+        ry.add(t0);
+        ry.sub(t1);
+
+        rz.setMul(qw, az);
+        t0.setMul(qx, ay);
+        t1.setMul(qy, ax);
+        rz.add(t0);
+        rz.sub(t1);
+
+        LLVector4a wpos[3];
+        // nx = -rw qx + rx qw - ry qz + rz qy
+        wpos[0].setMul(rx, qw);
+        t0.setMul(rw, qx);
+        wpos[0].sub(t0);
+        t0.setMul(ry, qz);
+        wpos[0].sub(t0);
+        t0.setMul(rz, qy);
+        wpos[0].add(t0);
+        // ny = -rw qy + ry qw - rz qx + rx qz
+        wpos[1].setMul(ry, qw);
+        t0.setMul(rw, qy);
+        wpos[1].sub(t0);
+        t0.setMul(rz, qx);
+        wpos[1].sub(t0);
+        t0.setMul(rx, qz);
+        wpos[1].add(t0);
+        // nz = -rw qz + rz qw - rx qy + ry qx
+        wpos[2].setMul(rz, qw);
+        t0.setMul(rw, qz);
+        wpos[2].sub(t0);
+        t0.setMul(rx, qy);
+        wpos[2].sub(t0);
+        t0.setMul(ry, qx);
+        wpos[2].add(t0);
+
+        for (U32 c = 0; c < 3; ++c)
+        {
+            wpos[c].add(ppos[c]);
+        }
+
+        // world rotation, as LLQuaternion a * b with a the local rotation
+        const LLVector4a& a0 = block.mRot[0];
+        const LLVector4a& a1 = block.mRot[1];
+        const LLVector4a& a2 = block.mRot[2];
+        const LLVector4a& a3 = block.mRot[3];
+
+        LLVector4a wrot[4];
+        wrot[0].setMul(qw, a0);
+        t0.setMul(qx, a3);
+        wrot[0].add(t0);
+        t0.setMul(qy, a2);
+        wrot[0].add(t0);
+        t0.setMul(qz, a1);
+        wrot[0].sub(t0);
+
+        wrot[1].setMul(qw, a1);
+        t0.setMul(qy, a3);
+        wrot[1].add(t0);
+        t0.setMul(qz, a0);
+        wrot[1].add(t0);
+        t0.setMul(qx, a2);
+        wrot[1].sub(t0);
+
+        wrot[2].setMul(qw, a2);
+        t0.setMul(qz, a3);
+        wrot[2].add(t0);
+        t0.setMul(qx, a1);
+        wrot[2].add(t0);
+        t0.setMul(qy, a0);
+        wrot[2].sub(t0);
+
+        wrot[3].setMul(qw, a3);
+        t0.setMul(qx, a0);
+        wrot[3].sub(t0);
+        t0.setMul(qy, a1);
+        wrot[3].sub(t0);
+        t0.setMul(qz, a2);
+        wrot[3].sub(t0);
+
+        // keep the read back values of the joints not computed
+        LLVector4Logical mask;
+        mask.clear();
+        if (dirty_lanes & 1) mask.setElement<0>();
+        if (dirty_lanes & 2) mask.setElement<1>();
+        if (dirty_lanes & 4) mask.setElement<2>();
+        if (dirty_lanes & 8) mask.setElement<3>();
+
+        for (U32 c = 0; c < 3; ++c)
+        {
+            block.mWorldPos[c].setSelectWithMask(mask, wpos[c], block.mWorldPos[c]);
+        }
+        for (U32 c = 0; c < 4; ++c)
+        {
+            block.mWorldRot[c].setSelectWithMask(mask, wrot[c], block.mWorldRot[c]);
+        }
+
+        // rotation matrix, as LLMatrix4::initAll()
+        LLVector4a xx, xy, xz, xw, yy, yz, yw, zz, zw;
+        xx.setMul(wrot[0], wrot[0]);
+        xy.setMul(wrot[0], wrot[1]);
+        xz.setMul(wrot[0], wrot[2]);
+        xw.setMul(wrot[0], wrot[3]);
+        yy.setMul(wrot[1], wrot[1]);
+        yz.setMul(wrot[1], wrot[2]);
+        yw.setMul(wrot[1], wrot[3]);
+        zz.setMul(wrot[2], wrot[2]);
+        zw.setMul(wrot[2], wrot[3]);
+
+        LLVector4a m[3][3];
+        t0.setAdd(yy, zz);
+        t0.mul(two);
+        m[0][0].setSub(one, t0);
+        m[0][1].setAdd(xy, zw);
+        m[0][1].mul(two);
+        m[0][2].setSub(xz, yw);
+        m[0][2].mul(two);
+
+        m[1][0].setSub(xy, zw);
+        m[1][0].mul(two);
+        t0.setAdd(xx, zz);
+        t0.mul(two);
+        m[1][1].setSub(one, t0);
+        m[1][2].setAdd(yz, xw);
+        m[1][2].mul(two);
+
+        m[2][0].setAdd(xz, yw);
+        m[2][0].mul(two);
+        m[2][1].setSub(yz, xw);
+        m[2][1].mul(two);
+        t0.setAdd(xx, yy);
+        t0.mul(two);
+        m[2][2].setSub(one, t0);
+
+        for (U32 r = 0; r < 3; ++r)
+        {
+            for (U32 c = 0; c < 3; ++c)
+            {
+                m[r][c].mul(block.mScale[r]);
+            }
+        }
+
+        // back to one matrix per joint, row by row
+        LLMatrix4a out[4];
+        for (U32 r = 0; r < 3; ++r)
+        {
+            __m128 c0 = m[r][0], c1 = m[r][1], c2 = m[r][2], c3 = zero;
+            _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+            out[0].mMatrix[r] = c0;
+            out[1].mMatrix[r] = c1;
+            out[2].mMatrix[r] = c2;
+            out[3].mMatrix[r] = c3;
+        }
+        {
+            __m128 c0 = wpos[0], c1 = wpos[1], c2 = wpos[2], c3 = one;
+            _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+            out[0].mMatrix[3] = c0;
+            out[1].mMatrix[3] = c1;
+            out[2].mMatrix[3] = c2;
+            out[3].mMatrix[3] = c3;
+        }
+
+        for (U32 lane = 0; lane < 4; ++lane)
+        {
+            if (!(dirty_lanes & (1 << lane)))
+            {
+                continue;
+            }
+
+            LLJoint* joint = mJoints[base + lane];
+
+            LLMatrix4 world_matrix;
+            for (U32 r = 0; r < 4; ++r)
+            {
+                _mm_storeu_ps(world_matrix.mMatrix[r], out[lane].mMatrix[r]);
+            }
+
+            LLVector3 world_pos(get_lane(wpos[0], lane), get_lane(wpos[1], lane), get_lane(wpos[2], lane));
+            LLQuaternion world_rot(get_lane(wrot[0], lane), get_lane(wrot[1], lane), get_lane(wrot[2], lane), get_lane(wrot[3], lane));
+
+            joint->mXform.setWorldTransform(world_pos, world_rot, world_matrix);
+            joint->mWorldMatrix = out[lane];
+            joint->mDirtyFlags = 0x0;
+            LLJoint::sNumUpdates++;
+        }
+    }
+}
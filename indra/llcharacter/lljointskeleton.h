@@ -0,0 +1,99 @@
+/**
+ * @file lljointskeleton.h
+ * @brief Flattened joint hierarchy with batched world matrix updates.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLJOINTSKELETON_H
+#define LL_LLJOINTSKELETON_H
+
+#include "llmath.h"
+#include "llvector4a.h"
+
+#include <vector>
+
+class LLJoint;
+
+// A joint hierarchy laid out flat for updateWorldMatrices(), which does
+// the work of LLJoint::updateWorldMatrixChildren() without recursing.
+//
+// Joints are stored breadth first, so every joint of a level depends only
+// on the level above it, and each level is evaluated four joints at a time
+// with local and world position, rotation and scale kept structure of
+// arrays: one LLVector4a per component holding that component for four
+// joints.  The LLJoints stay the public view of the skeleton; their local
+// transforms are read from them and world results written back to them, so
+// getWorldMatrix() and friends keep working unchanged.
+//
+// Any change to any joint hierarchy invalidates the layout, which is then
+// rebuilt on the next update.
+class LLJointSkeleton
+{
+public:
+    LLJointSkeleton();
+    ~LLJointSkeleton();
+
+    // Bring the world matrices of root and all its descendants up to date,
+    // honoring dirty flags and mUpdateXform like updateWorldMatrixChildren().
+    void updateWorldMatrices(LLJoint* root);
+
+    // forget the layout, e.g. before the joints are destroyed
+    void clear();
+
+    S32 getNumJoints() const { return (S32) mJoints.size(); }
+
+private:
+    void rebuild(LLJoint* root);
+
+    // four joints, one component per lane
+    struct Block
+    {
+        LLVector4a mPos[3];
+        LLVector4a mRot[4];
+        LLVector4a mScale[3];
+        LLVector4a mWorldPos[3];
+        LLVector4a mWorldRot[4];
+    };
+
+    void gather(U32 first, U32 count);
+    void evaluate(U32 first, U32 count);
+
+    LLJoint* mRoot;
+    U32 mTopologySerial;
+
+    // breadth first
+    std::vector<LLJoint*> mJoints;
+    // index of each joint's parent, -1 for the root
+    std::vector<S32> mParents;
+    // first joint of each level, plus one past the last joint
+    std::vector<U32> mLevels;
+
+    // joint i is lane i % 4 of block i / 4
+    std::vector<Block> mBlocks;
+
+    // per joint, rebuilt each update: 1 if the world matrix needs computing,
+    // 2 if it and its descendants are left alone (mUpdateXform unset)
+    std::vector<U8> mState;
+};
+
+#endif // LL_LLJOINTSKELETON_H
@@ -116,11 +116,80 @@ U32 LLKeyframeMotion::JointMotionList::dumpDiagInfo()
 			total_size += joint_motion_p->mPositionCurve.mNumKeys * sizeof(PositionKey);
 		}
 	}
+	total_size += (mRotationRanges.size() + mPositionRanges.size()) * sizeof(KeyRange);
+	total_size += (mRotationTimes.size() + mPositionTimes.size()) * sizeof(F32);
+	total_size += (mRotationValues.size() + mPositionValues.size()) * sizeof(U16);
 	LL_INFOS() << "Size: " << total_size << " bytes" << LL_ENDL;
 
 	return total_size;
 }
 
+//-----------------------------------------------------------------------------
+// compileKeys()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::JointMotionList::compileKeys()
+{
+	U32 num_joints = getNumJointMotions();
+	U32 num_rot_keys = 0;
+	U32 num_pos_keys = 0;
+	for (JointMotion* joint_motion : mJointMotionArray)
+	{
+		num_rot_keys += joint_motion->mRotationCurve.mKeys.size();
+		num_pos_keys += joint_motion->mPositionCurve.mKeys.size();
+	}
+
+	mRotationRanges.resize(num_joints);
+	mRotationTimes.clear();
+	mRotationTimes.reserve(num_rot_keys);
+	mRotationValues.clear();
+	mRotationValues.reserve(num_rot_keys * 4);
+	mPositionRanges.resize(num_joints);
+	mPositionTimes.clear();
+	mPositionTimes.reserve(num_pos_keys);
+	mPositionValues.clear();
+	mPositionValues.reserve(num_pos_keys * 3);
+
+	for (U32 i = 0; i < num_joints; i++)
+	{
+		JointMotion* joint_motion = mJointMotionArray[i];
+
+		// std::map keeps the keys sorted by time
+		const RotationCurve& rot_curve = joint_motion->mRotationCurve;
+		KeyRange& rot_range = mRotationRanges[i];
+		rot_range.mFirst = mRotationTimes.size();
+		rot_range.mCount = rot_curve.mNumKeys ? rot_curve.mKeys.size() : 0;
+		rot_range.mStep = rot_curve.mInterpolationType == IT_STEP;
+		if (rot_range.mCount)
+		{
+			for (const RotationCurve::key_map_t::value_type& key : rot_curve.mKeys)
+			{
+				mRotationTimes.push_back(key.first);
+				for (U32 c = 0; c < 4; c++)
+				{
+					mRotationValues.push_back(F32_to_U16_ROUND(key.second.mRotation.mQ[c], -1.f, 1.f));
+				}
+			}
+		}
+
+		const PositionCurve& pos_curve = joint_motion->mPositionCurve;
+		KeyRange& pos_range = mPositionRanges[i];
+		pos_range.mFirst = mPositionTimes.size();
+		pos_range.mCount = pos_curve.mNumKeys ? pos_curve.mKeys.size() : 0;
+		pos_range.mStep = pos_curve.mInterpolationType == IT_STEP;
+		if (pos_range.mCount)
+		{
+			for (const PositionCurve::key_map_t::value_type& key : pos_curve.mKeys)
+			{
+				mPositionTimes.push_back(key.first);
+				for (U32 c = 0; c < 3; c++)
+				{
+					mPositionValues.push_back(F32_to_U16_ROUND(key.second.mPosition.mV[c], -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET));
+				}
+			}
+		}
+	}
+}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 // ****Curve classes
@@ -729,19 +798,252 @@ BOOL LLKeyframeMotion::onUpdate(F32 time, U8* joint_mask)
 	return mLastLoopedTime <= mJointMotionList->mDuration;
 }
 
+//-----------------------------------------------------------------------------
+// KeySampler
+//-----------------------------------------------------------------------------
+LLKeyframeMotion::KeySampler::KeySampler(U32 components, const F32* times, const U16* values, F32 lower, F32 upper)
+:	mComponents(components),
+	mTimes(times),
+	mValues(values),
+	mLower(lower),
+	mScale((upper - lower) * OOU16MAX),
+	mCount(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+// KeySampler::add()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::KeySampler::add(LLJointState* joint_state, const JointMotionList::KeyRange& range, U32& cursor, F32 time)
+{
+	if (!range.mCount)
+	{
+		return;
+	}
+
+	const F32* times = mTimes + range.mFirst;
+	U32 count = range.mCount;
+
+	// first key at or after time, as std::map::lower_bound(); usually
+	// the same key as last update or the one after it
+	U32 right = cursor;
+	if (!isLowerBound(times, count, right, time))
+	{
+		right = cursor + 1;
+		if (!isLowerBound(times, count, right, time))
+		{
+			right = std::lower_bound(times, times + count, time) - times;
+		}
+	}
+	cursor = right;
+
+	U32 before;
+	U32 after;
+	F32 u = 0.f;
+	if (right == count)
+	{ // past last key
+		before = after = count - 1;
+	}
+	else if (right == 0 || times[right] == time || range.mStep)
+	{ // before first key, exactly on a key, or holding the previous one
+		before = after = (right == 0 || times[right] == time) ? right : right - 1;
+	}
+	else
+	{ // between two keys
+		before = right - 1;
+		after = right;
+		u = (time - times[before]) / (times[after] - times[before]);
+	}
+
+	U32 lane = mCount;
+	mJointStates[lane] = joint_state;
+	const U16* before_values = mValues + (range.mFirst + before) * mComponents;
+	const U16* after_values = mValues + (range.mFirst + after) * mComponents;
+	for (U32 c = 0; c < mComponents; c++)
+	{
+		mBefore[c][lane] = before_values[c];
+		mAfter[c][lane] = after_values[c];
+	}
+	mU[lane] = u;
+
+	if (++mCount == 4)
+	{
+		flush();
+	}
+}
+
+//-----------------------------------------------------------------------------
+// KeySampler::flush()
+//-----------------------------------------------------------------------------
+void LLKeyframeMotion::KeySampler::flush()
+{
+	if (!mCount)
+	{
+		return;
+	}
+
+	for (U32 lane = mCount; lane < 4; lane++)
+	{ // unused lanes repeat the first
+		for (U32 c = 0; c < mComponents; c++)
+		{
+			mBefore[c][lane] = mBefore[c][0];
+			mAfter[c][lane] = mAfter[c][0];
+		}
+		mU[lane] = 0.f;
+	}
+
+	LLVector4a u;
+	u.loadua(mU);
+	LLVector4a lower;
+	lower.splat(mLower);
+	LLVector4a scale;
+	scale.splat(mScale);
+
+	LLVector4a value[4];
+	LLVector4a before[4];
+	LLVector4a after[4];
+	for (U32 c = 0; c < mComponents; c++)
+	{
+		before[c] = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*) mBefore[c]));
+		after[c] = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*) mAfter[c]));
+		before[c].mul(scale);
+		before[c].add(lower);
+		after[c].mul(scale);
+		after[c].add(lower);
+
+		// before + u * (after - before)
+		value[c].setSub(after[c], before[c]);
+		value[c].mul(u);
+		value[c].add(before[c]);
+	}
+
+	if (mComponents == 4)
+	{
+		applyRotations(value, before, after);
+	}
+	else
+	{
+		for (U32 lane = 0; lane < mCount; lane++)
+		{
+			LLVector3 position(value[0][lane], value[1][lane], value[2][lane]);
+			llassert(position.isFinite());
+			mJointStates[lane]->setPosition(position);
+		}
+	}
+
+	mCount = 0;
+}
+
+//static
+bool LLKeyframeMotion::KeySampler::isLowerBound(const F32* times, U32 count, U32 right, F32 time)
+{
+	return right <= count
+		&& (right == count || times[right] >= time)
+		&& (right == 0 || times[right - 1] < time);
+}
+
+// nlerp() for four rotations, which is a normalized lerp for keys in
+// the same hemisphere and a slerp otherwise
+void LLKeyframeMotion::KeySampler::applyRotations(LLVector4a* value, const LLVector4a* before, const LLVector4a* after)
+{
+	LLVector4a dot;
+	dot.setMul(before[0], after[0]);
+	for (U32 c = 1; c < 4; c++)
+	{
+		LLVector4a t;
+		t.setMul(before[c], after[c]);
+		dot.add(t);
+	}
+
+	LLVector4a mag_sq;
+	mag_sq.setMul(value[0], value[0]);
+	for (U32 c = 1; c < 4; c++)
+	{
+		LLVector4a t;
+		t.setMul(value[c], value[c]);
+		mag_sq.add(t);
+	}
+	LLVector4a mag = _mm_sqrt_ps(mag_sq);
+	for (U32 c = 0; c < 4; c++)
+	{
+		value[c].div(mag);
+	}
+
+	for (U32 lane = 0; lane < mCount; lane++)
+	{
+		LLQuaternion rotation;
+		if (dot[lane] < 0.f)
+		{
+			LLQuaternion q0(before[0][lane], before[1][lane], before[2][lane], before[3][lane]);
+			LLQuaternion q1(after[0][lane], after[1][lane], after[2][lane], after[3][lane]);
+			rotation = slerp(mU[lane], q0, q1);
+		}
+		else if (mag[lane] > FP_MAG_THRESHOLD)
+		{
+			rotation.set(value[0][lane], value[1][lane], value[2][lane], value[3][lane]);
+		}
+		mJointStates[lane]->setRotation(rotation);
+	}
+}
+
 //-----------------------------------------------------------------------------
 // applyKeyframes()
 //-----------------------------------------------------------------------------
 void LLKeyframeMotion::applyKeyframes(F32 time)
 {
-	llassert_always (mJointMotionList->getNumJointMotions() <= mJointStates.size());
-	for (U32 i=0; i<mJointMotionList->getNumJointMotions(); i++)
+	LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+
+	U32 num_joints = mJointMotionList->getNumJointMotions();
+	llassert_always (num_joints <= mJointStates.size());
+
+	if (mRotationCursors.size() != num_joints)
 	{
-		mJointMotionList->getJointMotion(i)->update(mJointStates[i],
-													  time, 
-													  mJointMotionList->mDuration );
+		mRotationCursors.assign(num_joints, 0);
+		mPositionCursors.assign(num_joints, 0);
 	}
 
+	KeySampler rot_sampler(4, mJointMotionList->mRotationTimes.data(), mJointMotionList->mRotationValues.data(), -1.f, 1.f);
+	KeySampler pos_sampler(3, mJointMotionList->mPositionTimes.data(), mJointMotionList->mPositionValues.data(), -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+
+	// the pose blender would drop the other joints anyway
+	bool base_joints_only = mCharacter->getMotionController().getBaseJointsOnly();
+
+	for (U32 i = 0; i < num_joints; i++)
+	{
+		LLJointState* joint_state = mJointStates[i];
+		// see JointMotion::update()
+		if (joint_state == NULL)
+		{
+			continue;
+		}
+
+		if (base_joints_only && joint_state->getJoint() && joint_state->getJoint()->getSupport() != LLJoint::SUPPORT_BASE)
+		{
+			continue;
+		}
+
+		U32 usage = joint_state->getUsage();
+
+		ScaleCurve& scale_curve = mJointMotionList->getJointMotion(i)->mScaleCurve;
+		if ((usage & LLJointState::SCALE) && scale_curve.mNumKeys)
+		{ // the asset format has no scale keys, left uncompiled
+			joint_state->setScale(scale_curve.getValue(time, mJointMotionList->mDuration));
+		}
+
+		if (usage & LLJointState::ROT)
+		{
+			rot_sampler.add(joint_state, mJointMotionList->mRotationRanges[i], mRotationCursors[i], time);
+		}
+
+		if (usage & LLJointState::POS)
+		{
+			pos_sampler.add(joint_state, mJointMotionList->mPositionRanges[i], mPositionCursors[i], time);
+		}
+	}
+
+	rot_sampler.flush();
+	pos_sampler.flush();
+
 	LLJoint::JointPriority* pose_priority = (LLJoint::JointPriority* )mCharacter->getAnimationData("Hand Pose Priority");
 	if (pose_priority)
 	{
@@ -1985,6 +2287,8 @@ BOOL LLKeyframeMotion::deserialize(LLDataPacker& dp, const LLUUID& asset_id, boo
 		}
 	}
 
+	joint_motion_list->compileKeys();
+
 	// *FIX: support cleanup of old keyframe data
     mJointMotionList = joint_motion_list.release(); // release from unique_ptr to member;
 	LLKeyframeDataCache::addKeyframeData(getID(),  mJointMotionList);
@@ -45,6 +45,7 @@
 
 class LLKeyframeDataCache;
 class LLDataPacker;
+class LLVector4a;
 
 #define MIN_REQUIRED_PIXEL_AREA_KEYFRAME (40.f)
 #define MAX_CHAIN_LENGTH (4)
@@ -413,21 +414,80 @@ public:
 		// TODO: LLKeyframeDataCache::getKeyframeData should probably return a class containing 
 		// JointMotionList and mEmoteName, see LLKeyframeMotion::onInitialize.
 		std::string				mEmoteName; 
+
+		// Rotation and position keys of every joint, compiled by compileKeys()
+		// into flat arrays for applyKeyframes(): times sorted per curve,
+		// values quantized to 16 bits per component.  Indexed like
+		// mJointMotionArray, and shared with it by every motion playing
+		// this animation.
+		struct KeyRange
+		{
+			U32		mFirst;
+			U32		mCount;		// 0 if the joint has no such curve
+			bool	mStep;		// IT_STEP, hold each key until the next
+		};
+		std::vector<KeyRange>	mRotationRanges;
+		std::vector<F32>		mRotationTimes;
+		std::vector<U16>		mRotationValues;	// x, y, z, w per key
+		std::vector<KeyRange>	mPositionRanges;
+		std::vector<F32>		mPositionTimes;
+		std::vector<U16>		mPositionValues;	// x, y, z per key
 	public:
 		JointMotionList();
 		~JointMotionList();
 		U32 dumpDiagInfo();
+		void compileKeys();
 		JointMotion* getJointMotion(U32 index) const { llassert(index < mJointMotionArray.size()); return mJointMotionArray[index]; }
 		U32 getNumJointMotions() const { return mJointMotionArray.size(); }
 	};
 
+	//-------------------------------------------------------------------------
+	// KeySampler
+	// Evaluates compiled curves of one kind for up to four joints at a
+	// time, one lane per joint: keys are found per joint, then dequantized
+	// and interpolated together.
+	//-------------------------------------------------------------------------
+	class KeySampler
+	{
+	public:
+		KeySampler(U32 components, const F32* times, const U16* values, F32 lower, F32 upper);
+
+		// Queue the value of the curve in range at time for joint_state,
+		// using and updating cursor.
+		void add(LLJointState* joint_state, const JointMotionList::KeyRange& range, U32& cursor, F32 time);
+
+		// evaluate and apply what is queued
+		void flush();
+
+	private:
+		static bool isLowerBound(const F32* times, U32 count, U32 right, F32 time);
+		void applyRotations(LLVector4a* value, const LLVector4a* before, const LLVector4a* after);
+
+		U32				mComponents;
+		const F32*		mTimes;
+		const U16*		mValues;
+		F32				mLower;
+		F32				mScale;
+
+		U32				mCount;
+		LLJointState*	mJointStates[4];
+		S32				mBefore[4][4];	// component, lane
+		S32				mAfter[4][4];
+		F32				mU[4];
+	};
+
 protected:
+
 	JointMotionList*				mJointMotionList;
 	std::vector<LLPointer<LLJointState> > mJointStates;
 	LLJoint*						mPelvisp;
 	LLCharacter*					mCharacter;
 	typedef std::list<JointConstraint*>	constraint_list_t;
 	constraint_list_t				mConstraints;
+	// per compiled curve, the key found by the last update, where the next
+	// search starts
+	std::vector<U32>				mRotationCursors;
+	std::vector<U32>				mPositionCursors;
 	U32								mLastSkeletonSerialNum;
 	F32								mLastUpdateTime;
 	F32								mLastLoopedTime;
@@ -131,6 +131,7 @@ LLMotionController::LLMotionController()
 	: mTimeFactor(sCurrentTimeFactor),
 	  mCharacter(NULL),
 	  mAnimTime(0.f),
+	  mClockTime(0.f),
 	  mPrevTimerElapsed(0.f),
 	  mLastTime(0.0f),
 	  mHasRunOnce(FALSE),
@@ -139,6 +140,7 @@ LLMotionController::LLMotionController()
 	  mTimeStep(0.f),
 	  mTimeStepCount(0),
 	  mLastInterp(0.f),
+	  mNumBlendedJoints(0),
 	  mIsSelf(FALSE),
 	  mLastCountAfterPurge(0)
 {
@@ -264,9 +266,18 @@ void LLMotionController::deactivateStoppedMotions()
 //-----------------------------------------------------------------------------
 void LLMotionController::setTimeStep(F32 step)
 {
+	if (step == mTimeStep)
+	{
+		return;
+	}
 	mTimeStep = step;
 
-	if (step != 0.f)
+	if (step == 0.f)
+	{
+		// carry on from the last quantum, which is a little ahead
+		mClockTime = mAnimTime;
+	}
+	else
 	{
 		// make sure timestamps conform to new quantum
 		for (motion_list_t::iterator iter = mActiveMotions.begin();
@@ -811,10 +822,20 @@ void LLMotionController::updateLoadingMotions()
 void LLMotionController::updateMotions(bool force_update)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
-    // SL-763: "Distant animated objects run at super fast speed"
-    // The use_quantum optimization or possibly the associated code in setTimeStamp()
-    // does not work as implemented.
-    // Currently setting mTimeStep to nonzero is disabled elsewhere.
+	if (beginUpdateMotions(force_update))
+	{
+		finishUpdateMotions(force_update);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// beginUpdateMotions()
+//-----------------------------------------------------------------------------
+bool LLMotionController::beginUpdateMotions(bool force_update)
+{
+    // SL-763: "Distant animated objects run at super fast speed" was caused
+    // by advancing time from the quantized mAnimTime, which runs ahead, so
+    // every update started a new quantum.  Time now advances in mClockTime.
 	BOOL use_quantum = (mTimeStep != 0.f);
 
 	// Always update mPrevTimerElapsed
@@ -829,7 +850,8 @@ void LLMotionController::updateMotions(bool force_update)
 	// Update timing info for this time step.
 	if (!mPaused)
 	{
-		F32 update_time = mAnimTime + delta_time * mTimeFactor;
+		F32 update_time = mClockTime + delta_time * mTimeFactor;
+		mClockTime = update_time;
 		if (use_quantum)
 		{
 			F32 time_interval = fmodf(update_time, mTimeStep);
@@ -841,14 +863,19 @@ void LLMotionController::updateMotions(bool force_update)
 				// we're still in same time quantum as before, so just interpolate and exit
 				if (!mPaused)
 				{
+					// the joints are mLastInterp of the way to the cached
+					// pose, cover the same fraction of what remains
 					F32 interp = time_interval / mTimeStep;
-					mPoseBlender.interpolate(interp - mLastInterp);
-					mLastInterp = interp;
+					if (interp > mLastInterp && mLastInterp < 1.f)
+					{
+						mPoseBlender.interpolate((interp - mLastInterp) / (1.f - mLastInterp));
+						mLastInterp = interp;
+					}
 				}
 
 				updateLoadingMotions();
 				
-				return;
+				return false;
 			}
 			
 			// is calculating a new keyframe pose, make sure the last one gets applied
@@ -866,12 +893,24 @@ void LLMotionController::updateMotions(bool force_update)
 	}
 
 	updateLoadingMotions();
-	
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// finishUpdateMotions()
+//-----------------------------------------------------------------------------
+void LLMotionController::finishUpdateMotions(bool force_update)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+	BOOL use_quantum = (mTimeStep != 0.f);
+
 	resetJointSignatures();
 
 	if (mPaused && !force_update)
 	{
 		updateIdleActiveMotions();
+		mNumBlendedJoints = 0;
 	}
 	else
 	{
@@ -882,6 +921,8 @@ void LLMotionController::updateMotions(bool force_update)
 		
 		// update all regular motions
 		updateRegularMotions();
+
+		mNumBlendedJoints = mPoseBlender.getNumActiveBlenders();
 		
 		if (use_quantum)
 		{
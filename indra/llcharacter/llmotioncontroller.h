@@ -132,6 +132,14 @@ public:
 	// deactivates terminated motions`
 	void updateMotions(bool force_update = false);
 
+	// updateMotions() in two steps, so that many characters can be posed in
+	// parallel.  beginUpdateMotions() advances the clock and loads, purges
+	// and activates motions; it must run on the main thread.  If it returns
+	// true, finishUpdateMotions() evaluates the active motions and blends
+	// them into the skeleton, touching nothing outside this character.
+	bool beginUpdateMotions(bool force_update = false);
+	void finishUpdateMotions(bool force_update = false);
+
 	// minimal update (e.g. while hidden)
 	void updateMotionsMinimal();
 
@@ -150,9 +158,18 @@ public:
 	BOOL isPaused() const { return mPaused; }
     S32 getPausedFrame() const { return mPausedFrame; }
 
+	// Evaluate motions only every step seconds, a little ahead of time,
+	// and interpolate the pose in between.  0 evaluates every update.
 	void setTimeStep(F32 step);
     F32 getTimeStep() const { return mTimeStep; }
 
+	// animate only the joints of the base skeleton, see LLPoseBlender
+	void setBaseJointsOnly(bool base_only) { mPoseBlender.setBaseJointsOnly(base_only); }
+	bool getBaseJointsOnly() const { return mPoseBlender.getBaseJointsOnly(); }
+
+	// joints blended by the last update that evaluated motions
+	S32 getNumBlendedJoints() const { return mNumBlendedJoints; }
+
 	void setTimeFactor(F32 time_factor);
 	F32 getTimeFactor() const { return mTimeFactor; }
 
@@ -219,6 +236,7 @@ protected:
 	LLFrameTimer		mTimer;
 	F32					mPrevTimerElapsed;
 	F32					mAnimTime;
+	F32					mClockTime;	// mAnimTime before quantization
 	F32					mLastTime;
 	BOOL				mHasRunOnce;
 	BOOL				mPaused;
@@ -226,6 +244,7 @@ protected:
 	F32					mTimeStep;
 	S32					mTimeStepCount;
 	F32					mLastInterp;
+	S32					mNumBlendedJoints;
 
 	U8					mJointSignature[2][LL_CHARACTER_MAX_ANIMATED_JOINTS];
 private:
@@ -455,7 +455,8 @@ void LLJointStateBlender::resetCachedJoint()
 //-----------------------------------------------------------------------------
 
 LLPoseBlender::LLPoseBlender()
-	: mNextPoseSlot(0)
+	: mNextPoseSlot(0),
+	  mBaseJointsOnly(false)
 {
 }
 
@@ -475,6 +476,11 @@ BOOL LLPoseBlender::addMotion(LLMotion* motion)
 	for(LLJointState* jsp = pose->getFirstJointState(); jsp; jsp = pose->getNextJointState())
 	{
 		LLJoint *jointp = jsp->getJoint();
+		if (mBaseJointsOnly && jointp && jointp->getSupport() != LLJoint::SUPPORT_BASE)
+		{
+			continue;
+		}
+
 		LLJointStateBlender* joint_blender;
 		if (mJointStateBlenderPool.find(jointp) == mJointStateBlenderPool.end())
 		{
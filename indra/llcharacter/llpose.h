@@ -135,6 +135,16 @@ public:
 	void interpolate(F32 u);
 
 	LLPose* getBlendedPose() { return &mBlendedPose; }
+
+	// leave joints outside the base skeleton alone, as their last pose
+	void setBaseJointsOnly(bool base_only) { mBaseJointsOnly = base_only; }
+	bool getBaseJointsOnly() const { return mBaseJointsOnly; }
+
+	// joints blended by the next blendAndApply() or blendAndCache()
+	S32 getNumActiveBlenders() const { return (S32)mActiveBlenders.size(); }
+
+protected:
+	bool		mBaseJointsOnly;
 };
 
 #endif // LL_LLPOSE_H
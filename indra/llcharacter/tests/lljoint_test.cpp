@@ -31,6 +31,7 @@
 #include "v3math.h"
 
 #include "../lljoint.h"
+#include "../lljointskeleton.h"
 
 #include "../test/lltut.h"
 
@@ -221,6 +222,52 @@ namespace tut
 		ensure("2. addChild failed to remove prior parent", llparent1.findJoint("child2") == NULL);
 	}
 
+	// LLJointSkeleton::updateWorldMatrices() against updateWorldMatrixChildren()
+	template<> template<>
+	void lljoint_object::test<15>()
+	{
+		const S32 count = 9;
+		LLJoint ref[count];
+		LLJoint flat[count];
+		LLJoint* trees[2] = { ref, flat };
+		for (LLJoint* joints : trees)
+		{
+			for (S32 i = 1; i < count; ++i)
+			{
+				joints[(i - 1) / 2].addChild(&joints[i]);
+				joints[i].setPosition(LLVector3(0.1f * i, 1.f - 0.2f * i, 0.3f));
+				joints[i].setRotation(LLQuaternion(0.3f * i, LLVector3(1.f, 0.5f * i, -0.25f)));
+				joints[i].setScale(LLVector3(1.f + 0.1f * i, 1.f, 0.9f));
+			}
+			joints[0].setPosition(LLVector3(10.f, 20.f, 30.f));
+			joints[0].setRotation(LLQuaternion(1.f, LLVector3(0.f, 0.f, 1.f)));
+		}
+
+		LLJointSkeleton skeleton;
+		for (S32 pass = 0; pass < 2; ++pass)
+		{
+			if (pass)
+			{ // only part of the hierarchy dirty
+				ref[2].setRotation(LLQuaternion(0.7f, LLVector3(0.f, 1.f, 0.f)));
+				flat[2].setRotation(LLQuaternion(0.7f, LLVector3(0.f, 1.f, 0.f)));
+			}
+
+			ref[0].updateWorldMatrixChildren();
+			skeleton.updateWorldMatrices(&flat[0]);
+
+			for (S32 i = 0; i < count; ++i)
+			{
+				const F32* a = ref[i].getWorldMatrix().mMatrix[0];
+				const F32* b = flat[i].getWorldMatrix().mMatrix[0];
+				for (S32 j = 0; j < 16; ++j)
+				{
+					ensure("world matrix differs", fabsf(a[j] - b[j]) < 0.001f);
+				}
+				ensure("world position differs", dist_vec(ref[i].getWorldPosition(), flat[i].getWorldPosition()) < 0.001f);
+			}
+		}
+	}
+
 
 	/*
 		Test cases for the following not added. They perform operations 
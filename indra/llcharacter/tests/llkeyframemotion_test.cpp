@@ -0,0 +1,227 @@
+/**
+ * @file llkeyframemotion_test.cpp
+ * @date 2024-05-14
+ * @brief Test cases for the compiled keyframe curves of LLKeyframeMotion.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llkeyframemotion.h"
+
+#include "../test/lltut.h"
+#include "../test/lltestrandom.h"
+
+#include <vector>
+
+namespace
+{
+	typedef LLKeyframeMotion::JointMotionList JointMotionList;
+	typedef LLKeyframeMotion::JointMotion JointMotion;
+	typedef LLKeyframeMotion::KeySampler KeySampler;
+
+	// the values are quantized to 16 bits when compiled
+	const F32 ROTATION_TOLERANCE = 1.0e-3f;
+	const F32 POSITION_TOLERANCE = 1.0e-3f;
+
+	LLQuaternion random_rotation(LLTestRandom& rand)
+	{
+		LLQuaternion rot(rand.range(-1.f, 1.f), rand.range(-1.f, 1.f), rand.range(-1.f, 1.f), rand.range(-1.f, 1.f));
+		rot.normalize();
+		return rot;
+	}
+
+	LLVector3 random_position(LLTestRandom& rand)
+	{
+		return LLVector3(rand.range(-LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET),
+						 rand.range(-LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET),
+						 rand.range(-LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET));
+	}
+
+	// a joint with keys at times, the way deserialize() fills it in
+	JointMotion* make_joint_motion(const std::vector<F32>& times, LLKeyframeMotion::InterpolationType interpolation,
+								   LLTestRandom& rand)
+	{
+		JointMotion* joint_motion = new JointMotion;
+		joint_motion->mUsage = LLJointState::ROT | LLJointState::POS;
+		joint_motion->mRotationCurve.mInterpolationType = interpolation;
+		joint_motion->mPositionCurve.mInterpolationType = interpolation;
+		for (F32 time : times)
+		{
+			joint_motion->mRotationCurve.mKeys[time] = LLKeyframeMotion::RotationKey(time, random_rotation(rand));
+			joint_motion->mPositionCurve.mKeys[time] = LLKeyframeMotion::PositionKey(time, random_position(rand));
+		}
+		joint_motion->mRotationCurve.mNumKeys = joint_motion->mRotationCurve.mKeys.size();
+		joint_motion->mPositionCurve.mNumKeys = joint_motion->mPositionCurve.mKeys.size();
+		return joint_motion;
+	}
+
+	bool close_enough(const LLQuaternion& a, const LLQuaternion& b)
+	{
+		for (U32 i = 0; i < 4; i++)
+		{
+			if (fabsf(a.mQ[i] - b.mQ[i]) > ROTATION_TOLERANCE)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool close_enough(const LLVector3& a, const LLVector3& b)
+	{
+		for (U32 i = 0; i < 3; i++)
+		{
+			if (fabsf(a.mV[i] - b.mV[i]) > POSITION_TOLERANCE)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+namespace tut
+{
+	struct llkeyframemotion_data
+	{
+		llkeyframemotion_data()
+		{
+			LLTestRandom rand;
+
+			mKeyTimes.push_back(0.25f);
+			mKeyTimes.push_back(0.5f);
+			mKeyTimes.push_back(1.f);
+			mKeyTimes.push_back(1.125f);
+			mKeyTimes.push_back(2.f);
+
+			std::vector<F32> single_key(1, 0.75f);
+
+			// more joints than one batch of four lanes, with a single key
+			// curve and a stepped curve among them
+			for (U32 i = 0; i < 6; i++)
+			{
+				mList.mJointMotionArray.push_back(make_joint_motion(mKeyTimes, LLKeyframeMotion::IT_LINEAR, rand));
+			}
+			mList.mJointMotionArray.push_back(make_joint_motion(single_key, LLKeyframeMotion::IT_LINEAR, rand));
+			mList.mJointMotionArray.push_back(make_joint_motion(mKeyTimes, LLKeyframeMotion::IT_STEP, rand));
+			mList.mDuration = 2.5f;
+			mList.compileKeys();
+
+			U32 num_joints = mList.getNumJointMotions();
+			for (U32 i = 0; i < num_joints; i++)
+			{
+				mJointStates.push_back(new LLJointState);
+			}
+			mRotationCursors.assign(num_joints, 0);
+			mPositionCursors.assign(num_joints, 0);
+		}
+
+		// samples every joint at time as applyKeyframes() does and checks
+		// them against the curves they were compiled from
+		void check(F32 time)
+		{
+			KeySampler rot_sampler(4, mList.mRotationTimes.data(), mList.mRotationValues.data(), -1.f, 1.f);
+			KeySampler pos_sampler(3, mList.mPositionTimes.data(), mList.mPositionValues.data(),
+								   -LL_MAX_PELVIS_OFFSET, LL_MAX_PELVIS_OFFSET);
+			U32 num_joints = mList.getNumJointMotions();
+			for (U32 i = 0; i < num_joints; i++)
+			{
+				rot_sampler.add(mJointStates[i], mList.mRotationRanges[i], mRotationCursors[i], time);
+				pos_sampler.add(mJointStates[i], mList.mPositionRanges[i], mPositionCursors[i], time);
+			}
+			rot_sampler.flush();
+			pos_sampler.flush();
+
+			for (U32 i = 0; i < num_joints; i++)
+			{
+				JointMotion* joint_motion = mList.getJointMotion(i);
+				std::string where = llformat("joint %d at %f", i, time);
+				ensure("rotation of " + where,
+					   close_enough(mJointStates[i]->getRotation(), joint_motion->mRotationCurve.getValue(time, mList.mDuration)));
+				ensure("position of " + where,
+					   close_enough(mJointStates[i]->getPosition(), joint_motion->mPositionCurve.getValue(time, mList.mDuration)));
+			}
+		}
+
+		JointMotionList mList;
+		std::vector<F32> mKeyTimes;
+		std::vector<LLPointer<LLJointState> > mJointStates;
+		std::vector<U32> mRotationCursors;
+		std::vector<U32> mPositionCursors;
+	};
+	typedef test_group<llkeyframemotion_data> llkeyframemotion_test;
+	typedef llkeyframemotion_test::object llkeyframemotion_object;
+	tut::llkeyframemotion_test llkeyframemotion_testcase("LLKeyframeMotion");
+
+	template<> template<>
+	void llkeyframemotion_object::test<1>()
+	{
+		// compiled ranges cover every key of every curve
+		ensure_equals("rotation ranges", mList.mRotationRanges.size(), (size_t) mList.getNumJointMotions());
+		ensure_equals("position ranges", mList.mPositionRanges.size(), (size_t) mList.getNumJointMotions());
+		for (U32 i = 0; i < mList.getNumJointMotions(); i++)
+		{
+			JointMotion* joint_motion = mList.getJointMotion(i);
+			ensure_equals("rotation keys", mList.mRotationRanges[i].mCount, (U32) joint_motion->mRotationCurve.mKeys.size());
+			ensure_equals("position keys", mList.mPositionRanges[i].mCount, (U32) joint_motion->mPositionCurve.mKeys.size());
+			ensure_equals("stepped", mList.mRotationRanges[i].mStep,
+						  joint_motion->mRotationCurve.mInterpolationType == LLKeyframeMotion::IT_STEP);
+		}
+		ensure_equals("rotation values", mList.mRotationValues.size(), mList.mRotationTimes.size() * 4);
+		ensure_equals("position values", mList.mPositionValues.size(), mList.mPositionTimes.size() * 3);
+	}
+
+	template<> template<>
+	void llkeyframemotion_object::test<2>()
+	{
+		// on every key
+		for (F32 time : mKeyTimes)
+		{
+			check(time);
+		}
+	}
+
+	template<> template<>
+	void llkeyframemotion_object::test<3>()
+	{
+		// between keys, before the first and past the last, playing forward
+		// so the cursors are reused
+		for (F32 time = 0.f; time <= 2.5f; time += 1.f / 45.f)
+		{
+			check(time);
+		}
+	}
+
+	template<> template<>
+	void llkeyframemotion_object::test<4>()
+	{
+		// jumping around, as a loop or a seek does, so the cursors are
+		// searched past
+		const F32 times[] = { 2.4f, 0.3f, 1.9f, 0.1f, 1.0625f, 0.6f, 2.f, 0.75f };
+		for (F32 time : times)
+		{
+			check(time);
+		}
+	}
+}
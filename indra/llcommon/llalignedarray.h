@@ -38,9 +38,13 @@ public:
 	U32 mCapacity;
 
 	LLAlignedArray();
+	LLAlignedArray(const LLAlignedArray& rhs);
 	~LLAlignedArray();
 
+	LLAlignedArray& operator=(const LLAlignedArray& rhs);
+
 	void push_back(const T& elem);
+	void swap(LLAlignedArray& rhs);
 	U32 size() const { return mElementCount; }
 	void resize(U32 size);
 	T* append(S32 N);
@@ -57,6 +61,30 @@ LLAlignedArray<T, alignment>::LLAlignedArray()
 	mCapacity = 0;
 }
 
+template <class T, U32 alignment>
+LLAlignedArray<T, alignment>::LLAlignedArray(const LLAlignedArray& rhs)
+{
+	mArray = NULL;
+	mElementCount = 0;
+	mCapacity = 0;
+	*this = rhs;
+}
+
+template <class T, U32 alignment>
+LLAlignedArray<T, alignment>& LLAlignedArray<T, alignment>::operator=(const LLAlignedArray& rhs)
+{
+	if (this != &rhs)
+	{
+		resize(0);
+		resize(rhs.mElementCount);
+		if (mElementCount)
+		{
+			ll_memcpy_nonaliased_aligned_16((char*) mArray, (char*) rhs.mArray, sizeof(T)*mElementCount);
+		}
+	}
+	return *this;
+}
+
 template <class T, U32 alignment>
 LLAlignedArray<T, alignment>::~LLAlignedArray()
 {
@@ -89,6 +117,14 @@ void LLAlignedArray<T, alignment>::push_back(const T& elem)
 	ll_aligned_free<alignment>(old_buf);
 }
 
+template <class T, U32 alignment>
+void LLAlignedArray<T, alignment>::swap(LLAlignedArray& rhs)
+{
+	std::swap(mArray, rhs.mArray);
+	std::swap(mElementCount, rhs.mElementCount);
+	std::swap(mCapacity, rhs.mCapacity);
+}
+
 template <class T, U32 alignment>
 void LLAlignedArray<T, alignment>::resize(U32 size)
 {
@@ -0,0 +1,87 @@
+/**
+ * @file   llparallelbatch.cpp
+ * @date   2024-05-14
+ * @brief  Implementation for LL::parallelBatch().
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Copyright (c) 2024, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "llparallelbatch.h"
+// STL headers
+#include <atomic>
+#include <memory>
+#include <thread>
+// other Linden headers
+#include "workqueue.h"
+
+namespace
+{
+    // Shared with the helper jobs, which may outlive the call
+    struct Batch
+    {
+        Batch(U32 count, const std::function<void(U32)>& item):
+            mCount(count),
+            mItem(item)
+        {}
+
+        void run()
+        {
+            for (U32 i = mNext++; i < mCount; i = mNext++)
+            {
+                mItem(i);
+                ++mDone;
+            }
+        }
+
+        const U32 mCount;
+        std::function<void(U32)> mItem;
+        std::atomic<U32> mNext { 0 };
+        std::atomic<U32> mDone { 0 };
+    };
+} // anonymous namespace
+
+void LL::parallelBatch(U32 count, U32 helpers, const std::function<void(U32)>& item,
+                       const std::string& queue_name)
+{
+    LL_PROFILE_ZONE_SCOPED;
+
+    helpers = count > 1 ? llmin(helpers, count - 1) : 0;
+    WorkQueue::ptr_t queue;
+    if (helpers)
+    {
+        queue = WorkQueue::getInstance(queue_name);
+    }
+
+    if (!queue)
+    {
+        for (U32 i = 0; i < count; ++i)
+        {
+            item(i);
+        }
+        return;
+    }
+
+    std::shared_ptr<Batch> batch = std::make_shared<Batch>(count, item);
+    for (U32 i = 0; i < helpers; ++i)
+    {
+        if (!queue->post([batch]() { batch->run(); }))
+        {
+            break;
+        }
+    }
+
+    batch->run();
+
+    {
+        LL_PROFILE_ZONE_NAMED("parallelBatch - wait");
+        while (batch->mDone < count)
+        {
+            std::this_thread::yield();
+        }
+    }
+}
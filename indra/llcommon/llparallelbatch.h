@@ -0,0 +1,39 @@
+/**
+ * @file   llparallelbatch.h
+ * @date   2024-05-14
+ * @brief  Spread a batch of short items over the calling thread and a
+ *         WorkQueue, and wait for all of them.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Copyright (c) 2024, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+#if ! defined(LL_LLPARALLELBATCH_H)
+#define LL_LLPARALLELBATCH_H
+
+#include "stdtypes.h"
+#include <functional>
+#include <string>
+
+namespace LL
+{
+    /**
+     * Calls item(i) once for each i in [0, count), and returns when all of
+     * them are done.  The calling thread takes part, along with up to
+     * helpers jobs posted to the named WorkQueue, each of them claiming the
+     * next item nobody has claimed yet.
+     *
+     * Helpers that only start once every item is claimed return without
+     * calling item, so item may refer to the caller's stack.  Only threads
+     * already running claim items, so this never waits on a job still in
+     * the queue and may be called from one of the queue's own threads.
+     *
+     * The calling thread spins while the last items finish elsewhere, so
+     * items should be short.
+     */
+    void parallelBatch(U32 count, U32 helpers, const std::function<void(U32)>& item,
+                       const std::string& queue_name = "General");
+} // namespace LL
+
+#endif /* ! defined(LL_LLPARALLELBATCH_H) */
@@ -0,0 +1,148 @@
+/**
+ * @file llradixsort.h
+ * @brief Stable radix sort on 64 bit keys.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLRADIXSORT_H
+#define LL_LLRADIXSORT_H
+
+#include "stdtypes.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+// Sorts values by an unsigned 64 bit key each, ascending and stable.
+//
+// Least significant digit first, eight bits per pass.  All eight histograms
+// are gathered in one read of the keys, and any digit on which every key
+// agrees is skipped, so keys that pack a few fields into the high bits and
+// leave the rest constant cost only as many passes as they have varying
+// bytes.  Short lists fall back to an insertion sort.
+//
+// Keeps its scratch storage between calls; not thread safe.
+template<typename T>
+class LLRadixSort
+{
+public:
+    // below this many values insertion sort wins
+    static const U32 MIN_RADIX_COUNT = 64;
+
+    // Sort count values in place by the matching entries of keys, which are
+    // reordered along with them.
+    void sort(U64* keys, T* values, U32 count)
+    {
+        if (count < 2)
+        {
+            return;
+        }
+
+        if (count < MIN_RADIX_COUNT)
+        {
+            insertionSort(keys, values, count);
+            return;
+        }
+
+        U32 histogram[8][256];
+        memset(histogram, 0, sizeof(histogram));
+
+        for (U32 i = 0; i < count; ++i)
+        {
+            U64 key = keys[i];
+            for (U32 digit = 0; digit < 8; ++digit)
+            {
+                ++histogram[digit][(key >> (digit * 8)) & 0xFF];
+            }
+        }
+
+        if (mKeys.size() < count)
+        {
+            mKeys.resize(count);
+            mValues.resize(count);
+        }
+
+        U64* src_keys = keys;
+        T* src_values = values;
+        U64* dst_keys = mKeys.data();
+        T* dst_values = mValues.data();
+
+        for (U32 digit = 0; digit < 8; ++digit)
+        {
+            U32* counts = histogram[digit];
+            U32 shift = digit * 8;
+            if (counts[(keys[0] >> shift) & 0xFF] == count)
+            { // every key has the same value in this digit
+                continue;
+            }
+
+            U32 offset = 0;
+            for (U32 i = 0; i < 256; ++i)
+            {
+                U32 c = counts[i];
+                counts[i] = offset;
+                offset += c;
+            }
+
+            for (U32 i = 0; i < count; ++i)
+            {
+                U32 dst = counts[(src_keys[i] >> shift) & 0xFF]++;
+                dst_keys[dst] = src_keys[i];
+                dst_values[dst] = src_values[i];
+            }
+
+            std::swap(src_keys, dst_keys);
+            std::swap(src_values, dst_values);
+        }
+
+        if (src_keys != keys)
+        { // odd number of passes, results are in scratch
+            std::copy(src_keys, src_keys + count, keys);
+            std::copy(src_values, src_values + count, values);
+        }
+    }
+
+private:
+    static void insertionSort(U64* keys, T* values, U32 count)
+    {
+        for (U32 i = 1; i < count; ++i)
+        {
+            U64 key = keys[i];
+            T value = values[i];
+            U32 j = i;
+            while (j > 0 && keys[j - 1] > key)
+            {
+                keys[j] = keys[j - 1];
+                values[j] = values[j - 1];
+                --j;
+            }
+            keys[j] = key;
+            values[j] = value;
+        }
+    }
+
+    std::vector<U64> mKeys;
+    std::vector<T> mValues;
+};
+
+#endif
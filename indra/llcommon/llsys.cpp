@@ -593,6 +593,7 @@ LLCPUInfo::LLCPUInfo()
     mHasSSE41 = proc.hasSSE41();
     mHasSSE42 = proc.hasSSE42();
     mHasSSE4a = proc.hasSSE4a();
+    mHasAVX2 = proc.hasAVX2();
 	mHasAltivec = proc.hasAltivec();
 	mCPUMHz = (F64)proc.getCPUFrequency();
 	mFamily = proc.getCPUFamilyName();
@@ -676,6 +677,11 @@ bool LLCPUInfo::hasSSE4a() const
     return mHasSSE4a;
 }
 
+bool LLCPUInfo::hasAVX2() const
+{
+    return mHasAVX2;
+}
+
 F64 LLCPUInfo::getMHz() const
 {
 	return mCPUMHz;
@@ -705,6 +711,7 @@ void LLCPUInfo::stream(std::ostream& s) const
     s << "->mHasSSE41:    " << (U32)mHasSSE41 << std::endl;
     s << "->mHasSSE42:    " << (U32)mHasSSE42 << std::endl;
     s << "->mHasSSE4a:    " << (U32)mHasSSE4a << std::endl;
+    s << "->mHasAVX2:     " << (U32)mHasAVX2 << std::endl;
 	s << "->mHasAltivec: " << (U32)mHasAltivec << std::endl;
 	s << "->mCPUMHz:     " << mCPUMHz << std::endl;
 	s << "->mCPUString:  " << mCPUString << std::endl;
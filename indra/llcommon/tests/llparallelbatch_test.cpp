@@ -0,0 +1,93 @@
+/**
+ * @file   llparallelbatch_test.cpp
+ * @date   2024-05-14
+ * @brief  Test for llparallelbatch.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Copyright (c) 2024, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+// Precompiled header
+#include "linden_common.h"
+// associated header
+#include "llparallelbatch.h"
+// STL headers
+// std headers
+#include <atomic>
+#include <thread>
+#include <vector>
+// external library headers
+// other Linden headers
+#include "../test/lltut.h"
+#include "workqueue.h"
+
+/*****************************************************************************
+*   TUT
+*****************************************************************************/
+namespace tut
+{
+    struct llparallelbatch_data
+    {
+        // every item counted exactly once
+        void ensure_once(const std::vector<std::atomic<U32>>& counts)
+        {
+            for (const std::atomic<U32>& count : counts)
+            {
+                ensure_equals("item not run exactly once", U32(count), 1u);
+            }
+        }
+    };
+    typedef test_group<llparallelbatch_data> llparallelbatch_group;
+    typedef llparallelbatch_group::object object;
+    llparallelbatch_group llparallelbatchgrp("llparallelbatch");
+
+    template<> template<>
+    void object::test<1>()
+    {
+        set_test_name("no queue");
+        std::vector<std::atomic<U32>> counts(100);
+        LL::parallelBatch((U32) counts.size(), 3, [&counts](U32 i) { ++counts[i]; },
+                          "llparallelbatch_test no such queue");
+        ensure_once(counts);
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        set_test_name("late helpers");
+        // nobody services the queue until the batch is done, so the caller
+        // runs every item and the helpers find nothing left
+        LL::WorkQueue queue("llparallelbatch_test late");
+        std::vector<std::atomic<U32>> counts(100);
+        LL::parallelBatch((U32) counts.size(), 3, [&counts](U32 i) { ++counts[i]; },
+                          "llparallelbatch_test late");
+        ensure_once(counts);
+        queue.close();
+        queue.runUntilClose();
+        ensure_once(counts);
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        set_test_name("helper threads");
+        LL::WorkQueue queue("llparallelbatch_test threads");
+        std::vector<std::thread> threads;
+        for (U32 i = 0; i < 3; ++i)
+        {
+            threads.emplace_back([&queue]() { queue.runUntilClose(); });
+        }
+
+        std::vector<std::atomic<U32>> counts(10000);
+        LL::parallelBatch((U32) counts.size(), 3, [&counts](U32 i) { ++counts[i]; },
+                          "llparallelbatch_test threads");
+        ensure_once(counts);
+
+        queue.close();
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    }
+} // namespace tut
@@ -0,0 +1,104 @@
+/**
+ * @file   llradixsort_test.cpp
+ * @brief  Test for llradixsort.h.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../llradixsort.h"
+
+#include "../test/lltut.h"
+
+#include <vector>
+
+namespace
+{
+    // small deterministic generator so runs are repeatable
+    U64 next_random(U64& state)
+    {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return state;
+    }
+
+    // sort count keys drawn through mask, check against std::stable_sort
+    void check_sort(LLRadixSort<U32>& sorter, U32 count, U64 mask)
+    {
+        U64 state = count;
+        std::vector<U64> keys(count);
+        std::vector<U32> values(count);
+        std::vector<std::pair<U64, U32> > expected(count);
+        for (U32 i = 0; i < count; ++i)
+        {
+            keys[i] = next_random(state) & mask;
+            values[i] = i;
+            expected[i] = std::make_pair(keys[i], i);
+        }
+
+        std::stable_sort(expected.begin(), expected.end(),
+            [](const std::pair<U64, U32>& lhs, const std::pair<U64, U32>& rhs) { return lhs.first < rhs.first; });
+
+        sorter.sort(keys.data(), values.data(), count);
+
+        for (U32 i = 0; i < count; ++i)
+        {
+            tut::ensure_equals("key", keys[i], expected[i].first);
+            tut::ensure_equals("value follows key, ties keep their order", values[i], expected[i].second);
+        }
+    }
+}
+
+namespace tut
+{
+    struct radix_sort
+    {
+        LLRadixSort<U32> mSorter;
+    };
+    typedef test_group<radix_sort> radix_sort_t;
+    typedef radix_sort_t::object radix_sort_object_t;
+    tut::radix_sort_t tut_radix_sort("LLRadixSort");
+
+    template<> template<>
+    void radix_sort_object_t::test<1>()
+    {
+        // short lists take the insertion sort
+        check_sort(mSorter, 0, ~0ULL);
+        check_sort(mSorter, 1, ~0ULL);
+        check_sort(mSorter, 17, ~0ULL);
+        check_sort(mSorter, LLRadixSort<U32>::MIN_RADIX_COUNT - 1, 0xF0F0ULL);
+    }
+
+    template<> template<>
+    void radix_sort_object_t::test<2>()
+    {
+        // full width keys, an odd and an even number of passes, and keys
+        // that only vary in a few bytes
+        check_sort(mSorter, 5000, ~0ULL);
+        check_sort(mSorter, 5000, 0xFF00000000000000ULL);
+        check_sort(mSorter, 5000, 0xFF000000FF000000ULL);
+        check_sort(mSorter, 5000, 0x0000000000000003ULL);
+        check_sort(mSorter, 5000, 0ULL);
+        // scratch is reused at a smaller size
+        check_sort(mSorter, 100, ~0ULL);
+    }
+}
@@ -0,0 +1,133 @@
+/** 
+ * @file llimageblend.cpp
+ * @brief GL style blending of RGBA images on the CPU.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "llimageblend.h"
+
+#include <emmintrin.h>
+
+namespace
+{
+	// A blend factor as k0 + k1 * source alpha + k2 * dest alpha, which comes
+	// out bit for bit the same as the factor itself.
+	void blend_factor_terms(EImageBlendFactor factor, F32* k)
+	{
+		k[0] = k[1] = k[2] = 0.f;
+		switch (factor)
+		{
+			case IMAGE_BLEND_ZERO:
+				break;
+			case IMAGE_BLEND_ONE:
+				k[0] = 1.f;
+				break;
+			case IMAGE_BLEND_SOURCE_ALPHA:
+				k[1] = 1.f;
+				break;
+			case IMAGE_BLEND_ONE_MINUS_SOURCE_ALPHA:
+				k[0] = 1.f;
+				k[1] = -1.f;
+				break;
+			case IMAGE_BLEND_DEST_ALPHA:
+				k[2] = 1.f;
+				break;
+			case IMAGE_BLEND_ONE_MINUS_DEST_ALPHA:
+				k[0] = 1.f;
+				k[2] = -1.f;
+				break;
+			default:
+				llassert(0);
+				break;
+		}
+	}
+
+	// one RGBA8 texel as four normalized floats
+	inline __m128 load_texel(const U8* texel)
+	{
+		S32 packed;
+		memcpy(&packed, texel, 4);
+		const __m128i zero = _mm_setzero_si128();
+		__m128i channels = _mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero);
+		channels = _mm_unpacklo_epi16(channels, zero);
+		return _mm_div_ps(_mm_cvtepi32_ps(channels), _mm_set1_ps(255.f));
+	}
+
+	inline S32 pack_texel(__m128 value)
+	{
+		value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.f));
+		__m128i channels = _mm_cvtps_epi32(_mm_mul_ps(value, _mm_set1_ps(255.f)));
+		channels = _mm_packs_epi32(channels, channels);
+		channels = _mm_packus_epi16(channels, channels);
+		return _mm_cvtsi128_si32(channels);
+	}
+}
+
+void ll_image_blend(U8* dst, const U8* src, S32 pixels, const F32* color, F32 min_alpha,
+					EImageBlendFactor src_factor, EImageBlendFactor dst_factor, bool alpha_only)
+{
+	F32 sk[3];
+	F32 dk[3];
+	blend_factor_terms(src_factor, sk);
+	blend_factor_terms(dst_factor, dk);
+
+	const __m128 sk0 = _mm_set1_ps(sk[0]);
+	const __m128 sk1 = _mm_set1_ps(sk[1]);
+	const __m128 sk2 = _mm_set1_ps(sk[2]);
+	const __m128 dk0 = _mm_set1_ps(dk[0]);
+	const __m128 dk1 = _mm_set1_ps(dk[1]);
+	const __m128 dk2 = _mm_set1_ps(dk[2]);
+	const __m128 vertex_color = _mm_loadu_ps(color);
+
+	for (S32 i = 0; i < pixels; ++i)
+	{
+		U8* texel = dst + i * 4;
+
+		__m128 s = src ? _mm_mul_ps(vertex_color, load_texel(src + i * 4)) : vertex_color;
+		__m128 sa = _mm_shuffle_ps(s, s, _MM_SHUFFLE(3, 3, 3, 3));
+		if (_mm_cvtss_f32(sa) < min_alpha)
+		{ // alpha test
+			continue;
+		}
+
+		__m128 d = load_texel(texel);
+		__m128 da = _mm_shuffle_ps(d, d, _MM_SHUFFLE(3, 3, 3, 3));
+
+		__m128 sf = _mm_add_ps(_mm_add_ps(sk0, _mm_mul_ps(sk1, sa)), _mm_mul_ps(sk2, da));
+		__m128 df = _mm_add_ps(_mm_add_ps(dk0, _mm_mul_ps(dk1, sa)), _mm_mul_ps(dk2, da));
+		__m128 res = _mm_add_ps(_mm_mul_ps(s, sf), _mm_mul_ps(d, df));
+
+		S32 packed = pack_texel(res);
+		if (alpha_only)
+		{
+			texel[3] = ((U8*) &packed)[3];
+		}
+		else
+		{
+			memcpy(texel, &packed, 4);
+		}
+	}
+}
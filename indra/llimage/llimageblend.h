@@ -0,0 +1,55 @@
+/** 
+ * @file llimageblend.h
+ * @brief GL style blending of RGBA images on the CPU.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+
+#ifndef LL_LLIMAGEBLEND_H
+#define LL_LLIMAGEBLEND_H
+
+#include "stdtypes.h"
+
+// Blend factors, as glBlendFunc() takes them.
+typedef enum e_image_blend_factor
+{
+	IMAGE_BLEND_ZERO = 0,
+	IMAGE_BLEND_ONE,
+	IMAGE_BLEND_SOURCE_ALPHA,
+	IMAGE_BLEND_ONE_MINUS_SOURCE_ALPHA,
+	IMAGE_BLEND_DEST_ALPHA,
+	IMAGE_BLEND_ONE_MINUS_DEST_ALPHA
+} EImageBlendFactor;
+
+// Draws one image over another the way a full screen quad would be drawn
+// into an RGBA8 render target with blending on: each fragment is color (RGBA,
+// 0 to 1) times its src texel, or color alone when src is NULL, fragments
+// with alpha below min_alpha are discarded, and the rest become
+// src * src_factor + dst * dst_factor, clamped and rounded back to 8 bits.
+// With alpha_only set only the alpha channel of dst is written.  src and dst
+// are 4 component and pixels long; the math is done a pixel at a time, four
+// channels wide.
+void ll_image_blend(U8* dst, const U8* src, S32 pixels, const F32* color, F32 min_alpha,
+					EImageBlendFactor src_factor, EImageBlendFactor dst_factor, bool alpha_only);
+
+#endif
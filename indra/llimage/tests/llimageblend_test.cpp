@@ -0,0 +1,181 @@
+/** 
+ * @file llimageblend_test.cpp
+ * @brief Tests for the CPU image blend kernel.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+
+#include "linden_common.h"
+
+#include "../llimageblend.h"
+
+#include "../test/lltut.h"
+#include "../test/lltestrandom.h"
+
+#include <cmath>
+
+namespace
+{
+	// what GL does with one fragment, written out a channel at a time
+	F32 blend_factor(EImageBlendFactor factor, F32 src_alpha, F32 dst_alpha)
+	{
+		switch (factor)
+		{
+			case IMAGE_BLEND_ONE:					return 1.f;
+			case IMAGE_BLEND_SOURCE_ALPHA:			return src_alpha;
+			case IMAGE_BLEND_ONE_MINUS_SOURCE_ALPHA:	return 1.f - src_alpha;
+			case IMAGE_BLEND_DEST_ALPHA:			return dst_alpha;
+			case IMAGE_BLEND_ONE_MINUS_DEST_ALPHA:	return 1.f - dst_alpha;
+			default:								return 0.f;
+		}
+	}
+
+	void reference_blend(U8* dst, const U8* src, const F32* color, F32 min_alpha,
+						 EImageBlendFactor src_factor, EImageBlendFactor dst_factor, bool alpha_only)
+	{
+		F32 s[4];
+		F32 d[4];
+		for (S32 c = 0; c < 4; ++c)
+		{
+			s[c] = src ? color[c] * ((F32) src[c] / 255.f) : color[c];
+			d[c] = (F32) dst[c] / 255.f;
+		}
+		if (s[3] < min_alpha)
+		{
+			return;
+		}
+
+		F32 sf = blend_factor(src_factor, s[3], d[3]);
+		F32 df = blend_factor(dst_factor, s[3], d[3]);
+		for (S32 c = alpha_only ? 3 : 0; c < 4; ++c)
+		{
+			F32 res = llclamp(s[c] * sf + d[c] * df, 0.f, 1.f);
+			dst[c] = (U8) lrintf(res * 255.f);
+		}
+	}
+}
+
+namespace tut
+{
+	struct image_blend
+	{
+	};
+
+	typedef test_group<image_blend> image_blend_test;
+	typedef image_blend_test::object image_blend_t;
+	image_blend_test tut_image_blend("LLImageBlend");
+
+	// the usual alpha blend of a texture over an opaque target
+	template<> template<>
+	void image_blend_t::test<1>()
+	{
+		const U8 src[4] = { 255, 0, 0, 128 };
+		U8 dst[4] = { 0, 0, 255, 255 };
+		const F32 white[4] = { 1.f, 1.f, 1.f, 1.f };
+
+		ll_image_blend(dst, src, 1, white, 0.004f, IMAGE_BLEND_SOURCE_ALPHA, IMAGE_BLEND_ONE_MINUS_SOURCE_ALPHA, false);
+		ensure_equals("red", dst[0], 128);
+		ensure_equals("green", dst[1], 0);
+		ensure_equals("blue", dst[2], 127);
+		ensure_equals("alpha", dst[3], 191);
+	}
+
+	// fragments under the minimum alpha leave the target alone
+	template<> template<>
+	void image_blend_t::test<2>()
+	{
+		const U8 src[8] = { 255, 255, 255, 1,  255, 255, 255, 2 };
+		U8 dst[8] = { 10, 20, 30, 40,  10, 20, 30, 40 };
+		const F32 white[4] = { 1.f, 1.f, 1.f, 1.f };
+
+		ll_image_blend(dst, src, 2, white, 0.004f, IMAGE_BLEND_ONE, IMAGE_BLEND_ZERO, false);
+		ensure_equals("discarded", dst[0], 10);
+		ensure_equals("discarded alpha", dst[3], 40);
+		ensure_equals("written", dst[4], 255);
+		ensure_equals("written alpha", dst[7], 2);
+	}
+
+	// alpha only draws keep the color, additive ones saturate
+	template<> template<>
+	void image_blend_t::test<3>()
+	{
+		U8 dst[4] = { 10, 20, 30, 200 };
+		const F32 half[4] = { 0.f, 0.f, 0.f, 127.f / 255.f };
+
+		ll_image_blend(dst, NULL, 1, half, 0.f, IMAGE_BLEND_DEST_ALPHA, IMAGE_BLEND_ZERO, true);
+		ensure_equals("color kept", dst[0], 10);
+		ensure_equals("color kept", dst[2], 30);
+		ensure_equals("alpha multiplied", dst[3], 100);
+
+		ll_image_blend(dst, NULL, 1, half, 0.f, IMAGE_BLEND_ONE, IMAGE_BLEND_ONE, true);
+		ensure_equals("alpha added", dst[3], 227);
+		ll_image_blend(dst, NULL, 1, half, 0.f, IMAGE_BLEND_ONE, IMAGE_BLEND_ONE, true);
+		ensure_equals("alpha saturated", dst[3], 255);
+	}
+
+	// every factor pair the bake uses matches the per channel formula
+	template<> template<>
+	void image_blend_t::test<4>()
+	{
+		const EImageBlendFactor factors[] = {
+			IMAGE_BLEND_ZERO, IMAGE_BLEND_ONE, IMAGE_BLEND_SOURCE_ALPHA,
+			IMAGE_BLEND_ONE_MINUS_SOURCE_ALPHA, IMAGE_BLEND_DEST_ALPHA, IMAGE_BLEND_ONE_MINUS_DEST_ALPHA };
+		const S32 PIXELS = 257;
+
+		U8 src[PIXELS * 4];
+		U8 start[PIXELS * 4];
+		LLTestRandom rand;
+		for (S32 i = 0; i < PIXELS * 4; ++i)
+		{
+			src[i] = rand.nextU8();
+			start[i] = rand.nextU8();
+		}
+		const F32 color[4] = { 200.f / 255.f, 1.f, 37.f / 255.f, 180.f / 255.f };
+
+		for (EImageBlendFactor src_factor : factors)
+		{
+			for (EImageBlendFactor dst_factor : factors)
+			{
+				for (S32 textured = 0; textured < 2; ++textured)
+				{
+					for (S32 alpha_only = 0; alpha_only < 2; ++alpha_only)
+					{
+						U8 dst[PIXELS * 4];
+						U8 expected[PIXELS * 4];
+						memcpy(dst, start, sizeof(dst));
+						memcpy(expected, start, sizeof(expected));
+
+						const U8* tex = textured ? src : NULL;
+						ll_image_blend(dst, tex, PIXELS, color, 0.004f, src_factor, dst_factor, alpha_only);
+						for (S32 i = 0; i < PIXELS; ++i)
+						{
+							reference_blend(expected + i * 4, tex ? tex + i * 4 : NULL, color, 0.004f,
+											src_factor, dst_factor, alpha_only);
+						}
+						ensure("matches reference", memcmp(dst, expected, sizeof(dst)) == 0);
+					}
+				}
+			}
+		}
+	}
+}
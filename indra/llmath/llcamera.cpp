@@ -296,6 +296,86 @@ S32 LLCamera::AABBInRegionFrustumNoFarClip(const LLVector4a& center, const LLVec
 	return AABBInFrustumNoFarClip(center, radius, mRegionPlanes);
 }
 
+void LLCamera::AABBInFrustumBatch(const LLVector4a* centers, const LLVector4a* radii, U32 count, U8* results, bool no_far_clip) const
+{
+	// splat each active plane and its sign scaler once for the whole batch
+	LLVector4a plane[AGENT_PLANE_USER_CLIP_NUM][4];
+	LLVector4a scale[AGENT_PLANE_USER_CLIP_NUM][3];
+	U32 num_planes = 0;
+
+	U32 max_planes = llmin(mPlaneCount, (U32) AGENT_PLANE_USER_CLIP_NUM);
+	for (U32 i = 0; i < max_planes; i++)
+	{
+		U8 mask = mPlaneMask[i];
+		if ((!no_far_clip || i != 5) && mask < PLANE_MASK_NUM)
+		{
+			const LLPlane& p(mAgentPlanes[i]);
+			const LLVector4a& s(sFrustumScaler[mask]);
+			for (U32 j = 0; j < 3; ++j)
+			{
+				plane[num_planes][j].splat(p[j]);
+				scale[num_planes][j].splat(s[j]);
+			}
+			plane[num_planes][3].splat(-p[3]);
+			++num_planes;
+		}
+	}
+
+	for (U32 base = 0; base < count; base += 4)
+	{
+		// transpose four boxes into x, y and z lanes, repeating the last box
+		// to fill a partial batch
+		U32 idx[4];
+		for (U32 j = 0; j < 4; ++j)
+		{
+			idx[j] = llmin(base + j, count - 1);
+		}
+
+		LLQuad c0 = centers[idx[0]], c1 = centers[idx[1]], c2 = centers[idx[2]], c3 = centers[idx[3]];
+		LLQuad r0 = radii[idx[0]], r1 = radii[idx[1]], r2 = radii[idx[2]], r3 = radii[idx[3]];
+		_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		const LLVector4a center[3] = { LLVector4a(c0), LLVector4a(c1), LLVector4a(c2) };
+		const LLVector4a radius[3] = { LLVector4a(r0), LLVector4a(r1), LLVector4a(r2) };
+
+		LLVector4a outside, partial;
+		outside.clear();
+		partial.clear();
+
+		for (U32 i = 0; i < num_planes; i++)
+		{
+			// same operation order as LLVector4a::dot3 so results match AABBInFrustum
+			LLVector4a minp[3], maxp[3];
+			for (U32 j = 0; j < 3; ++j)
+			{
+				LLVector4a rscale;
+				rscale.setMul(radius[j], scale[i][j]);
+				minp[j].setSub(center[j], rscale);
+				minp[j].mul(plane[i][j]);
+				maxp[j].setAdd(center[j], rscale);
+				maxp[j].mul(plane[i][j]);
+			}
+
+			LLVector4a dmin, dmax;
+			dmin.setAdd(minp[0], minp[1]);
+			dmin.add(minp[2]);
+			dmax.setAdd(maxp[0], maxp[1]);
+			dmax.add(maxp[2]);
+
+			outside = _mm_or_ps(outside, _mm_cmpgt_ps(dmin, plane[i][3]));
+			partial = _mm_or_ps(partial, _mm_cmpgt_ps(dmax, plane[i][3]));
+		}
+
+		U32 out_bits = _mm_movemask_ps(outside);
+		U32 partial_bits = _mm_movemask_ps(partial);
+		U32 n = llmin(count - base, (U32) 4);
+		for (U32 j = 0; j < n; ++j)
+		{
+			results[base + j] = (out_bits & (1 << j)) ? 0 : ((partial_bits & (1 << j)) ? 1 : 2);
+		}
+	}
+}
+
 int LLCamera::sphereInFrustumQuick(const LLVector3 &sphere_center, const F32 radius) 
 {
 	LLVector3 dist = sphere_center-mFrustCenter;
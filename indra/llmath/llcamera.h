@@ -203,6 +203,12 @@ public:
 	S32 AABBInFrustumNoFarClip(const LLVector4a& center, const LLVector4a& radius, const LLPlane* planes = NULL);
 	S32 AABBInRegionFrustumNoFarClip(const LLVector4a& center, const LLVector4a& radius);
 
+	// Batched AABBInFrustum/AABBInFrustumNoFarClip against the agent planes.
+	// Tests count boxes stored as parallel center and radius arrays, four at a
+	// time, writing 0 (outside), 1 (partly in) or 2 (fully in) per box to
+	// results.  Gives exactly the same answers as the per box calls.
+	void AABBInFrustumBatch(const LLVector4a* centers, const LLVector4a* radii, U32 count, U8* results, bool no_far_clip = false) const;
+
 	//does a quick 'n dirty sphere-sphere check
 	S32 sphereInFrustumQuick(const LLVector3 &sphere_center, const F32 radius); 
 
@@ -0,0 +1,342 @@
+/**
+ * @file llgeometrykernels.cpp
+ * @brief Vectorized per attribute kernels for filling vertex buffers from LLVolumeFaces.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llgeometrykernels.h"
+
+#include "llmatrix4a.h"
+#include "m4math.h"
+#include "v2math.h"
+
+LLTexCoordKernel::LLTexCoordKernel()
+:   mKernel(nullptr),
+    mTransform(TRANSFORM_NONE),
+    mPlanar(false)
+{
+    for (U32 i = 0; i < 3; ++i)
+    {
+        mScale[i].splat(1.f);
+    }
+    for (U32 i = 0; i < 6; ++i)
+    {
+        mXform[i].clear();
+    }
+    select();
+}
+
+void LLTexCoordKernel::setPlanar(const LLVector4a& scale)
+{
+    mPlanar = true;
+    for (U32 i = 0; i < 3; ++i)
+    {
+        mScale[i].splat(scale, i);
+    }
+    select();
+}
+
+void LLTexCoordKernel::setTransform(F32 cos_ang, F32 sin_ang, F32 offset_s, F32 offset_t, F32 scale_s, F32 scale_t)
+{
+    mTransform = TRANSFORM_XFORM;
+    mXform[0].splat(cos_ang);
+    mXform[1].splat(sin_ang);
+    mXform[2].splat(scale_s);
+    mXform[3].splat(scale_t);
+    mXform[4].splat(offset_s + 0.5f);
+    mXform[5].splat(offset_t + 0.5f);
+    select();
+}
+
+void LLTexCoordKernel::setMatrix(const LLMatrix4& mat)
+{
+    mTransform = TRANSFORM_MATRIX;
+    mXform[0].splat(mat.mMatrix[VX][VX]);
+    mXform[1].splat(mat.mMatrix[VY][VX]);
+    mXform[2].splat(mat.mMatrix[VX][VY]);
+    mXform[3].splat(mat.mMatrix[VY][VY]);
+    mXform[4].splat(mat.mMatrix[VW][VX]);
+    mXform[5].splat(mat.mMatrix[VW][VY]);
+    select();
+}
+
+void LLTexCoordKernel::clearTransform()
+{
+    mTransform = TRANSFORM_NONE;
+    select();
+}
+
+void LLTexCoordKernel::select()
+{
+    static const kernel_t kernels[2][TRANSFORM_COUNT] =
+    {
+        { kernel<false, TRANSFORM_NONE>, kernel<false, TRANSFORM_XFORM>, kernel<false, TRANSFORM_MATRIX> },
+        { kernel<true, TRANSFORM_NONE>,  kernel<true, TRANSFORM_XFORM>,  kernel<true, TRANSFORM_MATRIX> },
+    };
+
+    mKernel = kernels[mPlanar ? 1 : 0][mTransform];
+}
+
+void LLTexCoordKernel::run(const LLVector4a* positions, const LLVector4a* normals, const LLVector2* tex_coords,
+                           S32 count, LLVector2* dst) const
+{
+    if (count > 0)
+    {
+        mKernel(*this, positions, normals, tex_coords, count, (F32*) dst);
+    }
+}
+
+// Four texture coordinates, written interleaved s, t to dst.
+template<bool PLANAR, U32 TRANSFORM>
+inline void LLTexCoordKernel::block(const LLVector4a* positions, const LLVector4a* normals, const LLVector2* tex_coords,
+                                    F32* dst) const
+{
+    LLVector4a s, t;
+
+    if (PLANAR)
+    {
+        // planarProjection(), transposed so each lane is one vertex:
+        //   binormal is +-y when |normal.x| >= 0.5, else -+x
+        //   tangent = binormal x normal
+        //   s = 1 + (2 (binormal . p) - 0.5), t = -(2 (tangent . p) - 0.5)
+        __m128 px = positions[0], py = positions[1], pz = positions[2], pw = positions[3];
+        _MM_TRANSPOSE4_PS(px, py, pz, pw);
+        __m128 nx = normals[0], ny = normals[1], nz = normals[2], nw = normals[3];
+        _MM_TRANSPOSE4_PS(nx, ny, nz, nw);
+
+        LLVector4a x, y, z;
+        x.setMul(LLVector4a(px), mScale[0]);
+        y.setMul(LLVector4a(py), mScale[1]);
+        z.setMul(LLVector4a(pz), mScale[2]);
+
+        LLVector4a zero, half, one, neg_one, two;
+        zero.clear();
+        half.splat(0.5f);
+        one.splat(1.f);
+        neg_one.splat(-1.f);
+        two.splat(2.f);
+
+        LLVector4a abs_nx;
+        abs_nx.setAbs(LLVector4a(nx));
+        LLVector4Logical y_binormal = abs_nx.greaterEqual(half);
+
+        LLVector4a sign_y, sign_x, sign;
+        sign_y.setSelectWithMask(LLVector4a(nx).lessThan(zero), neg_one, one);
+        sign_x.setSelectWithMask(LLVector4a(ny).greaterThan(zero), neg_one, one);
+        sign.setSelectWithMask(y_binormal, sign_y, sign_x);
+
+        // binormal . p
+        LLVector4a b_dot;
+        b_dot.setSelectWithMask(y_binormal, y, x);
+        b_dot.mul(sign);
+
+        // tangent . p, tangent is (nz, 0, -nx) or (0, -nz, ny) times sign
+        LLVector4a a0, a1, b0, b1;
+        a0.setMul(LLVector4a(nz), x);
+        a1.setMul(LLVector4a(nx), z);
+        a0.sub(a1);
+        b0.setMul(LLVector4a(ny), z);
+        b1.setMul(LLVector4a(nz), y);
+        b0.sub(b1);
+        LLVector4a t_dot;
+        t_dot.setSelectWithMask(y_binormal, a0, b0);
+        t_dot.mul(sign);
+
+        b_dot.mul(two);
+        b_dot.sub(half);
+        s.setAdd(one, b_dot);
+
+        t_dot.mul(two);
+        t_dot.sub(half);
+        t.setSub(zero, t_dot);
+    }
+    else
+    {
+        __m128 lo = _mm_loadu_ps(tex_coords[0].mV);
+        __m128 hi = _mm_loadu_ps(tex_coords[2].mV);
+        s = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+        t = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+    }
+
+    if (TRANSFORM == TRANSFORM_XFORM)
+    {
+        // xform(): about the face center, rotate, scale, offset
+        LLVector4a half;
+        half.splat(0.5f);
+        s.sub(half);
+        t.sub(half);
+
+        LLVector4a rs, rt, tmp;
+        rs.setMul(s, mXform[0]);
+        tmp.setMul(t, mXform[1]);
+        rs.add(tmp);
+
+        rt.setMul(t, mXform[0]);
+        tmp.setMul(s, mXform[1]);
+        rt.sub(tmp);
+
+        rs.mul(mXform[2]);
+        rt.mul(mXform[3]);
+        s.setAdd(rs, mXform[4]);
+        t.setAdd(rt, mXform[5]);
+    }
+    else if (TRANSFORM == TRANSFORM_MATRIX)
+    {
+        // LLVector3(s, t, 0) * LLMatrix4
+        LLVector4a rs, rt, tmp;
+        rs.setMul(s, mXform[0]);
+        tmp.setMul(t, mXform[1]);
+        rs.add(tmp);
+
+        rt.setMul(s, mXform[2]);
+        tmp.setMul(t, mXform[3]);
+        rt.add(tmp);
+
+        s.setAdd(rs, mXform[4]);
+        t.setAdd(rt, mXform[5]);
+    }
+
+    _mm_storeu_ps(dst, _mm_unpacklo_ps(s, t));
+    _mm_storeu_ps(dst + 4, _mm_unpackhi_ps(s, t));
+}
+
+template<bool PLANAR, U32 TRANSFORM>
+void LLTexCoordKernel::kernel(const LLTexCoordKernel& params, const LLVector4a* positions, const LLVector4a* normals,
+                              const LLVector2* tex_coords, S32 count, F32* dst)
+{
+    S32 i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        params.block<PLANAR, TRANSFORM>(positions + i, normals + i, tex_coords + i, dst + i * 2);
+    }
+
+    if (i < count)
+    {
+        // pad the tail out to a full block with copies of the last vertex
+        LLVector4a pos[4];
+        LLVector4a norm[4];
+        LLVector2 tc[4];
+        LL_ALIGN_16(F32 out[8]);
+
+        for (S32 j = 0; j < 4; ++j)
+        {
+            S32 idx = llmin(i + j, count - 1);
+            if (PLANAR)
+            {
+                pos[j] = positions[idx];
+                norm[j] = normals[idx];
+            }
+            else
+            {
+                tc[j] = tex_coords[idx];
+            }
+        }
+
+        params.block<PLANAR, TRANSFORM>(pos, norm, tc, out);
+        memcpy(dst + i * 2, out, (count - i) * 2 * sizeof(F32));
+    }
+}
+
+void ll_transform_positions(const LLMatrix4a& mat, const LLVector4a* src, S32 count, U32 tex_index,
+                            LLVector4a* dst, S32 dst_count)
+{
+    llassert(count > 0 && dst_count >= count);
+
+    LLVector4a tex_idx;
+    tex_idx.set(0.f, 0.f, 0.f, 0.f);
+    ((U32*) tex_idx.getF32ptr())[3] = tex_index;
+
+    LLVector4Logical mask;
+    mask.clear();
+    mask.setElement<3>();
+
+    S32 i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        LLVector4a res0, res1, res2, res3;
+        mat.affineTransform(src[i], res0);
+        mat.affineTransform(src[i + 1], res1);
+        mat.affineTransform(src[i + 2], res2);
+        mat.affineTransform(src[i + 3], res3);
+        dst[i].setSelectWithMask(mask, tex_idx, res0);
+        dst[i + 1].setSelectWithMask(mask, tex_idx, res1);
+        dst[i + 2].setSelectWithMask(mask, tex_idx, res2);
+        dst[i + 3].setSelectWithMask(mask, tex_idx, res3);
+    }
+
+    for (; i < count; ++i)
+    {
+        LLVector4a res;
+        mat.affineTransform(src[i], res);
+        dst[i].setSelectWithMask(mask, tex_idx, res);
+    }
+
+    for (; i < dst_count; ++i)
+    {
+        dst[i] = dst[count - 1];
+    }
+}
+
+void ll_rotate_normals(const LLMatrix4a& mat, const LLVector4a* src, S32 count, LLVector4a* dst)
+{
+    S32 i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        mat.rotate(src[i], dst[i]);
+        mat.rotate(src[i + 1], dst[i + 1]);
+        mat.rotate(src[i + 2], dst[i + 2]);
+        mat.rotate(src[i + 3], dst[i + 3]);
+    }
+
+    for (; i < count; ++i)
+    {
+        mat.rotate(src[i], dst[i]);
+    }
+}
+
+void ll_rotate_tangents(const LLMatrix4a& mat, const LLVector4a* src, S32 count, LLVector4a* dst)
+{
+    LLVector4Logical mask;
+    mask.clear();
+    mask.setElement<3>();
+
+    for (S32 i = 0; i < count; ++i)
+    {
+        LLVector4a res;
+        mat.rotate(src[i], res);
+        dst[i].setSelectWithMask(mask, src[i], res);
+    }
+}
+
+void ll_fill_u32(U32 value, S32 count, U32* dst)
+{
+    __m128i fill = _mm_set1_epi32((S32) value);
+    __m128i* out = (__m128i*) dst;
+    S32 num_vecs = (count + 3) / 4;
+    for (S32 i = 0; i < num_vecs; ++i)
+    {
+        _mm_store_si128(out + i, fill);
+    }
+}
@@ -0,0 +1,123 @@
+/**
+ * @file llgeometrykernels.h
+ * @brief Vectorized per attribute kernels for filling vertex buffers from LLVolumeFaces.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLGEOMETRYKERNELS_H
+#define LL_LLGEOMETRYKERNELS_H
+
+#include "llmath.h"
+#include "llmemory.h"
+#include "llvector4a.h"
+
+class LLMatrix4;
+class LLMatrix4a;
+class LLVector2;
+
+// Texture coordinate generator for one face and one texture channel.
+//
+// Configure it once per face with the texgen mode and texture transform the
+// face uses, then run() fills the whole channel with a kernel specialized for
+// that combination, four vertices at a time.  Results match what the per
+// vertex planarProjection() / xform() / LLVector3 * LLMatrix4 path in
+// LLFace::getGeometryVolume produced.
+//
+// Holds no state beyond its parameters, so faces may be filled concurrently
+// from worker threads with their own instances.
+class alignas(16) LLTexCoordKernel
+{
+    LL_ALIGN_NEW
+public:
+    LLTexCoordKernel();
+
+    // planar texgen, positions are scaled by scale (the object scale) first
+    void setPlanar(const LLVector4a& scale);
+
+    // rotate about the face center, then scale, then offset
+    void setTransform(F32 cos_ang, F32 sin_ang, F32 offset_s, F32 offset_t, F32 scale_s, F32 scale_t);
+
+    // full texture matrix, as used by texture animation
+    void setMatrix(const LLMatrix4& mat);
+
+    // no transform
+    void clearTransform();
+
+    // Write count texture coordinates to dst, which need not be aligned.
+    // positions and normals are only read for planar texgen.
+    void run(const LLVector4a* positions, const LLVector4a* normals, const LLVector2* tex_coords,
+             S32 count, LLVector2* dst) const;
+
+    bool isPlanar() const { return mPlanar; }
+    // true if run() would just copy tex_coords
+    bool isCopy() const { return !mPlanar && mTransform == TRANSFORM_NONE; }
+
+    enum
+    {
+        TRANSFORM_NONE = 0,
+        TRANSFORM_XFORM,
+        TRANSFORM_MATRIX,
+        TRANSFORM_COUNT
+    };
+
+private:
+    typedef void (*kernel_t)(const LLTexCoordKernel& params, const LLVector4a* positions, const LLVector4a* normals,
+                             const LLVector2* tex_coords, S32 count, F32* dst);
+
+    template<bool PLANAR, U32 TRANSFORM>
+    static void kernel(const LLTexCoordKernel& params, const LLVector4a* positions, const LLVector4a* normals,
+                       const LLVector2* tex_coords, S32 count, F32* dst);
+
+    template<bool PLANAR, U32 TRANSFORM>
+    inline void block(const LLVector4a* positions, const LLVector4a* normals, const LLVector2* tex_coords, F32* dst) const;
+
+    void select();
+
+    // planar texgen scale, each component splatted
+    LL_ALIGN_16(LLVector4a mScale[3]);
+    // TRANSFORM_XFORM:  cos, sin, scale s, scale t, offset s + 0.5, offset t + 0.5
+    // TRANSFORM_MATRIX: m[0][0], m[1][0], m[0][1], m[1][1], m[3][0], m[3][1]
+    // each splatted
+    LL_ALIGN_16(LLVector4a mXform[6]);
+
+    kernel_t mKernel;
+    U32 mTransform;
+    bool mPlanar;
+};
+
+// Positions through mat, with the bits of tex_index stored in w.  Fills
+// dst_count entries, repeating the last position past count.
+void ll_transform_positions(const LLMatrix4a& mat, const LLVector4a* src, S32 count, U32 tex_index,
+                            LLVector4a* dst, S32 dst_count);
+
+// Normals rotated by mat.
+void ll_rotate_normals(const LLMatrix4a& mat, const LLVector4a* src, S32 count, LLVector4a* dst);
+
+// Tangents rotated by mat, keeping the bitangent sign in w.
+void ll_rotate_tangents(const LLMatrix4a& mat, const LLVector4a* src, S32 count, LLVector4a* dst);
+
+// Fill count 32 bit values, rounded up to a multiple of four, with value.
+// dst must be 16 byte aligned.
+void ll_fill_u32(U32 value, S32 count, U32* dst);
+
+#endif
@@ -0,0 +1,286 @@
+/**
+ * @file llskinningkernels.cpp
+ * @brief Vectorized kernels for skinning rigged mesh positions on the CPU.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llskinningkernels.h"
+
+#include "llmatrix4a.h"
+#include "llsys.h"
+
+#include <immintrin.h>
+
+// The AVX2 kernel is compiled for AVX2 on its own, the rest of the library
+// keeps the baseline instruction set, and it is only called once gSysCPU
+// says the CPU has it.  It sticks to multiplies and adds in the same order
+// as the SSE kernel, so it needs no FMA and gives the same results.  MSVC
+// allows the intrinsics anywhere.
+#if LL_MSVC
+#define LL_TARGET_AVX2
+#else
+#define LL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+void ll_decode_skin_weights(const LLVector4a* weights, S32 count, U32 num_joints,
+                            U8* joint_indices, LLVector4a* joint_weights)
+{
+    llassert(num_joints > 0 && num_joints <= 256);
+
+    S32 max_index = (S32) num_joints - 1;
+
+    for (S32 i = 0; i < count; ++i)
+    {
+        const F32* w = weights[i].getF32ptr();
+        U8* idx = joint_indices + i * 4;
+
+        F32 wght[4];
+        F32 scale = 0.f;
+        for (U32 k = 0; k < 4; ++k)
+        {
+            F32 joint = floorf(w[k]);
+            idx[k] = (U8) llclamp((S32) joint, 0, max_index);
+            wght[k] = w[k] - joint;
+            scale += wght[k];
+        }
+
+        if (scale > 0.f)
+        {
+            joint_weights[i].set(wght[0], wght[1], wght[2], wght[3]);
+            joint_weights[i].mul(1.f / scale);
+        }
+        else
+        { // scrubSkinWeights() keeps these out of uploaded meshes
+            joint_weights[i].set(1.f, 0.f, 0.f, 0.f);
+        }
+    }
+}
+
+namespace
+{
+    // one position through one palette matrix, scaled by its weight
+    inline void skin_add(const LLMatrix4a& mat, const LLVector4a& x, const LLVector4a& y, const LLVector4a& z,
+                         const LLVector4a& weight, LLVector4a& res)
+    {
+        LLVector4a t;
+        LLVector4a a;
+        t.setMul(mat.mMatrix[0], x);
+        a.setMul(mat.mMatrix[1], y);
+        t.add(a);
+        a.setMul(mat.mMatrix[2], z);
+        t.add(a);
+        t.add(mat.mMatrix[3]);
+        t.mul(weight);
+        res.add(t);
+    }
+
+    inline void skin_vertex(const LLMatrix4a* palette, const U8* idx, const LLVector4a& w,
+                            const LLVector4a& v, LLVector4a& res)
+    {
+        LLVector4a x, y, z;
+        x.splat<0>(v);
+        y.splat<1>(v);
+        z.splat<2>(v);
+
+        LLVector4a w0, w1, w2, w3;
+        w0.splat<0>(w);
+        w1.splat<1>(w);
+        w2.splat<2>(w);
+        w3.splat<3>(w);
+
+        res.clear();
+        skin_add(palette[idx[0]], x, y, z, w0, res);
+        skin_add(palette[idx[1]], x, y, z, w1, res);
+        skin_add(palette[idx[2]], x, y, z, w2, res);
+        skin_add(palette[idx[3]], x, y, z, w3, res);
+    }
+
+    void skin_positions_sse(const LLMatrix4a* palette, const U8* joint_indices, const LLVector4a* joint_weights,
+                            const LLVector4a* src, S32 begin, S32 count, LLVector4a* dst, LLVector4a* extents)
+    {
+        for (S32 i = begin; i < count; ++i)
+        {
+            skin_vertex(palette, joint_indices + i * 4, joint_weights[i], src[i], dst[i]);
+            extents[0].setMin(extents[0], dst[i]);
+            extents[1].setMax(extents[1], dst[i]);
+        }
+    }
+
+    // matrix row r of the vertices' joint K, one vertex per 128 bit lane
+    template<int R>
+    LL_TARGET_AVX2 inline __m256 joint_row(const LLMatrix4a& a, const LLMatrix4a& b)
+    {
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(a.mMatrix[R]), b.mMatrix[R], 1);
+    }
+
+    template<int K>
+    LL_TARGET_AVX2 inline __m256 skin_add_avx2(const LLMatrix4a* palette, const U8* idx,
+                                               __m256 x, __m256 y, __m256 z, __m256 w, __m256 res)
+    {
+        const LLMatrix4a& a = palette[idx[K]];
+        const LLMatrix4a& b = palette[idx[K + 4]];
+
+        __m256 t = _mm256_mul_ps(joint_row<0>(a, b), x);
+        t = _mm256_add_ps(t, _mm256_mul_ps(joint_row<1>(a, b), y));
+        t = _mm256_add_ps(t, _mm256_mul_ps(joint_row<2>(a, b), z));
+        t = _mm256_add_ps(t, joint_row<3>(a, b));
+
+        __m256 weight = _mm256_permute_ps(w, K * 0x55);
+        return _mm256_add_ps(res, _mm256_mul_ps(t, weight));
+    }
+
+    LL_TARGET_AVX2 void skin_positions_avx2(const LLMatrix4a* palette, const U8* joint_indices,
+                                            const LLVector4a* joint_weights, const LLVector4a* src, S32 count,
+                                            LLVector4a* dst, LLVector4a* extents)
+    {
+        __m256 lo = _mm256_castps128_ps256(extents[0]);
+        lo = _mm256_insertf128_ps(lo, extents[0], 1);
+        __m256 hi = _mm256_castps128_ps256(extents[1]);
+        hi = _mm256_insertf128_ps(hi, extents[1], 1);
+
+        S32 i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            const U8* idx = joint_indices + i * 4;
+
+            __m256 v = _mm256_loadu_ps(src[i].getF32ptr());
+            __m256 w = _mm256_loadu_ps(joint_weights[i].getF32ptr());
+            __m256 x = _mm256_permute_ps(v, 0x00);
+            __m256 y = _mm256_permute_ps(v, 0x55);
+            __m256 z = _mm256_permute_ps(v, 0xAA);
+
+            __m256 res = _mm256_setzero_ps();
+            res = skin_add_avx2<0>(palette, idx, x, y, z, w, res);
+            res = skin_add_avx2<1>(palette, idx, x, y, z, w, res);
+            res = skin_add_avx2<2>(palette, idx, x, y, z, w, res);
+            res = skin_add_avx2<3>(palette, idx, x, y, z, w, res);
+
+            _mm256_storeu_ps(dst[i].getF32ptr(), res);
+            lo = _mm256_min_ps(lo, res);
+            hi = _mm256_max_ps(hi, res);
+        }
+
+        extents[0] = _mm_min_ps(_mm256_castps256_ps128(lo), _mm256_extractf128_ps(lo, 1));
+        extents[1] = _mm_max_ps(_mm256_castps256_ps128(hi), _mm256_extractf128_ps(hi, 1));
+
+        // odd vertex out
+        skin_positions_sse(palette, joint_indices, joint_weights, src, i, count, dst, extents);
+    }
+}
+
+void ll_skin_positions(const LLMatrix4a* palette, const U8* joint_indices, const LLVector4a* joint_weights,
+                       const LLVector4a* src, S32 count, LLVector4a* dst, LLVector4a* extents)
+{
+    llassert(count > 0);
+
+#if LL_MSVC
+    static const bool use_avx2 = gSysCPU.hasAVX2();
+#else
+    // also asks whether the OS saves the ymm registers
+    static const bool use_avx2 = gSysCPU.hasAVX2() && __builtin_cpu_supports("avx2");
+#endif
+
+    skin_vertex(palette, joint_indices, joint_weights[0], src[0], dst[0]);
+    extents[0] = dst[0];
+    extents[1] = dst[0];
+
+    if (use_avx2)
+    {
+        skin_positions_avx2(palette, joint_indices + 4, joint_weights + 1, src + 1, count - 1, dst + 1, extents);
+    }
+    else
+    {
+        skin_positions_sse(palette, joint_indices, joint_weights, src, 1, count, dst, extents);
+    }
+}
+
+U32 ll_skin_joint_bounds(const U8* joint_indices, const LLVector4a* joint_weights, const LLVector4a* src,
+                         S32 count, U32 num_joints, U8* joints, LLVector4a* bounds)
+{
+    llassert(num_joints > 0 && num_joints <= 256);
+
+    LLVector4a min[256];
+    LLVector4a max[256];
+    bool used[256];
+    for (U32 j = 0; j < num_joints; ++j)
+    {
+        used[j] = false;
+    }
+
+    for (S32 i = 0; i < count; ++i)
+    {
+        const U8* idx = joint_indices + i * 4;
+        const F32* w = joint_weights[i].getF32ptr();
+        for (U32 k = 0; k < 4; ++k)
+        {
+            if (w[k] <= 0.f)
+            {
+                continue;
+            }
+
+            U32 j = idx[k];
+            if (!used[j])
+            {
+                used[j] = true;
+                min[j] = src[i];
+                max[j] = src[i];
+            }
+            else
+            {
+                min[j].setMin(min[j], src[i]);
+                max[j].setMax(max[j], src[i]);
+            }
+        }
+    }
+
+    U32 n = 0;
+    for (U32 j = 0; j < num_joints; ++j)
+    {
+        if (used[j])
+        {
+            joints[n] = (U8) j;
+            bounds[n * 2] = min[j];
+            bounds[n * 2 + 1] = max[j];
+            ++n;
+        }
+    }
+    return n;
+}
+
+void ll_skinned_extents(const LLMatrix4a* palette, const U8* joints, const LLVector4a* bounds, U32 num_bounds,
+                        LLVector4a* extents)
+{
+    llassert(num_bounds > 0);
+
+    matMulBoundBox(palette[joints[0]], bounds, extents);
+
+    for (U32 n = 1; n < num_bounds; ++n)
+    {
+        LLVector4a box[2];
+        matMulBoundBox(palette[joints[n]], bounds + n * 2, box);
+        extents[0].setMin(extents[0], box[0]);
+        extents[1].setMax(extents[1], box[1]);
+    }
+}
@@ -0,0 +1,66 @@
+/**
+ * @file llskinningkernels.h
+ * @brief Vectorized kernels for skinning rigged mesh positions on the CPU.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLSKINNINGKERNELS_H
+#define LL_LLSKINNINGKERNELS_H
+
+#include "llmath.h"
+#include "llvector4a.h"
+
+class LLMatrix4a;
+
+// Split count packed skin weights, as stored in LLVolumeFace::mWeights with
+// the joint index in the integer part and the weight in the fraction, into
+// four joint indices per vertex clamped to num_joints - 1 and four weights
+// normalized to sum to one.  A vertex with no weight goes entirely to its
+// first joint.
+void ll_decode_skin_weights(const LLVector4a* weights, S32 count, U32 num_joints,
+                            U8* joint_indices, LLVector4a* joint_weights);
+
+// Skin count positions with decoded weights: each dst is the weighted sum of
+// its src through the four palette matrices it is bound to.  Also writes the
+// min and max of the results to extents[0] and extents[1].  Uses AVX2, two
+// vertices at a time, where the CPU and OS support it.
+void ll_skin_positions(const LLMatrix4a* palette, const U8* joint_indices, const LLVector4a* joint_weights,
+                       const LLVector4a* src, S32 count, LLVector4a* dst, LLVector4a* extents);
+
+// Bounds of the src positions each joint carries weight for, so skinned
+// extents can be had without skinning.  For every joint with weight on at
+// least one vertex, writes the joint to joints[n] and the min and max of its
+// vertices to bounds[n * 2] and bounds[n * 2 + 1], and returns the number
+// of joints written.  joints needs room for num_joints entries and bounds
+// for twice that.
+U32 ll_skin_joint_bounds(const U8* joint_indices, const LLVector4a* joint_weights, const LLVector4a* src,
+                         S32 count, U32 num_joints, U8* joints, LLVector4a* bounds);
+
+// Conservative extents of positions skinned through palette, from the joint
+// bounds of ll_skin_joint_bounds().  A skinned vertex is a weighted average
+// of its position through each of its joints, so it lies within the union of
+// its joints' bounds transformed by their palette matrices.
+void ll_skinned_extents(const LLMatrix4a* palette, const U8* joints, const LLVector4a* bounds, U32 num_bounds,
+                        LLVector4a* extents);
+
+#endif
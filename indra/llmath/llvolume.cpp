@@ -32,6 +32,11 @@
 #include <stdint.h>
 #endif
 #include <cmath>
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <tuple>
 #include <unordered_map>
 
 #include "llerror.h"
@@ -45,13 +50,15 @@
 #include "llmatrix3a.h"
 #include "lloctree.h"
 #include "llvolume.h"
-#include "llvolumeoctree.h"
+#include "llvolumebvh.h"
 #include "llstl.h"
 #include "llsdserialize.h"
 #include "llvector4a.h"
 #include "llmatrix4a.h"
 #include "llmeshoptimizer.h"
 #include "lltimer.h"
+#include "llmutex.h"
+#include "workqueue.h"
 
 #include "mikktspace/mikktspace.h"
 #include "mikktspace/mikktspace.c" // insert mikktspace implementation into llvolume object file
@@ -377,77 +384,6 @@ BOOL LLTriangleRayIntersect(const LLVector3& vert0, const LLVector3& vert1, cons
 	}
 }
 
-class LLVolumeOctreeRebound : public LLOctreeTravelerDepthFirst<LLVolumeTriangle, LLVolumeTriangle*>
-{
-public:
-	const LLVolumeFace* mFace;
-
-	LLVolumeOctreeRebound(const LLVolumeFace* face)
-	{
-		mFace = face;
-	}
-
-    virtual void visit(const LLOctreeNode<LLVolumeTriangle, LLVolumeTriangle*>* branch)
-	{ //this is a depth first traversal, so it's safe to assum all children have complete
-		//bounding data
-	LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME
-
-		LLVolumeOctreeListener* node = (LLVolumeOctreeListener*) branch->getListener(0);
-
-		LLVector4a& min = node->mExtents[0];
-		LLVector4a& max = node->mExtents[1];
-
-		if (!branch->isEmpty())
-		{ //node has data, find AABB that binds data set
-			const LLVolumeTriangle* tri = *(branch->getDataBegin());
-			
-			//initialize min/max to first available vertex
-			min = *(tri->mV[0]);
-			max = *(tri->mV[0]);
-			
-            for (LLOctreeNode<LLVolumeTriangle, LLVolumeTriangle*>::const_element_iter iter = branch->getDataBegin(); iter != branch->getDataEnd(); ++iter)
-			{ //for each triangle in node
-
-				//stretch by triangles in node
-				tri = *iter;
-				
-				min.setMin(min, *tri->mV[0]);
-				min.setMin(min, *tri->mV[1]);
-				min.setMin(min, *tri->mV[2]);
-
-				max.setMax(max, *tri->mV[0]);
-				max.setMax(max, *tri->mV[1]);
-				max.setMax(max, *tri->mV[2]);
-			}
-		}
-		else if (branch->getChildCount() > 0)
-		{ //no data, but child nodes exist
-			LLVolumeOctreeListener* child = (LLVolumeOctreeListener*) branch->getChild(0)->getListener(0);
-
-			//initialize min/max to extents of first child
-			min = child->mExtents[0];
-			max = child->mExtents[1];
-		}
-		else
-		{
-            llassert(!branch->isLeaf()); // Empty leaf
-		}
-
-		for (S32 i = 0; i < branch->getChildCount(); ++i)
-		{  //stretch by child extents
-			LLVolumeOctreeListener* child = (LLVolumeOctreeListener*) branch->getChild(i)->getListener(0);
-			min.setMin(min, child->mExtents[0]);
-			max.setMax(max, child->mExtents[1]);
-		}
-
-		node->mBounds[0].setAdd(min, max);
-		node->mBounds[0].mul(0.5f);
-
-		node->mBounds[1].setSub(max,min);
-		node->mBounds[1].mul(0.5f);
-	}
-};
-
 //-------------------------------------------------------------------
 // statics
 //-------------------------------------------------------------------
@@ -826,6 +762,136 @@ S32 LLProfile::getNumPoints(const LLProfileParams& params, BOOL path_open,F32 de
 }
 
 
+namespace
+{
+	// Most recently used results of LLProfile::generate and LLPath::generate,
+	// keyed by everything that influences them.  Builds full of identical
+	// prims and unique volumes (flexis, sculpt LOD changes) otherwise
+	// regenerate the same profiles and paths over and over.
+	template <typename KEY, typename VALUE>
+	class GenerateCache
+	{
+	public:
+		typedef std::shared_ptr<const VALUE> value_ptr_t;
+
+		GenerateCache(U32 capacity) : mCapacity(capacity) {}
+
+		value_ptr_t find(const KEY& key)
+		{
+			LLMutexLock lock(&mMutex);
+			typename map_t::iterator iter = mMap.find(key);
+			if (iter == mMap.end())
+			{
+				return value_ptr_t();
+			}
+			mLRU.splice(mLRU.begin(), mLRU, iter->second);
+			return iter->second->second;
+		}
+
+		void insert(const KEY& key, const value_ptr_t& value)
+		{
+			LLMutexLock lock(&mMutex);
+			if (mMap.find(key) != mMap.end())
+			{ // another thread got here first
+				return;
+			}
+
+			mLRU.emplace_front(key, value);
+			mMap[key] = mLRU.begin();
+
+			while (mLRU.size() > mCapacity)
+			{
+				mMap.erase(mLRU.back().first);
+				mLRU.pop_back();
+			}
+		}
+
+	private:
+		typedef std::list<std::pair<KEY, value_ptr_t> > lru_t;
+		typedef std::map<KEY, typename lru_t::iterator> map_t;
+
+		LLMutex mMutex;
+		lru_t mLRU;
+		map_t mMap;
+		U32 mCapacity;
+	};
+
+	const U32 PROFILE_CACHE_SIZE = 512;
+	const U32 PATH_CACHE_SIZE = 512;
+
+	struct ProfileCacheKey
+	{
+		LLProfileParams mParams;
+		F32 mDetail;
+		S32 mSplit;
+		BOOL mPathOpen;
+		BOOL mSculpted;
+		S32 mSculptSize;
+
+		bool operator<(const ProfileCacheKey& rhs) const
+		{
+			if (mParams != rhs.mParams)
+			{
+				return mParams < rhs.mParams;
+			}
+			return std::tie(mDetail, mSplit, mPathOpen, mSculpted, mSculptSize) <
+				   std::tie(rhs.mDetail, rhs.mSplit, rhs.mPathOpen, rhs.mSculpted, rhs.mSculptSize);
+		}
+	};
+
+	struct PathCacheKey
+	{
+		LLPathParams mParams;
+		F32 mDetail;
+		S32 mSplit;
+		BOOL mSculpted;
+		S32 mSculptSize;
+
+		bool operator<(const PathCacheKey& rhs) const
+		{
+			if (mParams != rhs.mParams)
+			{
+				return mParams < rhs.mParams;
+			}
+			return std::tie(mDetail, mSplit, mSculpted, mSculptSize) <
+				   std::tie(rhs.mDetail, rhs.mSplit, rhs.mSculpted, rhs.mSculptSize);
+		}
+	};
+
+	struct CachedProfile
+	{
+		LLAlignedArray<LLVector4a, 64> mProfile;
+		std::vector<LLProfile::Face> mFaces;
+		BOOL mOpen;
+		BOOL mConcave;
+		S32 mTotalOut;
+		S32 mTotal;
+	};
+
+	struct CachedPath
+	{
+		LLAlignedArray<LLPath::PathPt, 64> mPath;
+		BOOL mOpen;
+		S32 mTotal;
+		F32 mStep;
+	};
+
+	typedef GenerateCache<ProfileCacheKey, CachedProfile> profile_cache_t;
+	typedef GenerateCache<PathCacheKey, CachedPath> path_cache_t;
+
+	profile_cache_t& profile_cache()
+	{
+		static profile_cache_t cache(PROFILE_CACHE_SIZE);
+		return cache;
+	}
+
+	path_cache_t& path_cache()
+	{
+		static path_cache_t cache(PATH_CACHE_SIZE);
+		return cache;
+	}
+}
+
 BOOL LLProfile::generate(const LLProfileParams& params, BOOL path_open,F32 detail, S32 split,
 						 BOOL is_sculpted, S32 sculpt_size)
 {
@@ -843,6 +909,38 @@ BOOL LLProfile::generate(const LLProfileParams& params, BOOL path_open,F32 detai
 		detail = MIN_LOD;
 	}
 
+	ProfileCacheKey key = { params, detail, split, path_open, is_sculpted, sculpt_size };
+	if (profile_cache_t::value_ptr_t cached = profile_cache().find(key))
+	{
+		mProfile = cached->mProfile;
+		mFaces = cached->mFaces;
+		mOpen = cached->mOpen;
+		mConcave = cached->mConcave;
+		mTotalOut = cached->mTotalOut;
+		mTotal = cached->mTotal;
+		return TRUE;
+	}
+
+	if (!generateShape(params, path_open, detail, split, is_sculpted, sculpt_size))
+	{
+		return FALSE;
+	}
+
+	std::shared_ptr<CachedProfile> entry = std::make_shared<CachedProfile>();
+	entry->mProfile = mProfile;
+	entry->mFaces = mFaces;
+	entry->mOpen = mOpen;
+	entry->mConcave = mConcave;
+	entry->mTotalOut = mTotalOut;
+	entry->mTotal = mTotal;
+	profile_cache().insert(key, entry);
+
+	return TRUE;
+}
+
+BOOL LLProfile::generateShape(const LLProfileParams& params, BOOL path_open, F32 detail, S32 split,
+							  BOOL is_sculpted, S32 sculpt_size)
+{
 	mProfile.resize(0);
 	mFaces.resize(0);
 
@@ -1561,6 +1659,32 @@ BOOL LLPath::generate(const LLPathParams& params, F32 detail, S32 split,
 	}
 
 	mDirty = FALSE;
+
+	PathCacheKey key = { params, detail, split, is_sculpted, sculpt_size };
+	if (path_cache_t::value_ptr_t cached = path_cache().find(key))
+	{
+		mPath = cached->mPath;
+		mOpen = cached->mOpen;
+		mTotal = cached->mTotal;
+		mStep = cached->mStep;
+		return TRUE;
+	}
+
+	generateShape(params, detail, split, is_sculpted, sculpt_size);
+
+	std::shared_ptr<CachedPath> entry = std::make_shared<CachedPath>();
+	entry->mPath = mPath;
+	entry->mOpen = mOpen;
+	entry->mTotal = mTotal;
+	entry->mStep = mStep;
+	path_cache().insert(key, entry);
+
+	return TRUE;
+}
+
+void LLPath::generateShape(const LLPathParams& params, F32 detail, S32 split,
+						   BOOL is_sculpted, S32 sculpt_size)
+{
 	S32 np = 2; // hardcode for line
 
 	mPath.resize(0);
@@ -1673,8 +1797,6 @@ BOOL LLPath::generate(const LLPathParams& params, F32 detail, S32 split,
 	//if ((int(fabsf(params.getTwist() - params.getTwistBegin())*100))%100 != 0) {
 	//	mOpen = TRUE;
 	//}
-	
-	return TRUE;
 }
 
 BOOL LLDynamicPath::generate(const LLPathParams& params, F32 detail, S32 split,
@@ -2046,7 +2168,7 @@ LLProfile::~LLProfile()
 }
 
 
-S32 LLVolume::sNumMeshPoints = 0;
+std::atomic<S32> LLVolume::sNumMeshPoints(0);
 
 LLVolume::LLVolume(const LLVolumeParams &params, const F32 detail, const BOOL generate_single_face, const BOOL is_unique)
 	: mParams(params)
@@ -2055,9 +2177,11 @@ LLVolume::LLVolume(const LLVolumeParams &params, const F32 detail, const BOOL ge
 	mFaceMask = 0x0;
 	mDetail = detail;
 	mSculptLevel = -2;
+	mPendingSculptLevel = NO_SCULPT_PENDING;
 	mSurfaceArea = 1.f; //only calculated for sculpts, defaults to 1 for all other prims
 	mIsMeshAssetLoaded = false;
     mIsMeshAssetUnavaliable = false;
+    mDeferOctreeBuilds = false;
 	mLODScaleBias.setVec(1,1,1);
 	mHullPoints = NULL;
 	mHullIndices = NULL;
@@ -2185,25 +2309,18 @@ BOOL LLVolume::generate()
 
 		for (S32 s = 0; s < sizeS; ++s)
 		{
-			F32* scale = mPathp->mPath[s].mScale.getF32ptr();
-			
-			F32 sc [] = 
-			{ scale[0], 0, 0, 0,
-				0, scale[1], 0, 0,
-				0, 0, scale[2], 0,
-					0, 0, 0, 1 };
-			
-			LLMatrix4 rot((F32*) mPathp->mPath[s].mRot.mMatrix);
-			LLMatrix4 scale_mat(sc);
-			
-			scale_mat *= rot;
-			
-			LLMatrix4a rot_mat;
-			rot_mat.loadu(scale_mat);
+			const LLPath::PathPt& path_pt = mPathp->mPath[s];
+
+			// rows of scale * rot, each row of the path rotation scaled by
+			// the matching component of the path scale
+			LLVector4a row0, row1, row2;
+			row0.setMul(path_pt.mRot.mMatrix[0], _mm_shuffle_ps(path_pt.mScale, path_pt.mScale, _MM_SHUFFLE(0, 0, 0, 0)));
+			row1.setMul(path_pt.mRot.mMatrix[1], _mm_shuffle_ps(path_pt.mScale, path_pt.mScale, _MM_SHUFFLE(1, 1, 1, 1)));
+			row2.setMul(path_pt.mRot.mMatrix[2], _mm_shuffle_ps(path_pt.mScale, path_pt.mScale, _MM_SHUFFLE(2, 2, 2, 2)));
 			
-			LLVector4a* profile = mProfilep->mProfile.mArray;
-			LLVector4a* end_profile = profile+sizeT;
-			LLVector4a offset = mPathp->mPath[s].mPos;
+			const LLVector4a* profile = mProfilep->mProfile.mArray;
+			const LLVector4a* end_profile = profile+sizeT;
+			LLVector4a offset = path_pt.mPos;
 
             // hack to work around MAINT-5660 for debug until we can suss out
             // what is wrong with the path generated that inserts NaNs...
@@ -2212,13 +2329,21 @@ BOOL LLVolume::generate()
                 offset.clear();
             }
 
-			LLVector4a tmp;
-
 			// Run along the profile.
 			while (profile < end_profile)
 			{
-				rot_mat.rotate(*profile++, tmp);
-				dst->setAdd(tmp,offset);
+				LLVector4a x, y, z;
+				x = _mm_shuffle_ps(*profile, *profile, _MM_SHUFFLE(0, 0, 0, 0));
+				y = _mm_shuffle_ps(*profile, *profile, _MM_SHUFFLE(1, 1, 1, 1));
+				z = _mm_shuffle_ps(*profile, *profile, _MM_SHUFFLE(2, 2, 2, 2));
+				++profile;
+
+				x.mul(row0);
+				y.mul(row1);
+				z.mul(row2);
+				x.add(y);
+				x.add(z);
+				dst->setAdd(x, offset);
 				++dst;
 			}
 		}
@@ -2844,6 +2969,20 @@ void LLVolume::copyFacesFrom(const std::vector<LLVolumeFace> &faces)
 	mSculptLevel = 0;
 }
 
+void LLVolume::swapSculpt(LLVolume* volume)
+{
+	llassert(volume->mParams == mParams);
+
+	std::swap(mPathp, volume->mPathp);
+	std::swap(mProfilep, volume->mProfilep);
+	mMesh.swap(volume->mMesh);
+	mVolumeFaces.swap(volume->mVolumeFaces);
+
+	mFaceMask = volume->mFaceMask;
+	mSculptLevel = volume->mSculptLevel;
+	mSurfaceArea = volume->mSurfaceArea;
+}
+
 void LLVolume::copyVolumeFaces(const LLVolume* volume)
 {
 	mVolumeFaces = volume->mVolumeFaces;
@@ -3871,6 +4010,8 @@ void LLVolume::generateSilhouetteVertices(std::vector<LLVector3> &vertices,
 			continue;
 		}
 
+		face.expand();
+
 		if (face.mTypeMask & (LLVolumeFace::CAP_MASK))
 		{
 			LLVector4a* v = (LLVector4a*)face.mPositions;
@@ -4096,6 +4237,102 @@ void LLVolume::generateSilhouetteVertices(std::vector<LLVector3> &vertices,
 	}
 }
 
+// brute force raycast of every triangle of face, for faces without an
+// octree; true if a hit closer than closest_t was found
+static bool intersect_triangles(const LLVolumeFace& face, const LLVector4a& start, const LLVector4a& dir,
+                                F32& closest_t, LLVector4a* intersection, LLVector2* tex_coord,
+                                LLVector4a* normal, LLVector4a* tangent_out)
+{
+	bool hit = false;
+
+	U32 tri_count = face.mNumIndices/3;
+
+	for (U32 j = 0; j < tri_count; ++j)
+	{
+		U16 idx0 = face.mIndices[j*3+0];
+		U16 idx1 = face.mIndices[j*3+1];
+		U16 idx2 = face.mIndices[j*3+2];
+
+		const LLVector4a& v0 = face.mPositions[idx0];
+		const LLVector4a& v1 = face.mPositions[idx1];
+		const LLVector4a& v2 = face.mPositions[idx2];
+
+		F32 a,b,t;
+
+		if (LLTriangleRayIntersect(v0, v1, v2,
+				start, dir, a, b, t))
+		{
+			if ((t >= 0.f) &&      // if hit is after start
+				(t <= 1.f) &&      // and before end
+				(t < closest_t))   // and this hit is closer
+			{
+				closest_t = t;
+				hit = true;
+
+				if (intersection != NULL)
+				{
+					LLVector4a intersect = dir;
+					intersect.mul(closest_t);
+					intersect.add(start);
+					*intersection = intersect;
+				}
+
+
+				if (tex_coord != NULL)
+				{
+					LLVector2* tc = (LLVector2*) face.mTexCoords;
+					*tex_coord = ((1.f - a - b)  * tc[idx0] +
+						a              * tc[idx1] +
+						b              * tc[idx2]);
+
+				}
+
+				if (normal!= NULL)
+				{
+					LLVector4a* norm = face.mNormals;
+
+					LLVector4a n1,n2,n3;
+					n1 = norm[idx0];
+					n1.mul(1.f-a-b);
+
+					n2 = norm[idx1];
+					n2.mul(a);
+
+					n3 = norm[idx2];
+					n3.mul(b);
+
+					n1.add(n2);
+					n1.add(n3);
+
+					*normal		= n1; 
+				}
+
+				if (tangent_out != NULL)
+				{
+					LLVector4a* tangents = face.mTangents;
+
+					LLVector4a t1,t2,t3;
+					t1 = tangents[idx0];
+					t1.mul(1.f-a-b);
+
+					t2 = tangents[idx1];
+					t2.mul(a);
+
+					t3 = tangents[idx2];
+					t3.mul(b);
+
+					t1.add(t2);
+					t1.add(t3);
+
+					*tangent_out = t1; 
+				}
+			}
+		}
+	}
+
+	return hit;
+}
+
 S32 LLVolume::lineSegmentIntersect(const LLVector4a& start, const LLVector4a& end, 
 								   S32 face,
 								   LLVector4a* intersection,LLVector2* tex_coord, LLVector4a* normal, LLVector4a* tangent_out)
@@ -4136,108 +4373,40 @@ S32 LLVolume::lineSegmentIntersect(const LLVector4a& start, const LLVector4a& en
 
         if (LLLineSegmentBoxIntersect(start, end, box_center, box_size))
 		{
+			face.expand();
+
 			if (tangent_out != NULL) // if the caller wants tangents, we may need to generate them
 			{
                 genTangents(i);
 			}
 
-			if (isUnique())
-			{ //don't bother with an octree for flexi volumes
-				U32 tri_count = face.mNumIndices/3;
-
-				for (U32 j = 0; j < tri_count; ++j)
-				{
-					U16 idx0 = face.mIndices[j*3+0];
-					U16 idx1 = face.mIndices[j*3+1];
-					U16 idx2 = face.mIndices[j*3+2];
-
-					const LLVector4a& v0 = face.mPositions[idx0];
-					const LLVector4a& v1 = face.mPositions[idx1];
-					const LLVector4a& v2 = face.mPositions[idx2];
-				
-					F32 a,b,t;
+			if (isUnique() || (mDeferOctreeBuilds && !face.getOctree()))
+			{ //don't bother with an octree for flexi volumes, or wait on one
+			  //for volumes that defer building theirs
+                if (mDeferOctreeBuilds)
+                {
+                    // geometry still unchanged since the last raycast is
+                    // worth a tree, geometry that changes every frame (an
+                    // animating avatar) would never get to use one
+                    if (face.mRaycastStamp == face.mOctreeStamp)
+                    {
+                        requestOctree(i);
+                    }
+                    face.mRaycastStamp = face.mOctreeStamp;
+                }
 
-					if (LLTriangleRayIntersect(v0, v1, v2,
-							start, dir, a, b, t))
-					{
-						if ((t >= 0.f) &&      // if hit is after start
-							(t <= 1.f) &&      // and before end
-							(t < closest_t))   // and this hit is closer
-						{
-							closest_t = t;
-							hit_face = i;
-
-							if (intersection != NULL)
-							{
-								LLVector4a intersect = dir;
-								intersect.mul(closest_t);
-								intersect.add(start);
-								*intersection = intersect;
-							}
-
-
-							if (tex_coord != NULL)
-							{
-								LLVector2* tc = (LLVector2*) face.mTexCoords;
-								*tex_coord = ((1.f - a - b)  * tc[idx0] +
-									a              * tc[idx1] +
-									b              * tc[idx2]);
-
-							}
-
-							if (normal!= NULL)
-							{
-								LLVector4a* norm = face.mNormals;
-								
-								LLVector4a n1,n2,n3;
-								n1 = norm[idx0];
-								n1.mul(1.f-a-b);
-								
-								n2 = norm[idx1];
-								n2.mul(a);
-								
-								n3 = norm[idx2];
-								n3.mul(b);
-
-								n1.add(n2);
-								n1.add(n3);
-								
-								*normal		= n1; 
-							}
-
-							if (tangent_out != NULL)
-							{
-								LLVector4a* tangents = face.mTangents;
-								
-								LLVector4a t1,t2,t3;
-								t1 = tangents[idx0];
-								t1.mul(1.f-a-b);
-								
-								t2 = tangents[idx1];
-								t2.mul(a);
-								
-								t3 = tangents[idx2];
-								t3.mul(b);
-
-								t1.add(t2);
-								t1.add(t3);
-								
-								*tangent_out = t1; 
-							}
-						}
-					}
-				}
+                if (intersect_triangles(face, start, dir, closest_t, intersection, tex_coord, normal, tangent_out))
+                {
+                    hit_face = i;
+                }
 			}
 			else
 			{
-                if (!face.getOctree())
-				{
-					face.createOctree();
-				}
-			
-				LLOctreeTriangleRayIntersect intersect(start, dir, &face, &closest_t, intersection, tex_coord, normal, tangent_out);
-                intersect.traverse(face.getOctree());
-				if (intersect.mHitFace)
+                // builds the tree on first use, or marks it recently used
+                face.createOctree();
+
+                const LLVolumeBVH* octree = face.getOctree();
+                if (octree && octree->intersect(face, start, dir, &closest_t, intersection, tex_coord, normal, tangent_out))
 				{
 					hit_face = i;
 				}
@@ -4249,6 +4418,101 @@ S32 LLVolume::lineSegmentIntersect(const LLVector4a& start, const LLVector4a& en
 	return hit_face;
 }
 
+void LLVolume::prefetchOctrees()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+
+    if (isUnique())
+    { // unique volumes are brute force raycast, see lineSegmentIntersect
+        return;
+    }
+
+    for (S32 i = 0; i < getNumVolumeFaces(); ++i)
+    {
+        requestOctree(i);
+    }
+}
+
+void LLVolume::requestOctree(S32 i)
+{
+    LLVolumeFace& face = mVolumeFaces[i];
+
+    if (face.getOctree() || !face.mNumIndices || face.mOctreeRequestStamp == face.mOctreeStamp)
+    { // already built, nothing to build, or already in flight for this geometry
+        return;
+    }
+
+    if (face.isCompact())
+    { // the raycast that expands it will build the tree
+        return;
+    }
+
+    LL::WorkQueue::ptr_t main_queue = LL::WorkQueue::getInstance("mainloop");
+    LL::WorkQueue::ptr_t general_queue = LL::WorkQueue::getInstance("General");
+    if (!main_queue || !general_queue)
+    {
+        return;
+    }
+
+    struct Snapshot
+    {
+        LLAlignedArray<LLVector4a, 64> mPositions;
+        std::vector<U16> mIndices;
+    };
+
+    face.mOctreeRequestStamp = face.mOctreeStamp;
+
+    // the build runs against a copy so the face is free to be regenerated
+    // or destroyed while it's in flight
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->mPositions.resize(face.mNumVertices);
+    LLVector4a::memcpyNonAliased16((F32*) &snapshot->mPositions[0], (F32*) face.mPositions, face.mNumVertices * sizeof(LLVector4a));
+    snapshot->mIndices.assign(face.mIndices, face.mIndices + face.mNumIndices);
+
+    // LLRefCount isn't atomic and the closures are copied and destroyed on
+    // the worker, so the volume is held by a plain pointer, ref'd here and
+    // unref'd in the callback
+    LLVolume* volume = this;
+    volume->ref();
+
+    main_queue->postTo(
+        general_queue,
+        [snapshot]() // Work done on general queue
+        {
+            auto octree = std::make_shared<LLVolumeBVH>();
+            octree->build(&snapshot->mPositions[0], snapshot->mIndices.data(), (U32) snapshot->mIndices.size());
+            return octree;
+        },
+        [volume, i, stamp = face.mOctreeStamp](std::shared_ptr<LLVolumeBVH> octree) // Callback to main thread
+        {
+            if (i < volume->getNumVolumeFaces() && octree->getNodeCount())
+            {
+                LLVolumeFace& face = volume->getVolumeFace(i);
+                if (face.mOctreeStamp == stamp && !face.getOctree())
+                {
+                    face.installOctree(new LLVolumeBVH(std::move(*octree)));
+                }
+            }
+            volume->unref();
+        });
+}
+
+void LLVolume::compactFaces()
+{
+    for (S32 i = 0; i < getNumVolumeFaces(); ++i)
+    {
+        mVolumeFaces[i].compact();
+    }
+}
+
+void LLVolume::expandFaces()
+{
+    for (S32 i = 0; i < getNumVolumeFaces(); ++i)
+    {
+        mVolumeFaces[i].expand();
+    }
+}
+
 class LLVertexIndexPair
 {
 public:
@@ -4769,6 +5033,226 @@ std::ostream& operator<<(std::ostream &s, const LLVolume *volumep)
 	return s;
 }
 
+namespace
+{
+    // Faces that currently own an octree, most recently used at the front.
+    // Volumes may be torn down off the main thread, so guard with a mutex.
+    LLMutex* octree_mutex()
+    {
+        static LLMutex sMutex;
+        return &sMutex;
+    }
+
+    std::list<LLVolumeFace*>& octree_lru()
+    {
+        static std::list<LLVolumeFace*> sLRU;
+        return sLRU;
+    }
+
+    U64 sOctreeMemoryUsage = 0;
+    U64 sOctreeMemoryBudget = 64 * 1024 * 1024;
+
+    // unique across all faces, see mOctreeStamp and mWeightsStamp
+    U32 next_face_stamp()
+    {
+        static std::atomic<U32> sStamp(0);
+        return ++sStamp;
+    }
+}
+
+namespace
+{
+    // LLVolumeFace::mCompactData is a single allocation laid out as below,
+    // each section starting on a 16 byte boundary:
+    //   CompactHeader
+    //   U16[3] per vertex: position, 0..65535 across the face bounds
+    //   S16[2] per vertex: octahedral normal
+    //   U16[2] per vertex: half float texture coordinate
+    //   S16[3] per vertex: octahedral tangent and sign of w (if mHasTangents)
+    struct alignas(16) CompactHeader
+    {
+        LLVector4a mMin;
+        LLVector4a mScale;  // size of one position step on each axis
+        U32 mHasTangents;
+    };
+
+    // largest texture coordinate error accepted from the half float encoding
+    const F32 COMPACT_TEXCOORD_TOLERANCE = 1.f / 2048.f;
+    // largest error accepted from the octahedral normal encoding
+    const F32 COMPACT_NORMAL_TOLERANCE = 1.0e-3f;
+    // largest position error accepted from the 16 bit encoding, in volume
+    // units where the whole object spans one
+    const F32 COMPACT_POSITION_TOLERANCE = 1.0e-4f;
+
+    U32 compact_section(U32 bytes)
+    {
+        return (bytes + 0xF) & ~0xF;
+    }
+
+    struct CompactLayout
+    {
+        CompactLayout(S32 num_verts, bool has_tangents)
+        {
+            mPositions = compact_section(sizeof(CompactHeader));
+            mNormals = mPositions + compact_section(num_verts * 3 * sizeof(U16));
+            mTexCoords = mNormals + compact_section(num_verts * 2 * sizeof(S16));
+            mTangents = mTexCoords + compact_section(num_verts * 2 * sizeof(U16));
+            mSize = mTangents + (has_tangents ? compact_section(num_verts * 3 * sizeof(S16)) : 0);
+        }
+
+        U32 mPositions;
+        U32 mNormals;
+        U32 mTexCoords;
+        U32 mTangents;
+        U32 mSize;
+    };
+
+    U32 compact_data_size(const U8* data, S32 num_verts)
+    {
+        const CompactHeader* header = (const CompactHeader*) data;
+        return CompactLayout(num_verts, header->mHasTangents != 0).mSize;
+    }
+
+    U16 float_to_half(F32 val)
+    {
+        U32 bits;
+        memcpy(&bits, &val, sizeof(bits));
+
+        U32 sign = (bits >> 16) & 0x8000;
+        S32 exp = (S32) ((bits >> 23) & 0xFF) - 127 + 15;
+        U32 mantissa = bits & 0x7FFFFF;
+
+        if (exp >= 31)
+        { // too large, infinity or NaN, all become infinity
+            return (U16) (sign | 0x7C00);
+        }
+
+        if (exp <= 0)
+        { // denormal or zero
+            if (exp < -10)
+            {
+                return (U16) sign;
+            }
+
+            mantissa |= 0x800000;
+            U32 shift = 14 - exp;
+            U32 half = mantissa >> shift;
+            if ((mantissa >> (shift - 1)) & 1)
+            { // round to nearest, may carry into the smallest normal
+                ++half;
+            }
+            return (U16) (sign | half);
+        }
+
+        U32 half = sign | (exp << 10) | (mantissa >> 13);
+        if (mantissa & 0x1000)
+        { // round to nearest, a carry out of the mantissa bumps the exponent
+            ++half;
+        }
+        return (U16) half;
+    }
+
+    F32 half_to_float(U16 half)
+    {
+        U32 sign = (U32) (half & 0x8000) << 16;
+        U32 exp = (half >> 10) & 0x1F;
+        U32 mantissa = half & 0x3FF;
+
+        if (exp == 0)
+        { // denormal or zero
+            F32 val = mantissa * (1.f / 16777216.f);
+            return sign ? -val : val;
+        }
+
+        U32 bits;
+        if (exp == 31)
+        {
+            bits = sign | 0x7F800000 | (mantissa << 13);
+        }
+        else
+        {
+            bits = sign | ((exp + 112) << 23) | (mantissa << 13);
+        }
+
+        F32 val;
+        memcpy(&val, &bits, sizeof(val));
+        return val;
+    }
+
+    S16 snorm16(F32 val)
+    {
+        return (S16) ll_round(llclamp(val, -1.f, 1.f) * 32767.f);
+    }
+
+    // Octahedral encoding of a direction, returns false for zero length
+    // vectors, which have no encoding
+    bool oct_encode(const LLVector4a& dir, S16* out)
+    {
+        const F32* v = dir.getF32ptr();
+        F32 sum = fabsf(v[0]) + fabsf(v[1]) + fabsf(v[2]);
+        if (sum <= 0.f)
+        {
+            out[0] = out[1] = 0;
+            return false;
+        }
+
+        F32 x = v[0] / sum;
+        F32 y = v[1] / sum;
+        if (v[2] < 0.f)
+        { // fold the lower hemisphere over the diagonals
+            F32 fx = (1.f - fabsf(y)) * (x >= 0.f ? 1.f : -1.f);
+            y = (1.f - fabsf(x)) * (y >= 0.f ? 1.f : -1.f);
+            x = fx;
+        }
+
+        out[0] = snorm16(x);
+        out[1] = snorm16(y);
+        return true;
+    }
+
+    void oct_decode(const S16* in, LLVector4a& dir)
+    {
+        F32 x = in[0] * (1.f / 32767.f);
+        F32 y = in[1] * (1.f / 32767.f);
+        F32 z = 1.f - fabsf(x) - fabsf(y);
+        if (z < 0.f)
+        {
+            F32 fx = (1.f - fabsf(y)) * (x >= 0.f ? 1.f : -1.f);
+            y = (1.f - fabsf(x)) * (y >= 0.f ? 1.f : -1.f);
+            x = fx;
+        }
+
+        dir.set(x, y, z, 0.f);
+        dir.normalize3();
+    }
+
+    // Tangents carry the bitangent sign in w, stored in the third component
+    // which is 0 for zero length tangents
+    void tangent_encode(const LLVector4a& tangent, S16* out)
+    {
+        if (oct_encode(tangent, out))
+        {
+            out[2] = tangent.getF32ptr()[3] < 0.f ? -32767 : 32767;
+        }
+        else
+        {
+            out[2] = 0;
+        }
+    }
+
+    void tangent_decode(const S16* in, LLVector4a& tangent)
+    {
+        if (in[2] == 0)
+        {
+            tangent.clear();
+            return;
+        }
+
+        oct_decode(in, tangent);
+        tangent.getF32ptr()[3] = in[2] < 0 ? -1.f : 1.f;
+    }
+}
+
 LLVolumeFace::LLVolumeFace() : 
 	mID(0),
 	mTypeMask(0),
@@ -4790,9 +5274,13 @@ LLVolumeFace::LLVolumeFace() :
     mJointIndices(NULL),
 #endif
     mWeightsScrubbed(FALSE),
+    mWeightsStamp(0),
+	mOptimized(FALSE),
+    mOctreeStamp(next_face_stamp()),
+    mOctreeRequestStamp(0),
+    mRaycastStamp(0),
 	mOctree(NULL),
-    mOctreeTriangles(NULL),
-	mOptimized(FALSE)
+    mCompactData(NULL)
 {
 	mExtents = (LLVector4a*) ll_aligned_malloc_16(sizeof(LLVector4a)*3);
 	mExtents[0].splat(-0.5f);
@@ -4821,8 +5309,12 @@ LLVolumeFace::LLVolumeFace(const LLVolumeFace& src)
     mJointIndices(NULL),
 #endif
     mWeightsScrubbed(FALSE),
+    mWeightsStamp(0),
+    mOctreeStamp(next_face_stamp()),
+    mOctreeRequestStamp(0),
+    mRaycastStamp(0),
     mOctree(NULL),
-    mOctreeTriangles(NULL)
+    mCompactData(NULL)
 {
 	mExtents = (LLVector4a*) ll_aligned_malloc_16(sizeof(LLVector4a)*3);
 	mCenter = mExtents+2;
@@ -4852,7 +5344,18 @@ LLVolumeFace& LLVolumeFace::operator=(const LLVolumeFace& src)
 
 	freeData();
 	
-	resizeVertices(src.mNumVertices);
+	if (src.mCompactData)
+	{ //only the encoded vertices exist, copy them as is
+		U32 size = compact_data_size(src.mCompactData, src.mNumVertices);
+		mCompactData = (U8*) ll_aligned_malloc_16(size);
+		LLVector4a::memcpyNonAliased16((F32*) mCompactData, (F32*) src.mCompactData, size);
+		mNumVertices = src.mNumVertices;
+		mNumAllocatedVertices = src.mNumVertices;
+	}
+	else
+	{
+		resizeVertices(src.mNumVertices);
+	}
 	resizeIndices(src.mNumIndices);
 
 	if (mNumVertices)
@@ -4860,7 +5363,10 @@ LLVolumeFace& LLVolumeFace::operator=(const LLVolumeFace& src)
 		S32 vert_size = mNumVertices*sizeof(LLVector4a);
 		S32 tc_size = (mNumVertices*sizeof(LLVector2)+0xF) & ~0xF;
 			
+		if (src.mPositions)
+		{
 		LLVector4a::memcpyNonAliased16((F32*) mPositions, (F32*) src.mPositions, vert_size);
+		}
 
 		if (src.mNormals)
 		{
@@ -4895,6 +5401,7 @@ LLVolumeFace& LLVolumeFace::operator=(const LLVolumeFace& src)
 			ll_aligned_free_16(mWeights);            
 			mWeights = NULL;            
             mWeightsScrubbed = FALSE;
+            mWeightsStamp = next_face_stamp();
 		}   
 
     #if USE_SEPARATE_JOINT_INDICES_AND_WEIGHTS
@@ -4956,6 +5463,7 @@ void LLVolumeFace::freeData()
 	mTangents = NULL;
 	ll_aligned_free_16(mWeights);
 	mWeights = NULL;
+	mWeightsStamp = next_face_stamp();
 
 #if USE_SEPARATE_JOINT_INDICES_AND_WEIGHTS
     ll_aligned_free_16(mJointIndices);
@@ -4964,6 +5472,9 @@ void LLVolumeFace::freeData()
 	mJustWeights = NULL;
 #endif
 
+    ll_aligned_free_16(mCompactData);
+    mCompactData = NULL;
+
     destroyOctree();
 }
 
@@ -5676,96 +6187,102 @@ bool LLVolumeFace::cacheOptimize(bool gen_tangents)
 	return true;
 }
 
-void LLVolumeFace::createOctree(F32 scaler, const LLVector4a& center, const LLVector4a& size)
+void LLVolumeFace::createOctree()
 {
 	LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME
 
     if (getOctree())
 	{
+        touchOctree();
 		return;
 	}
 
     llassert(mNumIndices % 3 == 0);
 
-    mOctree = new LLOctreeRoot<LLVolumeTriangle, LLVolumeTriangle*>(center, size, NULL);
-	new LLVolumeOctreeListener(mOctree);
-    const U32 num_triangles = mNumIndices / 3;
-    // Initialize all the triangles we need
-    mOctreeTriangles = new LLVolumeTriangle[num_triangles];
+    LLVolumeBVH* octree = new LLVolumeBVH();
+    if (!octree->build(mPositions, mIndices, mNumIndices))
+    {
+        delete octree;
+        return;
+    }
 
-    for (U32 triangle_index = 0; triangle_index < num_triangles; ++triangle_index)
-	{ //for each triangle
-        const U32 index = triangle_index * 3;
-        LLVolumeTriangle* tri = &mOctreeTriangles[triangle_index];
-				
-		const LLVector4a& v0 = mPositions[mIndices[index]];
-		const LLVector4a& v1 = mPositions[mIndices[index + 1]];
-		const LLVector4a& v2 = mPositions[mIndices[index + 2]];
-
-		//store pointers to vertex data
-		tri->mV[0] = &v0;
-		tri->mV[1] = &v1;
-		tri->mV[2] = &v2;
-
-		//store indices
-		tri->mIndex[0] = mIndices[index];
-		tri->mIndex[1] = mIndices[index + 1];
-		tri->mIndex[2] = mIndices[index + 2];
-
-		//get minimum point
-		LLVector4a min = v0;
-		min.setMin(min, v1);
-		min.setMin(min, v2);
-
-		//get maximum point
-		LLVector4a max = v0;
-		max.setMax(max, v1);
-		max.setMax(max, v2);
-
-		//compute center
-		LLVector4a center;
-		center.setAdd(min, max);
-		center.mul(0.5f);
-
-		tri->mPositionGroup = center;
-
-		//compute "radius"
-		LLVector4a size;
-		size.setSub(max,min);
-		
-		tri->mRadius = size.getLength3().getF32() * scaler;
-		
-		//insert
-		mOctree->insert(tri);
-	}
+    installOctree(octree);
+}
 
-	//remove unneeded octree layers
-	while (!mOctree->balance())	{ }
+void LLVolumeFace::installOctree(LLVolumeBVH* octree)
+{
+    destroyOctree();
 
-	//calculate AABB for each node
-	LLVolumeOctreeRebound rebound(this);
-	rebound.traverse(mOctree);
+    LLMutexLock lock(octree_mutex());
 
-	if (gDebugGL)
-	{
-		LLVolumeOctreeValidate validate;
-		validate.traverse(mOctree);
-	}
+    mOctree = octree;
+    sOctreeMemoryUsage += mOctree->getMemoryUsage();
+
+    std::list<LLVolumeFace*>& lru = octree_lru();
+    lru.push_front(this);
+    mOctreeLRUIter = lru.begin();
+
+    // evict least recently used trees until we're back under budget, they
+    // get rebuilt on demand if they're ever raycast again
+    while (sOctreeMemoryUsage > sOctreeMemoryBudget && lru.back() != this)
+    {
+        lru.back()->destroyOctree();
+    }
 }
 
 void LLVolumeFace::destroyOctree()
 {
+    // whatever geometry an in flight build snapshotted is no longer current
+    mOctreeStamp = next_face_stamp();
+
+    if (!mOctree)
+    {
+        return;
+    }
+
+    LLMutexLock lock(octree_mutex());
+
+    if (!mOctree)
+    { // evicted by another thread while we were waiting on the lock
+        return;
+    }
+
+    sOctreeMemoryUsage -= mOctree->getMemoryUsage();
+    octree_lru().erase(mOctreeLRUIter);
+
     delete mOctree;
     mOctree = NULL;
-    delete[] mOctreeTriangles;
-    mOctreeTriangles = NULL;
 }
 
-const LLOctreeNode<LLVolumeTriangle, LLVolumeTriangle*>* LLVolumeFace::getOctree() const
+void LLVolumeFace::touchOctree()
+{
+    LLMutexLock lock(octree_mutex());
+
+    if (mOctree)
+    {
+        std::list<LLVolumeFace*>& lru = octree_lru();
+        lru.splice(lru.begin(), lru, mOctreeLRUIter);
+    }
+}
+
+const LLVolumeBVH* LLVolumeFace::getOctree() const
 {
     return mOctree;
 }
 
+//static
+U64 LLVolumeFace::getOctreeMemoryUsage()
+{
+    LLMutexLock lock(octree_mutex());
+    return sOctreeMemoryUsage;
+}
+
+//static
+void LLVolumeFace::setOctreeMemoryBudget(U64 bytes)
+{
+    LLMutexLock lock(octree_mutex());
+    sOctreeMemoryBudget = bytes;
+}
 
 void LLVolumeFace::swapData(LLVolumeFace& rhs)
 {
@@ -5774,8 +6291,187 @@ void LLVolumeFace::swapData(LLVolumeFace& rhs)
 	llswap(rhs.mTangents, mTangents);
 	llswap(rhs.mTexCoords, mTexCoords);
 	llswap(rhs.mIndices,mIndices);
+	llswap(rhs.mCompactData, mCompactData);
 	llswap(rhs.mNumVertices, mNumVertices);
 	llswap(rhs.mNumIndices, mNumIndices);
+
+    // trees index into geometry that just moved
+    destroyOctree();
+    rhs.destroyOctree();
+}
+
+bool LLVolumeFace::compact()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+
+    if (mCompactData)
+    {
+        return true;
+    }
+
+    if (!mNumVertices || !mPositions || !mNormals || !mTexCoords)
+    {
+        return false;
+    }
+
+    const bool has_tangents = mTangents != NULL;
+    CompactLayout layout(mNumVertices, has_tangents);
+
+    U8* data = (U8*) ll_aligned_malloc_16(layout.mSize);
+    if (!data)
+    {
+        return false;
+    }
+
+    CompactHeader* header = (CompactHeader*) data;
+    U16* positions = (U16*) (data + layout.mPositions);
+    S16* normals = (S16*) (data + layout.mNormals);
+    U16* tex_coords = (U16*) (data + layout.mTexCoords);
+    S16* tangents = (S16*) (data + layout.mTangents);
+
+    // quantize against the actual bounds of the vertices rather than
+    // mExtents, which may be stale or padded
+    LLVector4a min = mPositions[0];
+    LLVector4a max = mPositions[0];
+    for (S32 i = 1; i < mNumVertices; ++i)
+    {
+        min.setMin(min, mPositions[i]);
+        max.setMax(max, mPositions[i]);
+    }
+
+    LLVector4a range;
+    range.setSub(max, min);
+
+    F32 inv_scale[3];
+    for (U32 i = 0; i < 3; ++i)
+    {
+        F32 r = range.getF32ptr()[i];
+        inv_scale[i] = r > 0.f ? 65535.f / r : 0.f;
+    }
+
+    header->mMin = min;
+    header->mScale.setMul(range, 1.f / 65535.f);
+    header->mHasTangents = has_tangents ? 1 : 0;
+
+    bool lossless = true;
+
+    for (S32 i = 0; i < mNumVertices && lossless; ++i)
+    {
+        LLVector4a offset;
+        offset.setSub(mPositions[i], min);
+        const F32* o = offset.getF32ptr();
+        for (U32 j = 0; j < 3; ++j)
+        {
+            positions[i * 3 + j] = (U16) llclamp(ll_round(o[j] * inv_scale[j]), 0, 65535);
+        }
+
+        // decoded the way expand() does it
+        LLVector4a position((F32) positions[i * 3], (F32) positions[i * 3 + 1], (F32) positions[i * 3 + 2]);
+        position.mul(header->mScale);
+        position.add(min);
+        lossless = position.equals3(mPositions[i], COMPACT_POSITION_TOLERANCE);
+
+        LLVector4a normal;
+        lossless = lossless && oct_encode(mNormals[i], normals + i * 2);
+        oct_decode(normals + i * 2, normal);
+        lossless = lossless && normal.equals3(mNormals[i], COMPACT_NORMAL_TOLERANCE);
+
+        for (U32 j = 0; j < 2; ++j)
+        {
+            F32 tc = mTexCoords[i].mV[j];
+            tex_coords[i * 2 + j] = float_to_half(tc);
+            // written so that NaN fails too
+            lossless = lossless && fabsf(half_to_float(tex_coords[i * 2 + j]) - tc) <= COMPACT_TEXCOORD_TOLERANCE;
+        }
+
+        if (has_tangents)
+        {
+            LLVector4a tangent;
+            tangent_encode(mTangents[i], tangents + i * 3);
+            tangent_decode(tangents + i * 3, tangent);
+            lossless = lossless && tangent.equals3(mTangents[i], COMPACT_NORMAL_TOLERANCE);
+        }
+    }
+
+    if (!lossless)
+    {
+        ll_aligned_free_16(data);
+        return false;
+    }
+
+    ll_aligned_free<64>(mPositions);
+    mPositions = NULL;
+    mNormals = NULL;
+    mTexCoords = NULL;
+    ll_aligned_free_16(mTangents);
+    mTangents = NULL;
+    mNumAllocatedVertices = mNumVertices;
+
+    mCompactData = data;
+
+    // the tree was built against the full precision positions
+    destroyOctree();
+
+    return true;
+}
+
+void LLVolumeFace::expand()
+{
+    if (!mCompactData)
+    {
+        return;
+    }
+
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+
+    U8* data = mCompactData;
+    mCompactData = NULL;
+
+    const CompactHeader* header = (const CompactHeader*) data;
+    CompactLayout layout(mNumVertices, header->mHasTangents != 0);
+
+    // same layout resizeVertices produces, but keep mJointRiggingInfoTab
+    // since the geometry didn't change
+    allocateVertices(mNumVertices);
+    if (!mPositions)
+    {
+        LL_WARNS() << "Failed to allocate " << mNumVertices << " vertices for face expansion" << LL_ENDL;
+        mNumVertices = 0;
+        mNumAllocatedVertices = 0;
+        mNumIndices = 0;
+        ll_aligned_free_16(data);
+        return;
+    }
+
+    const U16* positions = (const U16*) (data + layout.mPositions);
+    const S16* normals = (const S16*) (data + layout.mNormals);
+    const U16* tex_coords = (const U16*) (data + layout.mTexCoords);
+    const S16* tangents = (const S16*) (data + layout.mTangents);
+
+    for (S32 i = 0; i < mNumVertices; ++i)
+    {
+        const U16* p = positions + i * 3;
+        mPositions[i].set(p[0], p[1], p[2]);
+        mPositions[i].mul(header->mScale);
+        mPositions[i].add(header->mMin);
+
+        oct_decode(normals + i * 2, mNormals[i]);
+
+        mTexCoords[i].set(half_to_float(tex_coords[i * 2]), half_to_float(tex_coords[i * 2 + 1]));
+    }
+
+    if (header->mHasTangents)
+    {
+        allocateTangents(mNumVertices);
+        for (S32 i = 0; i < mNumVertices; ++i)
+        {
+            tangent_decode(tangents + i * 3, mTangents[i]);
+        }
+    }
+
+    mNumAllocatedVertices = mNumVertices;
+
+    ll_aligned_free_16(data);
 }
 
 void	LerpPlanarVertex(LLVolumeFace::VertexData& v0,
@@ -6516,23 +7212,11 @@ void LLVolumeFace::resizeVertices(S32 num_verts)
 
 	mTangents = NULL;
 
-	if (num_verts)
-	{
-		//pad texture coordinate block end to allow for QWORD reads
-		S32 tc_size = ((num_verts*sizeof(LLVector2)) + 0xF) & ~0xF;
+	//whatever was encoded is being replaced
+	ll_aligned_free_16(mCompactData);
+	mCompactData = NULL;
 
-		mPositions = (LLVector4a*) ll_aligned_malloc<64>(sizeof(LLVector4a)*2*num_verts+tc_size);
-		mNormals = mPositions+num_verts;
-		mTexCoords = (LLVector2*) (mNormals+num_verts);
-
-		ll_assert_aligned(mPositions, 64);
-	}
-	else
-	{
-		mPositions = NULL;
-		mNormals = NULL;
-		mTexCoords = NULL;
-	}
+	allocateVertices(num_verts);
 
 
     if (mPositions)
@@ -6551,6 +7235,27 @@ void LLVolumeFace::resizeVertices(S32 num_verts)
     mJointRiggingInfoTab.clear();
 }
 
+void LLVolumeFace::allocateVertices(S32 num_verts)
+{
+	if (num_verts)
+	{
+		//pad texture coordinate block end to allow for QWORD reads
+		S32 tc_size = ((num_verts*sizeof(LLVector2)) + 0xF) & ~0xF;
+
+		mPositions = (LLVector4a*) ll_aligned_malloc<64>(sizeof(LLVector4a)*2*num_verts+tc_size);
+		mNormals = mPositions+num_verts;
+		mTexCoords = (LLVector2*) (mNormals+num_verts);
+
+		ll_assert_aligned(mPositions, 64);
+	}
+	else
+	{
+		mPositions = NULL;
+		mNormals = NULL;
+		mTexCoords = NULL;
+	}
+}
+
 void LLVolumeFace::pushVertex(const LLVolumeFace::VertexData& cv)
 {
 	pushVertex(cv.getPosition(), cv.getNormal(), cv.mTexCoord);
@@ -6616,7 +7321,7 @@ void LLVolumeFace::allocateWeights(S32 num_verts)
 {
 	ll_aligned_free_16(mWeights);
 	mWeights = (LLVector4a*)ll_aligned_malloc_16(sizeof(LLVector4a)*num_verts);
-    
+	mWeightsStamp = next_face_stamp();
 }
 
 void LLVolumeFace::allocateJointIndices(S32 num_verts)
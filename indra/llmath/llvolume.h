@@ -27,7 +27,9 @@
 #ifndef LL_LLVOLUME_H
 #define LL_LLVOLUME_H
 
+#include <atomic>
 #include <iostream>
+#include <list>
 
 class LLProfileParams;
 class LLPathParams;
@@ -36,11 +38,10 @@ class LLProfile;
 class LLPath;
 
 template<class T> class LLPointer;
-template <class T, typename T_PTR> class LLOctreeNode;
 
 class LLVolumeFace;
 class LLVolume;
-class LLVolumeTriangle;
+class LLVolumeBVH;
 
 #include "lluuid.h"
 #include "v4color.h"
@@ -732,6 +733,10 @@ protected:
 	static S32 getNumNGonPoints(const LLProfileParams& params, S32 sides, F32 offset=0.0f, F32 bevel = 0.0f, F32 ang_scale = 1.f, S32 split = 0);
 	void genNGon(const LLProfileParams& params, S32 sides, F32 offset=0.0f, F32 bevel = 0.0f, F32 ang_scale = 1.f, S32 split = 0);
 
+	// does the work of generate() on a cache miss
+	BOOL generateShape(const LLProfileParams& params, BOOL path_open, F32 detail, S32 split,
+					   BOOL is_sculpted, S32 sculpt_size);
+
 	Face* addHole(const LLProfileParams& params, BOOL flat, F32 sides, F32 offset, F32 box_hollow, F32 ang_scale, S32 split = 0);
 	Face* addCap (S16 faceID);
 	Face* addFace(S32 index, S32 count, F32 scaleU, S16 faceID, BOOL flat);
@@ -808,6 +813,11 @@ public:
 public:
 	LLAlignedArray<PathPt, 64> mPath;
 
+protected:
+	// does the work of generate() on a cache miss
+	void generateShape(const LLPathParams& params, F32 detail, S32 split,
+					   BOOL is_sculpted, S32 sculpt_size);
+
 protected:
 	BOOL		  mOpen;
 	S32			  mTotal;
@@ -910,10 +920,35 @@ public:
 	void optimize(F32 angle_cutoff = 2.f);
 	bool cacheOptimize(bool gen_tangents = false);
 
-	void createOctree(F32 scaler = 0.25f, const LLVector4a& center = LLVector4a(0,0,0), const LLVector4a& size = LLVector4a(0.5f,0.5f,0.5f));
+    // Raycast acceleration structure ("octree" for historical reasons, it is
+    // an LLVolumeBVH).  Built on demand by LLVolume::lineSegmentIntersect and
+    // kept in a global LRU bounded by sOctreeMemoryBudget.
+	void createOctree();
     void destroyOctree();
     // Get a reference to the octree, which may be null
-    const LLOctreeNode<LLVolumeTriangle, LLVolumeTriangle*>* getOctree() const;
+    const LLVolumeBVH* getOctree() const;
+    // Adopt a tree built off thread for this face's current geometry
+    void installOctree(LLVolumeBVH* octree);
+
+    // total bytes held by face octrees, and the budget past which the least
+    // recently used ones are evicted
+    static U64 getOctreeMemoryUsage();
+    static void setOctreeMemoryBudget(U64 bytes);
+
+    // Compact in-memory representation for faces that are retained but
+    // rarely read: 16 bit positions relative to the face extents, octahedral
+    // normals and tangents and half float texture coordinates, roughly a
+    // third of the full size.  While compact, mPositions, mNormals,
+    // mTexCoords and mTangents are NULL and expand() must be called before
+    // touching them.  Weights and indices are left as is.
+    //
+    // compact() returns false and leaves the face alone if the encoding
+    // would visibly change it (positions off by more than 1/10000 of the
+    // volume, texture coordinates out of half float range, degenerate
+    // normals).
+    bool compact();
+    void expand();
+    bool isCompact() const { return mCompactData != NULL; }
 
 	enum
 	{
@@ -974,6 +1009,11 @@ public:
 
     mutable BOOL mWeightsScrubbed;
 
+    // changes every time mWeights is allocated or freed, so what was
+    // decoded from the weights can't be mistaken for a new buffer's at the
+    // same address
+    U32 mWeightsStamp;
+
     // Which joints are rigged to, and the bounding box of any rigged
     // vertices per joint.
     LLJointRiggingInfoTab mJointRiggingInfoTab;
@@ -986,9 +1026,25 @@ public:
     // used for regenerating tangents
     LLVector3 mNormalizedScale = LLVector3(1,1,1);
 
+    // changes every time the octree is invalidated, lets asynchronous builds
+    // detect that the geometry they snapshotted is stale
+    U32 mOctreeStamp;
+    // mOctreeStamp at the time of the last asynchronous build request
+    U32 mOctreeRequestStamp;
+    // mOctreeStamp at the last brute force raycast of a volume that defers
+    // octree builds, see LLVolume::setDeferOctreeBuilds
+    U32 mRaycastStamp;
+
 private:
-    LLOctreeNode<LLVolumeTriangle, LLVolumeTriangle*>* mOctree;
-    LLVolumeTriangle* mOctreeTriangles;
+    void touchOctree();
+    void allocateVertices(S32 num_verts);
+
+    LLVolumeBVH* mOctree;
+    typedef std::list<LLVolumeFace*> octree_lru_t;
+    octree_lru_t::iterator mOctreeLRUIter;
+
+    // encoded vertex data while compact, see compact()
+    U8* mCompactData;
 
 	BOOL createUnCutCubeCap(LLVolume* volume, BOOL partial_build = FALSE);
 	BOOL createCap(LLVolume* volume, BOOL partial_build = FALSE);
@@ -1044,6 +1100,11 @@ public:
 	S32 getSculptLevel() const                              { return mSculptLevel; }
 	void setSculptLevel(S32 level)							{ mSculptLevel = level; }
 
+	// sculpt level being generated off the main thread for this volume
+	enum { NO_SCULPT_PENDING = -3 };
+	S32 getPendingSculptLevel() const						{ return mPendingSculptLevel; }
+	void setPendingSculptLevel(S32 level)					{ mPendingSculptLevel = level; }
+
 	
 	static void getLoDTriangleCounts(const LLVolumeParams& params, S32* counts);
 
@@ -1067,10 +1128,26 @@ public:
 							 LLVector4a* tangent = NULL             // return the surface tangent at the intersection point
 		);
 
+    // Speculatively build octrees for faces that don't have one yet on the
+    // "General" thread pool, so a later lineSegmentIntersect doesn't have to
+    // build them synchronously.  No-op for unique volumes or if that pool
+    // isn't running.
+    void prefetchOctrees();
+
+    // For volumes whose positions change often, like rigged volumes:
+    // lineSegmentIntersect tests every triangle of a face that has no octree
+    // instead of building one inline, and requests one on the "General"
+    // thread pool for the next raycast.
+    void setDeferOctreeBuilds(bool defer)                   { mDeferOctreeBuilds = defer; }
+
+    // Compact or expand all faces, see LLVolumeFace::compact
+    void compactFaces();
+    void expandFaces();
+
 	LLFaceID generateFaceMask();
 
 	BOOL isFaceMaskValid(LLFaceID face_mask);
-	static S32 sNumMeshPoints;
+	static std::atomic<S32> sNumMeshPoints;
 
 	friend std::ostream& operator<<(std::ostream &s, const LLVolume &volume);
 	friend std::ostream& operator<<(std::ostream &s, const LLVolume *volumep);		// HACK to bypass Windoze confusion over 
@@ -1085,6 +1162,10 @@ public:
 	LLVector3			mLODScaleBias;		// vector for biasing LOD based on scale
 	
 	void sculpt(U16 sculpt_width, U16 sculpt_height, S8 sculpt_components, const U8* sculpt_data, S32 sculpt_level, bool visible_placeholder);
+	// take over the path, profile, mesh and faces a scratch volume with the
+	// same params built with sculpt(), used to publish sculpts generated off
+	// the main thread
+	void swapSculpt(LLVolume* volume);
 	void copyVolumeFaces(const LLVolume* volume);
 	void copyFacesTo(std::vector<LLVolumeFace> &faces) const;
 	void copyFacesFrom(const std::vector<LLVolumeFace> &faces);
@@ -1109,6 +1190,8 @@ public:
 	bool unpackVolumeFaces(U8* in_data, S32 size);
 private:
 	bool unpackVolumeFacesInternal(const LLSD& mdl);
+    // build face's octree on the "General" pool if it lacks one
+    void requestOctree(S32 face);
 
 public:
 	virtual void setMeshAssetLoaded(bool loaded);
@@ -1120,9 +1203,11 @@ public:
 	BOOL mUnique;
 	F32 mDetail;
 	S32 mSculptLevel;
+	S32 mPendingSculptLevel;
 	F32 mSurfaceArea; //unscaled surface area
 	bool mIsMeshAssetLoaded;
     bool mIsMeshAssetUnavaliable;
+    bool mDeferOctreeBuilds;
 	
 	const LLVolumeParams mParams;
 	LLPath *mPathp;
@@ -0,0 +1,773 @@
+/** 
+
+ * @file llvolumebvh.cpp
+ * @brief Flat bounding volume hierarchy used for LLVolumeFace raycasts.
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ * 
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ * 
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ * 
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "llvolumebvh.h"
+#include "llvector4a.h"
+
+#include <algorithm>
+#include <memory>
+
+BOOL LLLineSegmentBoxIntersect(const LLVector4a& start, const LLVector4a& end, const LLVector4a& center, const LLVector4a& size)
+{
+	LLVector4a fAWdU;
+	LLVector4a dir;
+	LLVector4a diff;
+
+	dir.setSub(end, start);
+	dir.mul(0.5f);
+
+	diff.setAdd(end,start);
+	diff.mul(0.5f);
+	diff.sub(center);
+	fAWdU.setAbs(dir); 
+
+	LLVector4a rhs;
+	rhs.setAdd(size, fAWdU);
+
+	LLVector4a lhs;
+	lhs.setAbs(diff);
+
+	U32 grt = lhs.greaterThan(rhs).getGatheredBits();
+
+	if (grt & 0x7)
+	{
+		return false;
+	}
+	
+	LLVector4a f;
+	f.setCross3(dir, diff);
+	f.setAbs(f);
+
+	LLVector4a v0, v1;
+
+	v0 = _mm_shuffle_ps(size, size,_MM_SHUFFLE(3,0,0,1));
+	v1 = _mm_shuffle_ps(fAWdU, fAWdU, _MM_SHUFFLE(3,1,2,2));
+	lhs.setMul(v0, v1);
+
+	v0 = _mm_shuffle_ps(size, size, _MM_SHUFFLE(3,1,2,2));
+	v1 = _mm_shuffle_ps(fAWdU, fAWdU, _MM_SHUFFLE(3,0,0,1));
+	rhs.setMul(v0, v1);
+	rhs.add(lhs);
+	
+	grt = f.greaterThan(rhs).getGatheredBits();
+
+	return (grt & 0x7) ? false : true;
+}
+
+
+namespace
+{
+    // number of buckets candidate splits are evaluated over
+    const U32 SAH_BIN_COUNT = 12;
+
+    // past this depth the builder falls back to median splits, which bounds
+    // the depth of the tree no matter how degenerate the input is
+    const U32 SAH_MAX_DEPTH = 40;
+
+    // each visited node pushes at most 4 entries and pops 1, and collapsed
+    // trees are no deeper than SAH_MAX_DEPTH + 32 levels
+    const U32 BVH_STACK_DEPTH = 256;
+
+    // node of the intermediate binary tree, collapsed into LLVolumeBVH::Node
+    // once complete
+    struct alignas(16) BuildNode
+    {
+        LL_ALIGN_16(LLVector4a mMin);
+        LL_ALIGN_16(LLVector4a mMax);
+        U32 mLeft;
+        U32 mRight;
+        U32 mBegin;
+        U32 mCount;
+
+        bool isLeaf() const { return mLeft == 0; }
+    };
+
+    struct BuildContext
+    {
+        const LLVector4a* mTriMin;
+        const LLVector4a* mTriMax;
+        const LLVector4a* mTriCenter;
+        U32* mOrder;
+        std::vector<BuildNode>* mNodes;
+    };
+
+    inline F32 half_area(const LLVector4a& min, const LLVector4a& max)
+    {
+        LLVector4a size;
+        size.setSub(max, min);
+        return size[0] * size[1] + size[1] * size[2] + size[2] * size[0];
+    }
+
+    // Choose a split of mOrder[begin, end) with the binned surface area
+    // heuristic and partition it.  Returns the first index of the right
+    // half, or begin if no split beats keeping the triangles together.
+    U32 sah_split(BuildContext& ctx, U32 begin, U32 end, const LLVector4a& center_min, const LLVector4a& center_max)
+    {
+        struct alignas(16) Bin
+        {
+            LL_ALIGN_16(LLVector4a mMin);
+            LL_ALIGN_16(LLVector4a mMax);
+            U32 mCount;
+        };
+
+        LLVector4a spread;
+        spread.setSub(center_max, center_min);
+
+        F32 best_cost = F32_MAX;
+        U32 best_axis = 0;
+        U32 best_bin = 0;
+
+        for (U32 axis = 0; axis < 3; ++axis)
+        {
+            if (spread[axis] <= 0.f)
+            {
+                continue;
+            }
+
+            Bin bins[SAH_BIN_COUNT];
+            for (Bin& bin : bins)
+            {
+                bin.mMin.splat(F32_MAX);
+                bin.mMax.splat(-F32_MAX);
+                bin.mCount = 0;
+            }
+
+            F32 scale = SAH_BIN_COUNT / spread[axis];
+            for (U32 i = begin; i < end; ++i)
+            {
+                U32 tri = ctx.mOrder[i];
+                U32 b = llmin((U32) ((ctx.mTriCenter[tri][axis] - center_min[axis]) * scale), SAH_BIN_COUNT - 1);
+                bins[b].mMin.setMin(bins[b].mMin, ctx.mTriMin[tri]);
+                bins[b].mMax.setMax(bins[b].mMax, ctx.mTriMax[tri]);
+                bins[b].mCount++;
+            }
+
+            // sweep from the right to get the cost of every right half
+            F32 right_area[SAH_BIN_COUNT];
+            U32 right_count[SAH_BIN_COUNT];
+            LLVector4a min, max;
+            min.splat(F32_MAX);
+            max.splat(-F32_MAX);
+            U32 count = 0;
+            for (U32 b = SAH_BIN_COUNT - 1; b > 0; --b)
+            {
+                min.setMin(min, bins[b].mMin);
+                max.setMax(max, bins[b].mMax);
+                count += bins[b].mCount;
+                right_area[b] = count ? half_area(min, max) : 0.f;
+                right_count[b] = count;
+            }
+
+            min.splat(F32_MAX);
+            max.splat(-F32_MAX);
+            count = 0;
+            for (U32 b = 1; b < SAH_BIN_COUNT; ++b)
+            {
+                min.setMin(min, bins[b - 1].mMin);
+                max.setMax(max, bins[b - 1].mMax);
+                count += bins[b - 1].mCount;
+                if (!count || !right_count[b])
+                {
+                    continue;
+                }
+
+                F32 cost = half_area(min, max) * count + right_area[b] * right_count[b];
+                if (cost < best_cost)
+                {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_bin = b;
+                }
+            }
+        }
+
+        if (best_cost == F32_MAX)
+        {
+            return begin;
+        }
+
+        F32 scale = SAH_BIN_COUNT / spread[best_axis];
+        F32 origin = center_min[best_axis];
+        const LLVector4a* centers = ctx.mTriCenter;
+        U32* mid = std::partition(ctx.mOrder + begin, ctx.mOrder + end,
+            [=](U32 tri)
+            {
+                return llmin((U32) ((centers[tri][best_axis] - origin) * scale), SAH_BIN_COUNT - 1) < best_bin;
+            });
+
+        return (U32) (mid - ctx.mOrder);
+    }
+
+    // returns the index of the node built for the triangles mOrder[begin, end)
+    U32 build_node(BuildContext& ctx, U32 begin, U32 end, U32 depth)
+    {
+        U32 node_index = (U32) ctx.mNodes->size();
+        ctx.mNodes->emplace_back();
+
+        LLVector4a min = ctx.mTriMin[ctx.mOrder[begin]];
+        LLVector4a max = ctx.mTriMax[ctx.mOrder[begin]];
+        LLVector4a center_min = ctx.mTriCenter[ctx.mOrder[begin]];
+        LLVector4a center_max = center_min;
+
+        for (U32 i = begin + 1; i < end; ++i)
+        {
+            U32 tri = ctx.mOrder[i];
+            min.setMin(min, ctx.mTriMin[tri]);
+            max.setMax(max, ctx.mTriMax[tri]);
+            center_min.setMin(center_min, ctx.mTriCenter[tri]);
+            center_max.setMax(center_max, ctx.mTriCenter[tri]);
+        }
+
+        {
+            BuildNode& node = (*ctx.mNodes)[node_index];
+            node.mMin = min;
+            node.mMax = max;
+            node.mLeft = 0;
+            node.mRight = 0;
+            node.mBegin = begin;
+            node.mCount = end - begin;
+        }
+
+        U32 count = end - begin;
+        if (count <= LLVolumeBVH::MAX_LEAF_TRIANGLES)
+        {
+            return node_index;
+        }
+
+        U32 mid = depth < SAH_MAX_DEPTH ? sah_split(ctx, begin, end, center_min, center_max) : begin;
+        if (mid == begin || mid == end)
+        {
+            // all centroids coincide or the tree is already deep, split at the
+            // median centroid along the longest axis to keep leaves bounded
+            LLVector4a spread;
+            spread.setSub(center_max, center_min);
+            U32 axis = 0;
+            if (spread[1] > spread[axis])
+            {
+                axis = 1;
+            }
+            if (spread[2] > spread[axis])
+            {
+                axis = 2;
+            }
+
+            mid = begin + count / 2;
+            const LLVector4a* centers = ctx.mTriCenter;
+            std::nth_element(ctx.mOrder + begin, ctx.mOrder + mid, ctx.mOrder + end,
+                [centers, axis](U32 a, U32 b)
+                {
+                    return centers[a][axis] < centers[b][axis];
+                });
+        }
+
+        U32 left = build_node(ctx, begin, mid, depth + 1);
+        U32 right = build_node(ctx, mid, end, depth + 1);
+
+        // mNodes may have been reallocated by the recursive calls
+        BuildNode& node = (*ctx.mNodes)[node_index];
+        node.mLeft = left;
+        node.mRight = right;
+        return node_index;
+    }
+
+    // Collapse the binary subtree rooted at index into 4-wide nodes, pulling
+    // up the grandchildren with the largest surface area first.  Returns the
+    // index of the new node.
+    U32 collapse_node(const std::vector<BuildNode>& binary, U32 index, std::vector<LLVolumeBVH::Node>& nodes)
+    {
+        U32 node_index = (U32) nodes.size();
+        nodes.emplace_back();
+
+        U32 children[4];
+        U32 child_count = 0;
+
+        const BuildNode& root = binary[index];
+        if (root.isLeaf())
+        {
+            children[child_count++] = index;
+        }
+        else
+        {
+            children[child_count++] = root.mLeft;
+            children[child_count++] = root.mRight;
+
+            while (child_count < 4)
+            {
+                S32 best = -1;
+                F32 best_area = -1.f;
+                for (U32 i = 0; i < child_count; ++i)
+                {
+                    const BuildNode& child = binary[children[i]];
+                    if (!child.isLeaf())
+                    {
+                        F32 area = half_area(child.mMin, child.mMax);
+                        if (area > best_area)
+                        {
+                            best_area = area;
+                            best = i;
+                        }
+                    }
+                }
+
+                if (best < 0)
+                {
+                    break;
+                }
+
+                const BuildNode& child = binary[children[best]];
+                children[best] = child.mLeft;
+                children[child_count++] = child.mRight;
+            }
+        }
+
+        LLVolumeBVH::Node node;
+        for (U32 i = 0; i < 3; ++i)
+        {
+            node.mBounds[i].splat(F32_MAX);
+            node.mBounds[i + 3].splat(-F32_MAX);
+        }
+        memset(node.mChild, 0, sizeof(node.mChild));
+        memset(node.mCount, 0, sizeof(node.mCount));
+
+        for (U32 i = 0; i < child_count; ++i)
+        {
+            const BuildNode& child = binary[children[i]];
+            for (U32 axis = 0; axis < 3; ++axis)
+            {
+                node.mBounds[axis].getF32ptr()[i] = child.mMin[axis];
+                node.mBounds[axis + 3].getF32ptr()[i] = child.mMax[axis];
+            }
+
+            if (child.isLeaf())
+            {
+                node.mChild[i] = child.mBegin;
+                node.mCount[i] = (U8) child.mCount;
+            }
+            else
+            {
+                node.mChild[i] = collapse_node(binary, children[i], nodes);
+            }
+        }
+
+        // nodes may have been reallocated by the recursive calls
+        nodes[node_index] = node;
+        return node_index;
+    }
+
+    // Moller-Trumbore for four triangles at once, with the same one sided
+    // convention and tolerance as LLTriangleRayIntersect.  v0, v1 and v2 hold
+    // the x, y and z of the corners of the four triangles.  Returns a bitmask
+    // of the triangles hit, with the hit parameters in the matching lanes.
+    inline U32 triangle_ray_intersect4(const LLQuad* v0, const LLQuad* v1, const LLQuad* v2,
+                                       const LLQuad* orig, const LLQuad* dir,
+                                       LLQuad& out_a, LLQuad& out_b, LLQuad& out_t)
+    {
+        LLQuad e1x = _mm_sub_ps(v1[0], v0[0]);
+        LLQuad e1y = _mm_sub_ps(v1[1], v0[1]);
+        LLQuad e1z = _mm_sub_ps(v1[2], v0[2]);
+        LLQuad e2x = _mm_sub_ps(v2[0], v0[0]);
+        LLQuad e2y = _mm_sub_ps(v2[1], v0[1]);
+        LLQuad e2z = _mm_sub_ps(v2[2], v0[2]);
+
+        // pvec = dir x edge2
+        LLQuad px = _mm_sub_ps(_mm_mul_ps(dir[1], e2z), _mm_mul_ps(dir[2], e2y));
+        LLQuad py = _mm_sub_ps(_mm_mul_ps(dir[2], e2x), _mm_mul_ps(dir[0], e2z));
+        LLQuad pz = _mm_sub_ps(_mm_mul_ps(dir[0], e2y), _mm_mul_ps(dir[1], e2x));
+
+        LLQuad det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+
+        // tvec = orig - vert0
+        LLQuad tx = _mm_sub_ps(orig[0], v0[0]);
+        LLQuad ty = _mm_sub_ps(orig[1], v0[1]);
+        LLQuad tz = _mm_sub_ps(orig[2], v0[2]);
+
+        LLQuad u = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz));
+
+        // qvec = tvec x edge1
+        LLQuad qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+        LLQuad qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+        LLQuad qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+
+        LLQuad v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dir[0], qx), _mm_mul_ps(dir[1], qy)), _mm_mul_ps(dir[2], qz));
+        LLQuad t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz));
+
+        LLQuad zero = _mm_setzero_ps();
+        LLQuad valid = _mm_cmpge_ps(det, LLVector4a::getEpsilon());
+        valid = _mm_and_ps(valid, _mm_cmpge_ps(u, zero));
+        valid = _mm_and_ps(valid, _mm_cmple_ps(u, det));
+        valid = _mm_and_ps(valid, _mm_cmpge_ps(v, zero));
+        valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(u, v), det));
+
+        U32 mask = _mm_movemask_ps(valid);
+        if (mask)
+        {
+            out_a = _mm_div_ps(u, det);
+            out_b = _mm_div_ps(v, det);
+            out_t = _mm_div_ps(t, det);
+        }
+        return mask;
+    }
+}
+
+LLBVHRay::LLBVHRay(const LLVector4a& start, const LLVector4a& dir)
+:   mStart(start),
+    mDir(dir)
+{
+    for (U32 axis = 0; axis < 3; ++axis)
+    {
+        // zero components are nudged away from zero so no 0 * inf NaNs
+        // can show up in the slab tests
+        F32 d = dir[axis];
+        if (fabsf(d) < 1e-20f)
+        {
+            d = d < 0.f ? -1e-20f : 1e-20f;
+        }
+
+        mOrigin[axis].splat(start[axis]);
+        mInvDir[axis].splat(1.f / d);
+
+        // the min plane is entered first when travelling along +axis
+        mNear[axis] = d < 0.f ? axis + 3 : axis;
+        mFar[axis] = d < 0.f ? axis : axis + 3;
+    }
+}
+
+LLVolumeBVH::LLVolumeBVH()
+:   mData(NULL),
+    mDataSize(0),
+    mNodes(NULL),
+    mTriangles(NULL),
+    mNodeCount(0),
+    mTriangleCount(0)
+{
+}
+
+LLVolumeBVH::LLVolumeBVH(LLVolumeBVH&& rhs)
+:   mData(rhs.mData),
+    mDataSize(rhs.mDataSize),
+    mNodes(rhs.mNodes),
+    mTriangles(rhs.mTriangles),
+    mNodeCount(rhs.mNodeCount),
+    mTriangleCount(rhs.mTriangleCount)
+{
+    rhs.mData = NULL;
+    rhs.clear();
+}
+
+LLVolumeBVH::~LLVolumeBVH()
+{
+    clear();
+}
+
+void LLVolumeBVH::clear()
+{
+    ll_aligned_free_16(mData);
+    mData = NULL;
+    mDataSize = 0;
+    mNodes = NULL;
+    mTriangles = NULL;
+    mNodeCount = 0;
+    mTriangleCount = 0;
+}
+
+bool LLVolumeBVH::build(const LLVector4a* positions, const U16* indices, U32 num_indices)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+
+    clear();
+
+    llassert(num_indices % 3 == 0);
+    U32 num_triangles = num_indices / 3;
+    if (!num_triangles || !positions || !indices)
+    {
+        return false;
+    }
+
+    LLAlignedArray<LLVector4a, 64> tri_bounds;
+    tri_bounds.resize(num_triangles * 3);
+    LLVector4a* tri_min = &tri_bounds[0];
+    LLVector4a* tri_max = tri_min + num_triangles;
+    LLVector4a* tri_center = tri_max + num_triangles;
+
+    std::vector<U32> order(num_triangles);
+
+    for (U32 i = 0; i < num_triangles; ++i)
+    {
+        const LLVector4a& v0 = positions[indices[i * 3 + 0]];
+        const LLVector4a& v1 = positions[indices[i * 3 + 1]];
+        const LLVector4a& v2 = positions[indices[i * 3 + 2]];
+
+        tri_min[i].setMin(v0, v1);
+        tri_min[i].setMin(tri_min[i], v2);
+        tri_max[i].setMax(v0, v1);
+        tri_max[i].setMax(tri_max[i], v2);
+        tri_center[i].setAdd(tri_min[i], tri_max[i]);
+        tri_center[i].mul(0.5f);
+
+        order[i] = i;
+    }
+
+    std::vector<BuildNode> binary;
+    binary.reserve(num_triangles * 2 / MAX_LEAF_TRIANGLES + 1);
+
+    BuildContext ctx = { tri_min, tri_max, tri_center, order.data(), &binary };
+    build_node(ctx, 0, num_triangles, 0);
+
+    std::vector<Node> nodes;
+    nodes.reserve(binary.size() / 3 + 1);
+    collapse_node(binary, 0, nodes);
+
+    // one allocation holding the nodes followed by the leaf ordered indices
+    U32 node_bytes = (U32) (nodes.size() * sizeof(Node));
+    U32 index_bytes = (num_indices * sizeof(U16) + 0xF) & ~0xF;
+
+    mData = (U8*) ll_aligned_malloc_16(node_bytes + index_bytes);
+    if (!mData)
+    {
+        LL_WARNS("LLVolume") << "Failed to allocate " << (node_bytes + index_bytes) << " bytes for face BVH" << LL_ENDL;
+        clear();
+        return false;
+    }
+
+    mDataSize = node_bytes + index_bytes;
+    mNodes = (Node*) mData;
+    mTriangles = (U16*) (mData + node_bytes);
+    mNodeCount = (U32) nodes.size();
+    mTriangleCount = num_triangles;
+
+    std::uninitialized_copy(nodes.begin(), nodes.end(), mNodes);
+
+    for (U32 i = 0; i < num_triangles; ++i)
+    {
+        const U16* src = indices + order[i] * 3;
+        U16* dst = mTriangles + i * 3;
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+    }
+
+    return true;
+}
+
+S32 LLVolumeBVH::intersect(const LLVector4a* positions, const LLBVHRay& ray, F32* closest_t, F32& hit_a, F32& hit_b) const
+{
+    if (!mNodeCount)
+    {
+        return -1;
+    }
+
+    struct StackEntry
+    {
+        U32 mChild;
+        U32 mCount;
+        F32 mEnter;
+    };
+
+    LLQuad orig[3];
+    LLQuad dir[3];
+    for (U32 axis = 0; axis < 3; ++axis)
+    {
+        orig[axis] = _mm_set1_ps(ray.mStart[axis]);
+        dir[axis] = _mm_set1_ps(ray.mDir[axis]);
+    }
+
+    S32 hit_tri = -1;
+    F32 max_t = llmin(*closest_t, 1.f);
+
+    StackEntry stack[BVH_STACK_DEPTH];
+    U32 stack_size = 0;
+    stack[stack_size++] = { 0, 0, 0.f };
+
+    while (stack_size)
+    {
+        const StackEntry entry = stack[--stack_size];
+        if (entry.mEnter > max_t)
+        { // a closer hit was found since this was pushed
+            continue;
+        }
+
+        if (entry.mCount)
+        {
+            // gather the corners of up to four triangles, repeating the last
+            // one to fill the unused lanes, and transpose to x, y, z rows
+            LLQuad corners[3][4];
+            for (U32 i = 0; i < 4; ++i)
+            {
+                const U16* idx = mTriangles + (entry.mChild + llmin(i, entry.mCount - 1)) * 3;
+                corners[0][i] = positions[idx[0]];
+                corners[1][i] = positions[idx[1]];
+                corners[2][i] = positions[idx[2]];
+            }
+            for (U32 i = 0; i < 3; ++i)
+            {
+                _MM_TRANSPOSE4_PS(corners[i][0], corners[i][1], corners[i][2], corners[i][3]);
+            }
+
+            LLQuad a, b, t;
+            U32 mask = triangle_ray_intersect4(corners[0], corners[1], corners[2], orig, dir, a, b, t);
+            mask &= (1 << entry.mCount) - 1;
+
+            for (U32 i = 0; mask; ++i, mask >>= 1)
+            {
+                if (!(mask & 1))
+                {
+                    continue;
+                }
+
+                F32 tri_t = ((const F32*) &t)[i];
+                if ((tri_t >= 0.f) &&    // if hit is after start
+                    (tri_t <= 1.f) &&    // and before end
+                    (tri_t < *closest_t)) // and this hit is closer
+                {
+                    *closest_t = tri_t;
+                    max_t = llmin(tri_t, 1.f);
+                    hit_tri = entry.mChild + i;
+                    hit_a = ((const F32*) &a)[i];
+                    hit_b = ((const F32*) &b)[i];
+                }
+            }
+            continue;
+        }
+
+        const Node& node = mNodes[entry.mChild];
+
+        LLVector4a enter;
+        U32 mask = ray.intersectBoxes(node.mBounds, max_t, enter);
+        if (!mask)
+        {
+            continue;
+        }
+
+        // push far to near so the nearest child is visited first and the
+        // others are likely culled by its hit
+        StackEntry hits[4];
+        U32 hit_count = 0;
+        for (U32 i = 0; i < 4; ++i)
+        {
+            if (mask & (1 << i))
+            {
+                StackEntry child = { node.mChild[i], node.mCount[i], enter[i] };
+                U32 j = hit_count++;
+                for (; j > 0 && hits[j - 1].mEnter < child.mEnter; --j)
+                {
+                    hits[j] = hits[j - 1];
+                }
+                hits[j] = child;
+            }
+        }
+
+        llassert(stack_size + hit_count <= BVH_STACK_DEPTH);
+        for (U32 i = 0; i < hit_count; ++i)
+        {
+            stack[stack_size++] = hits[i];
+        }
+    }
+
+    return hit_tri;
+}
+
+bool LLVolumeBVH::intersect(const LLVolumeFace& face, const LLVector4a& start, const LLVector4a& dir,
+                            F32* closest_t, LLVector4a* intersection, LLVector2* tex_coord,
+                            LLVector4a* normal, LLVector4a* tangent) const
+{
+    LLBVHRay ray(start, dir);
+
+    F32 hit_a = 0.f;
+    F32 hit_b = 0.f;
+    S32 hit_tri = intersect(face.mPositions, ray, closest_t, hit_a, hit_b);
+
+    if (hit_tri < 0)
+    {
+        return false;
+    }
+
+    const U16* idx = mTriangles + hit_tri * 3;
+    U32 idx0 = idx[0];
+    U32 idx1 = idx[1];
+    U32 idx2 = idx[2];
+    F32 w0 = 1.f - hit_a - hit_b;
+
+    if (intersection != NULL)
+    {
+        LLVector4a intersect = dir;
+        intersect.mul(*closest_t);
+        intersect.add(start);
+        *intersection = intersect;
+    }
+
+    if (tex_coord != NULL)
+    {
+        LLVector2* tc = (LLVector2*) face.mTexCoords;
+        *tex_coord = (w0 * tc[idx0] +
+                      hit_a * tc[idx1] +
+                      hit_b * tc[idx2]);
+    }
+
+    if (normal != NULL)
+    {
+        LLVector4a* norm = face.mNormals;
+
+        LLVector4a n1, n2, n3;
+        n1 = norm[idx0];
+        n1.mul(w0);
+
+        n2 = norm[idx1];
+        n2.mul(hit_a);
+
+        n3 = norm[idx2];
+        n3.mul(hit_b);
+
+        n1.add(n2);
+        n1.add(n3);
+
+        *normal = n1;
+    }
+
+    if (tangent != NULL)
+    {
+        LLVector4a* tangents = face.mTangents;
+
+        LLVector4a t1, t2, t3;
+        t1 = tangents[idx0];
+        t1.mul(w0);
+
+        t2 = tangents[idx1];
+        t2.mul(hit_a);
+
+        t3 = tangents[idx2];
+        t3.mul(hit_b);
+
+        t1.add(t2);
+        t1.add(t3);
+
+        *tangent = t1;
+    }
+
+    return true;
+}
@@ -0,0 +1,166 @@
+/**
+ * @file llvolumebvh.h
+ * @brief Flat bounding volume hierarchy used for LLVolumeFace raycasts.
+ *
+ * $LicenseInfo:firstyear=2002&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2010, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#ifndef LL_LLVOLUME_BVH_H
+#define LL_LLVOLUME_BVH_H
+
+#include "linden_common.h"
+#include "llmemory.h"
+
+#include "llvolume.h"
+#include "llvector4a.h"
+
+// Line segment start + t * dir, t in [0, 1], set up for testing against four
+// axis aligned boxes at a time.  Boxes are given in structure of arrays form:
+// bounds[0..2] hold the min x, y and z of the four boxes, bounds[3..5] the
+// max x, y and z.
+class alignas(16) LLBVHRay
+{
+    LL_ALIGN_NEW
+public:
+    LLBVHRay(const LLVector4a& start, const LLVector4a& dir);
+
+    // Returns a bitmask of the boxes the segment enters at or before max_t,
+    // with the entry distance of each box in the matching lane of t_enter.
+    inline U32 intersectBoxes(const LLVector4a* bounds, F32 max_t, LLVector4a& t_enter) const;
+
+    LL_ALIGN_16(LLVector4a mStart);
+    LL_ALIGN_16(LLVector4a mDir);
+
+private:
+    // start and reciprocal direction, each component splatted
+    LL_ALIGN_16(LLVector4a mOrigin[3]);
+    LL_ALIGN_16(LLVector4a mInvDir[3]);
+    // index into bounds of the near and far plane on each axis
+    U32 mNear[3];
+    U32 mFar[3];
+};
+
+inline U32 LLBVHRay::intersectBoxes(const LLVector4a* bounds, F32 max_t, LLVector4a& t_enter) const
+{
+    LLVector4a t_exit;
+    t_enter.splat(0.f);
+    t_exit.splat(max_t);
+
+    for (U32 axis = 0; axis < 3; ++axis)
+    {
+        LLVector4a t0, t1;
+        t0.setSub(bounds[mNear[axis]], mOrigin[axis]);
+        t0.mul(mInvDir[axis]);
+        t1.setSub(bounds[mFar[axis]], mOrigin[axis]);
+        t1.mul(mInvDir[axis]);
+
+        t_enter.setMax(t_enter, t0);
+        t_exit.setMin(t_exit, t1);
+    }
+
+    return t_enter.lessEqual(t_exit).getGatheredBits();
+}
+
+// Bounding volume hierarchy over the triangles of an LLVolumeFace.
+//
+// Replaces the old pointer based LLOctreeRoot<LLVolumeTriangle> face octree.
+// Built top down with a binned surface area heuristic, then collapsed into
+// nodes of four children whose bounds are stored structure of arrays so a
+// segment is tested against all four with one LLBVHRay::intersectBoxes.
+// Leaves hold up to four triangles, which are likewise tested against the
+// segment together.
+//
+// Nodes and the leaf ordered triangle indices live in a single aligned
+// allocation.  Only vertex indices are stored, positions are read from the
+// owning face at query time, so a tree must be discarded whenever the face
+// geometry changes.
+class LLVolumeBVH
+{
+public:
+    // maximum number of triangles referenced by a leaf
+    static const U32 MAX_LEAF_TRIANGLES = 4;
+
+    class alignas(16) Node
+    {
+    public:
+        // bounds of the four children, see LLBVHRay; unused children have
+        // inverted bounds that no segment can enter
+        LL_ALIGN_16(LLVector4a mBounds[6]);
+
+        // interior child: index of its node in mNodes
+        // leaf child:     index of its first triangle in mTriangles
+        U32 mChild[4];
+        // number of triangles in a leaf child, 0 for interior or unused children
+        U8 mCount[4];
+
+        bool isLeaf(U32 child) const { return mCount[child] != 0; }
+
+    private:
+        U32 mPad[3];
+    };
+
+    LLVolumeBVH();
+    LLVolumeBVH(LLVolumeBVH&& rhs);
+    ~LLVolumeBVH();
+
+    LLVolumeBVH(const LLVolumeBVH&) = delete;
+    LLVolumeBVH& operator=(const LLVolumeBVH&) = delete;
+
+    // Build the hierarchy for the given triangle list.  Only touches the
+    // arrays passed in, so it is safe to call from a worker thread on a
+    // snapshot of a face's geometry.
+    bool build(const LLVector4a* positions, const U16* indices, U32 num_indices);
+
+    // Intersect the segment start -> start + dir with the triangles of face,
+    // which must be the geometry this hierarchy was built from.  Follows the
+    // LLVolume::lineSegmentIntersect conventions: closest_t is both an input
+    // (hits at or beyond it are ignored) and an output, and the optional
+    // outputs are only written when a closer hit is found.
+    bool intersect(const LLVolumeFace& face, const LLVector4a& start, const LLVector4a& dir,
+                   F32* closest_t, LLVector4a* intersection, LLVector2* tex_coord,
+                   LLVector4a* normal, LLVector4a* tangent) const;
+
+    // Closest triangle hit by ray before *closest_t, or -1.  Updates
+    // *closest_t and the barycentric coordinates of the hit.
+    S32 intersect(const LLVector4a* positions, const LLBVHRay& ray, F32* closest_t, F32& hit_a, F32& hit_b) const;
+
+    U32 getNodeCount() const                { return mNodeCount; }
+    const Node* getNodes() const            { return mNodes; }
+    U32 getTriangleCount() const            { return mTriangleCount; }
+    // 3 vertex indices per triangle, in leaf order
+    const U16* getTriangles() const         { return mTriangles; }
+
+    // bytes owned by this hierarchy
+    U32 getMemoryUsage() const              { return mDataSize + sizeof(LLVolumeBVH); }
+
+private:
+    void clear();
+
+    U8*     mData;
+    U32     mDataSize;
+    Node*   mNodes;
+    U16*    mTriangles;
+    U32     mNodeCount;
+    U32     mTriangleCount;
+};
+
+#endif
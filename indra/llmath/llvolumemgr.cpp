@@ -301,6 +301,19 @@ LLVolume* LLVolumeLODGroup::refLOD(const S32 lod)
 	return mVolumeLODs[lod];
 }
 
+// Number of objects using volumep, one of this group's LODs
+S32 LLVolumeLODGroup::getNumLODRefs(const LLVolume* volumep) const
+{
+	for (S32 i = 0; i < NUM_LODS; i++)
+	{
+		if (mVolumeLODs[i] == volumep)
+		{
+			return mLODRefs[i];
+		}
+	}
+	return 0;
+}
+
 BOOL LLVolumeLODGroup::derefLOD(LLVolume *volumep)
 {
 	llassert_always(mRefs > 0);
@@ -58,6 +58,7 @@ public:
 	LLVolume* refLOD(const S32 detail);
 	BOOL derefLOD(LLVolume *volumep);
 	S32 getNumRefs() const { return mRefs; }
+	S32 getNumLODRefs(const LLVolume* volumep) const;
 	
 	const LLVolumeParams* getVolumeParams() const { return &mVolumeParams; };
 
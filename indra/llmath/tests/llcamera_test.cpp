@@ -0,0 +1,227 @@
+/**
+ * @file   llcamera_test.cpp
+ * @brief  Test for llcamera.cpp.
+ *
+ * $LicenseInfo:firstyear=2023&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2023, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../test/lltut.h"
+#include "../test/lltestrandom.h"
+#include "../test/lltestbenchmark.h"
+
+#include "../llcamera.h"
+#include "llalignedarray.h"
+
+#include <memory>
+#include <vector>
+
+namespace
+{
+    // camera at the origin looking down +x, planes built from the frustum
+    // corners the same way LLViewerCamera does
+    void setup_camera(LLCamera& camera, F32 near_dist, F32 far_dist)
+    {
+        const F32 tan_half = tanf(DEFAULT_FIELD_OF_VIEW * 0.5f);
+        const F32 ndc[4][2] = { { -1.f, -1.f }, { 1.f, -1.f }, { 1.f, 1.f }, { -1.f, 1.f } };
+
+        LLVector3 frust[8];
+        for (U32 i = 0; i < 8; ++i)
+        {
+            F32 dist = i < 4 ? near_dist : far_dist;
+            F32 half_height = dist * tan_half;
+            F32 half_width = half_height * DEFAULT_ASPECT_RATIO;
+            // at = +x, left = +y, up = +z
+            frust[i].set(dist, -ndc[i % 4][0] * half_width, ndc[i % 4][1] * half_height);
+        }
+
+        camera.setOrigin(LLVector3::zero);
+        camera.calcAgentFrustumPlanes(frust);
+    }
+
+    // pointer based hierarchy of boxes, the shape of the octree traversal the
+    // spatial partitions do
+    struct Node
+    {
+        LLVector4a mCenter;
+        LLVector4a mRadius;
+        std::vector<std::unique_ptr<Node>> mChildren;
+    };
+
+    struct Hierarchy
+    {
+        Hierarchy(U32 count, LLTestRandom& rand)
+        {
+            mNodes.reserve(count);
+            mRoot.reset(new Node);
+            mRoot->mCenter.set(128.f, 0.f, 0.f);
+            mRoot->mRadius.set(128.f, 128.f, 128.f);
+            mNodes.push_back(mRoot.get());
+
+            // breadth first split into eight octants until count nodes exist
+            for (U32 i = 0; mNodes.size() < count; ++i)
+            {
+                Node* parent = mNodes[i];
+                for (U32 j = 0; j < 8 && mNodes.size() < count; ++j)
+                {
+                    std::unique_ptr<Node> child(new Node);
+                    LLVector4a offset((j & 1) ? 0.5f : -0.5f, (j & 2) ? 0.5f : -0.5f, (j & 4) ? 0.5f : -0.5f);
+                    offset.mul(parent->mRadius);
+                    child->mCenter.setAdd(parent->mCenter, offset);
+                    // jitter so boxes don't all fall exactly on octant boundaries
+                    LLVector4a jitter(rand.range(0.9f, 1.1f), rand.range(0.9f, 1.1f), rand.range(0.9f, 1.1f));
+                    child->mRadius.setMul(parent->mRadius, 0.5f);
+                    child->mRadius.mul(jitter);
+                    mNodes.push_back(child.get());
+                    parent->mChildren.push_back(std::move(child));
+                }
+            }
+        }
+
+        std::unique_ptr<Node> mRoot;
+        std::vector<Node*> mNodes;
+    };
+
+    U32 traverse(LLCamera& camera, const Node* node)
+    {
+        U32 visible = 0;
+        if (camera.AABBInFrustum(node->mCenter, node->mRadius) > 0)
+        {
+            ++visible;
+            for (const std::unique_ptr<Node>& child : node->mChildren)
+            {
+                visible += traverse(camera, child.get());
+            }
+        }
+        return visible;
+    }
+}
+
+namespace tut
+{
+    struct LLCameraData
+    {
+    };
+
+    typedef test_group<LLCameraData> factory;
+    typedef factory::object object;
+}
+
+namespace
+{
+    tut::factory llcamera_test_factory("LLCamera");
+}
+
+namespace tut
+{
+    template<> template<>
+    void object::test<1>()
+    {
+        //
+        // batched frustum test matches the per box tests, including the tail
+        // of a batch that isn't a multiple of four
+        //
+        LLCamera camera;
+        setup_camera(camera, 1.f, 64.f);
+
+        const U32 COUNT = 1027;
+        LLAlignedArray<LLVector4a, 64> centers;
+        centers.resize(COUNT);
+        LLAlignedArray<LLVector4a, 64> radii;
+        radii.resize(COUNT);
+        LLTestRandom rand(0x12345678);
+        for (U32 i = 0; i < COUNT; ++i)
+        {
+            centers[i].set(rand.range(-16.f, 96.f), rand.range(-64.f, 64.f), rand.range(-64.f, 64.f));
+            radii[i].set(rand.range(0.f, 8.f), rand.range(0.f, 8.f), rand.range(0.f, 8.f));
+        }
+
+        std::vector<U8> results(COUNT);
+        std::vector<U8> no_far_results(COUNT);
+        camera.AABBInFrustumBatch(centers.mArray, radii.mArray, COUNT, results.data());
+        camera.AABBInFrustumBatch(centers.mArray, radii.mArray, COUNT, no_far_results.data(), true);
+
+        U32 counts[3] = { 0, 0, 0 };
+        for (U32 i = 0; i < COUNT; ++i)
+        {
+            ensure_equals("frustum", (S32) results[i], camera.AABBInFrustum(centers[i], radii[i]));
+            ensure_equals("frustum no far clip", (S32) no_far_results[i], camera.AABBInFrustumNoFarClip(centers[i], radii[i]));
+            ++counts[results[i]];
+        }
+
+        ensure("some boxes outside", counts[0] > 0);
+        ensure("some boxes partly in", counts[1] > 0);
+        ensure("some boxes fully in", counts[2] > 0);
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        //
+        // benchmark a pointer chasing hierarchical cull against a sweep over
+        // the same 100k boxes packed structure of arrays
+        //
+        if (! lltest_benchmark_enabled())
+        {
+            skip("set LL_TEST_BENCHMARK to run");
+        }
+
+        const U32 COUNT = 100000;
+        LLTestRandom rand;
+        Hierarchy hierarchy(COUNT, rand);
+
+        LLAlignedArray<LLVector4a, 64> centers;
+        centers.resize(COUNT);
+        LLAlignedArray<LLVector4a, 64> radii;
+        radii.resize(COUNT);
+        for (U32 i = 0; i < COUNT; ++i)
+        {
+            centers[i] = hierarchy.mNodes[i]->mCenter;
+            radii[i] = hierarchy.mNodes[i]->mRadius;
+        }
+
+        LLCamera camera;
+        setup_camera(camera, 1.f, 128.f);
+
+        const U32 PASSES = 10;
+        std::vector<U8> results(COUNT);
+
+        U32 visible = 0;
+        F64 traverse_ms = lltest_benchmark_ms(PASSES, [&]()
+        {
+            visible = traverse(camera, hierarchy.mRoot.get());
+        });
+        F64 sweep_ms = lltest_benchmark_ms(PASSES, [&]()
+        {
+            camera.AABBInFrustumBatch(centers.mArray, radii.mArray, COUNT, results.data());
+        });
+
+        for (U32 i = 0; i < COUNT; ++i)
+        {
+            ensure_equals("sweep matches per box test", (S32) results[i], camera.AABBInFrustum(centers[i], radii[i]));
+        }
+
+        lltest_benchmark_out() << COUNT << " boxes, " << visible << " visible in traversal: traversal "
+                               << traverse_ms << " ms, sweep " << sweep_ms << " ms per pass" << std::endl;
+    }
+}
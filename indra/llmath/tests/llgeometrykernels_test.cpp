@@ -0,0 +1,393 @@
+/**
+ * @file   llgeometrykernels_test.cpp
+ * @brief  Test for llgeometrykernels.cpp.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../test/lltut.h"
+#include "../test/lltestvolume.h"
+#include "../test/lltestbenchmark.h"
+
+#include "../llgeometrykernels.h"
+#include "../llvolume.h"
+#include "../llmatrix4a.h"
+#include "../llquaternion.h"
+#include "../m4math.h"
+#include "../v2math.h"
+
+#include <vector>
+
+namespace
+{
+    // the fixed set of faces the tests and benchmark run through
+    struct Faces
+    {
+        Faces()
+        {
+            mVolumes.push_back(new LLVolume(lltest_volume_params(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE, 0.f), 1.f));
+            mVolumes.push_back(new LLVolume(lltest_volume_params(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE, 0.5f), 2.f));
+            mVolumes.push_back(new LLVolume(lltest_volume_params(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_LINE, 0.f), 3.f));
+            mVolumes.push_back(new LLVolume(lltest_volume_params(LL_PCODE_PROFILE_CIRCLE_HALF, LL_PCODE_PATH_CIRCLE, 0.f), 3.f));
+            mVolumes.push_back(new LLVolume(lltest_volume_params(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE, 0.25f), 3.f));
+
+            for (LLVolume* volume : mVolumes)
+            {
+                for (S32 i = 0; i < volume->getNumVolumeFaces(); ++i)
+                {
+                    LLVolumeFace& face = volume->getVolumeFace(i);
+                    face.createTangents();
+                    mFaces.push_back(&face);
+                    mMaxVertices = llmax(mMaxVertices, face.mNumVertices);
+                }
+            }
+        }
+
+        std::vector<LLPointer<LLVolume> > mVolumes;
+        std::vector<const LLVolumeFace*> mFaces;
+        S32 mMaxVertices = 0;
+    };
+
+    // the per vertex path LLFace::getGeometryVolume used before the kernels
+    void planar_projection(LLVector2& tc, const LLVector4a& normal, const LLVector4a& vec)
+    {
+        LLVector4a binormal;
+        F32 d = normal[0];
+
+        if (d >= 0.5f || d <= -0.5f)
+        {
+            if (d < 0)
+            {
+                binormal.set(0, -1, 0);
+            }
+            else
+            {
+                binormal.set(0, 1, 0);
+            }
+        }
+        else
+        {
+            if (normal[1] > 0)
+            {
+                binormal.set(-1, 0, 0);
+            }
+            else
+            {
+                binormal.set(1, 0, 0);
+            }
+        }
+        LLVector4a tangent;
+        tangent.setCross3(binormal, normal);
+
+        tc.mV[1] = -((tangent.dot3(vec).getF32()) * 2 - 0.5f);
+        tc.mV[0] = 1.0f + ((binormal.dot3(vec).getF32()) * 2 - 0.5f);
+    }
+
+    void xform(LLVector2& tex_coord, F32 cosAng, F32 sinAng, F32 offS, F32 offT, F32 magS, F32 magT)
+    {
+        F32 s = tex_coord.mV[0];
+        F32 t = tex_coord.mV[1];
+
+        s -= 0.5;
+        t -= 0.5;
+
+        F32 temp = s;
+        s = s * cosAng + t * sinAng;
+        t = -temp * sinAng + t * cosAng;
+
+        s *= magS;
+        t *= magT;
+
+        s += offS + 0.5f;
+        t += offT + 0.5f;
+
+        tex_coord.mV[0] = s;
+        tex_coord.mV[1] = t;
+    }
+
+    struct TexGen
+    {
+        bool mPlanar;
+        U32 mTransform;
+        LLVector4a mScale;
+        F32 mCos, mSin, mOffS, mOffT, mMagS, mMagT;
+        LLMatrix4 mMatrix;
+
+        TexGen(bool planar, U32 transform)
+        :   mPlanar(planar),
+            mTransform(transform),
+            mCos(cosf(0.7f)), mSin(sinf(0.7f)),
+            mOffS(0.25f), mOffT(-0.125f),
+            mMagS(3.f), mMagT(0.5f)
+        {
+            mScale.set(2.f, 0.5f, 3.f);
+            mMatrix.initAll(LLVector3(2.f, 1.f, 1.f), LLQuaternion(0.4f, LLVector3::z_axis), LLVector3(0.5f, -0.25f, 0.f));
+        }
+
+        void setup(LLTexCoordKernel& kernel) const
+        {
+            if (mPlanar)
+            {
+                kernel.setPlanar(mScale);
+            }
+            if (mTransform == LLTexCoordKernel::TRANSFORM_XFORM)
+            {
+                kernel.setTransform(mCos, mSin, mOffS, mOffT, mMagS, mMagT);
+            }
+            else if (mTransform == LLTexCoordKernel::TRANSFORM_MATRIX)
+            {
+                kernel.setMatrix(mMatrix);
+            }
+        }
+
+        void reference(const LLVolumeFace& face, LLVector2* dst) const
+        {
+            for (S32 i = 0; i < face.mNumVertices; ++i)
+            {
+                LLVector2 tc(face.mTexCoords[i]);
+                if (mPlanar)
+                {
+                    LLVector4a vec = face.mPositions[i];
+                    vec.mul(mScale);
+                    planar_projection(tc, face.mNormals[i], vec);
+                }
+
+                if (mTransform == LLTexCoordKernel::TRANSFORM_MATRIX)
+                {
+                    LLVector3 tmp(tc.mV[0], tc.mV[1], 0.f);
+                    tmp = tmp * mMatrix;
+                    tc.mV[0] = tmp.mV[0];
+                    tc.mV[1] = tmp.mV[1];
+                }
+                else if (mTransform == LLTexCoordKernel::TRANSFORM_XFORM)
+                {
+                    xform(tc, mCos, mSin, mOffS, mOffT, mMagS, mMagT);
+                }
+
+                dst[i] = tc;
+            }
+        }
+    };
+
+    bool close_enough(F32 a, F32 b)
+    {
+        return fabsf(a - b) <= 1.0e-5f * llmax(1.f, fabsf(b));
+    }
+
+    LLMatrix4a make_vertex_matrix()
+    {
+        LLMatrix4 mat;
+        mat.initAll(LLVector3(1.5f, 2.f, 0.75f), LLQuaternion(1.1f, LLVector3(1.f, 1.f, 0.f)), LLVector3(128.f, 64.f, 22.f));
+        LLMatrix4a mat_a;
+        mat_a.loadu(mat);
+        return mat_a;
+    }
+}
+
+namespace tut
+{
+    struct LLGeometryKernelsData
+    {
+    };
+
+    typedef test_group<LLGeometryKernelsData> factory;
+    typedef factory::object object;
+}
+
+namespace
+{
+    tut::factory llgeometrykernels_test_factory("LLGeometryKernels");
+}
+
+namespace tut
+{
+    template<> template<>
+    void object::test<1>()
+    {
+        //
+        // every texgen and transform kernel matches the per vertex path, and
+        // writes exactly the face's vertex count
+        //
+        Faces faces;
+        ensure("faces generated", !faces.mFaces.empty());
+
+        std::vector<LLVector2> expected(faces.mMaxVertices);
+        std::vector<LLVector2> actual(faces.mMaxVertices + 1);
+        const LLVector2 guard(-12345.f, 54321.f);
+
+        for (U32 planar = 0; planar < 2; ++planar)
+        {
+            for (U32 transform = 0; transform < LLTexCoordKernel::TRANSFORM_COUNT; ++transform)
+            {
+                TexGen texgen(planar != 0, transform);
+                LLTexCoordKernel kernel;
+                texgen.setup(kernel);
+                ensure_equals("copy only without texgen or transform", kernel.isCopy(), !planar && !transform);
+
+                for (const LLVolumeFace* face : faces.mFaces)
+                {
+                    S32 count = face->mNumVertices;
+                    texgen.reference(*face, expected.data());
+                    actual[count] = guard;
+                    kernel.run(face->mPositions, face->mNormals, face->mTexCoords, count, actual.data());
+
+                    ensure("no write past count", actual[count] == guard);
+                    for (S32 i = 0; i < count; ++i)
+                    {
+                        ensure("s", close_enough(actual[i].mV[0], expected[i].mV[0]));
+                        ensure("t", close_enough(actual[i].mV[1], expected[i].mV[1]));
+                    }
+                }
+            }
+        }
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        //
+        // position, normal, tangent and fill kernels match the per vertex path
+        //
+        Faces faces;
+        LLMatrix4a mat = make_vertex_matrix();
+        const U32 tex_index = 5;
+
+        LLVector4Logical mask;
+        mask.clear();
+        mask.setElement<3>();
+
+        for (const LLVolumeFace* face : faces.mFaces)
+        {
+            S32 count = face->mNumVertices;
+            S32 padded = count + 3;
+            LLAlignedArray<LLVector4a, 64> out;
+            out.resize(padded);
+
+            ll_transform_positions(mat, face->mPositions, count, tex_index, out.mArray, padded);
+            for (S32 i = 0; i < count; ++i)
+            {
+                LLVector4a res;
+                mat.affineTransform(face->mPositions[i], res);
+                ensure("position", out[i].equals3(res));
+                ensure_equals("texture index", ((U32*) out[i].getF32ptr())[3], tex_index);
+            }
+            for (S32 i = count; i < padded; ++i)
+            {
+                ensure("padding repeats last position", out[i].equals4(out[count - 1]));
+            }
+
+            ll_rotate_normals(mat, face->mNormals, count, out.mArray);
+            for (S32 i = 0; i < count; ++i)
+            {
+                LLVector4a res;
+                mat.rotate(face->mNormals[i], res);
+                ensure("normal", out[i].equals3(res));
+            }
+
+            ll_rotate_tangents(mat, face->mTangents, count, out.mArray);
+            for (S32 i = 0; i < count; ++i)
+            {
+                LLVector4a res;
+                mat.rotate(face->mTangents[i], res);
+                res.setSelectWithMask(mask, face->mTangents[i], res);
+                ensure("tangent", out[i].equals4(res));
+            }
+
+            ll_fill_u32(0x11223344, count, (U32*) out.mArray);
+            const U32* colors = (const U32*) out.mArray;
+            for (S32 i = 0; i < count; ++i)
+            {
+                ensure_equals("fill", colors[i], (U32) 0x11223344);
+            }
+        }
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        //
+        // benchmark the per vertex path against the kernels over the same
+        // fixed set of faces
+        //
+        if (! lltest_benchmark_enabled())
+        {
+            skip("set LL_TEST_BENCHMARK to run");
+        }
+
+        Faces faces;
+        std::vector<LLVector2> dst(faces.mMaxVertices);
+        LLAlignedArray<LLVector4a, 64> out;
+        out.resize(faces.mMaxVertices);
+        LLMatrix4a mat = make_vertex_matrix();
+
+        const U32 PASSES = 200;
+        F64 old_ms = 0.0;
+        F64 new_ms = 0.0;
+        U32 vertices = 0;
+
+        for (U32 planar = 0; planar < 2; ++planar)
+        {
+            for (U32 transform = 0; transform < LLTexCoordKernel::TRANSFORM_COUNT; ++transform)
+            {
+                TexGen texgen(planar != 0, transform);
+
+                old_ms += lltest_benchmark_ms(PASSES, [&]()
+                {
+                    for (const LLVolumeFace* face : faces.mFaces)
+                    {
+                        texgen.reference(*face, dst.data());
+                        for (S32 i = 0; i < face->mNumVertices; ++i)
+                        {
+                            mat.affineTransform(face->mPositions[i], out[i]);
+                        }
+                        for (S32 i = 0; i < face->mNumVertices; ++i)
+                        {
+                            mat.rotate(face->mNormals[i], out[i]);
+                        }
+                    }
+                });
+
+                new_ms += lltest_benchmark_ms(PASSES, [&]()
+                {
+                    for (const LLVolumeFace* face : faces.mFaces)
+                    {
+                        LLTexCoordKernel kernel;
+                        texgen.setup(kernel);
+                        kernel.run(face->mPositions, face->mNormals, face->mTexCoords, face->mNumVertices, dst.data());
+                        ll_transform_positions(mat, face->mPositions, face->mNumVertices, 0, out.mArray, face->mNumVertices);
+                        ll_rotate_normals(mat, face->mNormals, face->mNumVertices, out.mArray);
+                    }
+                });
+
+                for (const LLVolumeFace* face : faces.mFaces)
+                {
+                    vertices += face->mNumVertices;
+                }
+            }
+        }
+
+        lltest_benchmark_out() << faces.mFaces.size() << " faces, " << vertices << " vertices per pass: per vertex "
+                               << old_ms << " ms, kernels " << new_ms << " ms per pass" << std::endl;
+    }
+}
@@ -0,0 +1,333 @@
+/**
+ * @file   llskinningkernels_test.cpp
+ * @brief  Test for llskinningkernels.cpp.
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../test/lltut.h"
+#include "../test/lltestrandom.h"
+#include "../test/lltestbenchmark.h"
+
+#include "../llskinningkernels.h"
+#include "../llmatrix4a.h"
+#include "../llquaternion.h"
+#include "../m4math.h"
+
+#include <vector>
+
+namespace
+{
+    const U32 NUM_JOINTS = 110;
+
+    // a rigged mesh the way LLRiggedVolume::update sees it
+    struct Mesh
+    {
+        Mesh(S32 count)
+        {
+            LLTestRandom rand;
+
+            mPalette.resize(NUM_JOINTS);
+            for (U32 i = 0; i < NUM_JOINTS; ++i)
+            {
+                LLMatrix4 mat;
+                mat.initAll(LLVector3(0.5f + rand.next(), 0.5f + rand.next(), 0.5f + rand.next()),
+                            LLQuaternion(rand.next() * F_TWO_PI, LLVector3(rand.next(), rand.next(), 1.f)),
+                            LLVector3(rand.next() * 2.f, rand.next() * 2.f, rand.next() * 2.f));
+                mPalette[i].loadu(mat);
+            }
+
+            LLMatrix4 bind_shape;
+            bind_shape.initAll(LLVector3(1.f, 1.f, 1.f), LLQuaternion(0.3f, LLVector3(0.f, 0.f, 1.f)),
+                               LLVector3(0.f, 0.f, 1.2f));
+            mBindShape.loadu(bind_shape);
+
+            mPositions.resize(count);
+            mWeights.resize(count);
+            for (S32 i = 0; i < count; ++i)
+            {
+                mPositions[i].set(rand.next() - 0.5f, rand.next() - 0.5f, rand.next() * 2.f, 1.f);
+
+                // up to four influences, as unpackVolumeFaces() leaves them
+                F32* w = mWeights[i].getF32ptr();
+                U32 influences = 1 + (U32) (rand.next() * 4.f) % 4;
+                for (U32 k = 0; k < 4; ++k)
+                {
+                    F32 joint = (F32) (U32) (rand.next() * NUM_JOINTS);
+                    w[k] = k < influences ? joint + llclamp(rand.next(), 0.01f, 0.999f) : 0.f;
+                }
+            }
+        }
+
+        // what LLRiggedVolume::update did per vertex before the kernels
+        void reference(LLVector4a* dst) const
+        {
+            for (size_t i = 0; i < mPositions.size(); ++i)
+            {
+                const F32* w = mWeights[i].getF32ptr();
+                S32 idx[4];
+                F32 wght[4];
+                F32 scale = 0.f;
+                for (U32 k = 0; k < 4; ++k)
+                {
+                    idx[k] = llclamp((S32) floorf(w[k]), 0, (S32) NUM_JOINTS - 1);
+                    wght[k] = w[k] - floorf(w[k]);
+                    scale += wght[k];
+                }
+
+                LLMatrix4a final_mat;
+                final_mat.clear();
+                for (U32 k = 0; k < 4; ++k)
+                {
+                    LLMatrix4a src;
+                    src.setMul(mPalette[idx[k]], wght[k] / scale);
+                    final_mat.add(src);
+                }
+
+                LLVector4a t;
+                mBindShape.affineTransform(mPositions[i], t);
+                final_mat.affineTransform(t, dst[i]);
+            }
+        }
+
+        // the palette with the bind shape folded in, as the kernels take it
+        void foldBindShape(std::vector<LLMatrix4a>& palette) const
+        {
+            palette.resize(NUM_JOINTS);
+            for (U32 i = 0; i < NUM_JOINTS; ++i)
+            {
+                matMulUnsafe(mBindShape, mPalette[i], palette[i]);
+            }
+        }
+
+        std::vector<LLMatrix4a> mPalette;
+        LLMatrix4a mBindShape;
+        std::vector<LLVector4a> mPositions;
+        std::vector<LLVector4a> mWeights;
+    };
+
+    bool close_enough(const LLVector4a& a, const LLVector4a& b)
+    {
+        for (U32 i = 0; i < 3; ++i)
+        {
+            if (fabsf(a[i] - b[i]) > 1.0e-4f * llmax(1.f, fabsf(b[i])))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+namespace tut
+{
+    struct LLSkinningKernelsData
+    {
+    };
+
+    typedef test_group<LLSkinningKernelsData> factory;
+    typedef factory::object object;
+}
+
+namespace
+{
+    tut::factory llskinningkernels_test_factory("LLSkinningKernels");
+}
+
+namespace tut
+{
+    template<> template<>
+    void object::test<1>()
+    {
+        //
+        // decoded weights are clamped and normalized like
+        // LLSkinningUtil::getPerVertexSkinMatrix() does it
+        //
+        LLVector4a weights[3];
+        weights[0].set(2.25f, 7.75f, 0.f, 0.f);
+        weights[1].set(200.5f, 1.5f, 3.f, 4.f);
+        weights[2].set(5.f, 6.f, 0.f, 0.f);
+
+        U8 idx[12];
+        LLVector4a decoded[3];
+        ll_decode_skin_weights(weights, 3, 10, idx, decoded);
+
+        ensure_equals("index 0", (U32) idx[0], 2U);
+        ensure_equals("index 1", (U32) idx[1], 7U);
+        ensure_equals("weight 0", decoded[0][0], 0.25f);
+        ensure_equals("weight 1", decoded[0][1], 0.75f);
+        ensure_equals("weight 2", decoded[0][2], 0.f);
+
+        ensure_equals("index clamped", (U32) idx[4], 9U);
+        ensure_equals("even split", decoded[1][0], 0.5f);
+        ensure_equals("whole joint weighs nothing", decoded[1][2], 0.f);
+
+        ensure_equals("no weight index", (U32) idx[8], 5U);
+        ensure_equals("no weight goes to first joint", decoded[2][0], 1.f);
+        ensure_equals("no weight rest", decoded[2][1], 0.f);
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        //
+        // skinned positions and extents match the per vertex path, for every
+        // count around the two vertex AVX2 step
+        //
+        for (S32 count = 1; count < 12; ++count)
+        {
+            Mesh mesh(count);
+            std::vector<LLVector4a> expected(count);
+            mesh.reference(expected.data());
+
+            std::vector<LLMatrix4a> palette;
+            mesh.foldBindShape(palette);
+            std::vector<U8> idx(count * 4);
+            std::vector<LLVector4a> weights(count);
+            ll_decode_skin_weights(mesh.mWeights.data(), count, NUM_JOINTS, idx.data(), weights.data());
+
+            std::vector<LLVector4a> actual(count + 1);
+            LLVector4a guard;
+            guard.set(-12345.f, 54321.f, 0.f, 1.f);
+            actual[count] = guard;
+
+            LLVector4a extents[2];
+            ll_skin_positions(palette.data(), idx.data(), weights.data(), mesh.mPositions.data(), count,
+                              actual.data(), extents);
+
+            LLVector4a min = expected[0];
+            LLVector4a max = expected[0];
+            for (S32 i = 0; i < count; ++i)
+            {
+                ensure("position", close_enough(actual[i], expected[i]));
+                min.setMin(min, expected[i]);
+                max.setMax(max, expected[i]);
+            }
+            ensure("past the end untouched", actual[count].equals4(guard));
+            ensure("min", close_enough(extents[0], min));
+            ensure("max", close_enough(extents[1], max));
+        }
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        //
+        // extents from joint bounds contain every skinned position, and are
+        // exact for a mesh bound rigidly to one joint
+        //
+        const S32 VERTICES = 1000;
+        Mesh mesh(VERTICES);
+
+        std::vector<LLMatrix4a> palette;
+        mesh.foldBindShape(palette);
+        std::vector<U8> idx(VERTICES * 4);
+        std::vector<LLVector4a> weights(VERTICES);
+        ll_decode_skin_weights(mesh.mWeights.data(), VERTICES, NUM_JOINTS, idx.data(), weights.data());
+
+        std::vector<U8> joints(NUM_JOINTS);
+        std::vector<LLVector4a> bounds(NUM_JOINTS * 2);
+        U32 num_bounds = ll_skin_joint_bounds(idx.data(), weights.data(), mesh.mPositions.data(), VERTICES,
+                                              NUM_JOINTS, joints.data(), bounds.data());
+        ensure("joints found", num_bounds > 0 && num_bounds <= NUM_JOINTS);
+
+        std::vector<LLVector4a> skinned(VERTICES);
+        LLVector4a exact[2];
+        ll_skin_positions(palette.data(), idx.data(), weights.data(), mesh.mPositions.data(), VERTICES,
+                          skinned.data(), exact);
+
+        LLVector4a extents[2];
+        ll_skinned_extents(palette.data(), joints.data(), bounds.data(), num_bounds, extents);
+
+        LLVector4a slop;
+        slop.splat(1.0e-4f);
+        LLVector4a lo, hi;
+        lo.setSub(extents[0], slop);
+        hi.setAdd(extents[1], slop);
+        for (U32 i = 0; i < 3; ++i)
+        {
+            ensure("min contains", lo[i] <= exact[0][i]);
+            ensure("max contains", hi[i] >= exact[1][i]);
+        }
+
+        // every vertex on one joint, the bounds are the transformed box
+        for (S32 i = 0; i < 8; ++i)
+        {
+            mesh.mWeights[i].set(7.5f, 0.f, 0.f, 0.f);
+            mesh.mPositions[i].set((i & 1) ? 1.f : -1.f, (i & 2) ? 1.f : -1.f, (i & 4) ? 1.f : -1.f, 1.f);
+        }
+        ll_decode_skin_weights(mesh.mWeights.data(), 8, NUM_JOINTS, idx.data(), weights.data());
+        num_bounds = ll_skin_joint_bounds(idx.data(), weights.data(), mesh.mPositions.data(), 8,
+                                          NUM_JOINTS, joints.data(), bounds.data());
+        ensure_equals("one joint", num_bounds, 1U);
+        ensure_equals("that joint", (U32) joints[0], 7U);
+
+        ll_skin_positions(palette.data(), idx.data(), weights.data(), mesh.mPositions.data(), 8,
+                          skinned.data(), exact);
+        ll_skinned_extents(palette.data(), joints.data(), bounds.data(), num_bounds, extents);
+        ensure("rigid min", close_enough(extents[0], exact[0]));
+        ensure("rigid max", close_enough(extents[1], exact[1]));
+    }
+
+    template<> template<>
+    void object::test<4>()
+    {
+        //
+        // benchmark the per vertex path against the kernels on a 100k vertex
+        // mesh
+        //
+        if (! lltest_benchmark_enabled())
+        {
+            skip("set LL_TEST_BENCHMARK to run");
+        }
+
+        const S32 VERTICES = 100000;
+        const U32 PASSES = 20;
+
+        Mesh mesh(VERTICES);
+        std::vector<LLVector4a> out(VERTICES);
+
+        F64 old_ms = lltest_benchmark_ms(PASSES, [&]()
+        {
+            mesh.reference(out.data());
+        });
+
+        std::vector<LLMatrix4a> palette;
+        std::vector<U8> idx(VERTICES * 4);
+        std::vector<LLVector4a> weights(VERTICES);
+        ll_decode_skin_weights(mesh.mWeights.data(), VERTICES, NUM_JOINTS, idx.data(), weights.data());
+
+        F64 new_ms = lltest_benchmark_ms(PASSES, [&]()
+        {
+            // palette folding is part of every update
+            mesh.foldBindShape(palette);
+            LLVector4a extents[2];
+            ll_skin_positions(palette.data(), idx.data(), weights.data(), mesh.mPositions.data(), VERTICES,
+                              out.data(), extents);
+        });
+
+        lltest_benchmark_out() << VERTICES << " vertices: per vertex " << old_ms << " ms, kernels "
+                               << new_ms << " ms per pass" << std::endl;
+    }
+}
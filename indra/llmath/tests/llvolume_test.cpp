@@ -0,0 +1,223 @@
+/**
+ * @file   llvolume_test.cpp
+ * @brief  Test for llvolume.cpp.
+ *
+ * $LicenseInfo:firstyear=2023&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2023, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../test/lltut.h"
+#include "../test/lltestvolume.h"
+
+#include "../llvolume.h"
+#include "../m4math.h"
+#include "../llmatrix4a.h"
+
+namespace
+{
+    // mesh point the way LLVolume::generate computed it before the SIMD path
+    LLVector4a reference_point(const LLPath::PathPt& path_pt, const LLVector4a& profile_pt)
+    {
+        const F32* scale = path_pt.mScale.getF32ptr();
+        F32 sc[] =
+        { scale[0], 0, 0, 0,
+            0, scale[1], 0, 0,
+            0, 0, scale[2], 0,
+                0, 0, 0, 1 };
+
+        LLMatrix4 rot((F32*) path_pt.mRot.mMatrix);
+        LLMatrix4 scale_mat(sc);
+        scale_mat *= rot;
+
+        LLMatrix4a rot_mat;
+        rot_mat.loadu(scale_mat);
+
+        LLVector4a res;
+        rot_mat.rotate(profile_pt, res);
+        res.add(path_pt.mPos);
+        return res;
+    }
+}
+
+namespace tut
+{
+    struct LLVolumeData
+    {
+    };
+
+    typedef test_group<LLVolumeData> factory;
+    typedef factory::object object;
+}
+
+namespace
+{
+    tut::factory llvolume_test_factory("LLVolume");
+}
+
+namespace tut
+{
+    template<> template<>
+    void object::test<1>()
+    {
+        //
+        // identical params share cached profile and path results and produce identical meshes
+        //
+        LLVolumeParams params = lltest_volume_params(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE, 0.5f);
+
+        LLPointer<LLVolume> first = new LLVolume(params, 2.f);
+        LLPointer<LLVolume> second = new LLVolume(params, 2.f);
+
+        const LLAlignedArray<LLVector4a, 64>& a = first->getMesh();
+        const LLAlignedArray<LLVector4a, 64>& b = second->getMesh();
+
+        ensure("mesh generated", a.size() > 0);
+        ensure_equals("mesh size", b.size(), a.size());
+        ensure_equals("profile size", second->getProfile().mProfile.size(), first->getProfile().mProfile.size());
+        ensure_equals("profile faces", second->getProfile().mFaces.size(), first->getProfile().mFaces.size());
+        ensure_equals("path size", second->getPath().mPath.size(), first->getPath().mPath.size());
+        ensure_equals("face count", second->getNumVolumeFaces(), first->getNumVolumeFaces());
+
+        for (U32 i = 0; i < a.size(); ++i)
+        {
+            ensure("mesh point", a[i].equals3(b[i]));
+        }
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        //
+        // cache keys tell apart params that change the shape
+        //
+        LLPointer<LLVolume> solid = new LLVolume(lltest_volume_params(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE, 0.f), 1.f);
+        LLPointer<LLVolume> hollow = new LLVolume(lltest_volume_params(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE, 0.5f), 1.f);
+        LLPointer<LLVolume> detailed = new LLVolume(lltest_volume_params(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_LINE, 0.f), 3.f);
+        LLPointer<LLVolume> coarse = new LLVolume(lltest_volume_params(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_LINE, 0.f), 1.f);
+
+        ensure("hollow adds profile points", hollow->getProfile().mProfile.size() > solid->getProfile().mProfile.size());
+        ensure("detail adds profile points", detailed->getProfile().mProfile.size() > coarse->getProfile().mProfile.size());
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        //
+        // mesh points match the scalar scale * rotation transform
+        //
+        LLVolumeParams params = lltest_volume_params(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_CIRCLE, 0.25f);
+        params.setRatio(0.5f, 0.75f);
+        LLPointer<LLVolume> volume = new LLVolume(params, 2.f);
+
+        const LLAlignedArray<LLVector4a, 64>& mesh = volume->getMesh();
+        const LLAlignedArray<LLVector4a, 64>& profile = volume->getProfile().mProfile;
+        const LLAlignedArray<LLPath::PathPt, 64>& path = volume->getPath().mPath;
+
+        ensure_equals("mesh size", mesh.size(), profile.size() * path.size());
+
+        for (U32 s = 0; s < path.size(); ++s)
+        {
+            for (U32 t = 0; t < profile.size(); ++t)
+            {
+                LLVector4a expected = reference_point(path[s], profile[t]);
+                ensure("mesh point", mesh[s * profile.size() + t].equals3(expected, 1e-6f));
+            }
+        }
+    }
+
+    template<> template<>
+    void object::test<4>()
+    {
+        //
+        // compact faces expand back to within quantization error
+        //
+        LLPointer<LLVolume> volume = new LLVolume(lltest_volume_params(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE, 0.25f), 2.f);
+        LLVolumeFace& face = volume->getVolumeFace(0);
+        face.createTangents();
+
+        LLVolumeFace original(face);
+        ensure("original is full", !original.isCompact());
+
+        ensure("compacted", face.compact());
+        ensure("is compact", face.isCompact());
+        ensure("positions released", face.mPositions == NULL && face.mNormals == NULL && face.mTexCoords == NULL && face.mTangents == NULL);
+        ensure_equals("vertex count kept", face.mNumVertices, original.mNumVertices);
+        ensure_equals("index count kept", face.mNumIndices, original.mNumIndices);
+
+        face.expand();
+        ensure("expanded", !face.isCompact());
+        ensure("tangents restored", face.mTangents != NULL);
+
+        LLVector4a size;
+        size.setSub(original.mExtents[1], original.mExtents[0]);
+        F32 pos_tolerance = llmax(size[0], llmax(size[1], size[2])) / 65535.f;
+
+        for (S32 i = 0; i < face.mNumVertices; ++i)
+        {
+            ensure("position", face.mPositions[i].equals3(original.mPositions[i], pos_tolerance));
+            ensure("normal", face.mNormals[i].equals3(original.mNormals[i], 1.0e-3f));
+            ensure("tangent", face.mTangents[i].equals3(original.mTangents[i], 1.0e-3f));
+            ensure_equals("tangent sign", face.mTangents[i][3], original.mTangents[i][3]);
+            ensure("tex coord s", fabsf(face.mTexCoords[i].mV[0] - original.mTexCoords[i].mV[0]) <= 1.f / 2048.f);
+            ensure("tex coord t", fabsf(face.mTexCoords[i].mV[1] - original.mTexCoords[i].mV[1]) <= 1.f / 2048.f);
+        }
+
+        for (S32 i = 0; i < face.mNumIndices; ++i)
+        {
+            ensure_equals("index", face.mIndices[i], original.mIndices[i]);
+        }
+    }
+
+    template<> template<>
+    void object::test<5>()
+    {
+        //
+        // compact faces copy as compact, and faces the encoding can't
+        // represent stay full
+        //
+        LLPointer<LLVolume> volume = new LLVolume(lltest_volume_params(LL_PCODE_PROFILE_SQUARE, LL_PCODE_PATH_LINE, 0.f), 1.f);
+        LLVolumeFace& face = volume->getVolumeFace(0);
+
+        ensure("compacted", face.compact());
+
+        LLVolumeFace copy(face);
+        ensure("copy is compact", copy.isCompact());
+
+        face.expand();
+        copy.expand();
+        for (S32 i = 0; i < face.mNumVertices; ++i)
+        {
+            ensure("copy position", copy.mPositions[i].equals3(face.mPositions[i]));
+        }
+
+        face.mTexCoords[0].set(4096.3f, 0.f);
+        ensure("texture coordinates out of half float precision", !face.compact());
+        ensure("left full", !face.isCompact() && face.mPositions != NULL);
+
+        // one far vertex stretches the 16 bit grid past the position
+        // tolerance for the others
+        face.mTexCoords[0].set(0.f, 0.f);
+        face.mPositions[0].set(200.f, 0.f, 0.f);
+        ensure("positions out of tolerance", !face.compact());
+        ensure("left full with positions", !face.isCompact() && face.mPositions != NULL);
+    }
+}
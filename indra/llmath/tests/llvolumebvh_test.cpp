@@ -0,0 +1,450 @@
+/**
+ * @file   llvolumebvh_test.cpp
+ * @brief  Test for llvolumebvh.cpp.
+ *
+ * $LicenseInfo:firstyear=2023&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2023, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+
+#include "../test/lltut.h"
+#include "../test/lltestrandom.h"
+#include "../test/lltestbenchmark.h"
+
+#include "../llvolume.h"
+#include "../llvolumebvh.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    // fill face with a soup of small random triangles inside the cube of
+    // the given size around origin
+    void make_triangle_soup(LLVolumeFace& face, U32 num_triangles, LLTestRandom& rand,
+                            const LLVector4a& origin = LLVector4a(0.f, 0.f, 0.f), F32 size = 1.f)
+    {
+        face.resizeVertices(num_triangles * 3);
+        face.resizeIndices(num_triangles * 3);
+
+        for (U32 i = 0; i < num_triangles; ++i)
+        {
+            LLVector4a center(rand.range(-0.5f, 0.5f), rand.range(-0.5f, 0.5f), rand.range(-0.5f, 0.5f));
+            center.mul(size);
+            center.add(origin);
+            for (U32 j = 0; j < 3; ++j)
+            {
+                U32 v = i * 3 + j;
+                LLVector4a offset(rand.range(-0.05f, 0.05f), rand.range(-0.05f, 0.05f), rand.range(-0.05f, 0.05f));
+                offset.mul(size);
+                face.mPositions[v].setAdd(center, offset);
+                face.mNormals[v].set(0.f, 0.f, 1.f);
+                face.mTexCoords[v].set(rand.next(), rand.next());
+                face.mIndices[v] = (U16) v;
+            }
+        }
+    }
+
+    // reference answer, every triangle against the segment
+    S32 brute_force_intersect(const LLVolumeFace& face, const LLVector4a& start, const LLVector4a& dir, F32& closest_t)
+    {
+        S32 hit = -1;
+        for (S32 i = 0; i < face.mNumIndices / 3; ++i)
+        {
+            F32 a, b, t;
+            if (LLTriangleRayIntersect(face.mPositions[face.mIndices[i * 3 + 0]],
+                                       face.mPositions[face.mIndices[i * 3 + 1]],
+                                       face.mPositions[face.mIndices[i * 3 + 2]],
+                                       start, dir, a, b, t) &&
+                t >= 0.f && t <= 1.f && t < closest_t)
+            {
+                closest_t = t;
+                hit = i;
+            }
+        }
+        return hit;
+    }
+
+    // synthetic scene of many small objects for the raycast tests
+    struct Scene
+    {
+        static const U32 OBJECT_COUNT = 512;
+        static const U32 OBJECT_TRIANGLES = 200;
+
+        Scene()
+        {
+            LLTestRandom rand;
+            for (U32 i = 0; i < OBJECT_COUNT; ++i)
+            {
+                LLVector4a origin(rand.range(-10.f, 10.f), rand.range(-10.f, 10.f), rand.range(-10.f, 10.f));
+                make_triangle_soup(mFaces[i], OBJECT_TRIANGLES, rand, origin, rand.range(0.5f, 2.f));
+                mFaces[i].mExtents[0] = mFaces[i].mPositions[0];
+                mFaces[i].mExtents[1] = mFaces[i].mPositions[0];
+                for (S32 v = 1; v < mFaces[i].mNumVertices; ++v)
+                {
+                    mFaces[i].mExtents[0].setMin(mFaces[i].mExtents[0], mFaces[i].mPositions[v]);
+                    mFaces[i].mExtents[1].setMax(mFaces[i].mExtents[1], mFaces[i].mPositions[v]);
+                }
+
+                // object bounds in groups of four, as LLVolumeBVH::Node stores them
+                for (U32 axis = 0; axis < 3; ++axis)
+                {
+                    mBounds[i / 4][axis].getF32ptr()[i % 4] = mFaces[i].mExtents[0][axis];
+                    mBounds[i / 4][axis + 3].getF32ptr()[i % 4] = mFaces[i].mExtents[1][axis];
+                }
+
+                mBVH[i].build(mFaces[i].mPositions, mFaces[i].mIndices, mFaces[i].mNumIndices);
+            }
+        }
+
+        // object bounds tested four at a time, nearest candidates first,
+        // stopping once the next candidate starts past the closest hit
+        S32 intersect(const LLVector4a& start, const LLVector4a& dir, F32& closest_t) const
+        {
+            LLBVHRay ray(start, dir);
+
+            std::pair<F32, U32> candidates[OBJECT_COUNT];
+            U32 count = 0;
+            for (U32 i = 0; i < OBJECT_COUNT / 4; ++i)
+            {
+                LLVector4a enter;
+                U32 mask = ray.intersectBoxes(mBounds[i], 1.f, enter);
+                for (U32 j = 0; j < 4; ++j)
+                {
+                    if (mask & (1 << j))
+                    {
+                        candidates[count++] = std::make_pair(enter[j], i * 4 + j);
+                    }
+                }
+            }
+            std::sort(candidates, candidates + count);
+
+            S32 hit = -1;
+            for (U32 i = 0; i < count && candidates[i].first <= closest_t; ++i)
+            {
+                F32 a, b;
+                if (mBVH[candidates[i].second].intersect(mFaces[candidates[i].second].mPositions, ray, &closest_t, a, b) >= 0)
+                {
+                    hit = candidates[i].second;
+                }
+            }
+            return hit;
+        }
+
+        // the per object box test and triangle loop used before the BVH
+        S32 intersectBruteForce(const LLVector4a& start, const LLVector4a& dir, F32& closest_t) const
+        {
+            LLVector4a end;
+            end.setAdd(start, dir);
+
+            S32 hit = -1;
+            for (U32 i = 0; i < OBJECT_COUNT; ++i)
+            {
+                LLVector4a center, size;
+                center.setAdd(mFaces[i].mExtents[0], mFaces[i].mExtents[1]);
+                center.mul(0.5f);
+                size.setSub(mFaces[i].mExtents[1], mFaces[i].mExtents[0]);
+                size.mul(0.5f);
+
+                if (LLLineSegmentBoxIntersect(start, end, center, size) &&
+                    brute_force_intersect(mFaces[i], start, dir, closest_t) >= 0)
+                {
+                    hit = i;
+                }
+            }
+            return hit;
+        }
+
+        LLVolumeFace mFaces[OBJECT_COUNT];
+        LLVolumeBVH mBVH[OBJECT_COUNT];
+        LLVector4a mBounds[OBJECT_COUNT / 4][6];
+    };
+
+    // rays through the scene from one side to the other
+    void make_scene_rays(U32 count, std::vector<LLVector4a>& starts, std::vector<LLVector4a>& dirs)
+    {
+        starts.resize(count);
+        dirs.resize(count);
+
+        LLTestRandom rand;
+        for (U32 i = 0; i < count; ++i)
+        {
+            starts[i].set(rand.range(-12.f, 12.f), rand.range(-12.f, 12.f), -15.f);
+            LLVector4a end(rand.range(-12.f, 12.f), rand.range(-12.f, 12.f), 15.f);
+            dirs[i].setSub(end, starts[i]);
+        }
+    }
+}
+
+namespace tut
+{
+    struct LLVolumeBVHData
+    {
+    };
+
+    typedef test_group<LLVolumeBVHData> factory;
+    typedef factory::object object;
+}
+
+namespace
+{
+    tut::factory llvolumebvh_test_factory("LLVolumeBVH");
+}
+
+namespace tut
+{
+    template<> template<>
+    void object::test<1>()
+    {
+        //
+        // node layout: one root, leaves bounded in size, every triangle referenced once
+        //
+        LLTestRandom rand;
+        LLVolumeFace face;
+        make_triangle_soup(face, 1000, rand);
+
+        LLVolumeBVH bvh;
+        ensure("build succeeds", bvh.build(face.mPositions, face.mIndices, face.mNumIndices));
+        ensure_equals("triangle count", bvh.getTriangleCount(), 1000U);
+
+        U32 referenced = 0;
+        for (U32 i = 0; i < bvh.getNodeCount(); ++i)
+        {
+            const LLVolumeBVH::Node& node = bvh.getNodes()[i];
+            for (U32 j = 0; j < 4; ++j)
+            {
+                if (node.isLeaf(j))
+                {
+                    ensure("leaf size", node.mCount[j] <= LLVolumeBVH::MAX_LEAF_TRIANGLES);
+                    ensure("leaf in range", node.mChild[j] + node.mCount[j] <= bvh.getTriangleCount());
+                    referenced += node.mCount[j];
+                }
+                else if (node.mChild[j])
+                {
+                    ensure("children after parent", node.mChild[j] > i && node.mChild[j] < bvh.getNodeCount());
+                }
+            }
+        }
+        ensure_equals("all triangles in leaves", referenced, 1000U);
+    }
+
+    template<> template<>
+    void object::test<2>()
+    {
+        //
+        // BVH raycasts agree with testing every triangle
+        //
+        LLTestRandom rand;
+        LLVolumeFace face;
+        make_triangle_soup(face, 2000, rand);
+
+        LLVolumeBVH bvh;
+        bvh.build(face.mPositions, face.mIndices, face.mNumIndices);
+
+        for (U32 i = 0; i < 500; ++i)
+        {
+            LLVector4a start(rand.range(-1.f, 1.f), rand.range(-1.f, 1.f), -1.f);
+            LLVector4a end(rand.range(-1.f, 1.f), rand.range(-1.f, 1.f), 1.f);
+            if (i % 3 == 0)
+            { // axis aligned rays exercise the zero direction handling
+                end.set(start[0], start[1], 1.f);
+            }
+
+            LLVector4a dir;
+            dir.setSub(end, start);
+
+            F32 expected_t = 2.f;
+            S32 expected_hit = brute_force_intersect(face, start, dir, expected_t);
+
+            F32 t = 2.f;
+            LLVector4a intersection;
+            bool hit = bvh.intersect(face, start, dir, &t, &intersection, NULL, NULL, NULL);
+
+            ensure_equals("hit agrees with brute force", hit, expected_hit >= 0);
+            if (hit)
+            {
+                ensure_approximately_equals("closest t", t, expected_t, 16);
+            }
+        }
+    }
+
+    template<> template<>
+    void object::test<3>()
+    {
+        //
+        // face octrees are built on demand and evicted past the memory budget
+        //
+        LLTestRandom rand;
+        LLVolumeFace faces[4];
+        for (LLVolumeFace& face : faces)
+        {
+            make_triangle_soup(face, 500, rand);
+        }
+
+        U64 base_usage = LLVolumeFace::getOctreeMemoryUsage();
+
+        faces[0].createOctree();
+        ensure("built on demand", faces[0].getOctree() != NULL);
+        U64 one_tree = LLVolumeFace::getOctreeMemoryUsage() - base_usage;
+
+        // room for two trees
+        LLVolumeFace::setOctreeMemoryBudget(base_usage + one_tree * 2 + one_tree / 2);
+
+        faces[1].createOctree();
+        faces[0].createOctree(); // touch, 1 is now least recently used
+        faces[2].createOctree();
+
+        ensure("most recently used kept", faces[0].getOctree() != NULL);
+        ensure("least recently used evicted", faces[1].getOctree() == NULL);
+        ensure("newest kept", faces[2].getOctree() != NULL);
+
+        faces[2].destroyOctree();
+        ensure_equals("usage tracks destruction", LLVolumeFace::getOctreeMemoryUsage(), base_usage + one_tree);
+
+        LLVolumeFace::setOctreeMemoryBudget(64 * 1024 * 1024);
+    }
+
+    template<> template<>
+    void object::test<4>()
+    {
+        //
+        // 10k rays through a dense scene, BVH against box culled brute force
+        //
+        std::unique_ptr<Scene> scene(new Scene);
+
+        const U32 RAY_COUNT = 10000;
+        std::vector<LLVector4a> starts;
+        std::vector<LLVector4a> dirs;
+        make_scene_rays(RAY_COUNT, starts, dirs);
+
+        std::vector<F32> bvh_t(RAY_COUNT, 2.f);
+        std::vector<F32> brute_t(RAY_COUNT, 2.f);
+        std::vector<S32> bvh_hit(RAY_COUNT);
+        std::vector<S32> brute_hit(RAY_COUNT);
+
+        for (U32 i = 0; i < RAY_COUNT; ++i)
+        {
+            bvh_hit[i] = scene->intersect(starts[i], dirs[i], bvh_t[i]);
+            brute_hit[i] = scene->intersectBruteForce(starts[i], dirs[i], brute_t[i]);
+        }
+
+        U32 hits = 0;
+        for (U32 i = 0; i < RAY_COUNT; ++i)
+        {
+            ensure_equals("hit agrees with brute force", bvh_hit[i] >= 0, brute_hit[i] >= 0);
+            if (bvh_hit[i] >= 0)
+            {
+                ensure_approximately_equals("closest t", bvh_t[i], brute_t[i], 16);
+                ++hits;
+            }
+        }
+        ensure("rays hit", hits > 0);
+    }
+
+    template<> template<>
+    void object::test<5>()
+    {
+        //
+        // volumes that defer octree builds raycast their triangles directly
+        // instead of building a tree inline, with the same results
+        //
+        LLVolumeParams params;
+        params.setType(LL_PCODE_PROFILE_CIRCLE, LL_PCODE_PATH_CIRCLE);
+        params.setBeginAndEndS(0.f, 1.f);
+        params.setBeginAndEndT(0.f, 1.f);
+        params.setRatio(1.f, 0.25f);
+        params.setShear(0.f, 0.f);
+
+        LLPointer<LLVolume> immediate = new LLVolume(params, 3.f);
+        LLPointer<LLVolume> deferred = new LLVolume(params, 3.f);
+        deferred->setDeferOctreeBuilds(true);
+
+        LLTestRandom rand;
+        U32 hits = 0;
+        for (U32 i = 0; i < 200; ++i)
+        {
+            LLVector4a start(rand.range(-0.6f, 0.6f), rand.range(-0.6f, 0.6f), -1.f);
+            LLVector4a end(rand.range(-0.6f, 0.6f), rand.range(-0.6f, 0.6f), 1.f);
+
+            LLVector4a expected_point;
+            S32 expected = immediate->lineSegmentIntersect(start, end, -1, &expected_point);
+            LLVector4a point;
+            S32 face = deferred->lineSegmentIntersect(start, end, -1, &point);
+
+            ensure_equals("same face hit", face, expected);
+            if (face >= 0)
+            {
+                ensure("same point", point.equals3(expected_point, 1.0e-5f));
+                ++hits;
+            }
+        }
+        ensure("rays hit", hits > 0);
+
+        for (S32 i = 0; i < deferred->getNumVolumeFaces(); ++i)
+        {
+            ensure("no tree built inline", deferred->getVolumeFace(i).getOctree() == NULL);
+        }
+    }
+
+    template<> template<>
+    void object::test<6>()
+    {
+        //
+        // benchmark 10k rays through a dense scene, BVH against box culled
+        // brute force
+        //
+        if (! lltest_benchmark_enabled())
+        {
+            skip("set LL_TEST_BENCHMARK to run");
+        }
+
+        std::unique_ptr<Scene> scene(new Scene);
+
+        const U32 RAY_COUNT = 10000;
+        std::vector<LLVector4a> starts;
+        std::vector<LLVector4a> dirs;
+        make_scene_rays(RAY_COUNT, starts, dirs);
+
+        U32 hits = 0;
+        F64 bvh_ms = lltest_benchmark_ms(1, [&]()
+        {
+            for (U32 i = 0; i < RAY_COUNT; ++i)
+            {
+                F32 t = 2.f;
+                hits += scene->intersect(starts[i], dirs[i], t) >= 0;
+            }
+        });
+        F64 brute_ms = lltest_benchmark_ms(1, [&]()
+        {
+            for (U32 i = 0; i < RAY_COUNT; ++i)
+            {
+                F32 t = 2.f;
+                scene->intersectBruteForce(starts[i], dirs[i], t);
+            }
+        });
+
+        lltest_benchmark_out() << RAY_COUNT << " rays, " << hits << " hits against "
+                               << Scene::OBJECT_COUNT * Scene::OBJECT_TRIANGLES << " triangles: BVH "
+                               << bvh_ms << " ms, brute force " << brute_ms << " ms" << std::endl;
+    }
+}
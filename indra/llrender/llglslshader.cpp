@@ -61,6 +61,8 @@ U64 LLGLSLShader::sTotalTimeElapsed = 0;
 U32 LLGLSLShader::sTotalTrianglesDrawn = 0;
 U64 LLGLSLShader::sTotalSamplesDrawn = 0;
 U32 LLGLSLShader::sTotalBinds = 0;
+U32 LLGLSLShader::sUniformCalls = 0;
+U32 LLGLSLShader::sUniformsMerged = 0;
 
 //UI shader -- declared here so llui_libtest will link properly
 LLGLSLShader    gUIProgram;
@@ -842,6 +844,7 @@ BOOL LLGLSLShader::mapUniforms(const vector<LLStaticHashedString>* uniforms)
     mUniformMap.clear();
     mTexture.clear();
     mValue.clear();
+    mDirtyUniforms.clear();
     //initialize arrays
     U32 numUniforms = (uniforms == NULL) ? 0 : uniforms->size();
     mUniform.resize(numUniforms + LLShaderMgr::instance()->mReservedUniforms.size(), -1);
@@ -994,6 +997,24 @@ BOOL LLGLSLShader::mapUniforms(const vector<LLStaticHashedString>* uniforms)
             glUniformBlockBinding(mProgramObject, UBOBlockIndex, BLOCKBINDING);
         }
     }
+
+    if (mFeatures.hasInstancing)
+    {
+        GLuint UBOBlockIndex = glGetUniformBlockIndex(mProgramObject, "InstanceTransforms");
+        if (UBOBlockIndex != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding(mProgramObject, UBOBlockIndex, INSTANCE_BLOCK_BINDING);
+        }
+    }
+
+    if (mFeatures.hasShadows)
+    {
+        GLuint UBOBlockIndex = glGetUniformBlockIndex(mProgramObject, "ShadowParams");
+        if (UBOBlockIndex != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding(mProgramObject, UBOBlockIndex, SHADOW_BLOCK_BINDING);
+        }
+    }
     unbind();
 
     LL_DEBUGS("ShaderUniform") << "Total Uniform Size: " << mTotalUniformSize << LL_ENDL;
@@ -1229,6 +1250,74 @@ S32 LLGLSLShader::disableTexture(S32 uniform, LLTexUnit::eTextureType mode, LLTe
     return index;
 }
 
+void LLGLSLShader::setUniform(GLint location, U32 type, const LLVector4& value)
+{
+    UniformValue& uniform = mValue[location];
+    if (uniform.mType == UNIFORM_NONE || uniform.mType != type || shouldChange(uniform.mValue, value))
+    {
+        if (uniform.mDirty)
+        { // replaced before it was sent
+            ++sUniformsMerged;
+        }
+        else
+        {
+            uniform.mDirty = true;
+            mDirtyUniforms.push_back(std::make_pair(location, &uniform));
+        }
+        uniform.mValue = value;
+        uniform.mType = type;
+    }
+}
+
+void LLGLSLShader::uniformSent(GLint location)
+{
+    ++sUniformCalls;
+
+    const auto& iter = mValue.find(location);
+    if (iter != mValue.end())
+    { // a pending value would overwrite this one in flushUniforms
+        iter->second.mType = UNIFORM_NONE;
+        iter->second.mDirty = false;
+    }
+}
+
+void LLGLSLShader::flushUniforms()
+{
+    if (mDirtyUniforms.empty())
+    {
+        return;
+    }
+
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_SHADER;
+    llassert(sCurBoundShaderPtr == this);
+
+    for (auto& entry : mDirtyUniforms)
+    {
+        GLint location = entry.first;
+        UniformValue& uniform = *entry.second;
+        if (!uniform.mDirty)
+        { // sent directly since
+            continue;
+        }
+        uniform.mDirty = false;
+
+        const F32* v = uniform.mValue.mV;
+        switch (uniform.mType)
+        {
+        case UNIFORM_1I: glUniform1i(location, (GLint) v[0]); break;
+        case UNIFORM_2I: glUniform2i(location, (GLint) v[0], (GLint) v[1]); break;
+        case UNIFORM_1F: glUniform1f(location, v[0]); break;
+        case UNIFORM_2F: glUniform2fv(location, 1, v); break;
+        case UNIFORM_3F: glUniform3fv(location, 1, v); break;
+        case UNIFORM_4F: glUniform4fv(location, 1, v); break;
+        default: llassert(false); break;
+        }
+        ++sUniformCalls;
+    }
+
+    mDirtyUniforms.clear();
+}
+
 void LLGLSLShader::uniform1i(U32 index, GLint x)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_SHADER;
@@ -1243,12 +1332,7 @@ void LLGLSLShader::uniform1i(U32 index, GLint x)
 
         if (mUniform[index] >= 0)
         {
-            const auto& iter = mValue.find(mUniform[index]);
-            if (iter == mValue.end() || iter->second.mV[0] != x)
-            {
-                glUniform1i(mUniform[index], x);
-                mValue[mUniform[index]] = LLVector4(x, 0.f, 0.f, 0.f);
-            }
+            setUniform(mUniform[index], UNIFORM_1I, LLVector4(x, 0.f, 0.f, 0.f));
         }
     }
 }
@@ -1268,12 +1352,7 @@ void LLGLSLShader::uniform1f(U32 index, GLfloat x)
 
         if (mUniform[index] >= 0)
         {
-            const auto& iter = mValue.find(mUniform[index]);
-            if (iter == mValue.end() || iter->second.mV[0] != x)
-            {
-                glUniform1f(mUniform[index], x);
-                mValue[mUniform[index]] = LLVector4(x, 0.f, 0.f, 0.f);
-            }
+            setUniform(mUniform[index], UNIFORM_1F, LLVector4(x, 0.f, 0.f, 0.f));
         }
     }
 }
@@ -1286,6 +1365,7 @@ void LLGLSLShader::fastUniform1f(U32 index, GLfloat x)
     llassert(mUniform.size() <= index);
     llassert(mUniform[index] >= 0);
     glUniform1f(mUniform[index], x);
+    uniformSent(mUniform[index]);
 }
 
 void LLGLSLShader::uniform2f(U32 index, GLfloat x, GLfloat y)
@@ -1303,13 +1383,7 @@ void LLGLSLShader::uniform2f(U32 index, GLfloat x, GLfloat y)
 
         if (mUniform[index] >= 0)
         {
-            const auto& iter = mValue.find(mUniform[index]);
-            LLVector4 vec(x, y, 0.f, 0.f);
-            if (iter == mValue.end() || shouldChange(iter->second, vec))
-            {
-                glUniform2f(mUniform[index], x, y);
-                mValue[mUniform[index]] = vec;
-            }
+            setUniform(mUniform[index], UNIFORM_2F, LLVector4(x, y, 0.f, 0.f));
         }
     }
 }
@@ -1329,13 +1403,7 @@ void LLGLSLShader::uniform3f(U32 index, GLfloat x, GLfloat y, GLfloat z)
 
         if (mUniform[index] >= 0)
         {
-            const auto& iter = mValue.find(mUniform[index]);
-            LLVector4 vec(x, y, z, 0.f);
-            if (iter == mValue.end() || shouldChange(iter->second, vec))
-            {
-                glUniform3f(mUniform[index], x, y, z);
-                mValue[mUniform[index]] = vec;
-            }
+            setUniform(mUniform[index], UNIFORM_3F, LLVector4(x, y, z, 0.f));
         }
     }
 }
@@ -1355,13 +1423,7 @@ void LLGLSLShader::uniform4f(U32 index, GLfloat x, GLfloat y, GLfloat z, GLfloat
 
         if (mUniform[index] >= 0)
         {
-            const auto& iter = mValue.find(mUniform[index]);
-            LLVector4 vec(x, y, z, w);
-            if (iter == mValue.end() || shouldChange(iter->second, vec))
-            {
-                glUniform4f(mUniform[index], x, y, z, w);
-                mValue[mUniform[index]] = vec;
-            }
+            setUniform(mUniform[index], UNIFORM_4F, LLVector4(x, y, z, w));
         }
     }
 }
@@ -1381,12 +1443,14 @@ void LLGLSLShader::uniform1iv(U32 index, U32 count, const GLint* v)
 
         if (mUniform[index] >= 0)
         {
-            const auto& iter = mValue.find(mUniform[index]);
-            LLVector4 vec(v[0], 0.f, 0.f, 0.f);
-            if (iter == mValue.end() || shouldChange(iter->second, vec) || count != 1)
+            if (count == 1)
+            {
+                setUniform(mUniform[index], UNIFORM_1I, LLVector4(v[0], 0.f, 0.f, 0.f));
+            }
+            else
             {
                 glUniform1iv(mUniform[index], count, v);
-                mValue[mUniform[index]] = vec;
+                uniformSent(mUniform[index]);
             }
         }
     }
@@ -1407,13 +1471,8 @@ void LLGLSLShader::uniform4iv(U32 index, U32 count, const GLint* v)
 
         if (mUniform[index] >= 0)
         {
-            const auto& iter = mValue.find(mUniform[index]);
-            LLVector4 vec(v[0], v[1], v[2], v[3]);
-            if (iter == mValue.end() || shouldChange(iter->second, vec) || count != 1)
-            {
-                glUniform1iv(mUniform[index], count, v);
-                mValue[mUniform[index]] = vec;
-            }
+            glUniform1iv(mUniform[index], count, v);
+            uniformSent(mUniform[index]);
         }
     }
 }
@@ -1434,12 +1493,14 @@ void LLGLSLShader::uniform1fv(U32 index, U32 count, const GLfloat* v)
 
         if (mUniform[index] >= 0)
         {
-            const auto& iter = mValue.find(mUniform[index]);
-            LLVector4 vec(v[0], 0.f, 0.f, 0.f);
-            if (iter == mValue.end() || shouldChange(iter->second, vec) || count != 1)
+            if (count == 1)
+            {
+                setUniform(mUniform[index], UNIFORM_1F, LLVector4(v[0], 0.f, 0.f, 0.f));
+            }
+            else
             {
                 glUniform1fv(mUniform[index], count, v);
-                mValue[mUniform[index]] = vec;
+                uniformSent(mUniform[index]);
             }
         }
     }
@@ -1460,12 +1521,14 @@ void LLGLSLShader::uniform2fv(U32 index, U32 count, const GLfloat* v)
 
         if (mUniform[index] >= 0)
         {
-            const auto& iter = mValue.find(mUniform[index]);
-            LLVector4 vec(v[0], v[1], 0.f, 0.f);
-            if (iter == mValue.end() || shouldChange(iter->second, vec) || count != 1)
+            if (count == 1)
+            {
+                setUniform(mUniform[index], UNIFORM_2F, LLVector4(v[0], v[1], 0.f, 0.f));
+            }
+            else
             {
                 glUniform2fv(mUniform[index], count, v);
-                mValue[mUniform[index]] = vec;
+                uniformSent(mUniform[index]);
             }
         }
     }
@@ -1486,12 +1549,14 @@ void LLGLSLShader::uniform3fv(U32 index, U32 count, const GLfloat* v)
 
         if (mUniform[index] >= 0)
         {
-            const auto& iter = mValue.find(mUniform[index]);
-            LLVector4 vec(v[0], v[1], v[2], 0.f);
-            if (iter == mValue.end() || shouldChange(iter->second, vec) || count != 1)
+            if (count == 1)
+            {
+                setUniform(mUniform[index], UNIFORM_3F, LLVector4(v[0], v[1], v[2], 0.f));
+            }
+            else
             {
                 glUniform3fv(mUniform[index], count, v);
-                mValue[mUniform[index]] = vec;
+                uniformSent(mUniform[index]);
             }
         }
     }
@@ -1512,13 +1577,14 @@ void LLGLSLShader::uniform4fv(U32 index, U32 count, const GLfloat* v)
 
         if (mUniform[index] >= 0)
         {
-            const auto& iter = mValue.find(mUniform[index]);
-            LLVector4 vec(v[0], v[1], v[2], v[3]);
-            if (iter == mValue.end() || shouldChange(iter->second, vec) || count != 1)
+            if (count == 1)
+            {
+                setUniform(mUniform[index], UNIFORM_4F, LLVector4(v[0], v[1], v[2], v[3]));
+            }
+            else
             {
-                LL_PROFILE_ZONE_SCOPED_CATEGORY_SHADER;
                 glUniform4fv(mUniform[index], count, v);
-                mValue[mUniform[index]] = vec;
+                uniformSent(mUniform[index]);
             }
         }
     }
@@ -1540,6 +1606,7 @@ void LLGLSLShader::uniformMatrix2fv(U32 index, U32 count, GLboolean transpose, c
         if (mUniform[index] >= 0)
         {
             glUniformMatrix2fv(mUniform[index], count, transpose, v);
+            ++sUniformCalls;
         }
     }
 }
@@ -1560,6 +1627,7 @@ void LLGLSLShader::uniformMatrix3fv(U32 index, U32 count, GLboolean transpose, c
         if (mUniform[index] >= 0)
         {
             glUniformMatrix3fv(mUniform[index], count, transpose, v);
+            ++sUniformCalls;
         }
     }
 }
@@ -1580,6 +1648,7 @@ void LLGLSLShader::uniformMatrix3x4fv(U32 index, U32 count, GLboolean transpose,
         if (mUniform[index] >= 0)
         {
             glUniformMatrix3x4fv(mUniform[index], count, transpose, v);
+            ++sUniformCalls;
         }
     }
 }
@@ -1600,6 +1669,7 @@ void LLGLSLShader::uniformMatrix4fv(U32 index, U32 count, GLboolean transpose, c
         if (mUniform[index] >= 0)
         {
             glUniformMatrix4fv(mUniform[index], count, transpose, v);
+            ++sUniformCalls;
         }
     }
 }
@@ -1669,13 +1739,7 @@ void LLGLSLShader::uniform1i(const LLStaticHashedString& uniform, GLint v)
 
     if (location >= 0)
     {
-        const auto& iter = mValue.find(location);
-        LLVector4 vec(v, 0.f, 0.f, 0.f);
-        if (iter == mValue.end() || shouldChange(iter->second, vec))
-        {
-            glUniform1i(location, v);
-            mValue[location] = vec;
-        }
+        setUniform(location, UNIFORM_1I, LLVector4(v, 0.f, 0.f, 0.f));
     }
 }
 
@@ -1686,13 +1750,14 @@ void LLGLSLShader::uniform1iv(const LLStaticHashedString& uniform, U32 count, co
 
     if (location >= 0)
     {
-        LLVector4 vec(v[0], 0, 0, 0);
-        const auto& iter = mValue.find(location);
-        if (iter == mValue.end() || shouldChange(iter->second, vec) || count != 1)
+        if (count == 1)
+        {
+            setUniform(location, UNIFORM_1I, LLVector4(v[0], 0.f, 0.f, 0.f));
+        }
+        else
         {
-            LL_PROFILE_ZONE_SCOPED_CATEGORY_SHADER;
             glUniform1iv(location, count, v);
-            mValue[location] = vec;
+            uniformSent(location);
         }
     }
 }
@@ -1704,14 +1769,8 @@ void LLGLSLShader::uniform4iv(const LLStaticHashedString& uniform, U32 count, co
 
     if (location >= 0)
     {
-        LLVector4 vec(v[0], v[1], v[2], v[3]);
-        const auto& iter = mValue.find(location);
-        if (iter == mValue.end() || shouldChange(iter->second, vec) || count != 1)
-        {
-            LL_PROFILE_ZONE_SCOPED_CATEGORY_SHADER;
-            glUniform4iv(location, count, v);
-            mValue[location] = vec;
-        }
+        glUniform4iv(location, count, v);
+        uniformSent(location);
     }
 }
 
@@ -1722,13 +1781,7 @@ void LLGLSLShader::uniform2i(const LLStaticHashedString& uniform, GLint i, GLint
 
     if (location >= 0)
     {
-        const auto& iter = mValue.find(location);
-        LLVector4 vec(i, j, 0.f, 0.f);
-        if (iter == mValue.end() || shouldChange(iter->second, vec))
-        {
-            glUniform2i(location, i, j);
-            mValue[location] = vec;
-        }
+        setUniform(location, UNIFORM_2I, LLVector4(i, j, 0.f, 0.f));
     }
 }
 
@@ -1740,13 +1793,7 @@ void LLGLSLShader::uniform1f(const LLStaticHashedString& uniform, GLfloat v)
 
     if (location >= 0)
     {
-        const auto& iter = mValue.find(location);
-        LLVector4 vec(v, 0.f, 0.f, 0.f);
-        if (iter == mValue.end() || shouldChange(iter->second, vec))
-        {
-            glUniform1f(location, v);
-            mValue[location] = vec;
-        }
+        setUniform(location, UNIFORM_1F, LLVector4(v, 0.f, 0.f, 0.f));
     }
 }
 
@@ -1757,15 +1804,8 @@ void LLGLSLShader::uniform2f(const LLStaticHashedString& uniform, GLfloat x, GLf
 
     if (location >= 0)
     {
-        const auto& iter = mValue.find(location);
-        LLVector4 vec(x, y, 0.f, 0.f);
-        if (iter == mValue.end() || shouldChange(iter->second, vec))
-        {
-            glUniform2f(location, x, y);
-            mValue[location] = vec;
-        }
+        setUniform(location, UNIFORM_2F, LLVector4(x, y, 0.f, 0.f));
     }
-
 }
 
 void LLGLSLShader::uniform3f(const LLStaticHashedString& uniform, GLfloat x, GLfloat y, GLfloat z)
@@ -1775,13 +1815,7 @@ void LLGLSLShader::uniform3f(const LLStaticHashedString& uniform, GLfloat x, GLf
 
     if (location >= 0)
     {
-        const auto& iter = mValue.find(location);
-        LLVector4 vec(x, y, z, 0.f);
-        if (iter == mValue.end() || shouldChange(iter->second, vec))
-        {
-            glUniform3f(location, x, y, z);
-            mValue[location] = vec;
-        }
+        setUniform(location, UNIFORM_3F, LLVector4(x, y, z, 0.f));
     }
 }
 
@@ -1792,12 +1826,14 @@ void LLGLSLShader::uniform1fv(const LLStaticHashedString& uniform, U32 count, co
 
     if (location >= 0)
     {
-        const auto& iter = mValue.find(location);
-        LLVector4 vec(v[0], 0.f, 0.f, 0.f);
-        if (iter == mValue.end() || shouldChange(iter->second, vec) || count != 1)
+        if (count == 1)
+        {
+            setUniform(location, UNIFORM_1F, LLVector4(v[0], 0.f, 0.f, 0.f));
+        }
+        else
         {
             glUniform1fv(location, count, v);
-            mValue[location] = vec;
+            uniformSent(location);
         }
     }
 }
@@ -1809,12 +1845,14 @@ void LLGLSLShader::uniform2fv(const LLStaticHashedString& uniform, U32 count, co
 
     if (location >= 0)
     {
-        const auto& iter = mValue.find(location);
-        LLVector4 vec(v[0], v[1], 0.f, 0.f);
-        if (iter == mValue.end() || shouldChange(iter->second, vec) || count != 1)
+        if (count == 1)
+        {
+            setUniform(location, UNIFORM_2F, LLVector4(v[0], v[1], 0.f, 0.f));
+        }
+        else
         {
             glUniform2fv(location, count, v);
-            mValue[location] = vec;
+            uniformSent(location);
         }
     }
 }
@@ -1826,12 +1864,14 @@ void LLGLSLShader::uniform3fv(const LLStaticHashedString& uniform, U32 count, co
 
     if (location >= 0)
     {
-        const auto& iter = mValue.find(location);
-        LLVector4 vec(v[0], v[1], v[2], 0.f);
-        if (iter == mValue.end() || shouldChange(iter->second, vec) || count != 1)
+        if (count == 1)
+        {
+            setUniform(location, UNIFORM_3F, LLVector4(v[0], v[1], v[2], 0.f));
+        }
+        else
         {
             glUniform3fv(location, count, v);
-            mValue[location] = vec;
+            uniformSent(location);
         }
     }
 }
@@ -1843,13 +1883,14 @@ void LLGLSLShader::uniform4fv(const LLStaticHashedString& uniform, U32 count, co
 
     if (location >= 0)
     {
-        LLVector4 vec(v);
-        const auto& iter = mValue.find(location);
-        if (iter == mValue.end() || shouldChange(iter->second, vec) || count != 1)
+        if (count == 1)
+        {
+            setUniform(location, UNIFORM_4F, LLVector4(v));
+        }
+        else
         {
-            LL_PROFILE_ZONE_SCOPED_CATEGORY_SHADER;
             glUniform4fv(location, count, v);
-            mValue[location] = vec;
+            uniformSent(location);
         }
     }
 }
@@ -1863,6 +1904,7 @@ void LLGLSLShader::uniformMatrix4fv(const LLStaticHashedString& uniform, U32 cou
     {
         stop_glerror();
         glUniformMatrix4fv(location, count, transpose, v);
+        ++sUniformCalls;
         stop_glerror();
     }
 }
@@ -55,6 +55,7 @@ public:
     bool disableTextureIndex = false;
     bool hasAlphaMask = false;
     bool hasReflectionProbes = false;
+    bool hasInstancing = false; // include: shaders\class1\objects\instanceV.glsl
     bool attachNothing = false;
 };
 
@@ -154,6 +155,20 @@ public:
     static LLGLSLShader* sCurBoundShaderPtr;
     static S32 sIndexedTextureChannels;
 
+    // uniform block binding per instance transforms are read from, and the
+    // most instances one draw can have -- must match objects/instanceV.glsl
+    static const U32 INSTANCE_BLOCK_BINDING = 2;
+    static const U32 MAX_INSTANCES = 128;
+
+    // uniform block binding shadow state shared by every shader with
+    // hasShadows is read from -- must match deferred/shadowUtil.glsl
+    static const U32 SHADOW_BLOCK_BINDING = 3;
+
+    // glUniform calls made, and uniform values replaced before they were
+    // sent, since the render info display last reset them
+    static U32 sUniformCalls;
+    static U32 sUniformsMerged;
+
     static void initProfile();
     static void finishProfile(bool emit_report = true);
 
@@ -216,6 +231,11 @@ public:
 
     void setMinimumAlpha(F32 minimum);
 
+    // Send the uniform values set since the last draw, one glUniform call
+    // per changed uniform.  LLRender::syncMatrices calls this before every
+    // draw, so the uniform* functions above only record values.
+    void flushUniforms();
+
     void vertexAttrib4f(U32 index, GLfloat x, GLfloat y, GLfloat z, GLfloat w);
     void vertexAttrib4fv(U32 index, GLfloat* v);
 
@@ -282,8 +302,25 @@ public:
     U32 mAttributeMask;  //mask of which reserved attributes are set (lines up with LLVertexBuffer::getTypeMask())
     std::vector<GLint> mUniform;   //lookup table of uniform enum to uniform location
     LLStaticStringTable<GLint> mUniformMap; //lookup map of uniform name to uniform location
-    typedef std::unordered_map<GLint, LLVector4> uniform_value_map_t;
+    enum eUniformType
+    {
+        UNIFORM_NONE = 0,   // value unknown, e.g. set as an array
+        UNIFORM_1I,
+        UNIFORM_2I,
+        UNIFORM_1F,
+        UNIFORM_2F,
+        UNIFORM_3F,
+        UNIFORM_4F,
+    };
+    struct UniformValue
+    {
+        LLVector4 mValue;
+        U32 mType = UNIFORM_NONE;
+        bool mDirty = false;    // set but not sent to GL yet
+    };
+    typedef std::unordered_map<GLint, UniformValue> uniform_value_map_t;
     uniform_value_map_t mValue; //lookup map of uniform location to last known value
+    std::vector<std::pair<GLint, UniformValue*> > mDirtyUniforms; // entries of mValue for flushUniforms() to send
     std::vector<GLint> mTexture;
     S32 mTotalUniformSize;
     S32 mActiveTextureChannels;
@@ -326,6 +363,11 @@ public:
 
 private:
     void unloadInternal();
+
+    // record value for location, to be sent by flushUniforms()
+    void setUniform(GLint location, U32 type, const LLVector4& value);
+    // location was just set directly, forget what it held
+    void uniformSent(GLint location);
 };
 
 //UI shader (declared here so llui_libtest will link properly)
@@ -65,6 +65,10 @@ S32	gGLViewport[4];
 
 U32 LLRender::sUICalls = 0;
 U32 LLRender::sUIVerts = 0;
+U32 LLRender::sStreamedBatches = 0;
+U32 LLRender::sStreamWaits = 0;
+U32 LLRender::sCacheHits = 0;
+U32 LLRender::sCacheMisses = 0;
 U32 LLTexUnit::sWhiteTexture = 0;
 bool LLRender::sGLCoreProfile = false;
 bool LLRender::sNsightDebugSupport = false;
@@ -78,6 +82,148 @@ struct LLVBCache
 
 static std::unordered_map<U64, LLVBCache> sVBCache;
 
+// Ring of vertex storage immediate mode batches are streamed through.
+//
+// Positions, texture coordinates and colors each get an array in one GL
+// buffer, all sized for the same number of vertices, so attribute pointers
+// are set once per bind and every batch is drawn with glDrawArrays from its
+// first vertex.  The ring is split into chunks; a fence goes down when
+// writing moves off a chunk and is waited on before that chunk is written
+// again.  With GL 4.4 the buffer is persistently mapped and batches are
+// copied straight in, otherwise they go in with glBufferSubData.
+class LLVertexArena
+{
+public:
+    static const U32 VERTEX_COUNT = 128 * 1024;
+    static const U32 CHUNK_COUNT = 4;
+    static const U32 CHUNK_VERTICES = VERTEX_COUNT / CHUNK_COUNT;
+
+    LLVertexArena()
+    {
+        glGenBuffers(1, &mBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, mBuffer);
+
+        U32 size = VERTEX_COUNT * VERTEX_SIZE;
+        if (gGLManager.mGLVersion >= 4.39f && glBufferStorage)
+        {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+            mMapped = (U8*) glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+        }
+        else
+        {
+            glBufferData(GL_ARRAY_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        LLVertexBuffer::sGLRenderBuffer = 0;
+    }
+
+    ~LLVertexArena()
+    {
+        if (LLVertexBuffer::sGLRenderBuffer == mBuffer)
+        {
+            LLVertexBuffer::unbind();
+        }
+
+        if (mMapped)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, mBuffer);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &mBuffer);
+    }
+
+    // Copy count vertices in and bind the arena for drawing them with the
+    // current shader.  Returns the index of the first one.
+    U32 append(const LLVector4a* positions, const LLVector2* tex_coords, const LLColor4U* colors, U32 count, U32 attribute_mask)
+    {
+        llassert(count <= CHUNK_VERTICES);
+
+        if (mHead % CHUNK_VERTICES + count > CHUNK_VERTICES)
+        { // move on to the next chunk, once the GPU is done with it
+            U32 chunk = mHead / CHUNK_VERTICES;
+            mFences[chunk].placeFence();
+
+            chunk = (chunk + 1) % CHUNK_COUNT;
+            if (!mFences[chunk].isCompleted())
+            {
+                LL_PROFILE_ZONE_NAMED_CATEGORY_VERTEX("vb stream wait");
+                ++LLRender::sStreamWaits;
+                mFences[chunk].wait();
+            }
+            mHead = chunk * CHUNK_VERTICES;
+        }
+
+        U32 first = mHead;
+        mHead += count;
+
+        bind(attribute_mask);
+
+        write(first * sizeof(LLVector4a), positions, count * sizeof(LLVector4a));
+        if (attribute_mask & LLVertexBuffer::MAP_TEXCOORD0)
+        {
+            write(TEXCOORD_OFFSET + first * sizeof(LLVector2), tex_coords, count * sizeof(LLVector2));
+        }
+        if (attribute_mask & LLVertexBuffer::MAP_COLOR)
+        {
+            write(COLOR_OFFSET + first * sizeof(LLColor4U), colors, count * sizeof(LLColor4U));
+        }
+
+        return first;
+    }
+
+private:
+    static const U32 VERTEX_SIZE = sizeof(LLVector4a) + sizeof(LLVector2) + sizeof(LLColor4U);
+    static const U32 TEXCOORD_OFFSET = VERTEX_COUNT * sizeof(LLVector4a);
+    static const U32 COLOR_OFFSET = TEXCOORD_OFFSET + VERTEX_COUNT * sizeof(LLVector2);
+
+    void write(U32 offset, const void* data, U32 size)
+    {
+        if (mMapped)
+        {
+            memcpy(mMapped + offset, data, size);
+        }
+        else
+        {
+            glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+        }
+    }
+
+    // Point the current shader's attributes at the arena.  Any other
+    // vertex buffer being bound in between moves the pointers away.
+    void bind(U32 attribute_mask)
+    {
+        if (LLVertexBuffer::sGLRenderBuffer != mBuffer)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, mBuffer);
+            LLVertexBuffer::sGLRenderBuffer = mBuffer;
+            mBoundMask = 0;
+        }
+
+        if (mBoundMask != attribute_mask)
+        {
+            glVertexAttribPointer(LLVertexBuffer::TYPE_VERTEX, 3, GL_FLOAT, GL_FALSE, sizeof(LLVector4a), (void*) 0);
+            if (attribute_mask & LLVertexBuffer::MAP_TEXCOORD0)
+            {
+                glVertexAttribPointer(LLVertexBuffer::TYPE_TEXCOORD0, 2, GL_FLOAT, GL_FALSE, sizeof(LLVector2), (void*) (size_t) TEXCOORD_OFFSET);
+            }
+            if (attribute_mask & LLVertexBuffer::MAP_COLOR)
+            {
+                glVertexAttribPointer(LLVertexBuffer::TYPE_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(LLColor4U), (void*) (size_t) COLOR_OFFSET);
+            }
+            mBoundMask = attribute_mask;
+        }
+    }
+
+    U32 mBuffer = 0;
+    U8* mMapped = nullptr;
+    U32 mHead = 0;
+    U32 mBoundMask = 0;
+    LLGLSyncFence mFences[CHUNK_COUNT];
+};
+
 static const GLenum sGLTextureType[] =
 {
 	GL_TEXTURE_2D,
@@ -892,6 +1038,16 @@ bool LLRender::init(bool needs_vertex_buffer)
         glBindVertexArray(ret);
     }
 
+    { //instanced shaders see one identity transform unless a draw binds its own
+        std::vector<F32> identity(LLGLSLShader::MAX_INSTANCES * 12, 0.f);
+        identity[0] = identity[5] = identity[10] = 1.f;
+        glGenBuffers(1, &mIdentityInstances);
+        glBindBuffer(GL_UNIFORM_BUFFER, mIdentityInstances);
+        glBufferData(GL_UNIFORM_BUFFER, identity.size() * sizeof(F32), identity.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        bindInstanceTransforms(0);
+    }
+
     if (needs_vertex_buffer)
     {
         initVertexBuffer();
@@ -908,17 +1064,26 @@ void LLRender::initVertexBuffer()
     mBuffer->getVertexStrider(mVerticesp);
     mBuffer->getTexCoord0Strider(mTexcoordsp);
     mBuffer->getColorStrider(mColorsp);
+    mArena = new LLVertexArena();
     stop_glerror();
 }
 
 void LLRender::resetVertexBuffer()
 {
     mBuffer = NULL;
+    delete mArena;
+    mArena = nullptr;
 }
 
 void LLRender::shutdown()
 {
     resetVertexBuffer();
+
+    if (mIdentityInstances)
+    {
+        glDeleteBuffers(1, &mIdentityInstances);
+        mIdentityInstances = 0;
+    }
 }
 
 void LLRender::refreshState(void)
@@ -941,6 +1106,11 @@ void LLRender::refreshState(void)
 	mDirty = false;
 }
 
+void LLRender::bindInstanceTransforms(U32 buffer)
+{
+    glBindBufferBase(GL_UNIFORM_BUFFER, LLGLSLShader::INSTANCE_BLOCK_BINDING, buffer ? buffer : mIdentityInstances);
+}
+
 void LLRender::syncLightState()
 {
     LLGLSLShader *shader = LLGLSLShader::sCurBoundShaderPtr;
@@ -1133,6 +1303,9 @@ void LLRender::syncMatrices()
 		{ //also sync light state
 			syncLightState();
 		}
+
+		// send everything set since the last draw in one go
+		shader->flushUniforms();
 	}
 }
 
@@ -1629,108 +1802,29 @@ void LLRender::flush()
 
         if (mBuffer)
         {
-
-            HBXXH64 hash;
             U32 attribute_mask = LLGLSLShader::sCurBoundShaderPtr->mAttributeMask;
 
+            U32 mode = mMode;
+            if (mMode == LLRender::QUADS && sGLCoreProfile)
             {
-                LL_PROFILE_ZONE_NAMED_CATEGORY_VERTEX("vb cache hash");
-
-                hash.update((U8*)mVerticesp.get(), count * sizeof(LLVector4a));
-                if (attribute_mask & LLVertexBuffer::MAP_TEXCOORD0)
-                {
-                    hash.update((U8*)mTexcoordsp.get(), count * sizeof(LLVector2));
-                }
-
-                if (attribute_mask & LLVertexBuffer::MAP_COLOR)
-                {
-                    hash.update((U8*)mColorsp.get(), count * sizeof(LLColor4U));
-                }
-
-                hash.finalize();
-            }
-            
-            
-            U64 vhash = hash.digest();
-
-            // check the VB cache before making a new vertex buffer
-            // This is a giant hack to deal with (mostly) our terrible UI rendering code
-            // that was built on top of OpenGL immediate mode.  Huge performance wins
-            // can be had by not uploading geometry to VRAM unless absolutely necessary.
-            // Most of our usage of the "immediate mode" style draw calls is actually
-            // sending the same geometry over and over again.
-            // To leverage this, we maintain a running hash of the vertex stream being
-            // built up before a flush, and then check that hash against a VB 
-            // cache just before creating a vertex buffer in VRAM
-            std::unordered_map<U64, LLVBCache>::iterator cache = sVBCache.find(vhash);
-
-            LLPointer<LLVertexBuffer> vb;
-
-            if (cache != sVBCache.end())
-            {
-                LL_PROFILE_ZONE_NAMED_CATEGORY_VERTEX("vb cache hit");
-                // cache hit, just use the cached buffer
-                vb = cache->second.vb;
-                cache->second.touched = std::chrono::steady_clock::now();
-            }
-            else
-            {
-                LL_PROFILE_ZONE_NAMED_CATEGORY_VERTEX("vb cache miss");
-                vb = new LLVertexBuffer(attribute_mask);
-                vb->allocateBuffer(count, 0);
-
-                vb->setBuffer();
-
-                vb->setPositionData((LLVector4a*) mVerticesp.get());
-
-                if (attribute_mask & LLVertexBuffer::MAP_TEXCOORD0)
-                {
-                    vb->setTexCoordData(mTexcoordsp.get());
-                }
-
-                if (attribute_mask & LLVertexBuffer::MAP_COLOR)
-                {
-                    vb->setColorData(mColorsp.get());
-                }
-
-                vb->unbind();
-
-                sVBCache[vhash] = { vb , std::chrono::steady_clock::now() };
-
-                static U32 miss_count = 0;
-                miss_count++;
-                if (miss_count > 1024)
-                {
-                    LL_PROFILE_ZONE_NAMED_CATEGORY_VERTEX("vb cache clean");
-                    miss_count = 0;
-                    auto now = std::chrono::steady_clock::now();
-
-                    using namespace std::chrono_literals;
-                    // every 1024 misses, clean the cache of any VBs that haven't been touched in the last second
-                    for (std::unordered_map<U64, LLVBCache>::iterator iter = sVBCache.begin(); iter != sVBCache.end(); )
-                    {
-                        if (now - iter->second.touched > 1s)
-                        {
-                            iter = sVBCache.erase(iter);
-                        }
-                        else
-                        {
-                            ++iter;
-                        }
-                    }
-                }
+                mode = LLRender::TRIANGLES;
+                mQuadCycle = 1;
             }
 
-            vb->setBuffer();
-
-            if (mMode == LLRender::QUADS && sGLCoreProfile)
+            if (mArena && !mStaticGeometry && (attribute_mask & ~immediate_mask) == 0)
             {
-                vb->drawArrays(LLRender::TRIANGLES, 0, count);
-                mQuadCycle = 1;
+                LL_PROFILE_ZONE_NAMED_CATEGORY_VERTEX("vb stream");
+                U32 first = mArena->append((LLVector4a*) mVerticesp.get(), mTexcoordsp.get(), mColorsp.get(), count, attribute_mask);
+                ++sStreamedBatches;
+
+                syncMatrices();
+                glDrawArrays(LLVertexBuffer::sGLMode[mode], first, count);
             }
             else
             {
-                vb->drawArrays(mMode, 0, count);
+                LLPointer<LLVertexBuffer> vb = bufferFromCache(attribute_mask, count);
+                vb->setBuffer();
+                vb->drawArrays(mode, 0, count);
             }
         }
         else
@@ -1748,6 +1842,125 @@ void LLRender::flush()
 	}
 }
 
+LLPointer<LLVertexBuffer> LLRender::bufferFromCache(U32 attribute_mask, U32 count)
+{
+    HBXXH64 hash;
+
+    {
+        LL_PROFILE_ZONE_NAMED_CATEGORY_VERTEX("vb cache hash");
+
+        hash.update((U8*)mVerticesp.get(), count * sizeof(LLVector4a));
+        if (attribute_mask & LLVertexBuffer::MAP_TEXCOORD0)
+        {
+            hash.update((U8*)mTexcoordsp.get(), count * sizeof(LLVector2));
+        }
+
+        if (attribute_mask & LLVertexBuffer::MAP_COLOR)
+        {
+            hash.update((U8*)mColorsp.get(), count * sizeof(LLColor4U));
+        }
+
+        hash.finalize();
+    }
+
+    U64 vhash = hash.digest();
+
+    // check the VB cache before making a new vertex buffer
+    // This is a giant hack to deal with (mostly) our terrible UI rendering code
+    // that was built on top of OpenGL immediate mode.  Huge performance wins
+    // can be had by not uploading geometry to VRAM unless absolutely necessary.
+    // Callers mark the "immediate mode" style draw calls that send the same
+    // geometry over and over again as static.
+    // For those, we maintain a running hash of the vertex stream being
+    // built up before a flush, and then check that hash against a VB 
+    // cache just before creating a vertex buffer in VRAM
+    std::unordered_map<U64, LLVBCache>::iterator cache = sVBCache.find(vhash);
+
+    LLPointer<LLVertexBuffer> vb;
+
+    if (cache != sVBCache.end())
+    {
+        LL_PROFILE_ZONE_NAMED_CATEGORY_VERTEX("vb cache hit");
+        ++sCacheHits;
+        // cache hit, just use the cached buffer
+        vb = cache->second.vb;
+        cache->second.touched = std::chrono::steady_clock::now();
+    }
+    else
+    {
+        LL_PROFILE_ZONE_NAMED_CATEGORY_VERTEX("vb cache miss");
+        ++sCacheMisses;
+        vb = new LLVertexBuffer(attribute_mask);
+        vb->allocateBuffer(count, 0);
+
+        vb->setBuffer();
+
+        vb->setPositionData((LLVector4a*) mVerticesp.get());
+
+        if (attribute_mask & LLVertexBuffer::MAP_TEXCOORD0)
+        {
+            vb->setTexCoordData(mTexcoordsp.get());
+        }
+
+        if (attribute_mask & LLVertexBuffer::MAP_COLOR)
+        {
+            vb->setColorData(mColorsp.get());
+        }
+
+        vb->unbind();
+
+        sVBCache[vhash] = { vb , std::chrono::steady_clock::now() };
+
+        static U32 miss_count = 0;
+        miss_count++;
+        if (miss_count > 1024)
+        {
+            LL_PROFILE_ZONE_NAMED_CATEGORY_VERTEX("vb cache clean");
+            miss_count = 0;
+            auto now = std::chrono::steady_clock::now();
+
+            using namespace std::chrono_literals;
+            // every 1024 misses, clean the cache of any VBs that haven't been touched in the last second
+            for (std::unordered_map<U64, LLVBCache>::iterator iter = sVBCache.begin(); iter != sVBCache.end(); )
+            {
+                if (now - iter->second.touched > 1s)
+                {
+                    iter = sVBCache.erase(iter);
+                }
+                else
+                {
+                    ++iter;
+                }
+            }
+        }
+    }
+
+    return vb;
+}
+
+void LLRender::beginStaticGeometry()
+{
+    flush();
+    ++mStaticGeometry;
+}
+
+void LLRender::endStaticGeometry()
+{
+    llassert(mStaticGeometry > 0);
+    flush();
+    --mStaticGeometry;
+}
+
+LLStaticGeometryScope::LLStaticGeometryScope()
+{
+    gGL.beginStaticGeometry();
+}
+
+LLStaticGeometryScope::~LLStaticGeometryScope()
+{
+    gGL.endStaticGeometry();
+}
+
 void LLRender::vertex3f(const GLfloat& x, const GLfloat& y, const GLfloat& z)
 { 
 	//the range of mVerticesp, mColorsp and mTexcoordsp is [0, 4095]
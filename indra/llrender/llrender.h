@@ -47,6 +47,7 @@
 #include <array>
 
 class LLVertexBuffer;
+class LLVertexArena;
 class LLCubeMap;
 class LLImageGL;
 class LLRenderTarget;
@@ -403,6 +404,11 @@ public:
 	void syncMatrices();
 	void syncLightState();
 
+	// Bind the uniform buffer instanced shaders read instance transforms
+	// from, or with 0 the one holding a single identity transform that
+	// non-instanced draws with those shaders rely on.
+	void bindInstanceTransforms(U32 buffer);
+
 	void translateUI(F32 x, F32 y, F32 z);
 	void scaleUI(F32 x, F32 y, F32 z);
 	void pushUIMatrix();
@@ -413,6 +419,13 @@ public:
 
 	void flush();
 
+	// Immediate mode geometry drawn between these is expected to be drawn
+	// again unchanged in later frames, and is kept in vertex buffers looked
+	// up by a hash of its contents.  Everything else is streamed through a
+	// per frame vertex arena.  Calls nest.
+	void beginStaticGeometry();
+	void endStaticGeometry();
+
 	void begin(const GLuint& mode);
 	void end();
 	void vertex2i(const GLint& x, const GLint& y);
@@ -476,6 +489,13 @@ public:
 public:
 	static U32 sUICalls;
 	static U32 sUIVerts;
+	// immediate mode batches streamed through the arena, and how often the
+	// arena had to wait on the GPU to reuse memory
+	static U32 sStreamedBatches;
+	static U32 sStreamWaits;
+	// static geometry batches found in and missing from the buffer cache
+	static U32 sCacheHits;
+	static U32 sCacheMisses;
 	static bool sGLCoreProfile;
 	static bool sNsightDebugSupport;
 	static LLVector2 sUIGLScaleFactor;
@@ -499,6 +519,9 @@ private:
 	bool				mCurrColorMask[4];
 
 	LLPointer<LLVertexBuffer>	mBuffer;
+	LLVertexArena*				mArena = nullptr;
+	U32							mStaticGeometry = 0;
+	U32							mIdentityInstances = 0;
 	LLStrider<LLVector3>		mVerticesp;
 	LLStrider<LLVector2>		mTexcoordsp;
 	LLStrider<LLColor4U>		mColorsp;
@@ -514,6 +537,17 @@ private:
 	std::vector<LLVector3> mUIOffset;
 	std::vector<LLVector3> mUIScale;
 
+	// vertex buffer holding the first count vertices of the current batch,
+	// from the cache of static geometry
+	LLPointer<LLVertexBuffer> bufferFromCache(U32 attribute_mask, U32 count);
+};
+
+// Scope of static immediate mode geometry, see LLRender::beginStaticGeometry
+class LLStaticGeometryScope
+{
+public:
+	LLStaticGeometryScope();
+	~LLStaticGeometryScope();
 };
 
 extern F32 gGLModelView[16];
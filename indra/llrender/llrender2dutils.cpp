@@ -348,6 +348,9 @@ void gl_draw_scaled_image_with_border(S32 x, S32 y, S32 width, S32 height, LLTex
 		return;
 	}
 
+	// UI panels and widgets, the same quads from frame to frame
+	LLStaticGeometryScope static_geometry;
+
 	if (solid_color)
 	{
 		gSolidColorProgram.bind();
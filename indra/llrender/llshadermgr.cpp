@@ -174,6 +174,14 @@ BOOL LLShaderMgr::attachShaderFeatures(LLGLSLShader * shader)
 		}
 	}
 
+    if (features->hasInstancing)
+    {
+        if (!shader->attachVertexObject("objects/instanceV.glsl"))
+        {
+            return FALSE;
+        }
+    }
+
     if (!shader->attachVertexObject("deferred/textureUtilV.glsl"))
     {
         return FALSE;
@@ -288,229 +288,529 @@ static GLuint gen_buffer()
     return ret;
 }
 
-#define ANALYZE_VBO_POOL 0
-
-class LLVBOPool
+// Suballocates vertex or index buffers out of a few large GL buffers ("slabs")
+// so buffers no longer each need their own GL name.
+//
+// Free ranges are kept in two level segregated fit (TLSF) lists: the first
+// level is the power of two of the range size, the second splits each power
+// of two into SL_COUNT linear classes.  Allocating and freeing are constant
+// time, and a freed range is merged with free neighbors right away so slabs
+// don't break up into slivers nothing fits in.
+class LLVBOSlabAllocator
 {
 public:
     typedef std::chrono::steady_clock::time_point Time;
 
-    struct Entry
+    static constexpr U32 GRANULE = 64;  // size and alignment of every range in bytes
+    static constexpr U32 SL_BITS = 3;
+    static constexpr U32 SL_COUNT = 1 << SL_BITS;
+    static constexpr U32 FL_COUNT = 32;
+
+    struct Slab
     {
-        U8* mData;
         GLuint mGLName;
-        Time mAge;
+        U32 mSize;
+        U32 mUsed;          // bytes in allocated ranges
+        Time mEmptySince;   // when mUsed last dropped to zero
+    };
+
+    struct Block
+    {
+        Slab* mSlab;
+        U32 mOffset;
+        U32 mSize;
+        bool mFree;
+        Block* mPrev;       // neighbors in the slab, by offset
+        Block* mNext;
+        Block* mPrevFree;   // neighbors in the free list, only valid if mFree
+        Block* mNextFree;
     };
 
-    ~LLVBOPool()
+    LLVBOSlabAllocator(GLenum type, U32 slab_size)
+    :   mType(type),
+        mSlabSize(slab_size)
+    {
+        memset(mSLBitmap, 0, sizeof(mSLBitmap));
+        memset(mFreeLists, 0, sizeof(mFreeLists));
+    }
+
+    ~LLVBOSlabAllocator()
     {
         clear();
     }
 
-    typedef std::unordered_map<U32, std::list<Entry>> Pool;
+    // find a range of at least size bytes, making a new slab if none fits
+    void allocate(U32 size, GLuint& name, U32& offset)
+    {
+        size = (size + GRANULE - 1) & ~(GRANULE - 1);
 
-    Pool mVBOPool;
-    Pool mIBOPool;
+        Block* block = findFree(size);
+        if (!block)
+        {
+            LL_PROFILE_ZONE_NAMED_CATEGORY_VERTEX("vbo slab alloc");
+            block = newSlab(llmax(size, mSlabSize));
+        }
 
-    U32 mTouchCount = 0;
+        removeFree(block);
+
+        if (block->mSize - size >= GRANULE)
+        { // return the tail to the free lists
+            Block* rest = newBlock();
+            rest->mSlab = block->mSlab;
+            rest->mOffset = block->mOffset + size;
+            rest->mSize = block->mSize - size;
+            rest->mPrev = block;
+            rest->mNext = block->mNext;
+            if (rest->mNext)
+            {
+                rest->mNext->mPrev = rest;
+            }
+            block->mNext = rest;
+            block->mSize = size;
+            insertFree(rest);
+        }
 
-    U64 mDistributed = 0;
-    U64 mAllocated = 0;
-    U64 mReserved = 0;
-    U32 mMisses = 0;
-    U32 mHits = 0;
+        block->mFree = false;
+        block->mSlab->mUsed += block->mSize;
+        mUsed += block->mSize;
 
-    U64 getVramBytesUsed()
-    {
-        return mAllocated + mReserved;
+        name = block->mSlab->mGLName;
+        offset = block->mOffset;
+        mAllocated[key(name, offset)] = block;
     }
 
-    // increase the size to some common value (e.g. a power of two) to increase hit rate
-    void adjustSize(U32& size)
+    void free(GLuint name, U32 offset)
     {
-        // size = nhpo2(size);  // (193/303)/580 MB (distributed/allocated)/reserved in VBO Pool. Overhead: 66 percent. Hit rate: 77 percent
+        auto iter = mAllocated.find(key(name, offset));
+        llassert(iter != mAllocated.end()); // freeing a range that was never allocated
+        if (iter == mAllocated.end())
+        {
+            return;
+        }
 
-        //(245/276)/385 MB (distributed/allocated)/reserved in VBO Pool. Overhead: 57 percent. Hit rate: 69 percent
-        //(187/209)/397 MB (distributed/allocated)/reserved in VBO Pool. Overhead: 112 percent. Hit rate: 76 percent
-        U32 block_size = llmax(nhpo2(size) / 8, (U32) 16);
-        size += block_size - (size % block_size);
-    }
+        Block* block = iter->second;
+        mAllocated.erase(iter);
 
-    void allocate(GLenum type, U32 size, GLuint& name, U8*& data)
-    {
-        LL_PROFILE_ZONE_SCOPED_CATEGORY_VERTEX;
-        llassert(type == GL_ARRAY_BUFFER || type == GL_ELEMENT_ARRAY_BUFFER);
-        llassert(name == 0); // non zero name indicates a gl name that wasn't freed
-        llassert(data == nullptr);  // non null data indicates a buffer that wasn't freed
-        llassert(size >= 2);  // any buffer size smaller than a single index is nonsensical
+        Slab* slab = block->mSlab;
+        llassert(slab->mUsed >= block->mSize);
+        slab->mUsed -= block->mSize;
+        mUsed -= block->mSize;
+        if (slab->mUsed == 0)
+        {
+            slab->mEmptySince = std::chrono::steady_clock::now();
+        }
 
-        mDistributed += size;
-        adjustSize(size);
-        mAllocated += size;
-
-        auto& pool = type == GL_ELEMENT_ARRAY_BUFFER ? mIBOPool : mVBOPool;
-
-        Pool::iterator iter = pool.find(size);
-        if (iter == pool.end())
-        { // cache miss, allocate a new buffer
-            LL_PROFILE_ZONE_NAMED_CATEGORY_VERTEX("vbo pool miss");
-            LL_PROFILE_GPU_ZONE("vbo alloc");
-
-            mMisses++;
-            name = gen_buffer();
-            glBindBuffer(type, name);
-            glBufferData(type, size, nullptr, GL_DYNAMIC_DRAW);
-            if (type == GL_ELEMENT_ARRAY_BUFFER)
+        // merge with free neighbors
+        Block* next = block->mNext;
+        if (next && next->mFree)
+        {
+            removeFree(next);
+            block->mSize += next->mSize;
+            block->mNext = next->mNext;
+            if (block->mNext)
             {
-                LLVertexBuffer::sGLRenderIndices = name;
+                block->mNext->mPrev = block;
             }
-            else
+            mSpareBlocks.push_back(next);
+        }
+
+        Block* prev = block->mPrev;
+        if (prev && prev->mFree)
+        {
+            removeFree(prev);
+            prev->mSize += block->mSize;
+            prev->mNext = block->mNext;
+            if (prev->mNext)
             {
-                LLVertexBuffer::sGLRenderBuffer = name;
+                prev->mNext->mPrev = prev;
             }
-
-            data = (U8*)ll_aligned_malloc_16(size);
+            mSpareBlocks.push_back(block);
+            block = prev;
         }
-        else
+
+        insertFree(block);
+    }
+
+    // delete slabs that have been empty since before cutoff, always keeping one
+    void clean(const Time& cutoff)
+    {
+        for (auto iter = mSlabs.begin(); iter != mSlabs.end() && mSlabs.size() > 1; )
         {
-            mHits++;
-            llassert(mReserved >= size); // assert if accounting gets messed up
-            mReserved -= size;
-
-            std::list<Entry>& entries = iter->second;
-            Entry& entry = entries.back();
-            name = entry.mGLName;
-            data = entry.mData;
-            
-            entries.pop_back();
-            if (entries.empty())
+            Slab* slab = *iter;
+            if (slab->mUsed == 0 && slab->mEmptySince < cutoff)
             {
-                pool.erase(iter);
+                LL_PROFILE_ZONE_NAMED_CATEGORY_VERTEX("vbo slab timeout");
+                // an empty slab is a single free block
+                Block* block = findSlabBlock(slab);
+                llassert(block && block->mFree && block->mSize == slab->mSize);
+                removeFree(block);
+                mSpareBlocks.push_back(block);
+
+                mReserved -= slab->mSize;
+                glDeleteBuffers(1, &slab->mGLName);
+                delete slab;
+                iter = mSlabs.erase(iter);
+            }
+            else
+            {
+                ++iter;
             }
         }
-
-        clean();
     }
 
-    void free(GLenum type, U32 size, GLuint name, U8* data)
+    void clear()
     {
-        LL_PROFILE_ZONE_SCOPED_CATEGORY_VERTEX;
-        llassert(type == GL_ARRAY_BUFFER || type == GL_ELEMENT_ARRAY_BUFFER);
-        llassert(size >= 2);
-        llassert(name != 0);
-        llassert(data != nullptr);
+        for (Slab* slab : mSlabs)
+        {
+            glDeleteBuffers(1, &slab->mGLName);
+            delete slab;
+        }
+        mSlabs.clear();
 
-        clean();
+        for (U32 fl = 0; fl < FL_COUNT; ++fl)
+        {
+            for (U32 sl = 0; sl < SL_COUNT; ++sl)
+            {
+                for (Block* block = mFreeLists[fl][sl]; block; )
+                {
+                    Block* next = block->mNextFree;
+                    delete block;
+                    block = next;
+                }
+                mFreeLists[fl][sl] = nullptr;
+            }
+            mSLBitmap[fl] = 0;
+        }
+        mFLBitmap = 0;
 
-        llassert(mDistributed >= size);
-        mDistributed -= size;
-        adjustSize(size);
-        llassert(mAllocated >= size);
-        mAllocated -= size;
-        mReserved += size;
+        for (auto& entry : mAllocated)
+        {
+            delete entry.second;
+        }
+        mAllocated.clear();
+
+        for (Block* block : mSpareBlocks)
+        {
+            delete block;
+        }
+        mSpareBlocks.clear();
 
-        auto& pool = type == GL_ELEMENT_ARRAY_BUFFER ? mIBOPool : mVBOPool;
+        mReserved = 0;
+        mUsed = 0;
+    }
 
-        Pool::iterator iter = pool.find(size);
+    U64 getReserved() const { return mReserved; }
+    U64 getUsed() const { return mUsed; }
 
-        if (iter == pool.end())
+    // size of the largest free range, found in the highest non empty class
+    U32 getLargestFree() const
+    {
+        if (!mFLBitmap)
         {
-            std::list<Entry> newlist;
-            newlist.push_front({ data, name, std::chrono::steady_clock::now() });
-            pool[size] = newlist;
+            return 0;
         }
-        else
+
+        U32 fl = highest_bit(mFLBitmap);
+        U32 sl = highest_bit(mSLBitmap[fl]);
+        U32 largest = 0;
+        for (Block* block = mFreeLists[fl][sl]; block; block = block->mNextFree)
         {
-            iter->second.push_front({ data, name, std::chrono::steady_clock::now() });
+            largest = llmax(largest, block->mSize);
         }
-
+        return largest;
     }
 
-    // clean periodically (clean gets called for every alloc/free)
-    void clean()
+private:
+    static U32 highest_bit(U32 bits)
     {
-        mTouchCount++;
-        if (mTouchCount < 1024) // clean every 1k touches
+        U32 ret = 0;
+        while (bits >>= 1)
         {
-            return;
+            ++ret;
         }
-        mTouchCount = 0;
+        return ret;
+    }
 
-        LL_PROFILE_ZONE_SCOPED_CATEGORY_VERTEX;
+    static U32 lowest_bit(U32 bits)
+    {
+        U32 ret = 0;
+        while (!(bits & 1))
+        {
+            bits >>= 1;
+            ++ret;
+        }
+        return ret;
+    }
 
-        std::unordered_map<U32, std::list<Entry>>* pools[] = { &mVBOPool, &mIBOPool };
+    static U64 key(GLuint name, U32 offset)
+    {
+        return ((U64) name << 32) | offset;
+    }
 
-        using namespace std::chrono_literals;
+    // class of a range of size bytes, size is at least GRANULE
+    static void mapping(U32 size, U32& fl, U32& sl)
+    {
+        fl = highest_bit(size);
+        sl = (size >> (fl - SL_BITS)) & (SL_COUNT - 1);
+    }
 
-        Time cutoff = std::chrono::steady_clock::now() - 5s;
+    void insertFree(Block* block)
+    {
+        U32 fl, sl;
+        mapping(block->mSize, fl, sl);
 
-        for (auto* pool : pools)
+        block->mFree = true;
+        block->mPrevFree = nullptr;
+        block->mNextFree = mFreeLists[fl][sl];
+        if (block->mNextFree)
         {
-            for (Pool::iterator iter = pool->begin(); iter != pool->end(); )
-            {
-                auto& entries = iter->second;
+            block->mNextFree->mPrevFree = block;
+        }
+        mFreeLists[fl][sl] = block;
 
-                while (!entries.empty() && entries.back().mAge < cutoff)
-                {
-                    LL_PROFILE_ZONE_NAMED_CATEGORY_VERTEX("vbo cache timeout");
-                    auto& entry = entries.back();
-                    ll_aligned_free_16(entry.mData);
-                    glDeleteBuffers(1, &entry.mGLName);
-                    llassert(mReserved >= iter->first);
-                    mReserved -= iter->first;
-                    entries.pop_back();
+        mFLBitmap |= 1 << fl;
+        mSLBitmap[fl] |= 1 << sl;
+    }
 
-                }
+    void removeFree(Block* block)
+    {
+        llassert(block->mFree);
 
-                if (entries.empty())
-                {
-                    iter = pool->erase(iter);
-                }
-                else
+        U32 fl, sl;
+        mapping(block->mSize, fl, sl);
+
+        if (block->mPrevFree)
+        {
+            block->mPrevFree->mNextFree = block->mNextFree;
+        }
+        else
+        {
+            mFreeLists[fl][sl] = block->mNextFree;
+            if (!block->mNextFree)
+            {
+                mSLBitmap[fl] &= ~(1 << sl);
+                if (!mSLBitmap[fl])
                 {
-                    ++iter;
+                    mFLBitmap &= ~(1 << fl);
                 }
             }
         }
 
-#if 0
-        LL_INFOS() << llformat("(%d/%d)/%d MB (distributed/allocated)/total in VBO Pool. Overhead: %d percent. Hit rate: %d percent", 
-            mDistributed / 1000000, 
-            mAllocated / 1000000, 
-            (mAllocated + mReserved) / 1000000, // total bytes
-            ((mAllocated+mReserved-mDistributed)*100)/llmax(mDistributed, (U64) 1), // overhead percent
-            (mHits*100)/llmax(mMisses+mHits, (U32)1)) // hit rate percent
-            << LL_ENDL;
-#endif
+        if (block->mNextFree)
+        {
+            block->mNextFree->mPrevFree = block->mPrevFree;
+        }
+
+        block->mFree = false;
     }
 
-    void clear()
+    // a free block of at least size bytes, or null
+    Block* findFree(U32 size) const
     {
-        for (auto& entries : mIBOPool)
+        // round up to the next class boundary so any block in the class fits
+        U32 fl, sl;
+        mapping(size + (1 << (highest_bit(size) - SL_BITS)) - 1, fl, sl);
+
+        U32 sl_map = fl < FL_COUNT ? mSLBitmap[fl] & (~0U << sl) : 0;
+        if (!sl_map)
         {
-            for (auto& entry : entries.second)
+            U32 fl_map = fl + 1 < FL_COUNT ? mFLBitmap & (~0U << (fl + 1)) : 0;
+            if (!fl_map)
             {
-                ll_aligned_free_16(entry.mData);
-                glDeleteBuffers(1, &entry.mGLName);
+                return nullptr;
             }
+            fl = lowest_bit(fl_map);
+            sl_map = mSLBitmap[fl];
         }
 
-        for (auto& entries : mVBOPool)
+        sl = lowest_bit(sl_map);
+        return mFreeLists[fl][sl];
+    }
+
+    Block* findSlabBlock(Slab* slab) const
+    {
+        U32 fl, sl;
+        mapping(slab->mSize, fl, sl);
+        for (Block* block = mFreeLists[fl][sl]; block; block = block->mNextFree)
         {
-            for (auto& entry : entries.second)
+            if (block->mSlab == slab)
             {
-                ll_aligned_free_16(entry.mData);
-                glDeleteBuffers(1, &entry.mGLName);
+                return block;
             }
         }
+        return nullptr;
+    }
 
-        mReserved = 0;
+    // new slab of size bytes, returned as one free block
+    Block* newSlab(U32 size)
+    {
+        LL_PROFILE_GPU_ZONE("vbo alloc");
+
+        Slab* slab = new Slab;
+        slab->mGLName = gen_buffer();
+        slab->mSize = size;
+        slab->mUsed = 0;
+        slab->mEmptySince = std::chrono::steady_clock::now();
+        mSlabs.push_back(slab);
+        mReserved += size;
 
-        mIBOPool.clear();
-        mVBOPool.clear();
+        glBindBuffer(mType, slab->mGLName);
+        glBufferData(mType, size, nullptr, GL_DYNAMIC_DRAW);
+        if (mType == GL_ELEMENT_ARRAY_BUFFER)
+        {
+            LLVertexBuffer::sGLRenderIndices = slab->mGLName;
+        }
+        else
+        {
+            LLVertexBuffer::sGLRenderBuffer = slab->mGLName;
+            LLVertexBuffer::sGLRenderOffset = U32_MAX;
+        }
+
+        Block* block = newBlock();
+        block->mSlab = slab;
+        block->mOffset = 0;
+        block->mSize = size;
+        block->mPrev = nullptr;
+        block->mNext = nullptr;
+        insertFree(block);
+        return block;
+    }
+
+    Block* newBlock()
+    {
+        if (mSpareBlocks.empty())
+        {
+            return new Block;
+        }
+
+        Block* block = mSpareBlocks.back();
+        mSpareBlocks.pop_back();
+        return block;
     }
 
+    GLenum mType;
+    U32 mSlabSize;
+
+    U32 mFLBitmap = 0;
+    U32 mSLBitmap[FL_COUNT];
+    Block* mFreeLists[FL_COUNT][SL_COUNT];
 
+    std::vector<Slab*> mSlabs;
+    std::unordered_map<U64, Block*> mAllocated;    // allocated blocks by key(name, offset)
+    std::vector<Block*> mSpareBlocks;              // recycled Block structs
+
+    U64 mReserved = 0;  // bytes in slabs
+    U64 mUsed = 0;      // bytes in allocated ranges
+};
+
+class LLVBOPool
+{
+public:
+    typedef std::chrono::steady_clock::time_point Time;
+
+    // vertex buffers run up to 64k vertices of several attributes, index
+    // buffers are mostly much smaller
+    static constexpr U32 VBO_SLAB_SIZE = 16 * 1024 * 1024;
+    static constexpr U32 IBO_SLAB_SIZE = 4 * 1024 * 1024;
+
+    LLVBOPool()
+    :   mVBOSlabs(GL_ARRAY_BUFFER, VBO_SLAB_SIZE),
+        mIBOSlabs(GL_ELEMENT_ARRAY_BUFFER, IBO_SLAB_SIZE)
+    {
+    }
+
+    LLVBOSlabAllocator mVBOSlabs;
+    LLVBOSlabAllocator mIBOSlabs;
+
+    U32 mTouchCount = 0;
+
+    U64 mDistributed = 0;
+
+    U64 getVramBytesUsed()
+    {
+        return mVBOSlabs.getReserved() + mIBOSlabs.getReserved();
+    }
+
+    void allocate(GLenum type, U32 size, GLuint& name, U32& offset, U8*& data)
+    {
+        LL_PROFILE_ZONE_SCOPED_CATEGORY_VERTEX;
+        llassert(type == GL_ARRAY_BUFFER || type == GL_ELEMENT_ARRAY_BUFFER);
+        llassert(name == 0); // non zero name indicates a gl name that wasn't freed
+        llassert(data == nullptr);  // non null data indicates a buffer that wasn't freed
+        llassert(size >= 2);  // any buffer size smaller than a single index is nonsensical
+
+        mDistributed += size;
+
+        auto& slabs = type == GL_ELEMENT_ARRAY_BUFFER ? mIBOSlabs : mVBOSlabs;
+        slabs.allocate(size, name, offset);
+
+        data = (U8*)ll_aligned_malloc_16(size);
+
+        clean();
+    }
+
+    void free(GLenum type, U32 size, GLuint name, U32 offset, U8* data)
+    {
+        LL_PROFILE_ZONE_SCOPED_CATEGORY_VERTEX;
+        llassert(type == GL_ARRAY_BUFFER || type == GL_ELEMENT_ARRAY_BUFFER);
+        llassert(size >= 2);
+        llassert(name != 0);
+        llassert(data != nullptr);
+
+        llassert(mDistributed >= size);
+        mDistributed -= size;
+
+        auto& slabs = type == GL_ELEMENT_ARRAY_BUFFER ? mIBOSlabs : mVBOSlabs;
+        slabs.free(name, offset);
+
+        ll_aligned_free_16(data);
+
+        clean();
+    }
+
+    // clean periodically (clean gets called for every alloc/free)
+    void clean()
+    {
+        sample();
+
+        mTouchCount++;
+        if (mTouchCount < 1024) // clean every 1k touches
+        {
+            return;
+        }
+        mTouchCount = 0;
+
+        LL_PROFILE_ZONE_SCOPED_CATEGORY_VERTEX;
+
+        using namespace std::chrono_literals;
+
+        Time cutoff = std::chrono::steady_clock::now() - 5s;
+
+        mVBOSlabs.clean(cutoff);
+        mIBOSlabs.clean(cutoff);
+
+#if 0
+        LL_INFOS() << llformat("(%d/%d)/%d MB (distributed/allocated)/total in VBO Pool. Overhead: %d percent.",
+            mDistributed / 1000000,
+            (mVBOSlabs.getUsed() + mIBOSlabs.getUsed()) / 1000000,
+            getVramBytesUsed() / 1000000, // total bytes
+            ((getVramBytesUsed() - mDistributed)*100)/llmax(mDistributed, (U64) 1)) // overhead percent
+            << LL_ENDL;
+#endif
+    }
+
+    // utilization is requested bytes over slab bytes, fragmentation is the
+    // share of free bytes outside the largest free range
+    void sample()
+    {
+        U64 reserved = getVramBytesUsed();
+        U64 free_bytes = reserved - mVBOSlabs.getUsed() - mIBOSlabs.getUsed();
+        U64 largest = llmax(mVBOSlabs.getLargestFree(), mIBOSlabs.getLargestFree());
+
+        LLTrace::sample(LLVertexBuffer::sVBOPoolUsed, F64Bytes((F64) mDistributed));
+        LLTrace::sample(LLVertexBuffer::sVBOPoolUtilization, reserved ? (F64) mDistributed / reserved : 1.0);
+        LLTrace::sample(LLVertexBuffer::sVBOPoolFragmentation, free_bytes ? 1.0 - (F64) largest / free_bytes : 0.0);
+    }
 };
 
 static LLVBOPool* sVBOPool = nullptr;
@@ -521,11 +821,16 @@ U64 LLVertexBuffer::getBytesAllocated()
     return sVBOPool ? sVBOPool->getVramBytesUsed() : 0;
 }
 
+LLTrace::SampleStatHandle<F64Megabytes> LLVertexBuffer::sVBOPoolUsed("vbo_pool_used", "Vertex and index bytes requested by live vertex buffers");
+LLTrace::SampleStatHandle<F64> LLVertexBuffer::sVBOPoolUtilization("vbo_pool_utilization", "Requested bytes over bytes reserved in VBO slabs");
+LLTrace::SampleStatHandle<F64> LLVertexBuffer::sVBOPoolFragmentation("vbo_pool_fragmentation", "Share of free VBO slab bytes outside the largest free range");
+
 //============================================================================
 // 
 //static
 U32 LLVertexBuffer::sGLRenderBuffer = 0;
 U32 LLVertexBuffer::sGLRenderIndices = 0;
+U32 LLVertexBuffer::sGLRenderOffset = 0;
 U32 LLVertexBuffer::sLastMask = 0;
 U32 LLVertexBuffer::sVertexCount = 0;
 
@@ -742,7 +1047,40 @@ void LLVertexBuffer::drawRange(U32 mode, U32 start, U32 end, U32 count, U32 indi
     llassert(mGLIndices == sGLRenderIndices);
     gGL.syncMatrices();
     glDrawRangeElements(sGLMode[mode], start, end, count, GL_UNSIGNED_SHORT,
-        (GLvoid*) (indices_offset * sizeof(U16)));
+        (GLvoid*) (mIndexOffset + indices_offset * sizeof(U16)));
+}
+
+void LLVertexBuffer::drawMulti(U32 mode, const U32* counts, const U32* indices_offsets, U32 draw_count) const
+{
+    llassert(mGLBuffer == sGLRenderBuffer);
+    llassert(mGLIndices == sGLRenderIndices);
+    gGL.syncMatrices();
+
+    const U32 MAX_DRAWS = 64;
+    GLsizei gl_counts[MAX_DRAWS];
+    const GLvoid* gl_offsets[MAX_DRAWS];
+
+    for (U32 i = 0; i < draw_count; i += MAX_DRAWS)
+    {
+        U32 n = llmin(draw_count - i, MAX_DRAWS);
+        for (U32 j = 0; j < n; ++j)
+        {
+            llassert(validateRange(0, mNumVerts - 1, counts[i + j], indices_offsets[i + j]));
+            gl_counts[j] = (GLsizei) counts[i + j];
+            gl_offsets[j] = (const GLvoid*) (mIndexOffset + indices_offsets[i + j] * sizeof(U16));
+        }
+        glMultiDrawElements(sGLMode[mode], gl_counts, GL_UNSIGNED_SHORT, gl_offsets, n);
+    }
+}
+
+void LLVertexBuffer::drawInstanced(U32 mode, U32 count, U32 indices_offset, U32 instance_count) const
+{
+    llassert(validateRange(0, mNumVerts - 1, count, indices_offset));
+    llassert(mGLBuffer == sGLRenderBuffer);
+    llassert(mGLIndices == sGLRenderIndices);
+    gGL.syncMatrices();
+    glDrawElementsInstanced(sGLMode[mode], count, GL_UNSIGNED_SHORT,
+        (GLvoid*) (mIndexOffset + indices_offset * sizeof(U16)), instance_count);
 }
 
 void LLVertexBuffer::draw(U32 mode, U32 count, U32 indices_offset) const
@@ -893,7 +1231,7 @@ void LLVertexBuffer::genBuffer(U32 size)
         llassert(mMappedData == nullptr);
 
         mSize = size;
-        sVBOPool->allocate(GL_ARRAY_BUFFER, mSize, mGLBuffer, mMappedData);
+        sVBOPool->allocate(GL_ARRAY_BUFFER, mSize, mGLBuffer, mVertexOffset, mMappedData);
     }
 }
 
@@ -908,7 +1246,7 @@ void LLVertexBuffer::genIndices(U32 size)
         llassert(mGLIndices == 0);
         llassert(mMappedIndexData == nullptr);
         mIndicesSize = size;
-        sVBOPool->allocate(GL_ELEMENT_ARRAY_BUFFER, mIndicesSize, mGLIndices, mMappedIndexData);
+        sVBOPool->allocate(GL_ELEMENT_ARRAY_BUFFER, mIndicesSize, mGLIndices, mIndexOffset, mMappedIndexData);
     }
 }
 
@@ -966,11 +1304,17 @@ void LLVertexBuffer::destroyGLBuffer()
         //llassert(sVBOPool);
         if (sVBOPool)
         {
-            sVBOPool->free(GL_ARRAY_BUFFER, mSize, mGLBuffer, mMappedData);
+            sVBOPool->free(GL_ARRAY_BUFFER, mSize, mGLBuffer, mVertexOffset, mMappedData);
+        }
+
+        if (sGLRenderBuffer == mGLBuffer && sGLRenderOffset == mVertexOffset)
+        { // the next buffer allocated here must set up its attribute pointers again
+            sGLRenderBuffer = 0;
         }
 
         mSize = 0;
         mGLBuffer = 0;
+        mVertexOffset = 0;
         mMappedData = nullptr;
 	}
 }
@@ -983,11 +1327,12 @@ void LLVertexBuffer::destroyGLIndices()
         //llassert(sVBOPool);
         if (sVBOPool)
         {
-            sVBOPool->free(GL_ELEMENT_ARRAY_BUFFER, mIndicesSize, mGLIndices, mMappedIndexData);
+            sVBOPool->free(GL_ELEMENT_ARRAY_BUFFER, mIndicesSize, mGLIndices, mIndexOffset, mMappedIndexData);
         }
 
         mIndicesSize = 0;
         mGLIndices = 0;
+        mIndexOffset = 0;
         mMappedIndexData = nullptr;
 	}
 }
@@ -1080,6 +1425,11 @@ U8* LLVertexBuffer::mapVertexBuffer(LLVertexBuffer::AttributeType type, U32 inde
         count = mNumVerts - index;
     }
 
+    if (mMappedAll)
+    {
+        return mMappedData+mOffsets[type]+sTypeSize[type]*index;
+    }
+
     U32 start = mOffsets[type] + sTypeSize[type] * index;
     U32 end = start + sTypeSize[type] * count-1;
 
@@ -1114,6 +1464,11 @@ U8* LLVertexBuffer::mapIndexBuffer(U32 index, S32 count)
 		count = mNumIndices-index;
 	}
 
+    if (mMappedAll)
+    {
+        return mMappedIndexData + sizeof(U16)*index;
+    }
+
     U32 start = sizeof(U16) * index;
     U32 end = start + sizeof(U16) * count-1;
 
@@ -1138,6 +1493,24 @@ U8* LLVertexBuffer::mapIndexBuffer(U32 index, S32 count)
     return mMappedIndexData + sizeof(U16)*index;
 }
 
+void LLVertexBuffer::mapAll()
+{
+    mMappedVertexRegions.clear();
+    mMappedIndexRegions.clear();
+
+    if (mSize > 0)
+    {
+        mMappedVertexRegions.push_back({ 0, mSize - 1 });
+    }
+
+    if (mIndicesSize > 0)
+    {
+        mMappedIndexRegions.push_back({ 0, mIndicesSize - 1 });
+    }
+
+    mMappedAll = true;
+}
+
 // flush the given byte range
 //  target -- "targret" parameter for glBufferSubData
 //  start -- first byte to copy
@@ -1182,6 +1555,8 @@ void LLVertexBuffer::unmapBuffer()
         {
             glBindBuffer(GL_ARRAY_BUFFER, mGLBuffer);
             sGLRenderBuffer = mGLBuffer;
+            // attribute pointers still refer to the previous slab
+            sGLRenderOffset = U32_MAX;
         }
             
         U32 start = 0;
@@ -1198,13 +1573,13 @@ void LLVertexBuffer::unmapBuffer()
             }
             else
             {
-                flush_vbo(GL_ARRAY_BUFFER, start, end, (U8*)mMappedData + start);
+                flush_vbo(GL_ARRAY_BUFFER, mVertexOffset + start, mVertexOffset + end, (U8*)mMappedData + start);
                 start = region.mStart;
                 end = region.mEnd;
             }
 		}
 
-        flush_vbo(GL_ARRAY_BUFFER, start, end, (U8*)mMappedData + start);
+        flush_vbo(GL_ARRAY_BUFFER, mVertexOffset + start, mVertexOffset + end, (U8*)mMappedData + start);
 
 		mMappedVertexRegions.clear();
 	}
@@ -1232,16 +1607,18 @@ void LLVertexBuffer::unmapBuffer()
             }
             else
             {
-                flush_vbo(GL_ELEMENT_ARRAY_BUFFER, start, end, (U8*)mMappedIndexData + start);
+                flush_vbo(GL_ELEMENT_ARRAY_BUFFER, mIndexOffset + start, mIndexOffset + end, (U8*)mMappedIndexData + start);
                 start = region.mStart;
                 end = region.mEnd;
             }
         }
 
-        flush_vbo(GL_ELEMENT_ARRAY_BUFFER, start, end, (U8*)mMappedIndexData + start);
+        flush_vbo(GL_ELEMENT_ARRAY_BUFFER, mIndexOffset + start, mIndexOffset + end, (U8*)mMappedIndexData + start);
 
 		mMappedIndexRegions.clear();
 	}
+
+    mMappedAll = false;
 }
 
 //----------------------------------------------------------------------------
@@ -1377,8 +1754,8 @@ void LLVertexBuffer::setBuffer()
 
         setupVertexBuffer();
     }
-    else if (sLastMask != data_mask)
-    {
+    else if (sGLRenderOffset != mVertexOffset || sLastMask != data_mask)
+    { // same slab, but another buffer in it or another shader
         setupVertexBuffer();
         sLastMask = data_mask;
     }
@@ -1394,7 +1771,8 @@ void LLVertexBuffer::setBuffer()
 // virtual (default)
 void LLVertexBuffer::setupVertexBuffer()
 {
-    U8* base = nullptr;
+    U8* base = (U8*) nullptr + mVertexOffset;
+    sGLRenderOffset = mVertexOffset;
 
     U32 data_mask = LLGLSLShader::sCurBoundShaderPtr->mAttributeMask;
 
@@ -1488,19 +1866,21 @@ void LLVertexBuffer::setupVertexBuffer()
 void LLVertexBuffer::setPositionData(const LLVector4a* data)
 {
     llassert(sGLRenderBuffer == mGLBuffer);
-    flush_vbo(GL_ARRAY_BUFFER, 0, sizeof(LLVector4a) * getNumVerts()-1, (U8*) data);
+    flush_vbo(GL_ARRAY_BUFFER, mVertexOffset, mVertexOffset + sizeof(LLVector4a) * getNumVerts() - 1, (U8*) data);
 }
 
 void LLVertexBuffer::setTexCoordData(const LLVector2* data)
 {
     llassert(sGLRenderBuffer == mGLBuffer);
-    flush_vbo(GL_ARRAY_BUFFER, mOffsets[TYPE_TEXCOORD0], mOffsets[TYPE_TEXCOORD0] + sTypeSize[TYPE_TEXCOORD0] * getNumVerts() - 1, (U8*)data);
+    U32 start = mVertexOffset + mOffsets[TYPE_TEXCOORD0];
+    flush_vbo(GL_ARRAY_BUFFER, start, start + sTypeSize[TYPE_TEXCOORD0] * getNumVerts() - 1, (U8*)data);
 }
 
 void LLVertexBuffer::setColorData(const LLColor4U* data)
 {
     llassert(sGLRenderBuffer == mGLBuffer);
-    flush_vbo(GL_ARRAY_BUFFER, mOffsets[TYPE_COLOR], mOffsets[TYPE_COLOR] + sTypeSize[TYPE_COLOR] * getNumVerts() - 1, (U8*) data);
+    U32 start = mVertexOffset + mOffsets[TYPE_COLOR];
+    flush_vbo(GL_ARRAY_BUFFER, start, start + sTypeSize[TYPE_COLOR] * getNumVerts() - 1, (U8*) data);
 }
 
 
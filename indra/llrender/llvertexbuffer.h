@@ -159,6 +159,12 @@ public:
 	U8*		mapIndexBuffer(U32 index, S32 count = -1);
     void	unmapBuffer();
 
+    // Flag the whole buffer as written so the next unmapBuffer() sends all
+    // of it to GL.  Until then mapping doesn't track regions, so several
+    // threads may fill disjoint ranges through the getXXXStrider calls at
+    // once.  unmapBuffer() itself must still happen on the GL thread.
+    void	mapAll();
+
 	// set for rendering
     // assumes (and will assert on) the following:
     //      - this buffer has no pending unampBuffer call
@@ -213,6 +219,10 @@ public:
 	void draw(U32 mode, U32 count, U32 indices_offset) const;
 	void drawArrays(U32 mode, U32 offset, U32 count) const;
     void drawRange(U32 mode, U32 start, U32 end, U32 count, U32 indices_offset) const;
+    // one glMultiDrawElements call over draw_count index ranges of this buffer
+    void drawMulti(U32 mode, const U32* counts, const U32* indices_offsets, U32 draw_count) const;
+    // draw count indices instance_count times, see LLRender::bindInstanceTransforms
+    void drawInstanced(U32 mode, U32 count, U32 indices_offset, U32 instance_count) const;
 
 	//for debugging, validate data in given range is valid
 	bool validateRange(U32 start, U32 end, U32 count, U32 offset) const;
@@ -223,8 +233,10 @@ public:
 	
 
 protected:	
-    U32		mGLBuffer = 0;		// GL VBO handle
-    U32		mGLIndices = 0;		// GL IBO handle
+    U32		mGLBuffer = 0;		// GL VBO handle, shared with other buffers in the same slab
+    U32		mGLIndices = 0;		// GL IBO handle, shared with other buffers in the same slab
+    U32		mVertexOffset = 0;	// byte offset of this buffer's vertex data in mGLBuffer
+    U32		mIndexOffset = 0;	// byte offset of this buffer's indices in mGLIndices
     U32		mNumVerts = 0;		// Number of vertices allocated
     U32		mNumIndices = 0;	// Number of indices allocated
     U32		mOffsets[TYPE_MAX]; // byte offsets into mMappedData of each attribute
@@ -239,6 +251,7 @@ protected:
 
 	std::vector<MappedRegion> mMappedVertexRegions;  // list of mMappedData byte ranges that must be sent to GL
 	std::vector<MappedRegion> mMappedIndexRegions;   // list of mMappedIndexData byte ranges that must be sent to GL
+	bool	mMappedAll = false;  // mapAll() was called, regions already cover the whole buffer
 
 private:
     // DEPRECATED
@@ -258,10 +271,17 @@ private:
 public:
 
     static U64 getBytesAllocated();
+
+    // VBO pool slab usage, sampled whenever a buffer is allocated or freed
+    static LLTrace::SampleStatHandle<F64Megabytes> sVBOPoolUsed;   // bytes requested by live buffers
+    static LLTrace::SampleStatHandle<F64> sVBOPoolUtilization;     // requested bytes over slab bytes
+    static LLTrace::SampleStatHandle<F64> sVBOPoolFragmentation;   // share of free bytes outside the largest free range
+
 	static const U32 sTypeSize[TYPE_MAX];
 	static const U32 sGLMode[LLRender::NUM_MODES];
 	static U32 sGLRenderBuffer;
 	static U32 sGLRenderIndices;
+	static U32 sGLRenderOffset;  // mVertexOffset of the buffer the attribute pointers were last set up for
 	static U32 sLastMask;
 	static U32 sVertexCount;
 };
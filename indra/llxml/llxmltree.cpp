@@ -35,6 +35,7 @@
 #include "v4math.h"
 #include "llquaternion.h"
 #include "lluuid.h"
+#include "llfile.h"
 
 //////////////////////////////////////////////////////////////
 // LLXmlTree
@@ -44,7 +45,8 @@ LLStdStringTable LLXmlTree::sAttributeKeys(1024);
 
 LLXmlTree::LLXmlTree()
 	: mRoot( NULL ),
-	  mNodeNames(512)
+	  mNodeNames(512),
+	  mReadFromCache(FALSE)
 {
 }
 
@@ -96,6 +98,255 @@ void LLXmlTree::dumpNode( LLXmlTreeNode* node, const std::string& prefix )
 	}
 }
 
+//////////////////////////////////////////////////////////////
+// Binary cache of parsed trees
+//
+// A header, then the nodes depth first: name, contents, the number of
+// attributes followed by their keys and values, and the number of children.
+// Strings are a U32 length followed by the characters.  Numbers are in host
+// byte order, the cache is only ever read where it was written.
+
+namespace
+{
+	const char XML_TREE_CACHE_MAGIC[4] = { 'L', 'X', 'T', 'C' };
+	// bump whenever the layout changes
+	const U32 XML_TREE_CACHE_VERSION = 1;
+	// anything deeper is a corrupt cache
+	const S32 XML_TREE_CACHE_MAX_DEPTH = 256;
+
+	struct XmlTreeCacheHeader
+	{
+		char mMagic[4];
+		U32 mVersion;
+		U32 mKeepContents;
+		U32 mPad;
+		U64 mSourceSize;
+		S64 mSourceTime;
+	};
+
+	void cache_write_u32(std::string& out, U32 value)
+	{
+		out.append((const char*) &value, sizeof(U32));
+	}
+
+	void cache_write_string(std::string& out, const std::string& str)
+	{
+		cache_write_u32(out, (U32) str.size());
+		out.append(str);
+	}
+
+	bool cache_read_u32(const char*& data, const char* end, U32& value)
+	{
+		if ((size_t) (end - data) < sizeof(U32))
+		{
+			return false;
+		}
+		memcpy(&value, data, sizeof(U32));
+		data += sizeof(U32);
+		return true;
+	}
+
+	bool cache_read_string(const char*& data, const char* end, std::string& str)
+	{
+		U32 length;
+		if (!cache_read_u32(data, end, length) || (size_t) (end - data) < length)
+		{
+			return false;
+		}
+		str.assign(data, length);
+		data += length;
+		return true;
+	}
+}
+
+BOOL LLXmlTree::parseFileCached(const std::string &path, const std::string &cache_path, BOOL keep_contents)
+{
+	mReadFromCache = FALSE;
+
+	llstat source;
+	if (cache_path.empty() || LLFile::stat(path, &source) != 0)
+	{
+		return parseFile(path, keep_contents);
+	}
+
+	U64 source_size = (U64) source.st_size;
+	S64 source_time = (S64) source.st_mtime;
+	if (readCache(cache_path, source_size, source_time, keep_contents))
+	{
+		mReadFromCache = TRUE;
+		return TRUE;
+	}
+
+	if (!parseFile(path, keep_contents))
+	{
+		return FALSE;
+	}
+
+	writeCache(cache_path, source_size, source_time, keep_contents);
+	return TRUE;
+}
+
+BOOL LLXmlTree::readCache(const std::string& cache_path, U64 source_size, S64 source_time, BOOL keep_contents)
+{
+	LLFILE* fp = LLFile::fopen(cache_path, "rb");
+	if (!fp)
+	{
+		return FALSE;
+	}
+
+	// one read for the whole file, the tree is built from memory
+	std::vector<char> buffer;
+	if (fseek(fp, 0, SEEK_END) == 0)
+	{
+		long size = ftell(fp);
+		if (size > 0 && fseek(fp, 0, SEEK_SET) == 0)
+		{
+			buffer.resize(size);
+			if (fread(buffer.data(), 1, size, fp) != (size_t) size)
+			{
+				buffer.clear();
+			}
+		}
+	}
+	LLFile::close(fp);
+
+	XmlTreeCacheHeader header;
+	if (buffer.size() < sizeof(header))
+	{
+		return FALSE;
+	}
+	memcpy(&header, buffer.data(), sizeof(header));
+
+	if (memcmp(header.mMagic, XML_TREE_CACHE_MAGIC, sizeof(header.mMagic)) != 0
+		|| header.mVersion != XML_TREE_CACHE_VERSION
+		|| header.mKeepContents != (keep_contents ? 1 : 0)
+		|| header.mSourceSize != source_size
+		|| header.mSourceTime != source_time)
+	{
+		return FALSE;
+	}
+
+	const char* data = buffer.data() + sizeof(header);
+	const char* end = buffer.data() + buffer.size();
+	LLXmlTreeNode* root = readCachedNode(data, end, 0);
+	if (!root || data != end)
+	{
+		LL_WARNS() << "Ignoring corrupt XML cache " << cache_path << LL_ENDL;
+		delete root;
+		return FALSE;
+	}
+
+	delete mRoot;
+	mRoot = root;
+	return TRUE;
+}
+
+void LLXmlTree::writeCache(const std::string& cache_path, U64 source_size, S64 source_time, BOOL keep_contents)
+{
+	if (!mRoot)
+	{
+		return;
+	}
+
+	XmlTreeCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.mMagic, XML_TREE_CACHE_MAGIC, sizeof(header.mMagic));
+	header.mVersion = XML_TREE_CACHE_VERSION;
+	header.mKeepContents = keep_contents ? 1 : 0;
+	header.mSourceSize = source_size;
+	header.mSourceTime = source_time;
+
+	std::string out((const char*) &header, sizeof(header));
+	writeCachedNode(mRoot, out);
+
+	// written aside and renamed into place, so that no reader ever sees
+	// half a cache
+	std::string temp_path = cache_path + ".tmp";
+	LLFILE* fp = LLFile::fopen(temp_path, "wb");
+	if (!fp)
+	{
+		LL_WARNS() << "Unable to write XML cache " << temp_path << LL_ENDL;
+		return;
+	}
+	bool written = fwrite(out.data(), 1, out.size(), fp) == out.size();
+	LLFile::close(fp);
+
+	LLFile::remove(cache_path, ENOENT);
+	if (!written || LLFile::rename(temp_path, cache_path) != 0)
+	{
+		LL_WARNS() << "Unable to write XML cache " << cache_path << LL_ENDL;
+		LLFile::remove(temp_path, ENOENT);
+	}
+}
+
+LLXmlTreeNode* LLXmlTree::readCachedNode(const char*& data, const char* end, S32 depth)
+{
+	std::string name;
+	if (depth > XML_TREE_CACHE_MAX_DEPTH || !cache_read_string(data, end, name))
+	{
+		return NULL;
+	}
+
+	LLXmlTreeNode* node = new LLXmlTreeNode(name, NULL, this);
+
+	U32 num_attributes = 0;
+	bool ok = cache_read_string(data, end, node->mContents)
+		&& cache_read_u32(data, end, num_attributes);
+
+	std::string key;
+	std::string value;
+	for (U32 i = 0; ok && i < num_attributes; ++i)
+	{
+		ok = cache_read_string(data, end, key) && cache_read_string(data, end, value);
+		if (ok)
+		{
+			node->addAttribute(key, value);
+		}
+	}
+
+	U32 num_children = 0;
+	ok = ok && cache_read_u32(data, end, num_children);
+	for (U32 i = 0; ok && i < num_children; ++i)
+	{
+		LLXmlTreeNode* child = readCachedNode(data, end, depth + 1);
+		if (child)
+		{
+			node->addChild(child);
+		}
+		else
+		{
+			ok = false;
+		}
+	}
+
+	if (!ok)
+	{
+		delete node;
+		return NULL;
+	}
+	return node;
+}
+
+// static
+void LLXmlTree::writeCachedNode(LLXmlTreeNode* node, std::string& out)
+{
+	cache_write_string(out, node->mName);
+	cache_write_string(out, node->mContents);
+
+	cache_write_u32(out, (U32) node->mAttributes.size());
+	for (LLXmlTreeNode::attribute_map_t::value_type& attribute : node->mAttributes)
+	{
+		cache_write_string(out, *attribute.first);
+		cache_write_string(out, *attribute.second);
+	}
+
+	cache_write_u32(out, (U32) node->mChildren.size());
+	for (LLXmlTreeNode* child : node->mChildren)
+	{
+		writeCachedNode(child, out);
+	}
+}
+
 //////////////////////////////////////////////////////////////
 // LLXmlTreeNode
 
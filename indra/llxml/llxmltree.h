@@ -57,6 +57,13 @@ public:
 
 	virtual BOOL	parseFile(const std::string &path, BOOL keep_contents = TRUE);
 
+	// Like parseFile(), but reads the tree from a binary copy at cache_path
+	// when one was written for this size and modification time of the file,
+	// and otherwise parses the file and writes one.
+	BOOL			parseFileCached(const std::string &path, const std::string &cache_path, BOOL keep_contents = TRUE);
+	// TRUE when the last parseFileCached() used the binary copy
+	BOOL			wasReadFromCache() const { return mReadFromCache; }
+
 	LLXmlTreeNode*	getRoot() { return mRoot; }
 
 	void			dump();
@@ -72,10 +79,17 @@ public:
 	static LLStdStringTable sAttributeKeys;
 	
 protected:
+	BOOL			readCache(const std::string& cache_path, U64 source_size, S64 source_time, BOOL keep_contents);
+	void			writeCache(const std::string& cache_path, U64 source_size, S64 source_time, BOOL keep_contents);
+	LLXmlTreeNode*	readCachedNode(const char*& data, const char* end, S32 depth);
+	static void		writeCachedNode(LLXmlTreeNode* node, std::string& out);
+
 	LLXmlTreeNode* mRoot;
 
 	// local
 	LLStdStringTable mNodeNames;	
+
+	BOOL mReadFromCache;
 };
 
 //////////////////////////////////////////////////////////////
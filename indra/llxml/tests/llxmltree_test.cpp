@@ -0,0 +1,187 @@
+/**
+ * @file llxmltree_test.cpp
+ * @brief LLXmlTree binary cache tests
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Second Life Viewer Source Code
+ * Copyright (C) 2024, Linden Research, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation;
+ * version 2.1 of the License only.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * Linden Research, Inc., 945 Battery Street, San Francisco, CA  94111  USA
+ * $/LicenseInfo$
+ */
+
+#include "linden_common.h"
+#include "llfile.h"
+#include "lluuid.h"
+#include "stringize.h"
+
+#include "../llxmltree.h"
+
+#include "../test/lltut.h"
+
+namespace
+{
+	const char* TEST_XML =
+		"<?xml version=\"1.0\" encoding=\"US-ASCII\" standalone=\"yes\"?>\n"
+		"<linden_skeleton version=\"2.0\" num_bones=\"2\">\n"
+		"  <bone name=\"mPelvis\" pos=\"0 0 1.067\" rot=\"0 0 0\">\n"
+		"    <collision_volume name=\"PELVIS\" scale=\"0.12 0.16 0.17\"/>\n"
+		"    <bone name=\"mTorso\" pos=\"0 0 0.084\" aliases=\"torso avatar_mTorso\"/>\n"
+		"  </bone>\n"
+		"  <comment>  some text  </comment>\n"
+		"</linden_skeleton>\n";
+
+	// same names, attributes, contents and children, in the same order
+	bool same_tree(LLXmlTreeNode* a, LLXmlTreeNode* b)
+	{
+		if (!a || !b || a->getName() != b->getName() || a->getContents() != b->getContents()
+			|| a->getChildCount() != b->getChildCount())
+		{
+			return false;
+		}
+
+		static const char* attributes[] = { "version", "num_bones", "name", "pos", "rot", "scale", "aliases" };
+		for (const char* attribute : attributes)
+		{
+			std::string value_a;
+			std::string value_b;
+			if (a->getAttributeString(attribute, value_a) != b->getAttributeString(attribute, value_b)
+				|| value_a != value_b)
+			{
+				return false;
+			}
+		}
+
+		LLXmlTreeNode* child_b = b->getFirstChild();
+		for (LLXmlTreeNode* child_a = a->getFirstChild(); child_a; child_a = a->getNextChild())
+		{
+			if (!same_tree(child_a, child_b))
+			{
+				return false;
+			}
+			child_b = b->getNextChild();
+		}
+		return true;
+	}
+}
+
+namespace tut
+{
+	struct xml_tree
+	{
+		std::string mTestDir;
+		std::string mXmlFile;
+		std::string mCacheFile;
+
+		xml_tree()
+		{
+			LLUUID random;
+			random.generate();
+			mTestDir = STRINGIZE(LLFile::tmpdir() << "llxmltree-test-" << random << "/");
+			mXmlFile = mTestDir + "skeleton.xml";
+			mCacheFile = mTestDir + "skeleton.bin";
+			LLFile::mkdir(mTestDir);
+			writeFile(mXmlFile, TEST_XML);
+		}
+		~xml_tree()
+		{
+			LLFile::remove(mXmlFile, ENOENT);
+			LLFile::remove(mCacheFile, ENOENT);
+			LLFile::rmdir(mTestDir);
+		}
+		void writeFile(const std::string& path, const std::string& contents)
+		{
+			llofstream file(path.c_str(), std::ios::binary);
+			file << contents;
+			file.close();
+		}
+	};
+
+	typedef test_group<xml_tree> xml_tree_test;
+	typedef xml_tree_test::object xml_tree_t;
+	xml_tree_test tut_xml_tree("LLXmlTree");
+
+	// the cache is written on the first parse and read back identical
+	template<> template<>
+	void xml_tree_t::test<1>()
+	{
+		LLXmlTree parsed;
+		ensure("parse", parsed.parseFile(mXmlFile));
+
+		LLXmlTree first;
+		ensure("first cached parse", first.parseFileCached(mXmlFile, mCacheFile));
+		ensure("first parse not from cache", !first.wasReadFromCache());
+		ensure("cache written", LLFile::isfile(mCacheFile));
+		ensure("first cached parse matches", same_tree(parsed.getRoot(), first.getRoot()));
+
+		LLXmlTree second;
+		ensure("second cached parse", second.parseFileCached(mXmlFile, mCacheFile));
+		ensure("second parse from cache", second.wasReadFromCache());
+		ensure("read from cache matches", same_tree(parsed.getRoot(), second.getRoot()));
+		ensure("named children", second.getRoot()->getChildByName("bone") != NULL);
+		ensure_equals("trimmed contents", second.getRoot()->getChildByName("comment")->getContents(),
+					  std::string("some text"));
+	}
+
+	// a changed file makes for a new cache
+	template<> template<>
+	void xml_tree_t::test<2>()
+	{
+		LLXmlTree first;
+		ensure("first cached parse", first.parseFileCached(mXmlFile, mCacheFile));
+
+		writeFile(mXmlFile, "<linden_skeleton version=\"3.0\"/>");
+
+		LLXmlTree second;
+		ensure("second cached parse", second.parseFileCached(mXmlFile, mCacheFile));
+		std::string version;
+		ensure("version", second.getRoot()->getAttributeString("version", version));
+		ensure("changed file not read from cache", !second.wasReadFromCache());
+		ensure_equals("changed file read", version, std::string("3.0"));
+		ensure_equals("no children", second.getRoot()->getChildCount(), 0);
+	}
+
+	// a damaged cache is ignored and replaced
+	template<> template<>
+	void xml_tree_t::test<3>()
+	{
+		LLXmlTree parsed;
+		ensure("parse", parsed.parseFile(mXmlFile));
+
+		LLXmlTree first;
+		ensure("first cached parse", first.parseFileCached(mXmlFile, mCacheFile));
+
+		// cut the cache short, keeping its header
+		std::string cache;
+		{
+			llifstream file(mCacheFile.c_str(), std::ios::binary);
+			cache.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		}
+		ensure("cache has nodes", cache.size() > 64);
+		writeFile(mCacheFile, cache.substr(0, cache.size() - 10));
+
+		LLXmlTree second;
+		ensure("parse with damaged cache", second.parseFileCached(mXmlFile, mCacheFile));
+		ensure("damaged cache not used", !second.wasReadFromCache());
+		ensure("damaged cache ignored", same_tree(parsed.getRoot(), second.getRoot()));
+
+		LLXmlTree third;
+		ensure("parse with rewritten cache", third.parseFileCached(mXmlFile, mCacheFile));
+		ensure("rewritten cache used", third.wasReadFromCache());
+		ensure("cache rewritten", same_tree(parsed.getRoot(), third.getRoot()));
+	}
+}
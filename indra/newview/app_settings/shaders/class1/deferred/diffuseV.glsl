@@ -45,6 +45,10 @@ uniform mat4 projection_matrix;
 uniform mat4 modelview_matrix;
 #endif
 
+#ifdef HAS_INSTANCING
+mat4 getInstanceTransform();
+#endif
+
 void main()
 {
 #ifdef HAS_SKIN
@@ -53,6 +57,10 @@ void main()
     vec4 pos = mat * vec4(position.xyz, 1.0);
     gl_Position = projection_matrix * pos;
     vary_normal = normalize((mat*vec4(normal.xyz+position.xyz,1.0)).xyz-pos.xyz);
+#elif defined(HAS_INSTANCING)
+    mat4 mat = getInstanceTransform();
+    gl_Position = modelview_projection_matrix * (mat * vec4(position.xyz, 1.0));
+    vary_normal = normalize(normal_matrix * (mat3(mat) * normal));
 #else
 	gl_Position = modelview_projection_matrix * vec4(position.xyz, 1.0); 
     vary_normal = normalize(normal_matrix * normal);
@@ -35,6 +35,9 @@ mat4 getObjectSkinnedTransform();
 #else
 uniform mat3 normal_matrix;
 uniform mat4 modelview_projection_matrix;
+#ifdef HAS_INSTANCING
+mat4 getInstanceTransform();
+#endif
 #endif
 uniform mat4 texture_matrix0;
 
@@ -74,6 +77,9 @@ void main()
 
 	gl_Position = projection_matrix*vec4(pos,1.0);
 
+#elif defined(HAS_INSTANCING)
+	mat4 mat = getInstanceTransform();
+	gl_Position = modelview_projection_matrix * (mat * vec4(position.xyz, 1.0));
 #else
 	//transform vertex
 	gl_Position = modelview_projection_matrix * vec4(position.xyz, 1.0); 
@@ -87,6 +93,9 @@ void main()
 #ifdef HAS_SKIN
 	vec3 n = (mat*vec4(normal.xyz+position.xyz,1.0)).xyz-pos.xyz;
 	vec3 t = (mat*vec4(tangent.xyz+position.xyz,1.0)).xyz-pos.xyz;
+#elif defined(HAS_INSTANCING)
+	vec3 n = normal_matrix * (mat3(mat) * normal);
+	vec3 t = normal_matrix * (mat3(mat) * tangent.xyz);
 #else //HAS_SKIN
 	vec3 n = normal_matrix * normal;
 	vec3 t = normal_matrix * tangent.xyz;
@@ -40,14 +40,21 @@ uniform sampler2DShadow shadowMap5;
 
 uniform vec3 sun_dir;
 uniform vec3 moon_dir;
-uniform vec2 shadow_res;
-uniform vec2 proj_shadow_res;
-uniform mat4 shadow_matrix[6];
-uniform vec4 shadow_clip;
-uniform float shadow_bias;
-uniform float shadow_offset;
-uniform float spot_shadow_bias;
-uniform float spot_shadow_offset;
+
+// shared by every shader that uses shadows, set once per change by
+// LLPipeline::updateShadowBlock -- must match LLPipeline::ShadowBlock
+layout (std140) uniform ShadowParams
+{
+    mat4 shadow_matrix[6];
+    vec4 shadow_clip;
+    vec2 shadow_res;
+    vec2 proj_shadow_res;
+    float shadow_bias;
+    float shadow_offset;
+    float spot_shadow_bias;
+    float spot_shadow_offset;
+};
+
 uniform mat4 inv_proj;
 uniform vec2 screen_res;
 uniform int sun_up_factor;
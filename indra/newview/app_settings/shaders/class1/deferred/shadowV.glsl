@@ -27,8 +27,16 @@ uniform mat4 modelview_projection_matrix;
 
 in vec3 position;
 
+#ifdef HAS_INSTANCING
+mat4 getInstanceTransform();
+#endif
+
 void main()
 {
 	//transform vertex
+#ifdef HAS_INSTANCING
+	gl_Position = modelview_projection_matrix*(getInstanceTransform()*vec4(position.xyz, 1.0));
+#else
 	gl_Position = modelview_projection_matrix*vec4(position.xyz, 1.0);
+#endif
 }
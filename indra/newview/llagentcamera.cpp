@@ -1522,7 +1522,7 @@ void LLAgentCamera::updateCamera()
 		// SL-315
 		gAgentAvatarp->mPelvisp->setPosition(gAgentAvatarp->mPelvisp->getPosition() + diff);
 
-		gAgentAvatarp->mRoot->updateWorldMatrixChildren();
+		gAgentAvatarp->updateJointWorldMatrices();
 
 		for (LLVOAvatar::attachment_map_t::iterator iter = gAgentAvatarp->mAttachmentPoints.begin(); 
 			 iter != gAgentAvatarp->mAttachmentPoints.end(); )
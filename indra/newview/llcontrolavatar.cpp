@@ -366,17 +366,15 @@ void LLControlAvatar::markForDeath()
     mRootVolp = NULL;
 }
 
-void LLControlAvatar::idleUpdate(LLAgent &agent, const F64 &time)
+bool LLControlAvatar::idleUpdateBegin(LLAgent &agent, const F64 &time)
 {
     if (mMarkedForDeath)
     {
         markDead();
         mMarkedForDeath = false;
+        return false;
     }
-    else
-    {
-        LLVOAvatar::idleUpdate(agent,time);
-    }
+    return LLVOAvatar::idleUpdateBegin(agent,time);
 }
 
 void LLControlAvatar::markDead()
@@ -413,9 +411,9 @@ bool LLControlAvatar::computeNeedsUpdate()
 	return LLVOAvatar::computeNeedsUpdate();
 }
 
-bool LLControlAvatar::updateCharacter(LLAgent &agent)
+bool LLControlAvatar::beginUpdateCharacter(LLAgent &agent)
 {
-    return LLVOAvatar::updateCharacter(agent);
+    return LLVOAvatar::beginUpdateCharacter(agent);
 }
 
 //virtual
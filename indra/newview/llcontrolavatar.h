@@ -59,9 +59,9 @@ public:
     // markDead() inside other graphics pipeline operations.
     void markForDeath();
 
-    virtual void idleUpdate(LLAgent &agent, const F64 &time);
+    virtual bool idleUpdateBegin(LLAgent &agent, const F64 &time);
 	virtual bool computeNeedsUpdate();
-	virtual bool updateCharacter(LLAgent &agent);
+	virtual bool beginUpdateCharacter(LLAgent &agent);
 
     void getAnimatedVolumes(std::vector<LLVOVolume*>& volumes);
     void updateAnimations();  
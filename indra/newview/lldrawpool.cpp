@@ -427,11 +427,112 @@ void LLRenderPass::renderRiggedGroup(LLSpatialGroup* group, U32 type, bool textu
     }
 }
 
+namespace
+{
+    // most draws folded into one glMultiDrawElements call
+    const U32 MAX_MULTI_DRAW = 64;
+
+    // true if b can be drawn in the same multi draw call as a, i.e. nothing
+    // pushBatch would change between the two
+    bool can_multi_draw(const LLDrawInfo& a, const LLDrawInfo& b, bool textured, bool batch_textures)
+    {
+        if (!b.mCount ||
+            !a.mInstances.empty() ||
+            !b.mInstances.empty() ||
+            a.mVertexBuffer != b.mVertexBuffer ||
+            a.mModelMatrix != b.mModelMatrix ||
+            a.mAvatar != b.mAvatar ||
+            a.mSkinInfo != b.mSkinInfo)
+        {
+            return false;
+        }
+
+        if (textured)
+        {
+            if (a.mTextureMatrix || b.mTextureMatrix)
+            {
+                return false;
+            }
+
+            if (batch_textures && (a.mTextureList.size() > 1 || b.mTextureList.size() > 1))
+            {
+                return a.mTextureList == b.mTextureList;
+            }
+
+            return a.mTexture == b.mTexture;
+        }
+
+        return true;
+    }
+
+    // Collect the draws following params in the render map that can share its
+    // multi draw call, advancing i past them.  Returns how many were collected.
+    U32 gather_multi_draw(const LLDrawInfo& params, LLCullResult::drawinfo_iterator& i, LLCullResult::drawinfo_iterator end,
+                          bool textured, bool batch_textures, LLDrawInfo** merged)
+    {
+        static LLCachedControl<bool> multi_draw(gSavedSettings, "RenderMultiDraw", true);
+        if (!multi_draw || !params.mCount)
+        {
+            return 0;
+        }
+
+        U32 count = 0;
+        while (i != end && count < MAX_MULTI_DRAW - 1 && can_multi_draw(params, **i, textured, batch_textures))
+        {
+            merged[count++] = *i;
+            LLCullResult::increment_iterator(i, end);
+        }
+        return count;
+    }
+
+    // draw params and the draws merged with it in one call
+    void draw_multi(const LLDrawInfo& params, LLDrawInfo* const* merged, U32 merged_count)
+    {
+        U32 counts[MAX_MULTI_DRAW];
+        U32 offsets[MAX_MULTI_DRAW];
+        counts[0] = params.mCount;
+        offsets[0] = params.mOffset;
+        for (U32 i = 0; i < merged_count; ++i)
+        {
+            counts[i + 1] = merged[i]->mCount;
+            offsets[i + 1] = merged[i]->mOffset;
+        }
+
+        params.mVertexBuffer->drawMulti(LLRender::TRIANGLES, counts, offsets, merged_count + 1);
+    }
+
+    // draw every instance of an instanced draw info, in one call when the
+    // bound shader reads per instance transforms
+    void draw_instances(LLDrawInfo& params)
+    {
+        U32 count = (U32) params.mInstances.size();
+        if (LLGLSLShader::sCurBoundShaderPtr && LLGLSLShader::sCurBoundShaderPtr->mFeatures.hasInstancing)
+        {
+            gGL.bindInstanceTransforms(params.getInstanceBuffer());
+            params.mVertexBuffer->drawInstanced(LLRender::TRIANGLES, params.mCount, params.mOffset, count);
+            gGL.bindInstanceTransforms(0);
+            gPipeline.mInstancedDrawsSaved += count - 1;
+        }
+        else
+        {
+            gGL.matrixMode(LLRender::MM_MODELVIEW);
+            for (const LLMatrix4& mat : params.mInstances)
+            {
+                gGL.pushMatrix();
+                gGL.multMatrix((GLfloat*) mat.mMatrix);
+                params.mVertexBuffer->drawRange(LLRender::TRIANGLES, params.mStart, params.mEnd, params.mCount, params.mOffset);
+                gGL.popMatrix();
+            }
+        }
+    }
+}
+
 void LLRenderPass::pushBatches(U32 type, bool texture, bool batch_textures)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_DRAWPOOL;
     if (texture)
     {
+        LLDrawInfo* merged[MAX_MULTI_DRAW];
         auto* begin = gPipeline.beginRenderMap(type);
         auto* end = gPipeline.endRenderMap(type);
         for (LLCullResult::drawinfo_iterator i = begin; i != end; )
@@ -439,7 +540,8 @@ void LLRenderPass::pushBatches(U32 type, bool texture, bool batch_textures)
             LLDrawInfo* pparams = *i;
             LLCullResult::increment_iterator(i, end);
 
-            pushBatch(*pparams, texture, batch_textures);
+            U32 merged_count = gather_multi_draw(*pparams, i, end, true, batch_textures, merged);
+            pushBatch(*pparams, texture, batch_textures, merged, merged_count);
         }
     }
     else
@@ -451,6 +553,7 @@ void LLRenderPass::pushBatches(U32 type, bool texture, bool batch_textures)
 void LLRenderPass::pushUntexturedBatches(U32 type)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_DRAWPOOL;
+    LLDrawInfo* merged[MAX_MULTI_DRAW];
     auto* begin = gPipeline.beginRenderMap(type);
     auto* end = gPipeline.endRenderMap(type);
     for (LLCullResult::drawinfo_iterator i = begin; i != end; )
@@ -458,7 +561,8 @@ void LLRenderPass::pushUntexturedBatches(U32 type)
         LLDrawInfo* pparams = *i;
         LLCullResult::increment_iterator(i, end);
 
-        pushUntexturedBatch(*pparams);
+        U32 merged_count = gather_multi_draw(*pparams, i, end, false, false, merged);
+        pushUntexturedBatch(*pparams, merged, merged_count);
     }
 }
 
@@ -468,6 +572,7 @@ void LLRenderPass::pushRiggedBatches(U32 type, bool texture, bool batch_textures
     
     if (texture)
     {
+        LLDrawInfo* merged[MAX_MULTI_DRAW];
         LLVOAvatar* lastAvatar = nullptr;
         U64 lastMeshId = 0;
         auto* begin = gPipeline.beginRenderMap(type);
@@ -484,7 +589,8 @@ void LLRenderPass::pushRiggedBatches(U32 type, bool texture, bool batch_textures
                 lastMeshId = pparams->mSkinInfo->mHash;
             }
 
-            pushBatch(*pparams, texture, batch_textures);
+            U32 merged_count = gather_multi_draw(*pparams, i, end, true, batch_textures, merged);
+            pushBatch(*pparams, texture, batch_textures, merged, merged_count);
         }
     }
     else
@@ -496,6 +602,7 @@ void LLRenderPass::pushRiggedBatches(U32 type, bool texture, bool batch_textures
 void LLRenderPass::pushUntexturedRiggedBatches(U32 type)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_DRAWPOOL;
+    LLDrawInfo* merged[MAX_MULTI_DRAW];
     LLVOAvatar* lastAvatar = nullptr;
     U64 lastMeshId = 0;
     auto* begin = gPipeline.beginRenderMap(type);
@@ -512,7 +619,8 @@ void LLRenderPass::pushUntexturedRiggedBatches(U32 type)
             lastMeshId = pparams->mSkinInfo->mHash;
         }
 
-        pushUntexturedBatch(*pparams);
+        U32 merged_count = gather_multi_draw(*pparams, i, end, false, false, merged);
+        pushUntexturedBatch(*pparams, merged, merged_count);
     }
 }
 
@@ -580,7 +688,7 @@ void LLRenderPass::applyModelMatrix(const LLDrawInfo& params)
 	}
 }
 
-void LLRenderPass::pushBatch(LLDrawInfo& params, bool texture, bool batch_textures)
+void LLRenderPass::pushBatch(LLDrawInfo& params, bool texture, bool batch_textures, LLDrawInfo* const* merged, U32 merged_count)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_DRAWPOOL;
     llassert(texture);
@@ -627,7 +735,18 @@ void LLRenderPass::pushBatch(LLDrawInfo& params, bool texture, bool batch_textur
 	}
 	
     params.mVertexBuffer->setBuffer();
-    params.mVertexBuffer->drawRange(LLRender::TRIANGLES, params.mStart, params.mEnd, params.mCount, params.mOffset);
+    if (merged_count)
+    {
+        draw_multi(params, merged, merged_count);
+    }
+    else if (!params.mInstances.empty())
+    {
+        draw_instances(params);
+    }
+    else
+    {
+        params.mVertexBuffer->drawRange(LLRender::TRIANGLES, params.mStart, params.mEnd, params.mCount, params.mOffset);
+    }
 
 	if (tex_setup)
 	{
@@ -637,7 +756,7 @@ void LLRenderPass::pushBatch(LLDrawInfo& params, bool texture, bool batch_textur
 	}
 }
 
-void LLRenderPass::pushUntexturedBatch(LLDrawInfo& params)
+void LLRenderPass::pushUntexturedBatch(LLDrawInfo& params, LLDrawInfo* const* merged, U32 merged_count)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_DRAWPOOL;
 
@@ -649,7 +768,18 @@ void LLRenderPass::pushUntexturedBatch(LLDrawInfo& params)
     applyModelMatrix(params);
 
     params.mVertexBuffer->setBuffer();
-    params.mVertexBuffer->drawRange(LLRender::TRIANGLES, params.mStart, params.mEnd, params.mCount, params.mOffset);
+    if (merged_count)
+    {
+        draw_multi(params, merged, merged_count);
+    }
+    else if (!params.mInstances.empty())
+    {
+        draw_instances(params);
+    }
+    else
+    {
+        params.mVertexBuffer->drawRange(LLRender::TRIANGLES, params.mStart, params.mEnd, params.mCount, params.mOffset);
+    }
 }
 
 // static
@@ -759,7 +889,14 @@ void LLRenderPass::pushGLTFBatch(LLDrawInfo& params)
     applyModelMatrix(params);
 
     params.mVertexBuffer->setBuffer();
-    params.mVertexBuffer->drawRange(LLRender::TRIANGLES, params.mStart, params.mEnd, params.mCount, params.mOffset);
+    if (!params.mInstances.empty())
+    {
+        draw_instances(params);
+    }
+    else
+    {
+        params.mVertexBuffer->drawRange(LLRender::TRIANGLES, params.mStart, params.mEnd, params.mCount, params.mOffset);
+    }
 
     teardown_texture_matrix(params);
 }
@@ -773,7 +910,14 @@ void LLRenderPass::pushUntexturedGLTFBatch(LLDrawInfo& params)
     applyModelMatrix(params);
 
     params.mVertexBuffer->setBuffer();
-    params.mVertexBuffer->drawRange(LLRender::TRIANGLES, params.mStart, params.mEnd, params.mCount, params.mOffset);
+    if (!params.mInstances.empty())
+    {
+        draw_instances(params);
+    }
+    else
+    {
+        params.mVertexBuffer->drawRange(LLRender::TRIANGLES, params.mStart, params.mEnd, params.mCount, params.mOffset);
+    }
 }
 
 void LLRenderPass::pushRiggedGLTFBatches(U32 type, bool textured)
@@ -381,8 +381,11 @@ public:
 
 	void pushMaskBatches(U32 type, bool texture = true, bool batch_textures = false);
     void pushRiggedMaskBatches(U32 type, bool texture = true, bool batch_textures = false);
-	void pushBatch(LLDrawInfo& params, bool texture, bool batch_textures = false);
-    void pushUntexturedBatch(LLDrawInfo& params);
+	// merged are draws following params that can share its state, drawn
+	// along with it in one multi draw call
+	void pushBatch(LLDrawInfo& params, bool texture, bool batch_textures = false,
+	               LLDrawInfo* const* merged = nullptr, U32 merged_count = 0);
+    void pushUntexturedBatch(LLDrawInfo& params, LLDrawInfo* const* merged = nullptr, U32 merged_count = 0);
 	void pushBumpBatch(LLDrawInfo& params, bool texture, bool batch_textures = false);
     static bool uploadMatrixPalette(LLDrawInfo& params);
     static bool uploadMatrixPalette(LLVOAvatar* avatar, LLMeshSkinInfo* skinInfo);
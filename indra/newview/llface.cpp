@@ -32,6 +32,7 @@
 
 #include "llviewercontrol.h"
 #include "llvolume.h"
+#include "llgeometrykernels.h"
 #include "m3math.h"
 #include "llmatrix4a.h"
 #include "v3color.h"
@@ -594,6 +595,7 @@ void renderFace(LLDrawable* drawable, LLFace *face)
 
         if (volume)
         {
+            volume->getVolumeFace(face->getTEOffset()).expand();
             const LLVolumeFace& vol_face = volume->getVolumeFace(face->getTEOffset());
             LLVertexBuffer::drawElements(LLRender::TRIANGLES, vol_face.mPositions, NULL, vol_face.mNumIndices, vol_face.mIndices);
         }
@@ -602,6 +604,13 @@ void renderFace(LLDrawable* drawable, LLFace *face)
 
 void LLFace::renderOneWireframe(const LLColor4 &color, F32 fogCfx, bool wireframe_selection, bool bRenderHiddenSelections, bool shader)
 {
+    LLVOVolume* vobj = mDrawablep->getVOVolume();
+    if (vobj && mDrawablep->isState(LLDrawable::RIGGED))
+    { // geometry updates only keep the rigged bounds current, skin the face
+      // for the current pose before outlining it
+        vobj->updateRiggedVolume(false, getTEOffset());
+    }
+
     if (bRenderHiddenSelections)
     {
         gGL.blendFunc(LLRender::BF_SOURCE_COLOR, LLRender::BF_ONE);
@@ -750,50 +759,6 @@ static void xform(LLVector2 &tex_coord, F32 cosAng, F32 sinAng, F32 offS, F32 of
 	tex_coord.mV[1] = t;
 }
 
-// Transform the texture coordinates for this face.
-static void xform4a(LLVector4a &tex_coord, const LLVector4a& trans, const LLVector4Logical& mask, const LLVector4a& rot0, const LLVector4a& rot1, const LLVector4a& offset, const LLVector4a& scale) 
-{
-	//tex coord is two coords, <s0, t0, s1, t1>
-	LLVector4a st;
-
-	// Texture transforms are done about the center of the face.
-	st.setAdd(tex_coord, trans);
-	
-	// Handle rotation
-	LLVector4a rot_st;
-		
-	// <s0 * cosAng, s0*-sinAng, s1*cosAng, s1*-sinAng>
-	LLVector4a s0;
-	s0.splat(st, 0);
-	LLVector4a s1;
-	s1.splat(st, 2);
-	LLVector4a ss;
-	ss.setSelectWithMask(mask, s1, s0);
-
-	LLVector4a a; 
-	a.setMul(rot0, ss);
-	
-	// <t0*sinAng, t0*cosAng, t1*sinAng, t1*cosAng>
-	LLVector4a t0;
-	t0.splat(st, 1);
-	LLVector4a t1;
-	t1.splat(st, 3);
-	LLVector4a tt;
-	tt.setSelectWithMask(mask, t1, t0);
-
-	LLVector4a b;
-	b.setMul(rot1, tt);
-		
-	st.setAdd(a,b);
-
-	// Then scale
-	st.mul(scale);
-
-	// Then offset
-	tex_coord.setAdd(st, offset);
-}
-
-
 bool less_than_max_mag(const LLVector4a& vec)
 {
 	LLVector4a MAX_MAG;
@@ -947,7 +912,9 @@ LLVector2 LLFace::surfaceToTexture(LLVector2 surface_coord, const LLVector4a& po
 void LLFace::getPlanarProjectedParams(LLQuaternion* face_rot, LLVector3* face_pos, F32* scale) const
 {
 	const LLMatrix4& vol_mat = getWorldMatrix();
-	const LLVolumeFace& vf = getViewerObject()->getVolume()->getVolumeFace(mTEOffset);
+	LLVolume* volume = getViewerObject()->getVolume();
+	volume->getVolumeFace(mTEOffset).expand();
+	const LLVolumeFace& vf = volume->getVolumeFace(mTEOffset);
 	if (! (vf.mNormals && vf.mTangents))
 	{
 		return;
@@ -1558,120 +1525,31 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 			{ //not bump mapped, might be able to do a cheap update
 				mVertexBuffer->getTexCoord0Strider(tex_coords0, mGeomIndex, mGeomCount);
 
-				if (texgen != LLTextureEntry::TEX_GEN_PLANAR)
+				LLTexCoordKernel tc_kernel;
+				if (texgen == LLTextureEntry::TEX_GEN_PLANAR)
 				{
-                    LL_PROFILE_ZONE_NAMED_CATEGORY_FACE("getGeometryVolume - texgen");
-					if (!do_tex_mat)
-					{
-						if (xforms == XFORM_NONE)
-						{
-                            LL_PROFILE_ZONE_NAMED_CATEGORY_FACE("ggv - texgen 1");
-							S32 tc_size = (num_vertices*2*sizeof(F32)+0xF) & ~0xF;
-							LLVector4a::memcpyNonAliased16((F32*) tex_coords0.get(), (F32*) vf.mTexCoords, tc_size);
-						}
-						else
-						{
-                            LL_PROFILE_ZONE_NAMED_CATEGORY_FACE("ggv - texgen 2");
-							F32* dst = (F32*) tex_coords0.get();
-							LLVector4a* src = (LLVector4a*) vf.mTexCoords;
-
-							LLVector4a trans;
-							trans.splat(-0.5f);
-
-							LLVector4a rot0;
-							rot0.set(cos_ang, -sin_ang, cos_ang, -sin_ang);
-
-							LLVector4a rot1;
-							rot1.set(sin_ang, cos_ang, sin_ang, cos_ang);
-
-							LLVector4a scale;
-							scale.set(ms, mt, ms, mt);
-
-							LLVector4a offset;
-							offset.set(os+0.5f, ot+0.5f, os+0.5f, ot+0.5f);
-
-							LLVector4Logical mask;
-							mask.clear();
-							mask.setElement<2>();
-							mask.setElement<3>();
+					tc_kernel.setPlanar(scalea);
+				}
 
-							U32 count = num_vertices/2 + num_vertices%2;
+				if (do_tex_mat)
+				{
+					tc_kernel.setMatrix(*mTextureMatrix);
+				}
+				else if (xforms != XFORM_NONE)
+				{
+					tc_kernel.setTransform(cos_ang, sin_ang, os, ot, ms, mt);
+				}
 
-							for (S32 i = 0; i < count; i++)
-							{	
-								LLVector4a res = *src++;
-								xform4a(res, trans, mask, rot0, rot1, offset, scale);
-								res.store4a(dst);
-								dst += 4;
-							}
-						}
-					}
-					else
-					{ //do tex mat, no texgen, no bump
-						for (S32 i = 0; i < num_vertices; i++)
-						{	
-							LLVector2 tc(vf.mTexCoords[i]);
-							
-							LLVector3 tmp(tc.mV[0], tc.mV[1], 0.f);
-							tmp = tmp * *mTextureMatrix;
-							tc.mV[0] = tmp.mV[0];
-							tc.mV[1] = tmp.mV[1];
-							*tex_coords0++ = tc;	
-						}
-					}
+				if (tc_kernel.isCopy())
+				{
+                    LL_PROFILE_ZONE_NAMED_CATEGORY_FACE("ggv - texgen copy");
+					S32 tc_size = (num_vertices*2*sizeof(F32)+0xF) & ~0xF;
+					LLVector4a::memcpyNonAliased16((F32*) tex_coords0.get(), (F32*) vf.mTexCoords, tc_size);
 				}
 				else
-				{ //no bump, tex gen planar
-                    LL_PROFILE_ZONE_NAMED_CATEGORY_FACE("getGeometryVolume - texgen planar");
-					if (do_tex_mat)
-					{
-						for (S32 i = 0; i < num_vertices; i++)
-						{	
-							LLVector2 tc(vf.mTexCoords[i]);
-							LLVector4a& norm = vf.mNormals[i];
-							LLVector4a& center = *(vf.mCenter);
-							LLVector4a vec = vf.mPositions[i];	
-							vec.mul(scalea);
-							planarProjection(tc, norm, center, vec);
-						
-							LLVector3 tmp(tc.mV[0], tc.mV[1], 0.f);
-							tmp = tmp * *mTextureMatrix;
-							tc.mV[0] = tmp.mV[0];
-							tc.mV[1] = tmp.mV[1];
-				
-							*tex_coords0++ = tc;	
-						}
-					}
-					else if (xforms != XFORM_NONE)
-					{
-						for (S32 i = 0; i < num_vertices; i++)
-						{	
-							LLVector2 tc(vf.mTexCoords[i]);
-							LLVector4a& norm = vf.mNormals[i];
-							LLVector4a& center = *(vf.mCenter);
-							LLVector4a vec = vf.mPositions[i];	
-							vec.mul(scalea);
-							planarProjection(tc, norm, center, vec);
-						
-							xform(tc, cos_ang, sin_ang, os, ot, ms, mt);
-
-							*tex_coords0++ = tc;	
-						}
-					}
-					else
-					{
-						for (S32 i = 0; i < num_vertices; i++)
-						{	
-							LLVector2 tc(vf.mTexCoords[i]);
-							LLVector4a& norm = vf.mNormals[i];
-							LLVector4a& center = *(vf.mCenter);
-							LLVector4a vec = vf.mPositions[i];	
-							vec.mul(scalea);
-							planarProjection(tc, norm, center, vec);
-
-							*tex_coords0++ = tc;	
-						}
-					}
+				{
+                    LL_PROFILE_ZONE_NAMED_CATEGORY_FACE("ggv - texgen kernel");
+					tc_kernel.run(vf.mPositions, vf.mNormals, vf.mTexCoords, num_vertices, tex_coords0.get());
 				}
 			}
 			else
@@ -1739,45 +1617,31 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 							break;
 					}
                     const bool do_xform = (xforms & xform_channel) != XFORM_NONE;
-					
 
-                    for (S32 i = 0; i < num_vertices; i++)
-                    {   
-                        LLVector2 tc(vf.mTexCoords[i]);
-                
-                        LLVector4a& norm = vf.mNormals[i];
-                    
-                        LLVector4a& center = *(vf.mCenter);
-               
-                        if (texgen != LLTextureEntry::TEX_GEN_DEFAULT)
-                        {
-                            LLVector4a vec = vf.mPositions[i];
-                    
-                            vec.mul(scalea);
-
-                            if (texgen == LLTextureEntry::TEX_GEN_PLANAR)
-                            {
-                                planarProjection(tc, norm, center, vec);
-                            }       
-                        }
-
-                        if (tex_mode && mTextureMatrix)
-                        {
-                            LLVector3 tmp(tc.mV[0], tc.mV[1], 0.f);
-                            tmp = tmp * *mTextureMatrix;
-                            tc.mV[0] = tmp.mV[0];
-                            tc.mV[1] = tmp.mV[1];
-                        }
-                        else if (do_xform)
-                        {
-                            xform(tc, cos_ang, sin_ang, os, ot, ms, mt);
-                        }
-
-                        *dst++ = tc;
-                        if (do_bump)
-                        {
-                            bump_tc.push_back(tc);
-                        }
+                    LLTexCoordKernel tc_kernel;
+                    if (texgen == LLTextureEntry::TEX_GEN_PLANAR)
+                    {
+                        tc_kernel.setPlanar(scalea);
+                    }
+
+                    if (tex_mode && mTextureMatrix)
+                    {
+                        tc_kernel.setMatrix(*mTextureMatrix);
+                    }
+                    else if (do_xform)
+                    {
+                        tc_kernel.setTransform(cos_ang, sin_ang, os, ot, ms, mt);
+                    }
+
+                    if (do_bump && ch == 0)
+                    { // bump offsets are applied to the diffuse coordinates
+                        bump_tc.resize(num_vertices);
+                        tc_kernel.run(vf.mPositions, vf.mNormals, vf.mTexCoords, num_vertices, bump_tc.data());
+                        memcpy(dst.get(), bump_tc.data(), num_vertices * sizeof(LLVector2));
+                    }
+                    else
+                    {
+                        tc_kernel.run(vf.mPositions, vf.mNormals, vf.mTexCoords, num_vertices, dst.get());
                     }
 				}
 
@@ -1824,61 +1688,14 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 
 		if (rebuild_pos)
 		{
-			LLVector4a* src = vf.mPositions;
-			
-			//_mm_prefetch((char*)src, _MM_HINT_T0);
-
-			LLVector4a* end = src+num_vertices;
-			//LLVector4a* end_64 = end-4;
-
 			llassert(num_vertices > 0);
 		
 			mVertexBuffer->getVertexStrider(vert, mGeomIndex, mGeomCount);
-			
-			
-			F32* dst = (F32*) vert.get();
-			F32* end_f32 = dst+mGeomCount*4;
-
-			//_mm_prefetch((char*)dst, _MM_HINT_NTA);
-			//_mm_prefetch((char*)src, _MM_HINT_NTA);
-				
-			//_mm_prefetch((char*)dst, _MM_HINT_NTA);
-
-
-			LLVector4a res0; //,res1,res2,res3;
-
-			LLVector4a texIdx;
 
 			S32 index = mTextureIndex < FACE_DO_NOT_BATCH_TEXTURES ? mTextureIndex : 0;
-
-			F32 val = 0.f;
-			S32* vp = (S32*) &val;
-			*vp = index;
-			
 			llassert(index <= LLGLSLShader::sIndexedTextureChannels-1);
 
-			LLVector4Logical mask;
-			mask.clear();
-			mask.setElement<3>();
-		
-			texIdx.set(0,0,0,val);
-
-			LLVector4a tmp;
-
-			
-			while (src < end)
-			{	
-				mat_vert.affineTransform(*src++, res0);
-				tmp.setSelectWithMask(mask, texIdx, res0);
-				tmp.store4a((F32*) dst);
-				dst += 4;
-			}
-			
-			while (dst < end_f32)
-			{
-				res0.store4a((F32*) dst);
-				dst += 4;
-			}
+			ll_transform_positions(mat_vert, vf.mPositions, num_vertices, (U32) index, (LLVector4a*) vert.get(), mGeomCount);
 		}
 
 		if (rebuild_normal)
@@ -1886,44 +1703,17 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
             LL_PROFILE_ZONE_NAMED_CATEGORY_FACE("getGeometryVolume - normal");
 
 			mVertexBuffer->getNormalStrider(norm, mGeomIndex, mGeomCount);
-			F32* normals = (F32*) norm.get();
-			LLVector4a* src = vf.mNormals;
-			LLVector4a* end = src+num_vertices;
-			
-			while (src < end)
-			{	
-				LLVector4a normal;
-				mat_normal.rotate(*src++, normal);
-				normal.store4a(normals);
-				normals += 4;
-			}
+			ll_rotate_normals(mat_normal, vf.mNormals, num_vertices, (LLVector4a*) norm.get());
 		}
 		
 		if (rebuild_tangent)
 		{
             LL_PROFILE_ZONE_NAMED_CATEGORY_FACE("getGeometryVolume - tangent");
 			mVertexBuffer->getTangentStrider(tangent, mGeomIndex, mGeomCount);
-			F32* tangents = (F32*) tangent.get();
 			
             mVObjp->getVolume()->genTangents(face_index);
-			
-			LLVector4Logical mask;
-			mask.clear();
-			mask.setElement<3>();
-
-			LLVector4a* src = vf.mTangents;
-			LLVector4a* end = vf.mTangents +num_vertices;
 
-			while (src < end)
-			{
-				LLVector4a tangent_out;
-				mat_normal.rotate(*src, tangent_out);
-				tangent_out.setSelectWithMask(mask, *src, tangent_out);
-				tangent_out.store4a(tangents);
-				
-				src++;
-				tangents += 4;
-			}
+			ll_rotate_tangents(mat_normal, vf.mTangents, num_vertices, (LLVector4a*) tangent.get());
 		}
 	
 		if (rebuild_weights && vf.mWeights)
@@ -1938,26 +1728,7 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 		{
             LL_PROFILE_ZONE_NAMED_CATEGORY_FACE("getGeometryVolume - color");
 			mVertexBuffer->getColorStrider(colors, mGeomIndex, mGeomCount);
-
-			LLVector4a src;
-
-			U32 vec[4];
-			vec[0] = vec[1] = vec[2] = vec[3] = color.asRGBA();
-		
-			src.loadua((F32*) vec);
-
-			F32* dst = (F32*) colors.get();
-			S32 num_vecs = num_vertices/4;
-			if (num_vertices%4 > 0)
-			{
-				++num_vecs;
-			}
-
-			for (S32 i = 0; i < num_vecs; i++)
-			{	
-				src.store4a(dst);
-				dst += 4;
-			}
+			ll_fill_u32(color.asRGBA(), num_vertices, (U32*) colors.get());
 		}
 
 		if (rebuild_emissive)
@@ -1968,30 +1739,8 @@ BOOL LLFace::getGeometryVolume(const LLVolume& volume,
 
 			U8 glow = (U8) llclamp((S32) (getTextureEntry()->getGlow()*255), 0, 255);
 
-			LLVector4a src;
-
-		
 			LLColor4U glow4u = LLColor4U(0,0,0,glow);
-
-			U32 glow32 = glow4u.asRGBA();
-
-			U32 vec[4];
-			vec[0] = vec[1] = vec[2] = vec[3] = glow32;
-		
-			src.loadua((F32*) vec);
-
-			F32* dst = (F32*) emissive.get();
-			S32 num_vecs = num_vertices/4;
-			if (num_vertices%4 > 0)
-			{
-				++num_vecs;
-			}
-
-			for (S32 i = 0; i < num_vecs; i++)
-			{	
-				src.store4a(dst);
-				dst += 4;
-			}
+			ll_fill_u32(glow4u.asRGBA(), num_vertices, (U32*) emissive.get());
 		}
 	}
 
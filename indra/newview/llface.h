@@ -79,6 +79,7 @@ public:
 		TEXTURE_ANIM	= 0x0020, 
 		RIGGED			= 0x0040,
 		PARTICLE		= 0x0080,
+		INSTANCED		= 0x0100,
 	};
 
 public:
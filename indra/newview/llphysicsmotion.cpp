@@ -217,6 +217,14 @@ default_controller_map_t initDefaultController()
 
 default_controller_map_t LLPhysicsMotion::sDefaultController = initDefaultController();
 
+// Avatars may be posed on worker threads, so read the setting through a
+// cached control, first created from onInitialize() on the main thread.
+static bool avatar_physics_enabled()
+{
+        static LLCachedControl<bool> avatar_physics(gSavedSettings, "AvatarPhysics");
+        return avatar_physics;
+}
+
 BOOL LLPhysicsMotion::initialize()
 {
         if (!mJointState->setJoint(mCharacter->getJoint(mJointName.c_str())))
@@ -265,6 +273,8 @@ LLMotion::LLMotionInitStatus LLPhysicsMotionController::onInitialize(LLCharacter
 
         mMotions.clear();
 
+        avatar_physics_enabled();
+
         // Breast Cleavage
         {
                 controller_map_t controller;
@@ -455,7 +465,7 @@ BOOL LLPhysicsMotionController::onUpdate(F32 time, U8* joint_mask)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
         // Skip if disabled globally.
-        if (!gSavedSettings.getBOOL("AvatarPhysics"))
+        if (!avatar_physics_enabled())
         {
                 return TRUE;
         }
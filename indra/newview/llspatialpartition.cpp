@@ -37,7 +37,7 @@
 #include "llviewerobjectlist.h"
 #include "llvovolume.h"
 #include "llvolume.h"
-#include "llvolumeoctree.h"
+#include "llvolumebvh.h"
 #include "llviewercamera.h"
 #include "llface.h"
 #include "llfloatertools.h"
@@ -53,6 +53,7 @@
 #include "llvolumemgr.h"
 #include "llviewershadermgr.h"
 #include "llcontrolavatar.h"
+#include "llparallelbatch.h"
 
 extern bool gShiftFrame;
 
@@ -458,6 +459,7 @@ void LLSpatialGroup::shift(const LLVector4a &offset)
 	mObjectBounds[0].add(offset);
 	mObjectExtents[0].add(offset);
 	mObjectExtents[1].add(offset);
+	updateBoundsIndex();
 
 	if (!getSpatialPartition()->mRenderByGroup && 
 		getSpatialPartition()->mPartitionType != LLViewerRegion::PARTITION_TREE &&
@@ -794,6 +796,7 @@ void LLSpatialGroup::handleDestruction(const TreeNode* node)
 		return;
 	}
 	setState(DEAD);	
+	releaseBoundsIndex();
 
 	for (element_iter i = getDataBegin(); i != getDataEnd(); ++i)
 	{
@@ -863,6 +866,7 @@ void LLSpatialGroup::rebound()
                     const LLVector4a* addingExtents = controlAvatar->mDrawable->getSpatialExtents();
                     const LLXformMatrix* currentTransform = bridge->mDrawable->getXform();
                     expandExtents(addingExtents, *currentTransform);
+                    updateBoundsIndex();
                 }
             }
         }
@@ -1460,6 +1464,306 @@ S32 LLSpatialPartition::cull(LLCamera &camera, bool do_occlusion)
 	return 0;
 }
 
+namespace
+{
+    // A group visited by a recorded cull traversal, in traversal order
+    struct CullEntry
+    {
+        LLSpatialGroup* mGroup;
+        U32 mEnd;   // one past the last entry of this group's subtree
+        U32 mFlags;
+    };
+
+    enum
+    {
+        CULL_PRUNED = 0x1,   // occluded, subtree not traversed
+        CULL_VISIBLE = 0x2,  // passed the frustum and object checks
+    };
+
+    enum
+    {
+        CULLER_DEFAULT,
+        CULLER_NO_FAR_CLIP,
+        CULLER_SHADOW
+    };
+
+    // A subtree to be traversed by one worker
+    struct CullShard
+    {
+        const OctreeNode* mNode;
+        S32 mRes;       // frustum result inherited from the parent node
+        U32 mCuller;
+        std::vector<CullEntry> mEntries;
+    };
+
+    // Keeps the entry storage of shards around from one pass to the next
+    struct CullShardList
+    {
+        std::vector<CullShard> mShards;
+        U32 mCount = 0;
+
+        void add(const OctreeNode* node, S32 res, U32 culler)
+        {
+            if (mCount == mShards.size())
+            {
+                mShards.emplace_back();
+            }
+
+            CullShard& shard = mShards[mCount++];
+            shard.mNode = node;
+            shard.mRes = res;
+            shard.mCuller = culler;
+            shard.mEntries.clear();
+        }
+    };
+
+    // Runs one of the LLOctreeCull traversals without side effects.  The
+    // groups visited and the frustum decisions are recorded instead, for
+    // replay_cull to apply on the main thread.
+    //
+    // checkOcclusion reads back GL queries so it can't run here.  A group
+    // that is occluded now can only become visible in the replay if it has
+    // a query pending, so those subtrees are traversed speculatively and
+    // the replay skips them if they turn out to still be occluded.
+    //
+    // With shards set, children of the root aren't traversed but become
+    // shards of their own, each starting from the root's frustum result.
+    // The serial traversal lets a sibling reset that result to 0 for the
+    // siblings after it, but 0 and 1 only differ for SKIP_FRUSTUM_CHECK
+    // groups, and rebound() clears that state on every child of a node with
+    // more than one, so the shards see the same frustum checks.
+    //
+    // Frustum checks read the results of the partition's
+    // LLViewerOctreeGroupBounds sweep, groups without one are tested
+    // directly.
+    template <class T_CULL>
+    class LLOctreeCullRecord : public T_CULL
+    {
+    public:
+        LLOctreeCullRecord(LLCamera* camera, std::vector<CullEntry>& entries, CullShardList* shards, U32 culler)
+            : T_CULL(camera), mEntries(entries), mShards(shards), mCuller(culler), mDepth(0), mParentRes(-1) {}
+
+        void traverse(const OctreeNode* n, S32 res)
+        {
+            this->mRes = res;
+            traverse(n);
+        }
+
+        virtual void traverse(const OctreeNode* n)
+        {
+            if (mShards && mDepth == 1)
+            {
+                // the root's result as the first child sees it
+                if (mParentRes < 0)
+                {
+                    mParentRes = this->mRes;
+                }
+                mShards->add(n, mParentRes, mCuller);
+                return;
+            }
+
+            U32 index = (U32) mEntries.size();
+            mEntries.push_back({ (LLSpatialGroup*) n->getListener(0), 0, 0 });
+
+            ++mDepth;
+            T_CULL::traverse(n);
+            --mDepth;
+
+            mEntries[index].mEnd = (U32) mEntries.size();
+        }
+
+        virtual bool earlyFail(LLViewerOctreeGroup* base_group)
+        {
+            if (LLPipeline::sReflectionRender)
+            {
+                return false;
+            }
+
+            LLSpatialGroup* group = (LLSpatialGroup*)base_group;
+            if (group->getOctreeNode()->getParent() &&
+                LLPipeline::sUseOcclusion &&
+                group->isOcclusionState(LLSpatialGroup::OCCLUDED) &&
+                !(LLPipeline::sUseOcclusion > 1 && group->isOcclusionState(LLSpatialGroup::QUERY_PENDING)))
+            {
+                mEntries.back().mFlags |= CULL_PRUNED;
+                return true;
+            }
+
+            return false;
+        }
+
+        virtual void processGroup(LLViewerOctreeGroup* base_group)
+        {
+            mEntries.back().mFlags |= CULL_VISIBLE;
+        }
+
+        virtual S32 frustumCheck(const LLViewerOctreeGroup* base_group)
+        {
+            const LLOcclusionCullingGroup* group = (const LLOcclusionCullingGroup*) base_group;
+            const LLViewerOctreeGroupBounds& bounds = group->getSpatialPartition()->mGroupBounds;
+            S32 index = group->getBoundsIndex();
+            if (index < 0 || group->isDirty() || !bounds.hasResults())
+            {
+                return T_CULL::frustumCheck(base_group);
+            }
+            return bounds.getGroupResult(index);
+        }
+
+        virtual S32 frustumCheckObjects(const LLViewerOctreeGroup* base_group)
+        {
+            const LLOcclusionCullingGroup* group = (const LLOcclusionCullingGroup*) base_group;
+            const LLViewerOctreeGroupBounds& bounds = group->getSpatialPartition()->mGroupBounds;
+            S32 index = group->getBoundsIndex();
+            if (index < 0 || group->isDirty() || !bounds.hasResults())
+            {
+                return T_CULL::frustumCheckObjects(base_group);
+            }
+            return bounds.getObjectResult(index);
+        }
+
+    private:
+        std::vector<CullEntry>& mEntries;
+        CullShardList* mShards;
+        U32 mCuller;
+        U32 mDepth;
+        S32 mParentRes;
+    };
+
+    template <class T_CULL>
+    void record_cull(LLCamera* camera, const OctreeNode* node, S32 res, U32 culler, std::vector<CullEntry>& entries, CullShardList* shards)
+    {
+        LLOctreeCullRecord<T_CULL> culler_impl(camera, entries, shards, culler);
+        culler_impl.traverse(node, res);
+    }
+
+    void record_cull(LLCamera* camera, const OctreeNode* node, S32 res, U32 culler, std::vector<CullEntry>& entries, CullShardList* shards)
+    {
+        switch (culler)
+        {
+        case CULLER_SHADOW:
+            record_cull<LLOctreeCullShadow>(camera, node, res, culler, entries, shards);
+            break;
+        case CULLER_NO_FAR_CLIP:
+            record_cull<LLOctreeCullNoFarClip>(camera, node, res, culler, entries, shards);
+            break;
+        default:
+            record_cull<LLOctreeCull>(camera, node, res, culler, entries, shards);
+            break;
+        }
+    }
+
+    // Apply a recorded traversal the way LLOctreeCull would have
+    void replay_cull(const std::vector<CullEntry>& entries, LLCamera& camera)
+    {
+        U32 count = (U32) entries.size();
+        for (U32 i = 0; i < count; )
+        {
+            const CullEntry& entry = entries[i];
+            LLSpatialGroup* group = entry.mGroup;
+
+            if (!LLPipeline::sReflectionRender)
+            {
+                group->checkOcclusion();
+
+                if (group->getOctreeNode()->getParent() &&
+                    LLPipeline::sUseOcclusion &&
+                    group->isOcclusionState(LLSpatialGroup::OCCLUDED))
+                {
+                    gPipeline.markOccluder(group);
+                    i = entry.mEnd;
+                    continue;
+                }
+            }
+
+            llassert(!(entry.mFlags & CULL_PRUNED));
+
+            if (entry.mFlags & CULL_VISIBLE)
+            {
+                gPipeline.markNotCulled(group, camera);
+            }
+            ++i;
+        }
+    }
+}
+
+//static
+void LLSpatialPartition::cullPartitions(LLCamera& camera, const std::vector<LLSpatialPartition*>& partitions)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_SPATIAL;
+
+    // subtrees below each partition's root, reused from pass to pass
+    static CullShardList sShards;
+
+    // traversal of each partition's root, shards for its children start at
+    // mShardBegin
+    struct RootCull
+    {
+        std::vector<CullEntry> mEntries;
+        U32 mShardBegin;
+    };
+    static std::vector<RootCull> sRoots;
+
+    sShards.mCount = 0;
+
+    if (sRoots.size() < partitions.size())
+    {
+        sRoots.resize(partitions.size());
+    }
+
+    {
+        LL_PROFILE_ZONE_NAMED_CATEGORY_SPATIAL("cull - split");
+        for (U32 i = 0; i < partitions.size(); ++i)
+        {
+            LLSpatialPartition* part = partitions[i];
+
+            LLSpatialGroup* group = (LLSpatialGroup*) part->mOctree->getListener(0);
+            group->rebound();
+
+            U32 culler = CULLER_DEFAULT;
+            if (LLPipeline::sShadowRender)
+            {
+                culler = CULLER_SHADOW;
+            }
+            else if (part->mInfiniteFarClip || (!LLPipeline::sUseFarClip && !gCubeSnapshot))
+            {
+                culler = CULLER_NO_FAR_CLIP;
+            }
+
+            // frustum test every group of the partition in one sweep
+            part->mGroupBounds.cull(camera, culler != CULLER_SHADOW, culler == CULLER_DEFAULT);
+
+            RootCull& root = sRoots[i];
+            root.mEntries.clear();
+            root.mShardBegin = sShards.mCount;
+            record_cull(&camera, part->mOctree, 0, culler, root.mEntries, &sShards);
+        }
+    }
+
+    U32 shard_count = sShards.mCount;
+
+    static LLCachedControl<U32> cull_jobs(gSavedSettings, "RenderParallelCullJobs", 3);
+    LL::parallelBatch(shard_count, cull_jobs, [&camera](U32 i)
+        {
+            CullShard& shard = sShards.mShards[i];
+            record_cull(&camera, shard.mNode, shard.mRes, shard.mCuller, shard.mEntries, nullptr);
+        });
+
+    {
+        LL_PROFILE_ZONE_NAMED_CATEGORY_SPATIAL("cull - replay");
+        for (U32 i = 0; i < partitions.size(); ++i)
+        {
+            RootCull& root = sRoots[i];
+            replay_cull(root.mEntries, camera);
+
+            U32 shard_end = i + 1 < partitions.size() ? sRoots[i + 1].mShardBegin : shard_count;
+            for (U32 j = root.mShardBegin; j < shard_end; ++j)
+            {
+                replay_cull(sShards.mShards[j].mEntries, camera);
+            }
+        }
+    }
+}
+
 void pushVerts(LLDrawInfo* params)
 {
 	LLRenderPass::applyModelMatrix(*params);
@@ -1501,6 +1805,7 @@ void pushVerts(LLDrawable* drawable)
 
 void pushVerts(LLVolume* volume)
 {
+	volume->expandFaces();
 	LLVertexBuffer::unbind();
 	for (S32 i = 0; i < volume->getNumVolumeFaces(); ++i)
 	{
@@ -2030,6 +2335,8 @@ void renderNormals(LLDrawable *drawablep)
 
         gGL.getTexUnit(0)->unbind(LLTexUnit::TT_TEXTURE);
 
+        volume->expandFaces();
+
         for (S32 i = 0; i < volume->getNumVolumeFaces(); ++i)
         {
             const LLVolumeFace &face = volume->getVolumeFace(i);
@@ -2250,6 +2557,8 @@ void renderPhysicsShape(LLDrawable* drawable, LLVOVolume* volume, bool wireframe
 
 			if (!phys_volume->mHullPoints)
 			{ //build convex hull
+				phys_volume->expandFaces();
+
 				std::vector<LLVector3> pos;
 				std::vector<U16> index;
 
@@ -2788,79 +3097,86 @@ void renderLights(LLDrawable* drawablep)
 	}
 }
 
-class LLRenderOctreeRaycast : public LLOctreeTriangleRayIntersect
+// draw the nodes of a face octree touched by the segment start -> start + dir,
+// along with the triangles of the leaves they contain
+static void renderOctreeRaycast(const LLVolumeBVH* octree, const LLVector4a* octree_positions, const LLVector4a& start, const LLVector4a& dir)
 {
-public:
-	
-	
-	LLRenderOctreeRaycast(const LLVector4a& start, const LLVector4a& dir, F32* closest_t)
-		: LLOctreeTriangleRayIntersect(start, dir, NULL, closest_t, NULL, NULL, NULL, NULL)
-	{
+	LLBVHRay ray(start, dir);
 
-	}
+	const LLVolumeBVH::Node* nodes = octree->getNodes();
+	const U16* triangles = octree->getTriangles();
 
-    void visit(const LLOctreeNode<LLVolumeTriangle, LLVolumeTriangle*>* branch)
+	for (U32 n = 0; n < octree->getNodeCount(); ++n)
 	{
-		LLVolumeOctreeListener* vl = (LLVolumeOctreeListener*) branch->getListener(0);
+		const LLVolumeBVH::Node& node = nodes[n];
 
-		LLVector3 center, size;
-		
-		if (branch->isEmpty())
-		{
-			gGL.diffuseColor3f(1.f,0.2f,0.f);
-			center.set(branch->getCenter().getF32ptr());
-			size.set(branch->getSize().getF32ptr());
-		}
-		else
-		{
-			gGL.diffuseColor3f(0.75f, 1.f, 0.f);
-			center.set(vl->mBounds[0].getF32ptr());
-			size.set(vl->mBounds[1].getF32ptr());
-		}
+		LLVector4a enter;
+		U32 mask = ray.intersectBoxes(node.mBounds, 1.f, enter);
 
-		drawBoxOutline(center, size);	
-		
-		for (U32 i = 0; i < 2; i++)
+		for (U32 c = 0; c < 4; ++c)
 		{
-			LLGLDepthTest depth(GL_TRUE, GL_FALSE, i == 1 ? GL_LEQUAL : GL_GREATER);
-
-			if (i == 1)
+			if (!(mask & (1 << c)))
 			{
-				gGL.diffuseColor4f(0,1,1,0.5f);
-			}
-			else
-			{
-				gGL.diffuseColor4f(0,0.5f,0.5f, 0.25f);
-				drawBoxOutline(center, size);
+				continue;
 			}
-			
-			if (i == 1)
+
+			LLVector4a min(node.mBounds[0][c], node.mBounds[1][c], node.mBounds[2][c]);
+			LLVector4a max(node.mBounds[3][c], node.mBounds[4][c], node.mBounds[5][c]);
+
+			LLVector4a center, size;
+			center.setAdd(min, max);
+			center.mul(0.5f);
+			size.setSub(max, min);
+			size.mul(0.5f);
+
+			gGL.diffuseColor3f(0.75f, 1.f, 0.f);
+			drawBoxOutline(center, size);
+
+			if (!node.isLeaf(c))
 			{
-				gGL.flush();
-				glLineWidth(3.f);
+				continue;
 			}
 
-			gGL.begin(LLRender::TRIANGLES);
-            for (LLOctreeNode<LLVolumeTriangle, LLVolumeTriangle*>::const_element_iter iter = branch->getDataBegin();
-					iter != branch->getDataEnd();
-					++iter)
+			for (U32 i = 0; i < 2; i++)
 			{
-				const LLVolumeTriangle* tri = *iter;
+				LLGLDepthTest depth(GL_TRUE, GL_FALSE, i == 1 ? GL_LEQUAL : GL_GREATER);
+
+				if (i == 1)
+				{
+					gGL.diffuseColor4f(0,1,1,0.5f);
+				}
+				else
+				{
+					gGL.diffuseColor4f(0,0.5f,0.5f, 0.25f);
+					drawBoxOutline(center, size);
+				}
 				
-				gGL.vertex3fv(tri->mV[0]->getF32ptr());
-				gGL.vertex3fv(tri->mV[1]->getF32ptr());
-				gGL.vertex3fv(tri->mV[2]->getF32ptr());
-			}	
-			gGL.end();
+				if (i == 1)
+				{
+					gGL.flush();
+					glLineWidth(3.f);
+				}
 
-			if (i == 1)
-			{
-				gGL.flush();
-				glLineWidth(1.f);
+				gGL.begin(LLRender::TRIANGLES);
+				for (U32 t = node.mChild[c]; t < node.mChild[c] + node.mCount[c]; ++t)
+				{
+					const U16* idx = triangles + t * 3;
+					
+					gGL.vertex3fv(octree_positions[idx[0]].getF32ptr());
+					gGL.vertex3fv(octree_positions[idx[1]].getF32ptr());
+					gGL.vertex3fv(octree_positions[idx[2]].getF32ptr());
+				}	
+				gGL.end();
+
+				if (i == 1)
+				{
+					gGL.flush();
+					glLineWidth(1.f);
+				}
 			}
 		}
 	}
-};
+}
 
 void renderRaycast(LLDrawable* drawablep)
 {
@@ -2881,12 +3197,17 @@ void renderRaycast(LLDrawable* drawablep)
 			bool transform = true;
 			if (drawablep->isState(LLDrawable::RIGGED))
 			{
+				// picking only skins the faces near the ray, skin them all
+				// for the current pose to draw the whole object
+				vobj->updateRiggedVolume(true);
 				volume = vobj->getRiggedVolume();
 				transform = false;
 			}
 
 			if (volume)
 			{
+				volume->expandFaces();
+
 				LLVector3 trans = drawablep->getRegion()->getOriginAgent();
 				
 				for (S32 i = 0; i < volume->getNumVolumeFaces(); ++i)
@@ -2932,16 +3253,12 @@ void renderRaycast(LLDrawable* drawablep)
 					
 					if (!volume->isUnique())
 					{
-						F32 t = 1.f;
+                        ((LLVolumeFace*) &face)->createOctree(); 
 
-                        if (!face.getOctree())
-						{
-							((LLVolumeFace*) &face)->createOctree(); 
-						}
-
-						LLRenderOctreeRaycast render(start, dir, &t);
-					
-                        render.traverse(face.getOctree());
+                        if (face.getOctree())
+                        {
+                            renderOctreeRaycast(face.getOctree(), face.mPositions, start, dir);
+                        }
 					}
 
 					gGL.popMatrix();		
@@ -3608,52 +3925,163 @@ public:
 	{
 	}
 	
+	// mStart and mEnd in the space of the partition group belongs to
+	void getLocalSegment(LLSpatialGroup* group, LLVector4a& local_start, LLVector4a& local_end) const
+	{
+		local_start = mStart;
+		local_end   = mEnd;
+
+		if (group->getSpatialPartition()->isBridge())
+		{
+			LLMatrix4 local_matrix = group->getSpatialPartition()->asBridge()->mDrawable->getRenderMatrix();
+			local_matrix.invert();
+			
+			LLMatrix4a local_matrix4a;
+			local_matrix4a.loadu(local_matrix);
+
+			local_matrix4a.affineTransform(mStart, local_start);
+			local_matrix4a.affineTransform(mEnd, local_end);
+		}
+	}
+
+	// fraction of the segment mStart -> end still in front of the closest hit,
+	// hits shorten mEnd.  Affine transforms preserve it, so it applies to
+	// distances measured in a bridge's local space as well.
+	F32 getRemaining(const LLVector4a& end) const
+	{
+		LLVector4a dir, remaining;
+		dir.setSub(end, mStart);
+		remaining.setSub(mEnd, mStart);
+
+		F32 length = dir.dot3(dir).getF32();
+		return length > 0.f ? remaining.dot3(dir).getF32() / length : 0.f;
+	}
+
 	virtual void visit(const OctreeNode* branch) 
 	{	
-		for (OctreeNode::const_element_iter i = branch->getDataBegin(); i != branch->getDataEnd(); ++i)
+		LLVector4a end = mEnd;
+		LLVector4a local_start, local_end;
+		getLocalSegment((LLSpatialGroup*) branch->getListener(0), local_start, local_end);
+
+		LLVector4a dir;
+		dir.setSub(local_end, local_start);
+		LLBVHRay ray(local_start, dir);
+
+		// test entry extents four at a time, narrow phase nearest first
+		OctreeNode::const_element_iter iter = branch->getDataBegin();
+		while (iter != branch->getDataEnd())
 		{
-			check(*i);
+			LLViewerOctreeEntry* entries[4];
+			LL_ALIGN_16(LLVector4a bounds[6]);
+			U32 count = 0;
+			for (; count < 4 && iter != branch->getDataEnd(); ++count, ++iter)
+			{
+				entries[count] = *iter;
+				const LLVector4a* extents = entries[count]->getSpatialExtents();
+				for (U32 axis = 0; axis < 3; ++axis)
+				{
+					bounds[axis].getF32ptr()[count] = extents[0][axis];
+					bounds[axis + 3].getF32ptr()[count] = extents[1][axis];
+				}
+			}
+			for (U32 i = count; i < 4; ++i)
+			{
+				for (U32 axis = 0; axis < 3; ++axis)
+				{
+					bounds[axis].getF32ptr()[i] = F32_MAX;
+					bounds[axis + 3].getF32ptr()[i] = -F32_MAX;
+				}
+			}
+
+			LLVector4a enter;
+			U32 mask = ray.intersectBoxes(bounds, getRemaining(end), enter);
+
+			std::pair<F32, U32> hits[4];
+			U32 hit_count = 0;
+			for (U32 i = 0; i < count; ++i)
+			{
+				if (mask & (1 << i))
+				{
+					hits[hit_count++] = std::make_pair(enter[i], i);
+				}
+			}
+			std::sort(hits, hits + hit_count);
+
+			for (U32 i = 0; i < hit_count; ++i)
+			{
+				if (hits[i].first <= getRemaining(end))
+				{
+					check(entries[hits[i].second]);
+				}
+			}
 		}
 	}
 
 	virtual LLDrawable* check(const OctreeNode* node)
 	{
 		node->accept(this);
-	
-		for (U32 i = 0; i < node->getChildCount(); i++)
+
+		U32 child_count = node->getChildCount();
+		if (!child_count)
 		{
-			const OctreeNode* child = node->getChild(i);
-			LLVector3 res;
+			return mHit;
+		}
 
-			LLSpatialGroup* group = (LLSpatialGroup*) child->getListener(0);
-			
-			LLVector4a size;
-			LLVector4a center;
-			
-			const LLVector4a* bounds = group->getBounds();
-			size = bounds[1];
-			center = bounds[0];
-			
-			LLVector4a local_start = mStart;
-			LLVector4a local_end   = mEnd;
+		// children share the partition of their parent
+		LLVector4a end = mEnd;
+		LLVector4a local_start, local_end;
+		getLocalSegment((LLSpatialGroup*) node->getListener(0), local_start, local_end);
 
-			if (group->getSpatialPartition()->isBridge())
-			{
-				LLMatrix4 local_matrix = group->getSpatialPartition()->asBridge()->mDrawable->getRenderMatrix();
-				local_matrix.invert();
-				
-				LLMatrix4a local_matrix4a;
-				local_matrix4a.loadu(local_matrix);
+		LLVector4a dir;
+		dir.setSub(local_end, local_start);
+		LLBVHRay ray(local_start, dir);
+
+		std::pair<F32, U32> hits[8];
+		U32 hit_count = 0;
 
-				local_matrix4a.affineTransform(mStart, local_start);
-				local_matrix4a.affineTransform(mEnd, local_end);
+		for (U32 base = 0; base < child_count; base += 4)
+		{
+			LL_ALIGN_16(LLVector4a bounds[6]);
+			for (U32 i = 0; i < 4; ++i)
+			{
+				if (base + i < child_count)
+				{
+					LLSpatialGroup* group = (LLSpatialGroup*) node->getChild(base + i)->getListener(0);
+					const LLVector4a* group_bounds = group->getBounds();
+					for (U32 axis = 0; axis < 3; ++axis)
+					{
+						bounds[axis].getF32ptr()[i] = group_bounds[0][axis] - group_bounds[1][axis];
+						bounds[axis + 3].getF32ptr()[i] = group_bounds[0][axis] + group_bounds[1][axis];
+					}
+				}
+				else
+				{
+					for (U32 axis = 0; axis < 3; ++axis)
+					{
+						bounds[axis].getF32ptr()[i] = F32_MAX;
+						bounds[axis + 3].getF32ptr()[i] = -F32_MAX;
+					}
+				}
 			}
 
-			if (LLLineSegmentBoxIntersect(local_start, local_end, center, size))
+			LLVector4a enter;
+			U32 mask = ray.intersectBoxes(bounds, 1.f, enter);
+			for (U32 i = 0; i < 4; ++i)
 			{
-				check(child);
+				if (mask & (1 << i))
+				{
+					hits[hit_count++] = std::make_pair(enter[i], base + i);
+				}
 			}
-		}	
+		}
+
+		// visit children near to far, a hit in one shortens the segment and
+		// culls the children that start past it
+		std::sort(hits, hits + hit_count);
+		for (U32 i = 0; i < hit_count && hits[i].first <= getRemaining(end); ++i)
+		{
+			check(node->getChild(hits[i].second));
+		}
 
 		return mHit;
 	}
@@ -3794,6 +4222,43 @@ LLDrawInfo::~LLDrawInfo()
 	{
 		gPipeline.checkReferences(this);
 	}
+
+	if (mInstanceBuffer)
+	{
+		glDeleteBuffers(1, &mInstanceBuffer);
+	}
+}
+
+U32 LLDrawInfo::getInstanceBuffer()
+{
+    if (!mInstanceBuffer && !mInstances.empty())
+    {
+        llassert(mInstances.size() <= LLGLSLShader::MAX_INSTANCES);
+
+        // std140 mat3x4 per instance, the transposed upper 4x3 of each matrix;
+        // always the full block size, GL requires the bound range to cover it
+        std::vector<F32> data(LLGLSLShader::MAX_INSTANCES * 12, 0.f);
+        U32 count = llmin((U32) mInstances.size(), LLGLSLShader::MAX_INSTANCES);
+        for (U32 i = 0; i < count; ++i)
+        {
+            const LLMatrix4& mat = mInstances[i];
+            F32* dst = &data[i * 12];
+            for (U32 j = 0; j < 3; ++j)
+            {
+                for (U32 k = 0; k < 4; ++k)
+                {
+                    dst[j * 4 + k] = mat.mMatrix[k][j];
+                }
+            }
+        }
+
+        glGenBuffers(1, &mInstanceBuffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, mInstanceBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, data.size() * sizeof(F32), data.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    return mInstanceBuffer;
 }
 
 LLColor4U LLDrawInfo::getDebugColor() const
@@ -3820,6 +4285,32 @@ U64 LLDrawInfo::getSkinHash()
     return mSkinInfo ? mSkinInfo->mHash : 0;
 }
 
+// top bits of a multiplicative hash of value
+static inline U64 sort_key_bits(U64 value, U32 bits)
+{
+    return (value * 0x9E3779B97F4A7C15ULL) >> (64 - bits);
+}
+
+void LLDrawInfo::updateSortKey()
+{
+    // Most expensive state change first:
+    //   63..56  shader mask and bump code
+    //   55..44  avatar and skin, matrix palette uploads for rigged draws
+    //   43..32  material
+    //   31..16  texture
+    //   15..6   vertex buffer
+    //    5..0   model matrix
+    // Fields are hashed, so a collision only costs an extra state change.
+    U64 shader = ((U64) (mShaderMask & 0xF) << 4) | (mBump & 0xF);
+    U64 skin = mAvatar.notNull() ? sort_key_bits((U64) (uintptr_t) mAvatar.get() ^ getSkinHash(), 12) : 0;
+    U64 material = mMaterialID.isNull() ? 0 : sort_key_bits(mMaterialID.getDigest64(), 12);
+    U64 texture = sort_key_bits((U64) (uintptr_t) mTexture.get(), 16);
+    U64 buffer = sort_key_bits((U64) (uintptr_t) mVertexBuffer.get(), 10);
+    U64 matrix = sort_key_bits((U64) (uintptr_t) mModelMatrix, 6);
+
+    mSortKey = (shader << 56) | (skin << 44) | (material << 32) | (texture << 16) | (buffer << 6) | matrix;
+}
+
 LLCullResult::LLCullResult() 
 {
 	mVisibleGroupsAllocated = 0;
@@ -4106,6 +4597,38 @@ void LLCullResult::pushDrawInfo(U32 type, LLDrawInfo* draw_info)
 	mRenderMapEnd[type] = &(mRenderMap[type][mRenderMapSize[type]]);
 }
 
+void LLCullResult::sortRenderMaps()
+{
+	LL_PROFILE_ZONE_SCOPED_CATEGORY_SPATIAL;
+
+	for (U32 type = 0; type < LLRenderPass::NUM_RENDER_TYPES; ++type)
+	{
+		if (type == LLRenderPass::PASS_ALPHA || type == LLRenderPass::PASS_ALPHA_RIGGED)
+		{
+			continue;
+		}
+
+		U32 count = mRenderMapSize[type];
+		if (count < 2)
+		{
+			continue;
+		}
+
+		if (mSortKeys.size() < count)
+		{
+			mSortKeys.resize(count);
+		}
+
+		LLDrawInfo** infos = &mRenderMap[type][0];
+		for (U32 i = 0; i < count; ++i)
+		{
+			mSortKeys[i] = infos[i]->mSortKey;
+		}
+
+		mRenderMapSorter.sort(mSortKeys.data(), infos, count);
+	}
+}
+
 
 void LLCullResult::assertDrawMapsEmpty()
 {
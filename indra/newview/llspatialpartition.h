@@ -42,6 +42,7 @@
 #include "llvector4a.h"
 #include "llvoavatar.h"
 #include "llfetchedgltfmaterial.h"
+#include "llradixsort.h"
 
 #include <queue>
 #include <unordered_map>
@@ -95,12 +96,22 @@ public:
     // return mSkinHash->mHash, or 0 if mSkinHash is null
     U64 getSkinHash();
 
+    // recompute mSortKey from the current state, call after the draw info is set up
+    void updateSortKey();
+
+    // uniform buffer holding mInstances in the layout of objects/instanceV.glsl,
+    // created on first use
+    U32 getInstanceBuffer();
+
 	LLPointer<LLVertexBuffer> mVertexBuffer;
     U16 mStart = 0;
     U16 mEnd = 0;
     U32 mCount = 0;
     U32 mOffset = 0;
 
+    // render map order, draws that share GL state get neighbouring keys, see updateSortKey
+    U64 mSortKey = 0;
+
 	LLPointer<LLViewerTexture>     mTexture;
     LLPointer<LLViewerTexture> mSpecularMap;
     LLPointer<LLViewerTexture> mNormalMap;
@@ -125,6 +136,11 @@ public:
 
     LLUUID mMaterialID; // id of LLGLTFMaterial or LLMaterial applied to this draw info
 
+    // when not empty, this draw renders one face once per transform here,
+    // applied after mModelMatrix (see LLVolumeGeometryManager::registerFace)
+    std::vector<LLMatrix4> mInstances;
+    U32 mInstanceBuffer = 0;
+
     U32 mShaderMask = 0;
     F32  mEnvIntensity = 0.f;
 	F32  mAlphaMaskCutoff = 0.5f;
@@ -417,6 +433,12 @@ public:
 	BOOL visibleObjectsInFrustum(LLCamera& camera);
 	/*virtual*/ S32 cull(LLCamera &camera, bool do_occlusion=false); // Cull on arbitrary frustum
 	S32 cull(LLCamera &camera, std::vector<LLDrawable *>* results, BOOL for_select); // Cull on arbitrary frustum
+
+	// Same result as calling cull(camera) on each of partitions in turn, but
+	// the frustum traversal of their subtrees is spread over the "General"
+	// thread pool.  Occlusion query readback and the LLCullResult updates
+	// are replayed on the calling thread in serial traversal order.
+	static void cullPartitions(LLCamera& camera, const std::vector<LLSpatialPartition*>& partitions);
 	
 	BOOL isVisible(const LLVector3& v);
 	bool isHUDPartition() ;
@@ -543,6 +565,10 @@ public:
 	void pushDrawable(LLDrawable* drawable);
 	void pushBridge(LLSpatialBridge* bridge);
 	void pushDrawInfo(U32 type, LLDrawInfo* draw_info);
+
+	// order each render map by LLDrawInfo::mSortKey, except the alpha
+	// passes which must keep their depth order
+	void sortRenderMaps();
 	
 	U32 getVisibleGroupsSize()		{ return mVisibleGroupsSize; }
 	U32	getAlphaGroupsSize()		{ return mAlphaGroupsSize; }
@@ -594,6 +620,8 @@ private:
 	U32					mRenderMapAllocated[LLRenderPass::NUM_RENDER_TYPES];
 	drawinfo_iterator mRenderMapEnd[LLRenderPass::NUM_RENDER_TYPES];
 
+	std::vector<U64>	mSortKeys;
+	LLRadixSort<LLDrawInfo*> mRenderMapSorter;
 };
 
 
@@ -679,7 +707,8 @@ class LLVolumeGeometryManager: public LLGeometryManager
 	virtual void getGeometry(LLSpatialGroup* group);
     virtual void addGeometryCount(LLSpatialGroup* group, U32& vertex_count, U32& index_count);
 	U32 genDrawInfo(LLSpatialGroup* group, U32 mask, LLFace** faces, U32 face_count, BOOL distance_sort = FALSE, BOOL batch_textures = FALSE, BOOL rigged = FALSE);
-	void registerFace(LLSpatialGroup* group, LLFace* facep, U32 type);
+	// instances, when given, are the faces facep draws copies of (facep first)
+	void registerFace(LLSpatialGroup* group, LLFace* facep, U32 type, const std::vector<LLFace*>* instances = nullptr);
 
 private:
 	void allocateFaces(U32 pMaxFaceCount);
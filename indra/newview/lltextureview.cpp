@@ -36,6 +36,7 @@
 #include "llui.h"
 #include "llimageworker.h"
 #include "llrender.h"
+#include "llvertexbuffer.h"
 
 #include "lltooltip.h"
 #include "llappviewer.h"
@@ -541,6 +542,16 @@ void LLGLTexMemBar::draw()
 	LLFontGL::getFontMonospace()->renderUTF8(text, 0, 0, v_offset + line_height*6,
 											 text_color, LLFontGL::LEFT, LLFontGL::TOP);
 
+    // vertex and index buffer slabs
+    text = llformat("VBO Pool: %.1f/%.1f MB Util: %d%% Frag: %d%%",
+                    recording.getLastValue(LLVertexBuffer::sVBOPoolUsed).value(),
+                    LLVertexBuffer::getBytesAllocated() / (1024.0 * 1024.0),
+                    S32(recording.getLastValue(LLVertexBuffer::sVBOPoolUtilization) * 100.0),
+                    S32(recording.getLastValue(LLVertexBuffer::sVBOPoolFragmentation) * 100.0));
+
+	LLFontGL::getFontMonospace()->renderUTF8(text, 0, 0, v_offset + line_height*7,
+											 text_color, LLFontGL::LEFT, LLFontGL::TOP);
+
 	U32 cache_read(0U), cache_write(0U), res_wait(0U);
 	LLAppViewer::getTextureFetch()->getStateStats(&cache_read, &cache_write, &res_wait);
 	
@@ -650,7 +661,7 @@ BOOL LLGLTexMemBar::handleMouseDown(S32 x, S32 y, MASK mask)
 LLRect LLGLTexMemBar::getRequiredRect()
 {
 	LLRect rect;
-	rect.mTop = 78; //LLFontGL::getFontMonospace()->getLineHeight() * 6;
+	rect.mTop = 91; //LLFontGL::getFontMonospace()->getLineHeight() * 7;
 	return rect;
 }
 
@@ -805,6 +805,8 @@ BOOL LLViewerCamera::areVertsVisible(LLViewerObject* volumep, BOOL all_verts)
 	LLMatrix4a mata;
 	mata.loadu(mat);
 
+	volume->expandFaces();
+
 	num_faces = volume->getNumVolumeFaces();
 	for (i = 0; i < num_faces; i++)
 	{
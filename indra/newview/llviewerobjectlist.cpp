@@ -934,12 +934,29 @@ void LLViewerObjectList::update(LLAgent &agent)
 	}
 	else
 	{
+		// avatars first, all together, so their poses can be computed in parallel
+		static std::vector<LLVOAvatar*> idle_avatars;
+		idle_avatars.clear();
+		for (std::vector<LLViewerObject*>::iterator idle_iter = idle_list.begin();
+			idle_iter != idle_end; idle_iter++)
+		{
+			objectp = *idle_iter;
+			if (objectp->isAvatar())
+			{
+				idle_avatars.push_back((LLVOAvatar*) objectp);
+			}
+		}
+		LLVOAvatar::idleUpdateAvatars(agent, frame_time, idle_avatars);
+
 		for (std::vector<LLViewerObject*>::iterator idle_iter = idle_list.begin();
 			idle_iter != idle_end; idle_iter++)
 		{
 			objectp = *idle_iter;
 			llassert(objectp->isActive());
+			if (!objectp->isAvatar())
+			{
                 objectp->idleUpdate(agent, frame_time);
+			}
 		}
 
 		//update flexible objects
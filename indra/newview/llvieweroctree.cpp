@@ -33,6 +33,7 @@
 #include "llglslshader.h"
 #include "llviewershadermgr.h"
 #include "lldrawpoolwater.h"
+#include "llviewerstats.h"
 
 //-----------------------------------------------------------------------------------
 //static variables definitions
@@ -40,8 +41,7 @@
 U32 LLViewerOctreeEntryData::sCurVisible = 10; //reserve the low numbers for special use.
 BOOL LLViewerOctreeDebug::sInDebug = FALSE;
 
-static LLTrace::CountStatHandle<S32> sOcclusionQueries("occlusion_queries", "Number of occlusion queries executed"),
-									 sNumObjectsOccluded("occluded_objects", "Count of objects being occluded by a query"),
+static LLTrace::CountStatHandle<S32> sNumObjectsOccluded("occluded_objects", "Count of objects being occluded by a query"),
 									 sNumObjectsUnoccluded("unoccluded_objects", "Count of objects being unoccluded by a query");
 
 //-----------------------------------------------------------------------------------
@@ -863,8 +863,11 @@ public:
 
 LLOcclusionCullingGroup::LLOcclusionCullingGroup(OctreeNode* node, LLViewerOctreePartition* part) : 
 	LLViewerOctreeGroup(node),
-	mSpatialPartition(part)
+	mSpatialPartition(part),
+	mBoundsIndex(-1)
 {
+	mBoundsIndex = part->mGroupBounds.add(this);
+
 	part->mLODSeed = (part->mLODSeed+1)%part->mLODPeriod;
 	mLODHash = part->mLODSeed;
 
@@ -875,6 +878,7 @@ LLOcclusionCullingGroup::LLOcclusionCullingGroup(OctreeNode* node, LLViewerOctre
 	{
 		mOcclusionQuery[i] = 0;
         mOcclusionCheckCount[i] = 0;
+        mVisibleStreak[i] = 0;
 		mOcclusionIssued[i] = 0;
 		mOcclusionState[i] = parent ? SG_STATE_INHERIT_MASK & parent->mOcclusionState[i] : 0;
 		mVisible[i] = 0;
@@ -884,6 +888,43 @@ LLOcclusionCullingGroup::LLOcclusionCullingGroup(OctreeNode* node, LLViewerOctre
 LLOcclusionCullingGroup::~LLOcclusionCullingGroup()
 {
 	releaseOcclusionQueryObjectNames();
+	releaseBoundsIndex();
+}
+
+//virtual
+void LLOcclusionCullingGroup::rebound()
+{
+	if (!isDirty())
+	{
+		return;
+	}
+
+	LLViewerOctreeGroup::rebound();
+	updateBoundsIndex();
+}
+
+//virtual
+void LLOcclusionCullingGroup::handleDestruction(const TreeNode* node)
+{
+	releaseBoundsIndex();
+	LLViewerOctreeGroup::handleDestruction(node);
+}
+
+void LLOcclusionCullingGroup::updateBoundsIndex()
+{
+	if (mBoundsIndex >= 0)
+	{
+		mSpatialPartition->mGroupBounds.update(mBoundsIndex, this);
+	}
+}
+
+void LLOcclusionCullingGroup::releaseBoundsIndex()
+{
+	if (mBoundsIndex >= 0)
+	{
+		mSpatialPartition->mGroupBounds.remove(mBoundsIndex);
+		mBoundsIndex = -1;
+	}
 }
 
 BOOL LLOcclusionCullingGroup::needsUpdate()
@@ -891,6 +932,25 @@ BOOL LLOcclusionCullingGroup::needsUpdate()
 	return (LLDrawable::getCurrentFrame() % mSpatialPartition->mLODPeriod == mLODHash) ? TRUE : FALSE;
 }
 
+BOOL LLOcclusionCullingGroup::needsOcclusionQuery()
+{
+	static LLCachedControl<U32> max_interval(gSavedSettings, "RenderOcclusionMaxInterval", 8);
+
+	// every visible result doubles the frames until the next query, up to
+	// max_interval, but never more often than the partition updates LOD
+	U32 streak = llmin(mVisibleStreak[LLViewerCamera::sCurCameraID], (U32) 16);
+	U32 interval = llmin((U32) 1 << streak, llmax((U32) max_interval, (U32) 1));
+	interval = llmax(interval, mSpatialPartition->mLODPeriod);
+
+	U32 stagger = (U32) mLODHash;
+	if (interval > mSpatialPartition->mLODPeriod)
+	{ // spread the queries of a partition's groups over the interval
+		stagger += (U32) (((uintptr_t) this) >> 6);
+	}
+
+	return (LLDrawable::getCurrentFrame() % interval == stagger % interval) ? TRUE : FALSE;
+}
+
 BOOL LLOcclusionCullingGroup::isRecentlyVisible() const
 {
 	const S32 MIN_VIS_FRAME_RANGE = 2;
@@ -1137,7 +1197,7 @@ void LLOcclusionCullingGroup::checkOcclusion()
 
             static LLCachedControl<S32> occlusion_timeout(gSavedSettings, "RenderOcclusionTimeout", 4);
 
-            if (available || mOcclusionCheckCount[LLViewerCamera::sCurCameraID] > occlusion_timeout)
+            if (available)
             {   
                 mOcclusionCheckCount[LLViewerCamera::sCurCameraID] = 0;
                 GLuint query_result;    // Will be # samples drawn, or a boolean depending on mHasOcclusionQuery2 (both are type GLuint)
@@ -1148,17 +1208,35 @@ void LLOcclusionCullingGroup::checkOcclusion()
 #if LL_TRACK_PENDING_OCCLUSION_QUERIES
                 sPendingQueries.erase(mOcclusionQuery[LLViewerCamera::sCurCameraID]);
 #endif
+                add(LLStatViewer::OCCLUSION_QUERIES_READY, 1);
 
+                U32& streak = mVisibleStreak[LLViewerCamera::sCurCameraID];
                 if (query_result > 0)
                 {
                     clearOcclusionState(LLOcclusionCullingGroup::OCCLUDED, LLOcclusionCullingGroup::STATE_MODE_DIFF);
+                    streak = llmin(streak + 1, (U32) 255);
                 }
                 else
                 {
                     setOcclusionState(LLOcclusionCullingGroup::OCCLUDED, LLOcclusionCullingGroup::STATE_MODE_DIFF);
+                    streak = 0;
                 }
                 clearOcclusionState(QUERY_PENDING);
             }
+            else if (mOcclusionCheckCount[LLViewerCamera::sCurCameraID] > occlusion_timeout)
+            {   // don't stall waiting on the result, treat the group as visible and query it again
+                mOcclusionCheckCount[LLViewerCamera::sCurCameraID] = 0;
+#if LL_TRACK_PENDING_OCCLUSION_QUERIES
+                sPendingQueries.erase(mOcclusionQuery[LLViewerCamera::sCurCameraID]);
+#endif
+                releaseOcclusionQueryObjectName(mOcclusionQuery[LLViewerCamera::sCurCameraID]);
+                mOcclusionQuery[LLViewerCamera::sCurCameraID] = 0;
+                mVisibleStreak[LLViewerCamera::sCurCameraID] = 0;
+                add(LLStatViewer::OCCLUSION_QUERIES_STALLED, 1);
+
+                clearOcclusionState(LLOcclusionCullingGroup::OCCLUDED, LLOcclusionCullingGroup::STATE_MODE_DIFF);
+                clearOcclusionState(QUERY_PENDING);
+            }
         }
     }
     else if (mSpatialPartition->isOcclusionEnabled() && isOcclusionState(LLOcclusionCullingGroup::OCCLUDED))
@@ -1196,6 +1274,7 @@ void LLOcclusionCullingGroup::doOcclusion(LLCamera* camera, const LLVector4a* sh
 			assert_states_valid(this);
 			clearOcclusionState(LLOcclusionCullingGroup::OCCLUDED, LLOcclusionCullingGroup::STATE_MODE_DIFF);
 			assert_states_valid(this);
+			mVisibleStreak[LLViewerCamera::sCurCameraID] = 0;
 		}
 		else
 		{
@@ -1222,7 +1301,7 @@ void LLOcclusionCullingGroup::doOcclusion(LLCamera* camera, const LLVector4a* sh
 #if LL_TRACK_PENDING_OCCLUSION_QUERIES
 					sPendingQueries.insert(mOcclusionQuery[LLViewerCamera::sCurCameraID]);
 #endif
-					add(sOcclusionQueries, 1);
+					add(LLStatViewer::OCCLUSION_QUERIES, 1);
 
 					{
                         LL_PROFILE_ZONE_NAMED_CATEGORY_OCTREE("doOcclusion - push");
@@ -1296,6 +1375,111 @@ void LLOcclusionCullingGroup::doOcclusion(LLCamera* camera, const LLVector4a* sh
 //end of occulsion culling functions and classes
 //-------------------------------------------------------------------------------------------
 
+//-----------------------------------------------------------------------------------
+//class LLViewerOctreeGroupBounds definitions
+//-----------------------------------------------------------------------------------
+U32 LLViewerOctreeGroupBounds::add(LLOcclusionCullingGroup* group)
+{
+	U32 index = (U32) mGroups.size();
+	mGroups.push_back(group);
+
+	for (U32 i = 0; i < 2; i++)
+	{
+		mBounds[i].push_back(group->mBounds[i]);
+		mExtents[i].push_back(group->mExtents[i]);
+		mObjectBounds[i].push_back(group->mObjectBounds[i]);
+		mObjectExtents[i].push_back(group->mObjectExtents[i]);
+	}
+
+	return index;
+}
+
+void LLViewerOctreeGroupBounds::remove(U32 index)
+{
+	llassert(index < mGroups.size());
+
+	// move the last group into the hole
+	U32 last = (U32) mGroups.size() - 1;
+	if (index != last)
+	{
+		mGroups[index] = mGroups[last];
+		mGroups[index]->mBoundsIndex = index;
+
+		for (U32 i = 0; i < 2; i++)
+		{
+			mBounds[i][index] = mBounds[i][last];
+			mExtents[i][index] = mExtents[i][last];
+			mObjectBounds[i][index] = mObjectBounds[i][last];
+			mObjectExtents[i][index] = mObjectExtents[i][last];
+		}
+	}
+
+	mGroups.pop_back();
+	for (U32 i = 0; i < 2; i++)
+	{
+		mBounds[i].resize(last);
+		mExtents[i].resize(last);
+		mObjectBounds[i].resize(last);
+		mObjectExtents[i].resize(last);
+	}
+
+	// results no longer line up with the groups
+	mGroupResult.clear();
+	mObjectResult.clear();
+}
+
+void LLViewerOctreeGroupBounds::update(U32 index, const LLViewerOctreeGroup* group)
+{
+	llassert(index < mGroups.size());
+
+	const LLVector4a* bounds = group->getBounds();
+	const LLVector4a* extents = group->getExtents();
+	const LLVector4a* object_bounds = group->getObjectBounds();
+	const LLVector4a* object_extents = group->getObjectExtents();
+
+	for (U32 i = 0; i < 2; i++)
+	{
+		mBounds[i][index] = bounds[i];
+		mExtents[i][index] = extents[i];
+		mObjectBounds[i][index] = object_bounds[i];
+		mObjectExtents[i][index] = object_extents[i];
+	}
+}
+
+void LLViewerOctreeGroupBounds::cull(LLCamera& camera, bool no_far_clip, bool far_sphere)
+{
+	LL_PROFILE_ZONE_SCOPED_CATEGORY_OCTREE;
+
+	U32 count = size();
+	mGroupResult.resize(count);
+	mObjectResult.resize(count);
+	if (!count)
+	{
+		return;
+	}
+
+	camera.AABBInFrustumBatch(mBounds[0].mArray, mBounds[1].mArray, count, &mGroupResult[0], no_far_clip);
+	camera.AABBInFrustumBatch(mObjectBounds[0].mArray, mObjectBounds[1].mArray, count, &mObjectResult[0], no_far_clip);
+
+	if (far_sphere)
+	{
+		const LLVector3& origin = camera.getOrigin();
+		F32 radius = camera.mFrustumCornerDist;
+		for (U32 i = 0; i < count; i++)
+		{
+			if (mGroupResult[i])
+			{
+				mGroupResult[i] = llmin((S32) mGroupResult[i], AABBSphereIntersect(mExtents[0][i], mExtents[1][i], origin, radius));
+			}
+
+			if (mObjectResult[i])
+			{
+				mObjectResult[i] = llmin((S32) mObjectResult[i], AABBSphereIntersect(mObjectExtents[0][i], mObjectExtents[1][i], origin, radius));
+			}
+		}
+	}
+}
+
 //-----------------------------------------------------------------------------------
 //class LLViewerOctreePartition definitions
 //-----------------------------------------------------------------------------------
@@ -35,6 +35,7 @@
 #include "v4math.h"
 #include "m4math.h"
 #include "llvector4a.h"
+#include "llalignedarray.h"
 #include "llquaternion.h"
 #include "lloctree.h"
 #include "llviewercamera.h"
@@ -301,6 +302,11 @@ public:
 		*this = rhs;
 	}	
 
+	//virtual
+	void rebound();
+	//virtual
+	void handleDestruction(const TreeNode* node);
+
 	void setOcclusionState(U32 state, S32 mode = STATE_MODE_SINGLE);
 	void clearOcclusionState(U32 state, S32 mode = STATE_MODE_SINGLE);
 	void checkOcclusion(); //read back last occlusion query (if any)
@@ -309,6 +315,9 @@ public:
 	U32  getOcclusionState() const	{ return mOcclusionState[LLViewerCamera::sCurCameraID];}
 
 	BOOL needsUpdate();
+	// true if this group is due another occlusion query while visible, groups
+	// that keep coming back visible are queried less often
+	BOOL needsOcclusionQuery();
 	U32  getLastOcclusionIssuedTime();
 
 	//virtual 
@@ -319,11 +328,17 @@ public:
 	LLViewerOctreePartition* getSpatialPartition()const {return mSpatialPartition;}
 	BOOL isAnyRecentlyVisible() const;
 
+	// index of this group in its partition's LLViewerOctreeGroupBounds, -1 if not tracked
+	S32 getBoundsIndex() const { return mBoundsIndex; }
+
 	static U32 getNewOcclusionQueryObjectName();
 	static void releaseOcclusionQueryObjectName(U32 name);
 
 protected:
 	void releaseOcclusionQueryObjectNames();
+	// copy bounds to the partition's packed arrays, call whenever they change
+	void updateBoundsIndex();
+	void releaseBoundsIndex();
 
 private:	
 	BOOL earlyFail(LLCamera* camera, const LLVector4a* bounds);
@@ -337,11 +352,48 @@ protected:
 	LLViewerOctreePartition* mSpatialPartition;
 	U32		                 mOcclusionQuery[LLViewerCamera::NUM_CAMERAS];
     U32                      mOcclusionCheckCount[LLViewerCamera::NUM_CAMERAS];
+    U32                      mVisibleStreak[LLViewerCamera::NUM_CAMERAS]; // consecutive queries that came back visible
+	S32                      mBoundsIndex;
+
+	friend class LLViewerOctreeGroupBounds;
 
 public:		
 	static std::set<U32> sPendingQueries;
 };//LL_ALIGN_POSTFIX(16);
 
+// Bounds of every group of a partition packed structure of arrays, kept in
+// step with the groups as they are created, rebound, shifted and destroyed.
+// Lets a cull frustum test all of a partition's groups in one SIMD sweep
+// up front, the octree traversal then only looks up the answers.
+class LLViewerOctreeGroupBounds
+{
+public:
+	U32 add(LLOcclusionCullingGroup* group);
+	void remove(U32 index);
+	void update(U32 index, const LLViewerOctreeGroup* group);
+
+	// Test every group and its objects against camera, with the far clip
+	// plane unless no_far_clip is set and clipped to the sphere through the
+	// far corners of the frustum if far_sphere is set, the way the
+	// LLOctreeCull variants test them one at a time.
+	void cull(LLCamera& camera, bool no_far_clip, bool far_sphere);
+
+	U32 size() const { return (U32) mGroups.size(); }
+	bool hasResults() const { return mGroupResult.size() == mGroups.size(); }
+	// result of the last cull: 0 outside, 1 partly in, 2 fully in
+	S32 getGroupResult(U32 index) const { return mGroupResult[index]; }
+	S32 getObjectResult(U32 index) const { return mObjectResult[index]; }
+
+private:
+	LLAlignedArray<LLVector4a, 64> mBounds[2];        // center, size
+	LLAlignedArray<LLVector4a, 64> mExtents[2];       // min, max
+	LLAlignedArray<LLVector4a, 64> mObjectBounds[2];
+	LLAlignedArray<LLVector4a, 64> mObjectExtents[2];
+	std::vector<LLOcclusionCullingGroup*> mGroups;
+	std::vector<U8> mGroupResult;
+	std::vector<U8> mObjectResult;
+};
+
 class LLViewerOctreePartition
 {
 public:
@@ -364,6 +416,7 @@ public:
 	BOOL             mOcclusionEnabled; // if TRUE, occlusion culling is performed
 	U32              mLODSeed;
 	U32              mLODPeriod;	//number of frames between LOD updates for a given spatial group (staggered by mLODSeed)
+	LLViewerOctreeGroupBounds mGroupBounds;
 };
 
 class LLViewerOctreeCull : public OctreeTraveler
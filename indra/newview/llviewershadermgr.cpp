@@ -221,6 +221,7 @@ bool make_rigged_variant(LLGLSLShader& shader, LLGLSLShader& riggedShader)
     riggedShader.mName = llformat("Skinned %s", shader.mName.c_str());
     riggedShader.mFeatures = shader.mFeatures;
     riggedShader.mFeatures.hasObjectSkinning = true;
+    riggedShader.mFeatures.hasInstancing = false;
     riggedShader.mDefines = shader.mDefines;    // NOTE: Must come before addPermutation
     riggedShader.addPermutation("HAS_SKIN", "1");
     riggedShader.mShaderFiles = shader.mShaderFiles;
@@ -978,6 +979,8 @@ BOOL LLViewerShaderMgr::loadShadersDeferred()
 		gDeferredDiffuseProgram.mFeatures.mIndexedTextureChannels = LLGLSLShader::sIndexedTextureChannels;
 		gDeferredDiffuseProgram.mShaderLevel = mShaderLevel[SHADER_DEFERRED];
         success = make_rigged_variant(gDeferredDiffuseProgram, gDeferredSkinnedDiffuseProgram);
+        gDeferredDiffuseProgram.mFeatures.hasInstancing = true;
+        gDeferredDiffuseProgram.addPermutation("HAS_INSTANCING", "1");
 		success = success && gDeferredDiffuseProgram.createShader(NULL, NULL);
 	}
 
@@ -1129,6 +1132,8 @@ BOOL LLViewerShaderMgr::loadShadersDeferred()
         gDeferredPBROpaqueProgram.clearPermutations();
         
         success = make_rigged_variant(gDeferredPBROpaqueProgram, gDeferredSkinnedPBROpaqueProgram);
+        gDeferredPBROpaqueProgram.mFeatures.hasInstancing = true;
+        gDeferredPBROpaqueProgram.addPermutation("HAS_INSTANCING", "1");
         if (success)
         {
             success = gDeferredPBROpaqueProgram.createShader(NULL, NULL);
@@ -1822,6 +1827,8 @@ BOOL LLViewerShaderMgr::loadShadersDeferred()
 		gDeferredShadowProgram.mShaderFiles.push_back(make_pair("deferred/shadowF.glsl", GL_FRAGMENT_SHADER));
 		gDeferredShadowProgram.mShaderLevel = mShaderLevel[SHADER_DEFERRED];
 		gDeferredShadowProgram.mRiggedVariant = &gDeferredSkinnedShadowProgram;
+		gDeferredShadowProgram.mFeatures.hasInstancing = true;
+		gDeferredShadowProgram.addPermutation("HAS_INSTANCING", "1");
 		success = gDeferredShadowProgram.createShader(NULL, NULL);
 		llassert(success);
 	}
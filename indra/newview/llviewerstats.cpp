@@ -140,7 +140,10 @@ LLTrace::CountStatHandle<>	FPS("FPS", "Frames rendered"),
 							FRAMETIME_DOUBLED("frametimedoubled", "Ratio of frames 2x longer than previous"),
 							TEX_BAKES("texbakes", "Number of times avatar textures have been baked"),
 							TEX_REBAKES("texrebakes", "Number of times avatar textures have been forced to rebake"),
-							NUM_NEW_OBJECTS("numnewobjectsstat", "Number of objects in scene that were not previously in cache");
+							NUM_NEW_OBJECTS("numnewobjectsstat", "Number of objects in scene that were not previously in cache"),
+							OCCLUSION_QUERIES("occlusion_queries", "Number of occlusion queries executed"),
+							OCCLUSION_QUERIES_READY("occlusion_queries_ready", "Number of occlusion query results read back"),
+							OCCLUSION_QUERIES_STALLED("occlusion_queries_stalled", "Number of occlusion queries abandoned because their result was not ready in time");
 
 LLTrace::CountStatHandle<LLUnit<F64, LLUnits::Kilotriangles> > 
 							TRIANGLES_DRAWN("trianglesdrawnstat");
@@ -148,6 +151,10 @@ LLTrace::CountStatHandle<LLUnit<F64, LLUnits::Kilotriangles> >
 LLTrace::EventStatHandle<LLUnit<F64, LLUnits::Kilotriangles> >
 							TRIANGLES_DRAWN_PER_FRAME("trianglesdrawnperframestat");
 
+LLTrace::EventStatHandle<>	OCCLUSION_QUERIES_PER_FRAME("occlusionqueriesperframestat"),
+							OCCLUSION_QUERIES_READY_PER_FRAME("occlusionqueriesreadyperframestat"),
+							OCCLUSION_QUERIES_STALLED_PER_FRAME("occlusionqueriesstalledperframestat");
+
 LLTrace::CountStatHandle<F64Kilobytes >	
 							ACTIVE_MESSAGE_DATA_RECEIVED("activemessagedatareceived", "Message system data received on all active regions"),
 							LAYERS_NETWORK_DATA_RECEIVED("layersdatareceived", "Network data received for layer data (terrain)"),
@@ -399,6 +406,9 @@ void update_statistics()
 	LLTrace::Recording& last_frame_recording = LLTrace::get_frame_recording().getLastRecording();
 
 	record(LLStatViewer::TRIANGLES_DRAWN_PER_FRAME, last_frame_recording.getSum(LLStatViewer::TRIANGLES_DRAWN));
+	record(LLStatViewer::OCCLUSION_QUERIES_PER_FRAME, last_frame_recording.getSum(LLStatViewer::OCCLUSION_QUERIES));
+	record(LLStatViewer::OCCLUSION_QUERIES_READY_PER_FRAME, last_frame_recording.getSum(LLStatViewer::OCCLUSION_QUERIES_READY));
+	record(LLStatViewer::OCCLUSION_QUERIES_STALLED_PER_FRAME, last_frame_recording.getSum(LLStatViewer::OCCLUSION_QUERIES_STALLED));
 
 	sample(LLStatViewer::ENABLE_VBO,      (F64)gSavedSettings.getBOOL("RenderVBOEnable"));
 	sample(LLStatViewer::DRAW_DISTANCE,   (F64)gSavedSettings.getF32("RenderFarClip"));
@@ -138,7 +138,10 @@ extern LLTrace::CountStatHandle<>			FPS,
 											FRAMETIME_DOUBLED,
 											TEX_BAKES,
 											TEX_REBAKES,
-											NUM_NEW_OBJECTS;
+											NUM_NEW_OBJECTS,
+											OCCLUSION_QUERIES,
+											OCCLUSION_QUERIES_READY,
+											OCCLUSION_QUERIES_STALLED;
 
 extern LLTrace::CountStatHandle<LLUnit<F64, LLUnits::Kilotriangles> > TRIANGLES_DRAWN;
 
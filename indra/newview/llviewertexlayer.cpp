@@ -33,9 +33,11 @@
 #include "llnotificationsutil.h"
 #include "llviewerregion.h"
 #include "llglslshader.h"
+#include "lltexlayercomposite.h"
 #include "llvoavatarself.h"
 #include "pipeline.h"
 #include "llviewercontrol.h"
+#include "workqueue.h"
 
 // runway consolidate
 extern std::string self_av_string();
@@ -54,7 +56,10 @@ LLViewerTexLayerSetBuffer::LLViewerTexLayerSetBuffer(LLTexLayerSet* const owner,
 	LLTexLayerSetBuffer(owner),
     LLViewerDynamicTexture(width, height, 4, LLViewerDynamicTexture::ORDER_LAST, FALSE),
 	mNeedsUpdate(TRUE),
-	mNumLowresUpdates(0)
+	mNumLowresUpdates(0),
+	mUpdateRequests(0),
+	mCompositeBake(NULL),
+	mCompositeOnGL(FALSE)
 {
 	mGLTexturep->setNeedsAlphaAndPickMask(FALSE);
 
@@ -101,6 +106,7 @@ void LLViewerTexLayerSetBuffer::requestUpdate()
 	restartUpdateTimer();
 	mNeedsUpdate = TRUE;
 	mNumLowresUpdates = 0;
+	mUpdateRequests++;
 }
 
 void LLViewerTexLayerSetBuffer::restartUpdateTimer()
@@ -111,6 +117,24 @@ void LLViewerTexLayerSetBuffer::restartUpdateTimer()
 
 // virtual
 BOOL LLViewerTexLayerSetBuffer::needsRender()
+{
+	if (!isReadyToRender())
+	{
+		return FALSE;
+	}
+
+	// Left to updateCompositeBake() when compositing on the CPU, unless it
+	// couldn't make this update.
+	static LLCachedControl<bool> bake_on_cpu(gSavedSettings, "AvatarBakeLocalTexturesOnCPU", false);
+	if (mCompositeBake || (bake_on_cpu && !mCompositeOnGL))
+	{
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+BOOL LLViewerTexLayerSetBuffer::isReadyToRender() const
 {
 	llassert(mTexLayerSet->getAvatarAppearance() == gAgentAvatarp);
 	if (!isAgentAvatarValid()) return FALSE;
@@ -137,7 +161,123 @@ BOOL LLViewerTexLayerSetBuffer::needsRender()
 	}
 
 	// Render if we have at least minimal level of detail for each local texture.
-	return getViewerTexLayerSet()->isLocalTextureDataAvailable();
+	if (!getViewerTexLayerSet()->isLocalTextureDataAvailable())
+	{
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+// Composites on the CPU, for GL not to have to, when an update is due and
+// the local textures have decoded pixels to make it from.
+void LLViewerTexLayerSetBuffer::updateCompositeBake()
+{
+	if (mCompositeBake || mCompositeOnGL || !isReadyToRender())
+	{
+		return;
+	}
+
+	if (!startCompositeBake())
+	{
+		mCompositeOnGL = TRUE;
+	}
+}
+
+// Records the layer set's draws and makes them on the General pool, to be
+// uploaded when done.  Returns FALSE for GL to render it instead, as when a
+// local texture has no decoded pixels yet.
+BOOL LLViewerTexLayerSetBuffer::startCompositeBake()
+{
+	LL::WorkQueue::ptr_t main_queue = LL::WorkQueue::getInstance("mainloop");
+	LL::WorkQueue::ptr_t general_queue = LL::WorkQueue::getInstance("General");
+	if (!main_queue || !general_queue)
+	{
+		return FALSE;
+	}
+
+	std::unique_ptr<LLTexLayerComposite> recorded(new LLTexLayerComposite(getFullWidth(), getFullHeight()));
+	if (recorded->getImage()->isBufferInvalid())
+	{
+		return FALSE;
+	}
+
+	mTexLayerSet->recordComposite(*recorded);
+	if (recorded->isMissingSource())
+	{
+		return FALSE;
+	}
+
+	static LLCachedControl<U32> bake_jobs(gSavedSettings, "AvatarBakeCPUJobs", 3);
+	U32 helpers = bake_jobs;
+	BOOL highest_lod = getViewerTexLayerSet()->isLocalTextureDataFinal();
+	U32 update_requests = mUpdateRequests;
+
+	// LLRefCount isn't atomic and the closures are copied and destroyed on
+	// the worker, so they only carry plain pointers.  The composite holds
+	// main thread images and is deleted by the main thread callback, the
+	// buffer may be gone by then and is looked up before it's used.
+	LLTexLayerComposite* composite = recorded.release();
+	LLViewerTexLayerSetBuffer* buffer = this;
+
+	mCompositeBake = composite;
+	main_queue->postTo(
+		general_queue,
+		[composite, helpers]()
+		{
+			LL_PROFILE_ZONE_NAMED_CATEGORY_AVATAR("composite bake");
+			composite->run(helpers);
+		},
+		[buffer, composite, highest_lod, update_requests]()
+		{
+			if (isInstance(buffer))
+			{
+				buffer->finishCompositeBake(composite, highest_lod, update_requests);
+			}
+			delete composite;
+		});
+
+	return TRUE;
+}
+
+// static
+bool LLViewerTexLayerSetBuffer::isInstance(LLViewerTexLayerSetBuffer* buffer)
+{
+	// the destructor takes the buffer out of the instance list
+	return sInstances[ORDER_LAST].count(buffer) != 0;
+}
+
+void LLViewerTexLayerSetBuffer::finishCompositeBake(LLTexLayerComposite* composite, BOOL highest_lod, U32 update_requests)
+{
+	if (mCompositeBake != composite)
+	{
+		// cancelled, our layer set is gone
+		return;
+	}
+	mCompositeBake = NULL;
+
+	if (!isAgentAvatarValid())
+	{
+		return;
+	}
+
+	// the only GL left to do
+	mGLTexturep->setSubImage(composite->getImage(), 0, 0, getFullWidth(), getFullHeight());
+	mTexLayerSet->applyCompositeMorphMasks(*composite);
+
+	doUpdate();
+	mGLTexturep->setGLTextureCreated(true);
+
+	if (!highest_lod || mUpdateRequests != update_requests)
+	{
+		// made from lower res textures than we may have now, or out of date already
+		mNeedsUpdate = TRUE;
+	}
+}
+
+void LLViewerTexLayerSetBuffer::cancelCompositeBake()
+{
+	mCompositeBake = NULL;
 }
 
 // virtual
@@ -203,6 +343,12 @@ BOOL LLViewerTexLayerSetBuffer::requestUpdateImmediate()
 	mNeedsUpdate = TRUE;
 	BOOL result = FALSE;
 
+	static LLCachedControl<bool> bake_on_cpu(gSavedSettings, "AvatarBakeLocalTexturesOnCPU", false);
+	if (bake_on_cpu)
+	{
+		updateCompositeBake();
+	}
+
 	if (needsRender())
 	{
 		preRender(FALSE);
@@ -227,6 +373,7 @@ void LLViewerTexLayerSetBuffer::doUpdate()
 	{
 		mNumLowresUpdates++;
 	}
+	mCompositeOnGL = FALSE;
 
 	restartUpdateTimer();
 
@@ -263,6 +410,13 @@ LLViewerTexLayerSet::LLViewerTexLayerSet(LLAvatarAppearance* const appearance) :
 // virtual
 LLViewerTexLayerSet::~LLViewerTexLayerSet()
 {
+	// a CPU bake finishing after us would have no layers to go back to
+	LLViewerTexLayerSetBuffer* composite = dynamic_cast<LLViewerTexLayerSetBuffer*>(mComposite.get());
+	if (composite)
+	{
+		composite->cancelCompositeBake();
+	}
+	releaseLocalTextureRaws();
 }
 
 // Returns TRUE if at least one packet of data has been received for each of the textures that this layerset depends on.
@@ -296,6 +450,28 @@ void LLViewerTexLayerSet::updateComposite()
 	getViewerComposite()->requestUpdateImmediate();
 }
 
+void LLViewerTexLayerSet::updateCompositeBake()
+{
+	static LLCachedControl<bool> bake_on_cpu(gSavedSettings, "AvatarBakeLocalTexturesOnCPU", false);
+	if (!bake_on_cpu)
+	{
+		releaseLocalTextureRaws();
+		return;
+	}
+
+	LLViewerTexLayerSetBuffer* composite = dynamic_cast<LLViewerTexLayerSetBuffer*>(mComposite.get());
+	if (composite)
+	{
+		composite->updateCompositeBake();
+	}
+
+	if (!composite || composite->isUpToDate())
+	{
+		// nothing left to composite until the next change
+		releaseLocalTextureRaws();
+	}
+}
+
 // virtual
 void LLViewerTexLayerSet::createComposite()
 {
@@ -312,6 +488,41 @@ void LLViewerTexLayerSet::createComposite()
 	}
 }
 
+// virtual
+LLImageRaw* LLViewerTexLayerSet::getLocalTextureRaw(LLGLTexture* tex)
+{
+	LLViewerFetchedTexture* fetched = LLViewerTextureManager::staticCastToFetchedTexture(tex);
+	if (!fetched)
+	{
+		return NULL;
+	}
+
+	// keep the decoded pixels of what we composite until the bake is final
+	fetched->forceToSaveRawImage(0);
+	mKeptRawTextures.insert(fetched);
+
+	LLImageRaw* raw = fetched->hasSavedRawImage() ? fetched->getSavedRawImage() : NULL;
+	if (!raw || raw->getWidth() < fetched->getWidth() || raw->getHeight() < fetched->getHeight())
+	{
+		// nothing yet, or not as sharp as what GL has
+		return NULL;
+	}
+	return raw;
+}
+
+void LLViewerTexLayerSet::releaseLocalTextureRaws()
+{
+	for (LLViewerFetchedTexture* fetched : mKeptRawTextures)
+	{
+		// textures still loading keep theirs for their loaded callbacks
+		if (!fetched->hasCallbacks())
+		{
+			fetched->destroySavedRawImage();
+		}
+	}
+	mKeptRawTextures.clear();
+}
+
 void LLViewerTexLayerSet::setUpdatesEnabled( BOOL b )
 {
 	mUpdatesEnabled = b; 
@@ -31,6 +31,10 @@
 #include "llextendedstatus.h"
 #include "lltexlayer.h"
 
+#include <set>
+
+class LLTexLayerComposite;
+class LLViewerFetchedTexture;
 class LLVOAvatarSelf;
 class LLViewerTexLayerSetBuffer;
 
@@ -53,6 +57,11 @@ public:
 	/*virtual*/void				createComposite();
 	void						setUpdatesEnabled(BOOL b);
 	BOOL						getUpdatesEnabled()	const 	{ return mUpdatesEnabled; }
+	/*virtual*/ LLImageRaw*		getLocalTextureRaw(LLGLTexture* tex);
+	// Lets go of the decoded pixels getLocalTextureRaw() kept
+	void						releaseLocalTextureRaws();
+	// Starts a CPU bake when one is due, called every frame
+	void						updateCompositeBake();
 
 	LLVOAvatarSelf*				getAvatar();
 	const LLVOAvatarSelf*		getAvatar()	const;
@@ -61,6 +70,8 @@ public:
 
 private:
 	BOOL						mUpdatesEnabled;
+	typedef std::set<LLPointer<LLViewerFetchedTexture> > texture_set_t;
+	texture_set_t				mKeptRawTextures;	// local textures keeping decoded pixels for CPU bakes
 
 };
 
@@ -127,6 +138,25 @@ private:
 	BOOL					mNeedsUpdate; 					// Whether we need to locally update our baked textures
 	U32						mNumLowresUpdates; 				// Number of times we've locally updated with lowres version of our baked textures
 	LLFrameTimer    		mNeedsUpdateTimer; 				// Tracks time since update was requested and performed.
+	U32						mUpdateRequests;				// Number of requestUpdate() calls, to tell if any came in during a CPU bake
+
+	//--------------------------------------------------------------------
+	// CPU Bakes
+	//--------------------------------------------------------------------
+public:
+	void					updateCompositeBake();
+	void					cancelCompositeBake();
+	// Made from the final local textures, with no bake in flight
+	BOOL					isUpToDate() const						{ return !mNeedsUpdate && mCompositeBake == NULL; }
+protected:
+	BOOL					isReadyToRender() const;
+	BOOL					startCompositeBake();
+	void					finishCompositeBake(LLTexLayerComposite* composite, BOOL highest_lod, U32 update_requests);
+private:
+	static bool				isInstance(LLViewerTexLayerSetBuffer* buffer);
+
+	LLTexLayerComposite*	mCompositeBake;					// The CPU bake in flight, if any, owned by its callback
+	BOOL					mCompositeOnGL;					// This update couldn't be made on the CPU, GL renders it
 };
 
 #endif  // LL_VIEWER_TEXLAYER_H
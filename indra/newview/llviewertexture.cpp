@@ -1164,9 +1164,7 @@ void LLViewerFetchedTexture::loadFromFastCache()
         record(LLTextureFetch::sCacheHitRate, LLUnits::Ratio::fromValue(1));
         sample(LLTextureFetch::sCacheReadLatency, cachReadTime);
 
-		mFullWidth = mRawImage->getWidth() << mRawDiscardLevel;
-		mFullHeight = mRawImage->getHeight() << mRawDiscardLevel;
-		setTexelsPerImage();
+		setFullSize(mRawImage->getWidth() << mRawDiscardLevel, mRawImage->getHeight() << mRawDiscardLevel);
 
 		if(mFullWidth > MAX_IMAGE_SIZE || mFullHeight > MAX_IMAGE_SIZE)
 		{ 
@@ -1456,9 +1454,7 @@ BOOL LLViewerFetchedTexture::preCreateTexture(S32 usename/*= 0*/)
             mRawImage->expandToPowerOfTwo(MAX_IMAGE_SIZE, FALSE);
         }
 
-        mFullWidth = mRawImage->getWidth();
-        mFullHeight = mRawImage->getHeight();
-        setTexelsPerImage();
+        setFullSize(mRawImage->getWidth(), mRawImage->getHeight());
     }
     else
     {
@@ -1907,9 +1903,7 @@ bool LLViewerFetchedTexture::updateFetch()
 				(current_discard < 0 || mRawDiscardLevel < current_discard))
 			{
                 LL_PROFILE_ZONE_NAMED_CATEGORY_TEXTURE("vftuf - data good");
-				mFullWidth = mRawImage->getWidth() << mRawDiscardLevel;
-				mFullHeight = mRawImage->getHeight() << mRawDiscardLevel;
-				setTexelsPerImage();
+				setFullSize(mRawImage->getWidth() << mRawDiscardLevel, mRawImage->getHeight() << mRawDiscardLevel);
 
 				if(mFullWidth > MAX_IMAGE_SIZE || mFullHeight > MAX_IMAGE_SIZE)
 				{ 
@@ -2894,6 +2888,40 @@ void LLViewerFetchedTexture::checkCachedRawSculptImage()
 	}
 }
 
+// The render complexity of the volumes using this texture depends on its
+// full size, tell them when it changes.
+void LLViewerFetchedTexture::setFullSize(S32 width, S32 height)
+{
+	bool changed = width != mFullWidth || height != mFullHeight;
+	mFullWidth = width;
+	mFullHeight = height;
+	setTexelsPerImage();
+
+	if (!changed)
+	{
+		return;
+	}
+	for (U32 ch = 0; ch < LLRender::NUM_TEXTURE_CHANNELS; ++ch)
+	{
+		for (U32 i = 0; i < mNumFaces[ch]; ++i)
+		{
+			LLDrawable* drawable = mFaceList[ch][i]->getDrawable();
+			LLVOVolume* volume = drawable ? drawable->getVOVolume() : NULL;
+			if (volume)
+			{
+				volume->updateVisualComplexity();
+			}
+		}
+	}
+	for (U32 ch = 0; ch < LLRender::NUM_VOLUME_TEXTURE_CHANNELS; ++ch)
+	{
+		for (U32 i = 0; i < mNumVolumes[ch]; ++i)
+		{
+			mVolumeList[ch][i]->updateVisualComplexity();
+		}
+	}
+}
+
 void LLViewerFetchedTexture::saveRawImage() 
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_TEXTURE;
@@ -427,6 +427,7 @@ private:
 
 	void saveRawImage() ;
 	void setCachedRawImage() ;
+	void setFullSize(S32 width, S32 height);
 
 	//for atlas
 	void resetFaceAtlas() ;
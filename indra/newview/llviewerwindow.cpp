@@ -678,8 +678,12 @@ public:
 			addText(xpos, ypos, llformat("%d Texture Matrix Ops", gPipeline.mTextureMatrixOps));
 			ypos += y_inc;
 
+			addText(xpos, ypos, llformat("%d Draws Saved by Instancing", gPipeline.mInstancedDrawsSaved));
+			ypos += y_inc;
+
 			gPipeline.mTextureMatrixOps = 0;
 			gPipeline.mMatrixOpCount = 0;
+			gPipeline.mInstancedDrawsSaved = 0;
 
  			if (last_frame_recording.getSampleCount(LLPipeline::sStatBatchSize) > 0)
 			{
@@ -691,6 +695,18 @@ public:
 			LLRender::sUICalls = LLRender::sUIVerts = 0;
 			ypos += y_inc;
 
+			addText(xpos, ypos, llformat("Immediate Streamed/Waits: %d/%d Cache Hits/Misses: %d/%d",
+				LLRender::sStreamedBatches, LLRender::sStreamWaits, LLRender::sCacheHits, LLRender::sCacheMisses));
+			LLRender::sStreamedBatches = LLRender::sStreamWaits = 0;
+			LLRender::sCacheHits = LLRender::sCacheMisses = 0;
+			ypos += y_inc;
+
+			addText(xpos, ypos, llformat("glUniform Calls/Merged: %d/%d Shadow Block Uploads: %d",
+				LLGLSLShader::sUniformCalls, LLGLSLShader::sUniformsMerged, gPipeline.mShadowBlockUploads));
+			LLGLSLShader::sUniformCalls = LLGLSLShader::sUniformsMerged = 0;
+			gPipeline.mShadowBlockUploads = 0;
+			ypos += y_inc;
+
 			addText(xpos,ypos, llformat("%d/%d Nodes visible", gPipeline.mNumVisibleNodes, LLSpatialGroup::sNodeCount));
 			
 			ypos += y_inc;
@@ -706,6 +722,12 @@ public:
 			
 			ypos += y_inc;
 
+			addText(xpos, ypos, llformat("Avatar Anim LOD Avatars/Joints: full %d/%d reduced %d/%d minimal %d/%d",
+				LLVOAvatar::sAnimLODAvatars[LLVOAvatar::ANIM_LOD_FULL], LLVOAvatar::sAnimLODJoints[LLVOAvatar::ANIM_LOD_FULL],
+				LLVOAvatar::sAnimLODAvatars[LLVOAvatar::ANIM_LOD_REDUCED], LLVOAvatar::sAnimLODJoints[LLVOAvatar::ANIM_LOD_REDUCED],
+				LLVOAvatar::sAnimLODAvatars[LLVOAvatar::ANIM_LOD_MINIMAL], LLVOAvatar::sAnimLODJoints[LLVOAvatar::ANIM_LOD_MINIMAL]));
+			ypos += y_inc;
+
 			addText(xpos,ypos, llformat("%d Lights visible", LLPipeline::sVisibleLightCount));
 			
 			ypos += y_inc;
@@ -114,6 +114,7 @@
 #include "llskinningutil.h"
 
 #include "llperfstats.h"
+#include "llparallelbatch.h"
 
 #include <boost/lexical_cast.hpp>
 
@@ -324,6 +325,11 @@ public:
 		mTorsoState->setUsage(LLJointState::ROT);
 
 		addJointState( mTorsoState );
+
+		// noise2() builds its tables on first use; do that here on the main
+		// thread rather than from avatars being posed on worker threads
+		F32 warm[2] = { 0.f, 0.f };
+		noise2(warm);
 		return STATUS_SUCCESS;
 	}
 
@@ -592,6 +598,8 @@ bool LLVOAvatar::sLimitNonImpostors = false; // True unless RenderAvatarMaxNonIm
 F32 LLVOAvatar::sRenderDistance = 256.f;
 S32	LLVOAvatar::sNumVisibleAvatars = 0;
 S32	LLVOAvatar::sNumLODChangesThisFrame = 0;
+U32 LLVOAvatar::sAnimLODAvatars[LLVOAvatar::ANIM_LOD_COUNT] = { 0 };
+U32 LLVOAvatar::sAnimLODJoints[LLVOAvatar::ANIM_LOD_COUNT] = { 0 };
 
 const LLUUID LLVOAvatar::sStepSoundOnLand("e8af4a28-aa83-4310-a7c4-c047e15ea0df");
 const LLUUID LLVOAvatar::sStepSounds[LL_MCODE_END] =
@@ -670,6 +678,14 @@ LLVOAvatar::LLVOAvatar(const LLUUID& id,
 	mCulled( FALSE ),
 	mVisibilityRank(0),
 	mNeedsSkin(FALSE),
+	mPosePending(false),
+	mPoseMotionsPending(false),
+	mPoseVisible(false),
+	mPoseNeedsPalettes(false),
+	mPoseSitGroundConstrained(false),
+	mPoseEvaluated(false),
+	mPoseUpdateType(LLCharacter::NORMAL_UPDATE),
+	mAnimationLOD(ANIM_LOD_FULL),
 	mLastSkinTime(0.f),
 	mUpdatePeriod(1),
 	mOverallAppearance(AOA_INVISIBLE),
@@ -2556,10 +2572,69 @@ void LLVOAvatar::idleUpdate(LLAgent &agent, const F64 &time)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
 
+	if (idleUpdateBegin(agent, time))
+	{
+		updateCharacterPose();
+		idleUpdateFinish(agent);
+	}
+}
+
+// static
+void LLVOAvatar::idleUpdateAvatars(LLAgent &agent, const F64 &time, const std::vector<LLVOAvatar*>& avatars)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+
+    static LLCachedControl<U32> pose_jobs(gSavedSettings, "AvatarParallelUpdateJobs", 3);
+
+    // avatars between idleUpdateBegin() and idleUpdateFinish()
+    static std::vector<LLVOAvatar*> sPosing;
+    sPosing.clear();
+
+    for (S32 lod = 0; lod < ANIM_LOD_COUNT; ++lod)
+    {
+        sAnimLODAvatars[lod] = 0;
+        sAnimLODJoints[lod] = 0;
+    }
+
+    for (LLVOAvatar* avatar : avatars)
+    {
+        if (!pose_jobs || !avatar->canPoseInParallel())
+        {
+            avatar->idleUpdate(agent, time);
+        }
+        else if (avatar->idleUpdateBegin(agent, time))
+        {
+            sPosing.push_back(avatar);
+        }
+    }
+
+    LL::parallelBatch((U32) sPosing.size(), pose_jobs, [](U32 i)
+        {
+            sPosing[i]->updateCharacterPose();
+        });
+
+    for (LLVOAvatar* avatar : sPosing)
+    {
+        avatar->idleUpdateFinish(agent);
+    }
+}
+
+bool LLVOAvatar::canPoseInParallel() const
+{
+    // agent avatar motions message the simulator and drive the camera, and
+    // preview avatars are driven by their floaters
+    return !isSelf() && mSpecialRenderMode == 0;
+}
+
+bool LLVOAvatar::idleUpdateBegin(LLAgent &agent, const F64 &time)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+	mPosePending = false;
+
 	if (isDead())
 	{
 		LL_INFOS() << "Warning!  Idle on dead avatar" << LL_ENDL;
-		return;
+		return false;
 	}
     // record time and refresh "tooSlow" status
     updateTooSlow();
@@ -2572,7 +2647,7 @@ void LLVOAvatar::idleUpdate(LLAgent &agent, const F64 &time)
         {
             idleUpdateNameTag(idleCalcNameTagPosition(mLastRootPos));
         }
-		return;
+		return false;
 	}
 
     // Update should be happening max once per frame.
@@ -2648,7 +2723,15 @@ void LLVOAvatar::idleUpdate(LLAgent &agent, const F64 &time)
 	// animate the character
 	// store off last frame's root position to be consistent with camera position
 	mLastRootPos = mRoot->getWorldPosition();
-	BOOL detailed_update = updateCharacter(agent);
+	mPosePending = beginUpdateCharacter(agent);
+
+	return true;
+}
+
+void LLVOAvatar::idleUpdateFinish(LLAgent &agent)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+	BOOL detailed_update = finishUpdateCharacter();
 
 	static LLUICachedControl<bool> visualizers_in_calls("ShowVoiceVisualizersInCalls", false);
 	bool voice_enabled = (visualizers_in_calls || LLVoiceClient::getInstance()->inProximalChannel()) &&
@@ -3020,12 +3103,14 @@ void LLVOAvatar::idleUpdateAppearanceAnimation()
 			}
 
 			// apply all params
+			beginDeferredMorphs();
 			for (param = getFirstVisualParam();
 				 param;
 				 param = getNextVisualParam())
 			{
 				param->apply(avatar_sex);
 			}
+			applyDeferredMorphs();
 
 			mLastAppearanceBlendTime = appearance_anim_time;
 		}
@@ -3708,7 +3793,7 @@ void LLVOAvatar::slamPosition()
 	{
 		gPipeline.updateMoveNormalAsync(mDrawable);
 	}
-	mRoot->updateWorldMatrixChildren();
+	updateJointWorldMatrices();
 }
 
 bool LLVOAvatar::isVisuallyMuted()
@@ -4359,40 +4444,60 @@ void LLVOAvatar::updateOrientation(LLAgent& agent, F32 speed, F32 delta_time)
 }
 
 //------------------------------------------------------------------------
-// updateTimeStep()
-// Factored out from updateCharacter().
+// updateAnimationLOD()
 //
-// Updates the time step used by the motion controller, based on area
-// and avatar count criteria.  This will also stop the
-// ANIM_AGENT_WALK_ADJUST animation under some circumstances.
+// Picks the animation level of detail from the avatar's pixel area.
+// Distant avatars evaluate their motions at a reduced rate, interpolating
+// the pose in between, and the most distant ones animate only the base
+// skeleton.
 // ------------------------------------------------------------------------
-void LLVOAvatar::updateTimeStep()
+void LLVOAvatar::updateAnimationLOD()
 {
-	if (!isSelf() && !isUIAvatar()) // ie, non-self avatars, and animated objects will be affected.
+	static LLCachedControl<bool> anim_lod_enabled(gSavedSettings, "AvatarAnimationLOD", true);
+	static LLCachedControl<F32> reduced_area(gSavedSettings, "AvatarAnimationLODReducedArea", 5000.f);
+	static LLCachedControl<F32> minimal_area(gSavedSettings, "AvatarAnimationLODMinimalArea", 1000.f);
+
+	const F32 REDUCED_TIME_STEP = 1.f / 15.f;
+	const F32 MINIMAL_TIME_STEP = 1.f / 8.f;
+	// avatars must grow this much past a threshold to get more detail again,
+	// so ones sitting on a threshold don't flip every frame
+	const F32 HYSTERESIS = 1.25f;
+
+	S32 lod = ANIM_LOD_FULL;
+	if (anim_lod_enabled && !isSelf() && !isUIAvatar() && mSpecialRenderMode == 0)
 	{
-        // Note that sInstances counts animated objects and
-        // standard avatars in the same bucket. Is this desirable?
-		F32 time_quantum = clamp_rescale((F32)sInstances.size(), 10.f, 35.f, 0.f, 0.25f);
-		F32 pixel_area_scale = clamp_rescale(mPixelArea, 100, 5000, 1.f, 0.f);
-		F32 time_step = time_quantum * pixel_area_scale;
-        // Extrema:
-        //   If number of avs is 10 or less, time_step is unmodified (flagged with 0.0).
-        //   If area of av is 5000 or greater, time_step is unmodified (flagged with 0.0).
-        //   If number of avs is 35 or greater, and area of av is 100 or less,
-        //   time_step takes the maximum possible value of 0.25.
-        //   Other situations will give values within the (0, 0.25) range.
-		if (time_step != 0.f)
+		F32 minimal = minimal_area * (mAnimationLOD >= ANIM_LOD_MINIMAL ? HYSTERESIS : 1.f);
+		F32 reduced = reduced_area * (mAnimationLOD >= ANIM_LOD_REDUCED ? HYSTERESIS : 1.f);
+		if (mPixelArea < minimal)
+		{
+			lod = ANIM_LOD_MINIMAL;
+		}
+		else if (mPixelArea < reduced)
 		{
-			// disable walk motion servo controller as it doesn't work with motion timesteps
-			stopMotion(ANIM_AGENT_WALK_ADJUST);
-			removeAnimationData("Walk Speed");
+			lod = ANIM_LOD_REDUCED;
 		}
-        // See SL-763 - playback with altered time step does not
-        // appear to work correctly, odd behavior for distant avatars.
-        // As of 11-2017, LLMotionController::updateMotions() will
-        // ignore the value here. Need to re-enable if it's every
-        // fixed.
-		mMotionController.setTimeStep(time_step);
+	}
+
+	if (lod == mAnimationLOD)
+	{
+		return;
+	}
+	mAnimationLOD = lod;
+
+	if (lod != ANIM_LOD_FULL)
+	{
+		// disable walk motion servo controller as it doesn't work with motion timesteps
+		stopMotion(ANIM_AGENT_WALK_ADJUST);
+		removeAnimationData("Walk Speed");
+	}
+	mMotionController.setTimeStep(lod == ANIM_LOD_MINIMAL ? MINIMAL_TIME_STEP :
+								  lod == ANIM_LOD_REDUCED ? REDUCED_TIME_STEP : 0.f);
+	mMotionController.setBaseJointsOnly(lod == ANIM_LOD_MINIMAL);
+
+	if (lod == ANIM_LOD_FULL && isAnyAnimationSignaled(AGENT_WALK_ANIMS, NUM_AGENT_WALK_ANIMS))
+	{
+		// processAnimationStateChanges() held it back while stepping
+		startMotion(ANIM_AGENT_WALK_ADJUST);
 	}
 }
 
@@ -4597,11 +4702,20 @@ bool LLVOAvatar::computeNeedsUpdate()
 //------------------------------------------------------------------------
 bool LLVOAvatar::updateCharacter(LLAgent &agent)
 {	
+	mPosePending = beginUpdateCharacter(agent);
+	updateCharacterPose();
+	return finishUpdateCharacter();
+}
+
+// Main thread half of updateCharacter(), up to the motion evaluation.
+// Returns false if there is no pose to update.
+bool LLVOAvatar::beginUpdateCharacter(LLAgent &agent)
+{
 	updateDebugText();
 	
 	if (!mIsBuilt)
 	{
-		return FALSE;
+		return false;
 	}
 
 	BOOL visible = isVisible();
@@ -4641,7 +4755,7 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
 	if (!needs_update && !isSelf())
 	{
 		updateMotions(LLCharacter::HIDDEN_UPDATE);
-		return FALSE;
+		return false;
 	}
 
 	//--------------------------------------------------------------------
@@ -4651,10 +4765,9 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
 	updateOverallAppearance();
 	
 	//--------------------------------------------------------------------
-	// change animation time quanta based on avatar render load
+	// change animation time quanta and joint set based on avatar render load
 	//--------------------------------------------------------------------
-    // SL-763 the time step quantization does not currently work.
-    //updateTimeStep();
+    updateAnimationLOD();
     
 	//--------------------------------------------------------------------
     // Update sitting state based on parent and active animation info.
@@ -4700,20 +4813,47 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
 	// update animations
 	if (!visible)
 	{
-		updateMotions(LLCharacter::HIDDEN_UPDATE);
+		mPoseUpdateType = LLCharacter::HIDDEN_UPDATE;
 	}
 	else if (mSpecialRenderMode == 1) // Animation Preview
 	{
-		updateMotions(LLCharacter::FORCE_UPDATE);
+		mPoseUpdateType = LLCharacter::FORCE_UPDATE;
 	}
 	else
 	{
 		// Might be better to do HIDDEN_UPDATE if cloud
-		updateMotions(LLCharacter::NORMAL_UPDATE);
+		mPoseUpdateType = LLCharacter::NORMAL_UPDATE;
+	}
+	mPoseMotionsPending = beginUpdateMotions(mPoseUpdateType);
+	mPoseVisible = visible;
+	// impostors only need skinning matrices when the impostor is redrawn,
+	// which builds them on demand
+	mPoseNeedsPalettes = visible && !(isImpostor() && !needsImpostorUpdate());
+	mPoseSitGroundConstrained = was_sit_ground_constrained;
+
+	return true;
+}
+
+// Evaluate and blend the motions started by beginUpdateCharacter() and
+// bring the skeleton and skinning matrices up to date.  Touches nothing
+// but this avatar, so different avatars may be posed concurrently.
+void LLVOAvatar::updateCharacterPose()
+{
+	if (!mPosePending)
+	{
+		return;
+	}
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+
+	mPoseEvaluated = mPoseMotionsPending;
+	if (mPoseMotionsPending)
+	{
+		finishUpdateMotions(mPoseUpdateType);
+		mPoseMotionsPending = false;
 	}
 
 	// Special handling for sitting on ground.
-	if (!getParent() && (isSitting() || was_sit_ground_constrained))
+	if (!getParent() && (isSitting() || mPoseSitGroundConstrained))
 	{
 		
 		F32 off_z = LLVector3d(getHoverOffset()).mdV[VZ];
@@ -4727,22 +4867,44 @@ bool LLVOAvatar::updateCharacter(LLAgent &agent)
 		}
 	}
 
+	// Update child joints as needed.
+	updateJointWorldMatrices();
+
+	if (mPoseNeedsPalettes)
+	{
+		updateMatrixPalettes();
+	}
+}
+
+// Main thread side effects of the new pose.  Returns true if the avatar
+// is visible and got a detailed update.
+bool LLVOAvatar::finishUpdateCharacter()
+{
+	if (!mPosePending)
+	{
+		return false;
+	}
+	mPosePending = false;
+
+	sAnimLODAvatars[mAnimationLOD]++;
+	if (mPoseEvaluated)
+	{
+		sAnimLODJoints[mAnimationLOD] += mMotionController.getNumBlendedJoints();
+	}
+
 	// update head position
 	updateHeadOffset();
 
 	// Generate footstep sounds when feet hit the ground
     updateFootstepSounds();
 
-	// Update child joints as needed.
-	mRoot->updateWorldMatrixChildren();
-
-    if (visible)
+    if (mPoseVisible)
     {
 		// System avatar mesh vertices need to be reskinned.
 		mNeedsSkin = TRUE;
     }
 
-	return visible;
+	return mPoseVisible;
 }
 
 //-----------------------------------------------------------------------------
@@ -4837,12 +4999,20 @@ void LLVOAvatar::debugBodySize() const
     LL_DEBUGS("Avatar") << "new_body_size " << new_body_size << LL_ENDL;
 }
    
+//------------------------------------------------------------------------
+// updateJointWorldMatrices
+//------------------------------------------------------------------------
+void LLVOAvatar::updateJointWorldMatrices()
+{
+	mJointSkeleton.updateWorldMatrices(mRoot);
+}
+
 //------------------------------------------------------------------------
 // postPelvisSetRecalc
 //------------------------------------------------------------------------
 void LLVOAvatar::postPelvisSetRecalc()
 {		
-	mRoot->updateWorldMatrixChildren();			
+	updateJointWorldMatrices();			
 	computeBodySize();
 	dirtyMesh(2);
 }
@@ -5836,7 +6006,12 @@ void LLVOAvatar::processAnimationStateChanges()
 {
 	if ( isAnyAnimationSignaled(AGENT_WALK_ANIMS, NUM_AGENT_WALK_ANIMS) )
 	{
-		startMotion(ANIM_AGENT_WALK_ADJUST);
+		// the walk motion servo controller doesn't work with motion
+		// timesteps, see updateAnimationLOD()
+		if (mMotionController.getTimeStep() == 0.f)
+		{
+			startMotion(ANIM_AGENT_WALK_ADJUST);
+		}
 		stopMotion(ANIM_AGENT_FLY_ADJUST);
 	}
 	else if (mInAir && !isSitting())
@@ -6179,13 +6354,10 @@ LLJoint *LLVOAvatar::getJoint( const std::string &name )
 
 	if (iter == mJointMap.end() || iter->second == NULL)
 	{   //search for joint and cache found joint in lookup table
-		if (mJointAliasMap.empty())
-		{
-			getJointAliases();
-		}
-		joint_alias_map_t::const_iterator alias_iter = mJointAliasMap.find(name);
+		const joint_alias_map_t& joint_aliases = getJointAliases();
+		joint_alias_map_t::const_iterator alias_iter = joint_aliases.find(name);
 		std::string canonical_name;
-		if (alias_iter != mJointAliasMap.end())
+		if (alias_iter != joint_aliases.end())
 		{
 			canonical_name = alias_iter->second;
 		}
@@ -7031,7 +7203,9 @@ void LLVOAvatar::updateVisualParams()
 	ESex avatar_sex = (getVisualParamWeight("male") > 0.5f) ? SEX_MALE : SEX_FEMALE;
 	if (getSex() != avatar_sex)
 	{
-		if (mIsSitting && findMotion(avatar_sex == SEX_MALE ? ANIM_AGENT_SIT_FEMALE : ANIM_AGENT_SIT) != NULL)
+		// motions update visual params from updateCharacterPose(), possibly
+		// on a worker, where motions must not be started or stopped
+		if (mIsSitting && on_main_thread() && findMotion(avatar_sex == SEX_MALE ? ANIM_AGENT_SIT_FEMALE : ANIM_AGENT_SIT) != NULL)
 		{
 			// In some cases of gender change server changes sit motion with motion message,
 			// but in case of some avatars (legacy?) there is no update from server side,
@@ -7049,18 +7223,51 @@ void LLVOAvatar::updateVisualParams()
 		}
 	}
 
+	beginDeferredMorphs();
 	LLCharacter::updateVisualParams();
+	applyDeferredMorphs();
 
 	if (mLastSkeletonSerialNum != mSkeletonSerialNum)
 	{
 		computeBodySize();
 		mLastSkeletonSerialNum = mSkeletonSerialNum;
-		mRoot->updateWorldMatrixChildren();
+		updateJointWorldMatrices();
 	}
 
 	dirtyMesh();
 	updateHeadOffset();
 }
+
+void LLVOAvatar::applyDeferredMorphs()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+
+    if (!on_main_thread())
+    {
+        // already posing on a General pool thread, whose siblings are busy
+        // posing other avatars
+        std::vector<LLPolyMesh*> meshes;
+        endDeferredMorphs(meshes);
+        for (LLPolyMesh* mesh : meshes)
+        {
+            mesh->applyDeferredMorphs();
+        }
+        return;
+    }
+
+    static LLCachedControl<U32> morph_jobs(gSavedSettings, "AvatarParallelMorphJobs", 3);
+
+    // reused from call to call
+    static std::vector<LLPolyMesh*> sMorphing;
+    sMorphing.clear();
+    endDeferredMorphs(sMorphing);
+
+    LL::parallelBatch((U32) sMorphing.size(), morph_jobs, [](U32 i)
+        {
+            sMorphing[i]->applyDeferredMorphs();
+        });
+}
+
 //-----------------------------------------------------------------------------
 // isActive()
 //-----------------------------------------------------------------------------
@@ -7393,7 +7600,7 @@ const LLViewerJointAttachment *LLVOAvatar::attachObject(LLViewerObject *viewer_o
         updateAttachmentOverrides();
     }
 
-	updateVisualComplexity();
+	updateVisualComplexity(viewer_object);
 
 	if (viewer_object->isSelected())
 	{
@@ -7681,7 +7888,7 @@ BOOL LLVOAvatar::detachObject(LLViewerObject *viewer_object)
 		
 		if (attachment->isObjectAttached(viewer_object))
 		{
-            updateVisualComplexity();
+            updateVisualComplexity(viewer_object);
             bool is_animated_object = viewer_object->isAnimatedObject();
 			cleanupAttachedMesh(viewer_object);
 
@@ -7789,7 +7996,7 @@ void LLVOAvatar::sitOnObject(LLViewerObject *sit_object)
 	mRoot->getXform()->setParent(&sit_object->mDrawable->mXform); // LLVOAvatar::sitOnObject
 	// SL-315
 	mRoot->setPosition(getPosition());
-	mRoot->updateWorldMatrixChildren();
+	updateJointWorldMatrices();
 
 	stopMotion(ANIM_AGENT_BODY_NOISE);
 	
@@ -9700,45 +9907,77 @@ const LLVOAvatar::MatrixPaletteCache& LLVOAvatar::updateSkinInfoMatrixPalette(co
 
     if (entry.mFrame != gFrameCount)
     {
-        LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
-
         entry.mFrame = gFrameCount;
+        if (entry.mSkinInfo.get() != skin)
+        {
+            entry.mSkinInfo = skin;
+        }
+        buildMatrixPalette(entry, skin);
+    }
 
-        //build matrix palette
-        U32 count = LLSkinningUtil::getMeshJointCount(skin);
-        entry.mMatrixPalette.resize(count);
-        LLSkinningUtil::initSkinningMatrixPalette(&(entry.mMatrixPalette[0]), count, skin, this);
-
-        const LLMatrix4a* mat = &(entry.mMatrixPalette[0]);
+    return entry;
+}
 
-        entry.mGLMp.resize(count * 12);
+void LLVOAvatar::updateMatrixPalettes()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
 
-        F32* mp = &(entry.mGLMp[0]);
+    // idle runs before display() increments gFrameCount, so entries drawn
+    // last frame are tagged gFrameCount and the ones built here must carry
+    // the number of the frame about to be drawn
+    U32 next_frame = gFrameCount + 1;
 
-        for (U32 i = 0; i < count; ++i)
+    for (auto& it : mMatrixPaletteCache)
+    {
+        MatrixPaletteCache& entry = it.second;
+        const LLMeshSkinInfo* skin = entry.mSkinInfo.get();
+        // joint numbers are resolved on first use on the main thread, don't
+        // race other avatars wearing the same mesh to do it here
+        if ((entry.mFrame == gFrameCount || entry.mFrame == next_frame) &&
+            skin && skin->mJointNumsInitialized)
         {
-            F32* m = (F32*)mat[i].mMatrix[0].getF32ptr();
+            entry.mFrame = next_frame;
+            buildMatrixPalette(entry, skin);
+        }
+    }
+}
+
+void LLVOAvatar::buildMatrixPalette(MatrixPaletteCache& entry, const LLMeshSkinInfo* skin)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
 
-            U32 idx = i * 12;
+    //build matrix palette
+    U32 count = LLSkinningUtil::getMeshJointCount(skin);
+    entry.mMatrixPalette.resize(count);
+    LLSkinningUtil::initSkinningMatrixPalette(&(entry.mMatrixPalette[0]), count, skin, this);
 
-            mp[idx + 0] = m[0];
-            mp[idx + 1] = m[1];
-            mp[idx + 2] = m[2];
-            mp[idx + 3] = m[12];
+    const LLMatrix4a* mat = &(entry.mMatrixPalette[0]);
 
-            mp[idx + 4] = m[4];
-            mp[idx + 5] = m[5];
-            mp[idx + 6] = m[6];
-            mp[idx + 7] = m[13];
+    entry.mGLMp.resize(count * 12);
 
-            mp[idx + 8] = m[8];
-            mp[idx + 9] = m[9];
-            mp[idx + 10] = m[10];
-            mp[idx + 11] = m[14];
-        }
-    }
+    F32* mp = &(entry.mGLMp[0]);
 
-    return entry;
+    for (U32 i = 0; i < count; ++i)
+    {
+        F32* m = (F32*)mat[i].mMatrix[0].getF32ptr();
+
+        U32 idx = i * 12;
+
+        mp[idx + 0] = m[0];
+        mp[idx + 1] = m[1];
+        mp[idx + 2] = m[2];
+        mp[idx + 3] = m[12];
+
+        mp[idx + 4] = m[4];
+        mp[idx + 5] = m[5];
+        mp[idx + 6] = m[6];
+        mp[idx + 7] = m[13];
+
+        mp[idx + 8] = m[8];
+        mp[idx + 9] = m[9];
+        mp[idx + 10] = m[10];
+        mp[idx + 11] = m[14];
+    }
 }
 
 // static
@@ -10879,45 +11118,46 @@ void LLVOAvatar::updateVisualComplexity()
 	LL_DEBUGS("AvatarRender") << "avatar " << getID() << " appearance changed" << LL_ENDL;
 	// Set the cache time to in the past so it's updated ASAP
 	mVisualComplexityStale = true;
+	mAttachmentComplexity.clear();
+}
+
+// Only the attachment the object is part of needs gathering again.
+void LLVOAvatar::updateVisualComplexity(const LLViewerObject* object)
+{
+	mVisualComplexityStale = true;
+	mAttachmentComplexity.erase(object->getRootEdit()->getID());
 }
 
 
-// Account for the complexity of a single top-level object associated
-// with an avatar. This will be either an attached object or an animated
-// object.
-void LLVOAvatar::accountRenderComplexityForObject(
-    LLViewerObject *attached_object,
-    const F32 max_attachment_complexity,
-    LLVOVolume::texture_cost_t& textures,
-    U32& cost,
-    hud_complexity_list_t& hud_complexity_list,
-    object_complexity_list_t& object_complexity_list)
+// Gather what the complexity of a single top-level object associated
+// with an avatar comes from. This will be either an attached object or an
+// animated object.
+void LLVOAvatar::gatherRenderComplexityForObject(LLViewerObject* attached_object, AttachmentComplexity& complexity)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
-    if (attached_object && !attached_object->isHUDAttachment())
+    LLVOVolume::texture_cost_t textures;
+    if (!attached_object->isHUDAttachment())
     {
-        mAttachmentVisibleTriangleCount += attached_object->recursiveGetTriangleCount();
-        mAttachmentEstTriangleCount += attached_object->recursiveGetEstTrianglesMax();
-        mAttachmentSurfaceArea += attached_object->recursiveGetScaledSurfaceArea();
+        complexity.mVisibleTriangleCount = attached_object->recursiveGetTriangleCount();
+        complexity.mEstTriangleCount = attached_object->recursiveGetEstTrianglesMax();
+        complexity.mSurfaceArea = attached_object->recursiveGetScaledSurfaceArea();
 
-        textures.clear();
         const LLDrawable* drawable = attached_object->mDrawable;
         if (drawable)
         {
             const LLVOVolume* volume = drawable->getVOVolume();
             if (volume)
             {
-                F32 attachment_total_cost = 0;
-                F32 attachment_volume_cost = 0;
-                F32 attachment_texture_cost = 0;
-                F32 attachment_children_cost = 0;
-                const F32 animated_object_attachment_surcharge = 1000;
-
-                if (volume->isAnimatedObjectFast())
+                complexity.mHasVolume = true;
+                complexity.mAnimated = volume->isAnimatedObjectFast();
+                complexity.mItemID = attached_object->getAttachmentItemID();
+                if (isSelf())
                 {
-                    attachment_volume_cost += animated_object_attachment_surcharge;
+                    complexity.mItemName = attached_object->getAttachmentItemName();
                 }
-                attachment_volume_cost += volume->getRenderCost(textures);
+
+                complexity.mVolumes.emplace_back();
+                volume->getRenderCostInputs(complexity.mVolumes.back(), textures);
 
                 const_child_list_t children = volume->getChildren();
                 for (const_child_list_t::const_iterator child_iter = children.begin();
@@ -10928,54 +11168,34 @@ void LLVOAvatar::accountRenderComplexityForObject(
                     LLVOVolume* child = dynamic_cast<LLVOVolume*>(child_obj);
                     if (child)
                     {
-                        attachment_children_cost += child->getRenderCost(textures);
+                        complexity.mVolumes.emplace_back();
+                        child->getRenderCostInputs(complexity.mVolumes.back(), textures);
                     }
                 }
 
+                complexity.mTextureCosts.reserve(textures.size());
                 for (LLVOVolume::texture_cost_t::iterator volume_texture = textures.begin();
                     volume_texture != textures.end();
                     ++volume_texture)
                 {
-                    // add the cost of each individual texture in the linkset
-                    attachment_texture_cost += LLVOVolume::getTextureCost(*volume_texture);
-                }
-                attachment_total_cost = attachment_volume_cost + attachment_texture_cost + attachment_children_cost;
-                LL_DEBUGS("ARCdetail") << "Attachment costs " << attached_object->getAttachmentItemID()
-                    << " total: " << attachment_total_cost
-                    << ", volume: " << attachment_volume_cost
-                    << ", " << textures.size()
-                    << " textures: " << attachment_texture_cost
-                    << ", " << volume->numChildren()
-                    << " children: " << attachment_children_cost
-                    << LL_ENDL;
-                // Limit attachment complexity to avoid signed integer flipping of the wearer's ACI
-                cost += (U32)llclamp(attachment_total_cost, MIN_ATTACHMENT_COMPLEXITY, max_attachment_complexity);
-
-                if (isSelf())
-                {
-                    LLObjectComplexity object_complexity;
-                    object_complexity.objectName = attached_object->getAttachmentItemName();
-                    object_complexity.objectId = attached_object->getAttachmentItemID();
-                    object_complexity.objectCost = attachment_total_cost;
-                    object_complexity_list.push_back(object_complexity);
+                    complexity.mTextureCosts.push_back(LLVOVolume::getTextureCost(*volume_texture));
                 }
             }
         }
     }
     if (isSelf()
-        && attached_object
         && attached_object->isHUDAttachment()
         && !attached_object->isTempAttachment()
         && attached_object->mDrawable)
     {
-        textures.clear();
-        mAttachmentSurfaceArea += attached_object->recursiveGetScaledSurfaceArea();
+        complexity.mSurfaceArea = attached_object->recursiveGetScaledSurfaceArea();
 
         const LLVOVolume* volume = attached_object->mDrawable->getVOVolume();
         if (volume)
         {
+            complexity.mIsHUD = true;
+            LLHUDComplexity& hud_object_complexity = complexity.mHUDComplexity;
             BOOL is_rigged_mesh = volume->isRiggedMeshFast();
-            LLHUDComplexity hud_object_complexity;
             hud_object_complexity.objectName = attached_object->getAttachmentItemName();
             hud_object_complexity.objectId = attached_object->getAttachmentItemID();
             std::string joint_name;
@@ -11030,12 +11250,132 @@ void LLVOAvatar::accountRenderComplexityForObject(
                     }
                 }
             }
-            hud_complexity_list.push_back(hud_object_complexity);
         }
     }
 }
 
+// Adds up the complexity of the body parts and attachments.  Reads nothing
+// but what it is given.
+//static
+void LLVOAvatar::sumRenderComplexity(U32 body_parts_cost, const attachment_complexity_vec_t& attachments,
+                                     F32 max_attachment_complexity, bool is_self, RenderComplexity& result)
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_AVATAR;
+
+    result.mCost = body_parts_cost;
+
+    for (const attachment_complexity_ptr_t& attachment : attachments)
+    {
+        result.mVisibleTriangleCount += attachment->mVisibleTriangleCount;
+        result.mEstTriangleCount += attachment->mEstTriangleCount;
+        result.mSurfaceArea += attachment->mSurfaceArea;
+
+        if (attachment->mHasVolume)
+        {
+            F32 attachment_total_cost = 0;
+            F32 attachment_volume_cost = 0;
+            F32 attachment_texture_cost = 0;
+            F32 attachment_children_cost = 0;
+            const F32 animated_object_attachment_surcharge = 1000;
+
+            if (attachment->mAnimated)
+            {
+                attachment_volume_cost += animated_object_attachment_surcharge;
+            }
+            attachment_volume_cost += LLVOVolume::getRenderCost(attachment->mVolumes[0]);
+
+            for (size_t i = 1; i < attachment->mVolumes.size(); ++i)
+            {
+                attachment_children_cost += LLVOVolume::getRenderCost(attachment->mVolumes[i]);
+            }
+
+            for (S32 texture_cost : attachment->mTextureCosts)
+            {
+                // add the cost of each individual texture in the linkset
+                attachment_texture_cost += texture_cost;
+            }
+            attachment_total_cost = attachment_volume_cost + attachment_texture_cost + attachment_children_cost;
+            LL_DEBUGS("ARCdetail") << "Attachment costs " << attachment->mItemID
+                << " total: " << attachment_total_cost
+                << ", volume: " << attachment_volume_cost
+                << ", " << attachment->mTextureCosts.size()
+                << " textures: " << attachment_texture_cost
+                << ", " << attachment->mVolumes.size() - 1
+                << " children: " << attachment_children_cost
+                << LL_ENDL;
+            // Limit attachment complexity to avoid signed integer flipping of the wearer's ACI
+            result.mCost += (U32)llclamp(attachment_total_cost, MIN_ATTACHMENT_COMPLEXITY, max_attachment_complexity);
+
+            if (is_self)
+            {
+                LLObjectComplexity object_complexity;
+                object_complexity.objectName = attachment->mItemName;
+                object_complexity.objectId = attachment->mItemID;
+                object_complexity.objectCost = attachment_total_cost;
+                result.mObjectComplexityList.push_back(object_complexity);
+            }
+        }
+
+        if (attachment->mIsHUD)
+        {
+            result.mHUDComplexityList.push_back(attachment->mHUDComplexity);
+        }
+    }
+}
+
+void LLVOAvatar::applyRenderComplexity(const RenderComplexity& result)
+{
+    mAttachmentVisibleTriangleCount = result.mVisibleTriangleCount;
+    mAttachmentEstTriangleCount = result.mEstTriangleCount;
+    mAttachmentSurfaceArea = result.mSurfaceArea;
+
+    U32 cost = result.mCost;
+    if ( cost != mVisualComplexity )
+    {
+        LL_DEBUGS("AvatarRender") << "Avatar "<< getID()
+                                  << " complexity updated was " << mVisualComplexity << " now " << cost
+                                  << " reported " << mReportedVisualComplexity
+                                  << LL_ENDL;
+    }
+    else
+    {
+        LL_DEBUGS("AvatarRender") << "Avatar "<< getID()
+                                  << " complexity updated no change " << mVisualComplexity
+                                  << " reported " << mReportedVisualComplexity
+                                  << LL_ENDL;
+    }
+    mVisualComplexity = cost;
+
+    static LLCachedControl<U32> show_my_complexity_changes(gSavedSettings, "ShowMyComplexityChanges", 20);
+
+    if (isSelf() && show_my_complexity_changes)
+    {
+        // Avatar complexity
+        LLAvatarRenderNotifier::getInstance()->updateNotificationAgent(mVisualComplexity);
+        LLAvatarRenderNotifier::getInstance()->setObjectComplexityList(result.mObjectComplexityList);
+        // HUD complexity
+        LLHUDRenderNotifier::getInstance()->updateNotificationHUD(result.mHUDComplexityList);
+    }
+
+    //schedule an update to ART next frame if needed
+    if (LLPerfStats::tunables.userAutoTuneEnabled && 
+        LLPerfStats::tunables.userFPSTuningStrategy != LLPerfStats::TUNE_SCENE_ONLY &&
+        !isVisuallyMuted())
+    {
+        LLUUID id = getID(); // <== use id to make sure this avatar didn't get deleted between frames
+        LL::WorkQueue::getInstance("mainloop")->post([this, id]()
+            {
+                if (gObjectList.findObject(id) != nullptr)
+                {
+                    gPipeline.profileAvatar(this);
+                }
+            });
+    }
+}
+
 // Calculations for mVisualComplexity value
+// Gathers again only the attachments that changed since last time, and
+// adds everything up.
 void LLVOAvatar::calculateUpdateRenderComplexity()
 {
     /*****************************************************************
@@ -11053,13 +11393,7 @@ void LLVOAvatar::calculateUpdateRenderComplexity()
         F32 max_attachment_complexity = max_complexity_setting;
         max_attachment_complexity = llmax(max_attachment_complexity, DEFAULT_MAX_ATTACHMENT_COMPLEXITY);
 
-        // Diagnostic list of all textures on our avatar
-        static std::unordered_set<const LLViewerTexture*> all_textures;
-
 		U32 cost = VISUAL_COMPLEXITY_UNKNOWN;
-		LLVOVolume::texture_cost_t textures;
-		hud_complexity_list_t hud_complexity_list;
-        object_complexity_list_t object_complexity_list;
 
 		for (U8 baked_index = 0; baked_index < BAKED_NUM_INDICES; baked_index++)
 		{
@@ -11089,10 +11423,29 @@ void LLVOAvatar::calculateUpdateRenderComplexity()
 		}
         LL_DEBUGS("ARCdetail") << "Avatar body parts complexity: " << cost << LL_ENDL;
 
-        mAttachmentVisibleTriangleCount = 0;
-        mAttachmentEstTriangleCount = 0.f;
-        mAttachmentSurfaceArea = 0.f;
-        
+        // Gather the objects not gathered since they last changed, and
+        // forget those no longer attached.
+        attachment_complexity_vec_t attachments;
+        attachment_complexity_map_t gathered;
+        auto gather = [&](LLViewerObject* attached_object)
+        {
+            const LLUUID& id = attached_object->getID();
+            attachment_complexity_map_t::iterator found = mAttachmentComplexity.find(id);
+            attachment_complexity_ptr_t complexity;
+            if (found != mAttachmentComplexity.end())
+            {
+                complexity = found->second;
+            }
+            else
+            {
+                std::shared_ptr<AttachmentComplexity> fresh = std::make_shared<AttachmentComplexity>();
+                gatherRenderComplexityForObject(attached_object, *fresh);
+                complexity = fresh;
+            }
+            gathered[id] = complexity;
+            attachments.push_back(complexity);
+        };
+
         // A standalone animated object needs to be accounted for
         // using its associated volume. Attached animated objects
         // will be covered by the subsequent loop over attachments.
@@ -11102,8 +11455,7 @@ void LLVOAvatar::calculateUpdateRenderComplexity()
             LLVOVolume *volp = control_av->mRootVolp;
             if (volp && !volp->isAttachment())
             {
-                accountRenderComplexityForObject(volp, max_attachment_complexity,
-                                                 textures, cost, hud_complexity_list, object_complexity_list);
+                gather(volp);
             }
         }
 
@@ -11118,53 +11470,19 @@ void LLVOAvatar::calculateUpdateRenderComplexity()
 				 ++attachment_iter)
 			{
                 LLViewerObject* attached_object = attachment_iter->get();
-                accountRenderComplexityForObject(attached_object, max_attachment_complexity,
-                                                 textures, cost, hud_complexity_list, object_complexity_list);
+                if (attached_object)
+                {
+                    gather(attached_object);
+                }
 			}
 		}
 
-        if ( cost != mVisualComplexity )
-        {
-            LL_DEBUGS("AvatarRender") << "Avatar "<< getID()
-                                      << " complexity updated was " << mVisualComplexity << " now " << cost
-                                      << " reported " << mReportedVisualComplexity
-                                      << LL_ENDL;
-        }
-        else
-        {
-            LL_DEBUGS("AvatarRender") << "Avatar "<< getID()
-                                      << " complexity updated no change " << mVisualComplexity
-                                      << " reported " << mReportedVisualComplexity
-                                      << LL_ENDL;
-        }
-		mVisualComplexity = cost;
+        mAttachmentComplexity.swap(gathered);
 		mVisualComplexityStale = false;
 
-        static LLCachedControl<U32> show_my_complexity_changes(gSavedSettings, "ShowMyComplexityChanges", 20);
-
-        if (isSelf() && show_my_complexity_changes)
-        {
-            // Avatar complexity
-            LLAvatarRenderNotifier::getInstance()->updateNotificationAgent(mVisualComplexity);
-            LLAvatarRenderNotifier::getInstance()->setObjectComplexityList(object_complexity_list);
-            // HUD complexity
-            LLHUDRenderNotifier::getInstance()->updateNotificationHUD(hud_complexity_list);
-        }
-
-        //schedule an update to ART next frame if needed
-        if (LLPerfStats::tunables.userAutoTuneEnabled && 
-            LLPerfStats::tunables.userFPSTuningStrategy != LLPerfStats::TUNE_SCENE_ONLY &&
-            !isVisuallyMuted())
-        {
-            LLUUID id = getID(); // <== use id to make sure this avatar didn't get deleted between frames
-            LL::WorkQueue::getInstance("mainloop")->post([this, id]()
-                {
-                    if (gObjectList.findObject(id) != nullptr)
-                    {
-                        gPipeline.profileAvatar(this);
-                    }
-                });
-        }
+        RenderComplexity result;
+        sumRenderComplexity(cost, attachments, max_attachment_complexity, isSelf(), result);
+        applyRenderComplexity(result);
     }
 }
 
@@ -54,6 +54,7 @@
 #include "llvovolume.h"
 #include "llavatarrendernotifier.h"
 #include "llmodel.h"
+#include "lljointskeleton.h"
 
 extern const LLUUID ANIM_AGENT_BODY_NOISE;
 extern const LLUUID ANIM_AGENT_BREATHE_ROT;
@@ -132,6 +133,13 @@ public:
 													 const EObjectUpdateType update_type,
 													 LLDataPacker *dp);
 	virtual void   	 	 	idleUpdate(LLAgent &agent, const F64 &time);
+
+	// idleUpdate() for many avatars at once.  Each avatar's update is split
+	// in three: idleUpdateBegin() and idleUpdateFinish() run on the main
+	// thread, updateCharacterPose() in between runs on the "General" thread
+	// pool, so motion evaluation, pose blending and joint and skinning
+	// matrices for different avatars are computed in parallel.
+	static void				idleUpdateAvatars(LLAgent &agent, const F64 &time, const std::vector<LLVOAvatar*>& avatars);
 	/*virtual*/ BOOL   	 	 	updateLOD();
 	BOOL  	 	 	 	 	updateJointLODs();
 	void					updateLODRiggedAttachments( void );
@@ -270,11 +278,21 @@ public:
 	void 			updateAnimationDebugText();
 	virtual void	updateDebugText();
 	virtual bool 	computeNeedsUpdate();
-	virtual bool 	updateCharacter(LLAgent &agent);
+	bool 			updateCharacter(LLAgent &agent);
+	// updateCharacter() in three steps, only updateCharacterPose() is safe
+	// to run off the main thread, and only for one avatar per thread
+	virtual bool	beginUpdateCharacter(LLAgent &agent);
+	void			updateCharacterPose();
+	bool			finishUpdateCharacter();
+	// likewise for idleUpdate(), returns false if there is nothing more to do
+	virtual bool	idleUpdateBegin(LLAgent &agent, const F64 &time);
+	void			idleUpdateFinish(LLAgent &agent);
+	// false for avatars that must be updated start to finish on the main thread
+	bool			canPoseInParallel() const;
     void			updateFootstepSounds();
     void			computeUpdatePeriod();
     void			updateOrientation(LLAgent &agent, F32 speed, F32 delta_time);
-    void			updateTimeStep();
+    void			updateAnimationLOD();
     void			updateRootPositionAndRotation(LLAgent &agent, F32 speed, bool was_sit_ground_constrained);
     
 	void            idleUpdateVoiceVisualizer(bool voice_enabled, const LLVector3 &position);
@@ -294,15 +312,46 @@ public:
 	void			addNameTagLine(const std::string& line, const LLColor4& color, S32 style, const LLFontGL* font, const bool use_ellipses = false);
 	void 			idleUpdateRenderComplexity();
 	void 			idleUpdateDebugInfo();
-    void 			accountRenderComplexityForObject(LLViewerObject *attached_object,
-                                                     const F32 max_attachment_complexity,
-                                                     LLVOVolume::texture_cost_t& textures,
-                                                     U32& cost,
-                                                     hud_complexity_list_t& hud_complexity_list,
-                                                     object_complexity_list_t& object_complexity_list);
+
+    // Render complexity of one attachment, or of an animated object's own
+    // volume.  Kept until the attachment, the LOD of one of its volumes or
+    // the full size of one of its textures changes.
+    struct AttachmentComplexity
+    {
+        U32         mVisibleTriangleCount = 0;
+        F32         mEstTriangleCount = 0.f;
+        F32         mSurfaceArea = 0.f;
+        bool        mHasVolume = false; // counts towards the ARC
+        bool        mAnimated = false;
+        std::vector<LLVOVolume::RenderCostInputs> mVolumes; // root first, then its children
+        std::vector<S32> mTextureCosts; // one per texture in the linkset
+        LLUUID      mItemID;
+        std::string mItemName;
+        bool        mIsHUD = false;
+        LLHUDComplexity mHUDComplexity;
+    };
+    typedef std::shared_ptr<const AttachmentComplexity> attachment_complexity_ptr_t;
+    typedef std::vector<attachment_complexity_ptr_t> attachment_complexity_vec_t;
+
+    // What the attachments and body parts of an avatar add up to
+    struct RenderComplexity
+    {
+        U32         mCost = VISUAL_COMPLEXITY_UNKNOWN;
+        U32         mVisibleTriangleCount = 0;
+        F32         mEstTriangleCount = 0.f;
+        F32         mSurfaceArea = 0.f;
+        hud_complexity_list_t mHUDComplexityList;
+        object_complexity_list_t mObjectComplexityList;
+    };
+
+    void            gatherRenderComplexityForObject(LLViewerObject* attached_object, AttachmentComplexity& complexity);
+    static void     sumRenderComplexity(U32 body_parts_cost, const attachment_complexity_vec_t& attachments,
+                                        F32 max_attachment_complexity, bool is_self, RenderComplexity& result);
+    void            applyRenderComplexity(const RenderComplexity& result);
 	void			calculateUpdateRenderComplexity();
 	static const U32 VISUAL_COMPLEXITY_UNKNOWN;
 	void			updateVisualComplexity();
+	void			updateVisualComplexity(const LLViewerObject* object);
 	
     void placeProfileQuery();
     void readProfileQuery(S32 retries);
@@ -461,6 +510,8 @@ public:
 	void				updateHeadOffset();
     void				debugBodySize() const;
 	void				postPelvisSetRecalc( void );
+	// world matrices of mRoot and everything under it, in one flat pass
+	void				updateJointWorldMatrices();
 
 	/*virtual*/ BOOL	loadSkeletonNode();
     void                initAttachmentPoints(bool ignore_hud_joints = false);
@@ -473,6 +524,8 @@ public:
 	LLVector3			mTargetRootToHeadOffset;
 
 	S32					mLastSkeletonSerialNum;
+private:
+	LLJointSkeleton		mJointSkeleton;
 
 
 /**                    Skeleton
@@ -551,6 +604,15 @@ private:
 	bool		shouldAlphaMask();
 
 	BOOL 		mNeedsSkin; // avatar has been animated and verts have not been updated
+	// handed from beginUpdateCharacter() to updateCharacterPose() and finishUpdateCharacter()
+	bool		mPosePending; // got as far as the motions
+	bool		mPoseMotionsPending; // motions still to be evaluated and blended
+	bool		mPoseVisible;
+	bool		mPoseNeedsPalettes; // visible, and not an impostor that is not being redrawn
+	bool		mPoseSitGroundConstrained;
+	bool		mPoseEvaluated; // motions were evaluated rather than interpolated
+	LLCharacter::e_update_t mPoseUpdateType;
+	S32			mAnimationLOD; // EAnimationLOD
 	F32			mLastSkinTime; //value of gFrameTimeSeconds at last skin update
 
 	S32	 		mUpdatePeriod;
@@ -572,6 +634,8 @@ private:
     // DEPRECATED -- obsolete avatar render cost values
 	mutable U32  mVisualComplexity;
 	mutable bool mVisualComplexityStale;
+	typedef std::map<LLUUID, attachment_complexity_ptr_t> attachment_complexity_map_t;
+	attachment_complexity_map_t mAttachmentComplexity; // by attached object, until it changes
 	U32          mReportedVisualComplexity; // from other viewers through the simulator
 
 	mutable bool		mCachedInMuteList;
@@ -817,6 +881,10 @@ public:
         // Float array ready to be sent to GL
         std::vector<F32> mGLMp;
 
+        // Skin this entry was built for, so updateCharacterPose() can
+        // rebuild it ahead of the next frame
+        LLConstPointer<LLMeshSkinInfo> mSkinInfo;
+
         MatrixPaletteCache() :
             mFrame(gFrameCount - 1)
         {
@@ -828,6 +896,11 @@ public:
     // Will update said entry if it hasn't been updated yet this frame
     const MatrixPaletteCache& updateSkinInfoMatrixPalette(const LLMeshSkinInfo* skinInfo);
 
+    // Rebuild the entries drawn last frame for the next one, from the pose
+    // just computed.  Safe to call from updateCharacterPose().
+    void updateMatrixPalettes();
+    void buildMatrixPalette(MatrixPaletteCache& entry, const LLMeshSkinInfo* skin);
+
     // Map of LLMeshSkinInfo::mHash to MatrixPaletteCache
     typedef std::unordered_map<U64, MatrixPaletteCache> matrix_palette_cache_t;
     matrix_palette_cache_t mMatrixPaletteCache;
@@ -835,6 +908,9 @@ public:
 protected:
 	void 			releaseMeshData();
 	virtual void restoreMeshData();
+	// Apply the morphs queued since beginDeferredMorphs(), one mesh per job
+	// spread over the General pool when called on the main thread.
+	void			applyDeferredMorphs();
 private:
 	virtual void	dirtyMesh(S32 priority); // Dirty the avatar mesh, with priority
 	LLViewerJoint*	getViewerJoint(S32 idx);
@@ -900,6 +976,17 @@ public:
 	void			setVisibilityRank(U32 rank);
     U32				getVisibilityRank() const { return mVisibilityRank; }
 	static S32 		sNumVisibleAvatars; // Number of instances of this class
+
+	// animation level of detail, chosen by updateAnimationLOD()
+	enum EAnimationLOD
+	{
+		ANIM_LOD_FULL = 0,	// every joint, every update
+		ANIM_LOD_REDUCED,	// every joint, interpolated between fewer updates
+		ANIM_LOD_MINIMAL,	// base skeleton only, interpolated between fewer updates
+		ANIM_LOD_COUNT
+	};
+	static U32		sAnimLODAvatars[ANIM_LOD_COUNT]; // avatars posed this frame, by animation LOD
+	static U32		sAnimLODJoints[ANIM_LOD_COUNT]; // joints they blended
 /**                    Appearance
  **                                                                            **
  *******************************************************************************/
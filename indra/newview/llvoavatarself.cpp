@@ -675,7 +675,7 @@ LLVOAvatarSelf::~LLVOAvatarSelf()
  *********************************************************************************/
 
 // virtual
-bool LLVOAvatarSelf::updateCharacter(LLAgent &agent)
+bool LLVOAvatarSelf::beginUpdateCharacter(LLAgent &agent)
 {
 	// update screen joint size
 	if (mScreenp)
@@ -687,7 +687,7 @@ bool LLVOAvatarSelf::updateCharacter(LLAgent &agent)
 		resetHUDAttachments();
 	}
 	
-	return LLVOAvatar::updateCharacter(agent);
+	return LLVOAvatar::beginUpdateCharacter(agent);
 }
 
 // virtual
@@ -703,6 +703,19 @@ void LLVOAvatarSelf::idleUpdate(LLAgent &agent, const F64 &time)
 	{
 		LLVOAvatar::idleUpdate(agent, time);
 		idleUpdateTractorBeam();
+		idleUpdateCompositeBakes();
+	}
+}
+
+void LLVOAvatarSelf::idleUpdateCompositeBakes()
+{
+	for (U32 i = 0; i < mBakedTextureDatas.size(); i++)
+	{
+		LLViewerTexLayerSet* layerset = getTexLayerSet(i);
+		if (layerset)
+		{
+			layerset->updateCompositeBake();
+		}
 	}
 }
 
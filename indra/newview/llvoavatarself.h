@@ -116,8 +116,9 @@ public:
 	// Updates
 	//--------------------------------------------------------------------
 public:
-	/*virtual*/ bool 	updateCharacter(LLAgent &agent);
+	/*virtual*/ bool 	beginUpdateCharacter(LLAgent &agent);
 	/*virtual*/ void 	idleUpdateTractorBeam();
+	void				idleUpdateCompositeBakes();
 	bool				checkStuckAppearance();
 
 	//--------------------------------------------------------------------
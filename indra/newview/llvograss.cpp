@@ -709,6 +709,7 @@ void LLGrassPartition::getGeometry(LLSpatialGroup* group)
 		{
 			draw_vec[idx]->mCount += facep->getIndicesCount();
 			draw_vec[idx]->mEnd += facep->getGeomCount();
+			draw_vec[idx]->updateSortKey();
 		}
 		else
 		{
@@ -719,6 +720,7 @@ void LLGrassPartition::getGeometry(LLSpatialGroup* group)
 			LLDrawInfo* info = new LLDrawInfo(start,end,count,offset,facep->getTexture(), 
 				//facep->getTexture(),
 				buffer, object->isSelected(), fullbright);
+			info->updateSortKey();
 
 			draw_vec.push_back(info);
 			//for alpha sorting
@@ -40,7 +40,7 @@
 #include "llmaterialtable.h"
 #include "llprimitive.h"
 #include "llvolume.h"
-#include "llvolumeoctree.h"
+#include "llvolumebvh.h"
 #include "llvolumemgr.h"
 #include "llvolumemessage.h"
 #include "material_codes.h"
@@ -55,6 +55,7 @@
 #include "llhudmanager.h"
 #include "llflexibleobject.h"
 #include "llskinningutil.h"
+#include "llskinningkernels.h"
 #include "llsky.h"
 #include "lltexturefetch.h"
 #include "llvector4a.h"
@@ -89,6 +90,8 @@
 #include "llsculptidsize.h"
 #include "llavatarappearancedefines.h"
 #include "llgltfmateriallist.h"
+#include "llparallelbatch.h"
+#include <unordered_map>
 
 const F32 FORCE_SIMPLE_RENDER_AREA = 512.f;
 const F32 FORCE_CULL_AREA = 8.f;
@@ -306,6 +309,8 @@ void LLVOVolume::markDead()
 void LLVOVolume::initClass()
 {
 	// gSavedSettings better be around
+	LLVolumeFace::setOctreeMemoryBudget((U64) gSavedSettings.getU32("VolumeOctreeMemoryBudget") * 1024 * 1024);
+
 	if (gSavedSettings.getBOOL("PrimMediaMasterEnabled"))
 	{
 		const F32 queue_timer_delay = gSavedSettings.getF32("PrimMediaRequestQueueDelay");
@@ -1178,12 +1183,12 @@ void LLVOVolume::updateVisualComplexity()
     LLVOAvatar* avatar = getAvatarAncestor();
     if (avatar)
     {
-        avatar->updateVisualComplexity();
+        avatar->updateVisualComplexity(this);
     }
     LLVOAvatar* rigged_avatar = getAvatar();
     if(rigged_avatar && (rigged_avatar != avatar))
     {
-        rigged_avatar->updateVisualComplexity();
+        rigged_avatar->updateVisualComplexity(this);
     }
 }
 
@@ -1296,6 +1301,10 @@ void LLVOVolume::sculpt()
 
 		if (current_discard == discard_level)  // no work to do here
 			return;
+
+		LLPointer<LLVolume> volume = getVolume();
+		if (volume->getPendingSculptLevel() == discard_level)  // already being generated
+			return;
 		
 		if(!raw_image)
 		{
@@ -1323,17 +1332,81 @@ void LLVOVolume::sculpt()
 				mSculptTexture->updateBindStatsForTester() ;
 			}
 		}
-		getVolume()->sculpt(sculpt_width, sculpt_height, sculpt_components, sculpt_data, discard_level, mSculptTexture->isMissingAsset());
 
-		//notify rebuild any other VOVolumes that reference this sculpty volume
-		for (S32 i = 0; i < mSculptTexture->getNumVolumes(LLRender::SCULPT_TEX); ++i)
-		{
-			LLVOVolume* volume = (*(mSculptTexture->getVolumeList(LLRender::SCULPT_TEX)))[i];
-			if (volume != this && volume->getVolume() == getVolume())
+		bool visible_placeholder = mSculptTexture->isMissingAsset();
+
+		LL::WorkQueue::ptr_t main_queue = LL::WorkQueue::getInstance("mainloop");
+		LL::WorkQueue::ptr_t general_queue = LL::WorkQueue::getInstance("General");
+
+		if (volume->isUnique() || !main_queue || !general_queue)
+		{ // flexi sculpts own their volume and regenerate it in place
+			volume->sculpt(sculpt_width, sculpt_height, sculpt_components, sculpt_data, discard_level, visible_placeholder);
+
+			//notify rebuild any other VOVolumes that reference this sculpty volume
+			for (S32 i = 0; i < mSculptTexture->getNumVolumes(LLRender::SCULPT_TEX); ++i)
 			{
-				gPipeline.markRebuild(volume->mDrawable, LLDrawable::REBUILD_GEOMETRY);
+				LLVOVolume* vobj = (*(mSculptTexture->getVolumeList(LLRender::SCULPT_TEX)))[i];
+				if (vobj != this && vobj->getVolume() == volume)
+				{
+					gPipeline.markRebuild(vobj->mDrawable, LLDrawable::REBUILD_GEOMETRY);
+				}
 			}
+			return;
 		}
+
+		// Sample the sculpt map and build the faces into a scratch volume on
+		// the General pool, from a copy of the pixels so later decodes can't
+		// touch them mid job.  The main thread only swaps the result in.
+		std::shared_ptr<std::vector<U8> > pixels = std::make_shared<std::vector<U8> >();
+		if (sculpt_data)
+		{
+			pixels->assign(sculpt_data, sculpt_data + sculpt_width * sculpt_height * sculpt_components);
+		}
+
+		LLVolumeParams params = volume->getParams();
+		F32 detail = volume->getDetail();
+		volume->setPendingSculptLevel(discard_level);
+
+		// the closures are copied and destroyed on the worker, so they hold
+		// plain pointers and the references are taken and dropped here
+		LLVolume* volume_ptr = volume;
+		LLViewerFetchedTexture* sculpt_texture = mSculptTexture;
+		volume_ptr->ref();
+		sculpt_texture->ref();
+
+		main_queue->postTo(
+			general_queue,
+			[=]()
+			{
+				LL_PROFILE_ZONE_NAMED_CATEGORY_VOLUME("generate sculpt");
+				LLPointer<LLVolume> scratch = new LLVolume(params, detail);
+				scratch->sculpt(sculpt_width, sculpt_height, sculpt_components,
+								pixels->empty() ? NULL : pixels->data(), discard_level, visible_placeholder);
+				return scratch;
+			},
+			[=](LLPointer<LLVolume> scratch)
+			{
+				if (volume_ptr->getPendingSculptLevel() == discard_level)
+				{ // not superseded by a newer decode
+					volume_ptr->setPendingSculptLevel(LLVolume::NO_SCULPT_PENDING);
+					volume_ptr->swapSculpt(scratch);
+
+					// rebuild every VOVolume that references this sculpty volume,
+					// the same way meshes are published when their LOD arrives
+					for (S32 i = 0; i < sculpt_texture->getNumVolumes(LLRender::SCULPT_TEX); ++i)
+					{
+						LLVOVolume* vobj = (*(sculpt_texture->getVolumeList(LLRender::SCULPT_TEX)))[i];
+						if (vobj->getVolume() == volume_ptr)
+						{
+							vobj->mSculptChanged = TRUE;
+							gPipeline.markRebuild(vobj->mDrawable, LLDrawable::REBUILD_GEOMETRY);
+						}
+					}
+				}
+
+				sculpt_texture->unref();
+				volume_ptr->unref();
+			});
 	}
 }
 
@@ -1726,7 +1799,7 @@ BOOL LLVOVolume::genBBoxes(BOOL force_global, BOOL should_update_octree_bounds)
         // updates needed, set REBUILD_RIGGED accordingly.
 
         // Without the flag, this will remove unused rigged volumes, which we are not currently very aggressive about.
-        updateRiggedVolume(false);
+        updateRiggedVolume(false, LLRiggedVolume::UPDATE_BOUNDS);
     }
 
     LLVolume* volume = mRiggedVolume;
@@ -1973,10 +2046,9 @@ bool LLVOVolume::lodOrSculptChanged(LLDrawable *drawable, BOOL &compiled, BOOL &
 
 	if ((new_lod != old_lod) || mSculptChanged)
 	{
-        if (mDrawable->isState(LLDrawable::RIGGED))
-        {
-            updateVisualComplexity();
-        }
+        // the render complexity of an attachment depends on the LOD of
+        // each of its volumes
+        updateVisualComplexity();
 
 		compiled = TRUE;
         // new_lod > old_lod breaks a feedback loop between LOD updates and
@@ -2020,7 +2092,7 @@ BOOL LLVOVolume::updateGeometry(LLDrawable *drawable)
 	
 	if (mDrawable->isState(LLDrawable::REBUILD_RIGGED))
 	{
-        updateRiggedVolume(false);
+        updateRiggedVolume(false, LLRiggedVolume::UPDATE_BOUNDS);
 		genBBoxes(FALSE);
 		mDrawable->clearState(LLDrawable::REBUILD_RIGGED);
 	}
@@ -2083,7 +2155,7 @@ BOOL LLVOVolume::updateGeometry(LLDrawable *drawable)
 		
 		if(drawable->isState(LLDrawable::REBUILD_RIGGED | LLDrawable::RIGGED)) 
 		{
-			updateRiggedVolume(false);
+			updateRiggedVolume(false, LLRiggedVolume::UPDATE_BOUNDS);
 		}
 	}
 	// it has its own drawable (it's moved) or it has changed UVs or it has changed xforms from global<->local
@@ -2490,6 +2562,7 @@ LLVector3 LLVOVolume::getApproximateFaceNormal(U8 face_id)
 
 	if (volume && face_id < volume->getNumVolumeFaces())
 	{
+		volume->getVolumeFace(face_id).expand();
 		const LLVolumeFace& face = volume->getVolumeFace(face_id);
 		for (S32 i = 0; i < (S32)face.mNumVertices; ++i)
 		{
@@ -3796,6 +3869,7 @@ void LLVOVolume::updateRiggingInfo()
                 for (S32 f = 0; f < volume->getNumVolumeFaces(); ++f)
                 {
                     LLVolumeFace& vol_face = volume->getVolumeFace(f);
+                    vol_face.expand();
                     LLSkinningUtil::updateRiggingInfo(skin, avatar, vol_face);
                     if (vol_face.mJointRiggingInfoTab.size()>0)
                     {
@@ -3930,56 +4004,36 @@ S32 LLVOVolume::getTextureCost(const LLViewerTexture* img)
 U32 LLVOVolume::getRenderCost(texture_cost_t &textures) const
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
-    /*****************************************************************
-     * This calculation should not be modified by third party viewers,
-     * since it is used to limit rendering and should be uniform for
-     * everyone. If you have suggested improvements, submit them to
-     * the official viewer for consideration.
-     *****************************************************************/
+
+    RenderCostInputs inputs;
+    getRenderCostInputs(inputs, textures);
+    U32 cost = getRenderCost(inputs);
+
+	if ((S32)cost > mRenderComplexity_current)
+	{
+		mRenderComplexity_current = (S32)cost;
+	}
+
+	return cost;
+}
+
+// Gathers what getRenderCost() needs to know of this volume, and adds its
+// textures to the passed in set.  Returns false if it has no cost.
+bool LLVOVolume::getRenderCostInputs(RenderCostInputs& inputs, texture_cost_t &textures) const
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+
+    inputs = RenderCostInputs();
 
 	// Get access to params we'll need at various points.  
 	// Skip if this is object doesn't have a volume (e.g. is an avatar).
     if (getVolume() == NULL)
     {
-        return 0;
+        return false;
     }
 
 	U32 num_triangles = 0;
 
-	// per-prim costs
-	static const U32 ARC_PARTICLE_COST = 1; // determined experimentally
-	static const U32 ARC_PARTICLE_MAX = 2048; // default values
-	static const U32 ARC_LIGHT_COST = 500; // static cost for light-producing prims 
-	static const U32 ARC_MEDIA_FACE_COST = 1500; // static cost per media-enabled face 
-
-
-	// per-prim multipliers
-	static const F32 ARC_GLOW_MULT = 1.5f; // tested based on performance
-	static const F32 ARC_BUMP_MULT = 1.25f; // tested based on performance
-	static const F32 ARC_FLEXI_MULT = 5; // tested based on performance
-	static const F32 ARC_SHINY_MULT = 1.6f; // tested based on performance
-	static const F32 ARC_INVISI_COST = 1.2f; // tested based on performance
-	static const F32 ARC_WEIGHTED_MESH = 1.2f; // tested based on performance
-
-	static const F32 ARC_PLANAR_COST = 1.0f; // tested based on performance to have negligible impact
-	static const F32 ARC_ANIM_TEX_COST = 4.f; // tested based on performance
-	static const F32 ARC_ALPHA_COST = 4.f; // 4x max - based on performance
-
-	F32 shame = 0;
-
-	U32 invisi = 0;
-	U32 shiny = 0;
-	U32 glow = 0;
-	U32 alpha = 0;
-	U32 flexi = 0;
-	U32 animtex = 0;
-	U32 particles = 0;
-	U32 bump = 0;
-	U32 planar = 0;
-	U32 weighted_mesh = 0;
-	U32 produces_light = 0;
-	U32 media_faces = 0;
-
 	const LLDrawable* drawablep = mDrawable;
 	U32 num_faces = drawablep->getNumFaces();
 
@@ -4007,6 +4061,7 @@ U32 LLVOVolume::getRenderCost(texture_cost_t &textures) const
 	{
 		num_triangles = 4;
 	}
+	inputs.mNumTriangles = num_triangles;
 
 	if (isSculptedFast())
 	{
@@ -4020,13 +4075,13 @@ U32 LLVOVolume::getRenderCost(texture_cost_t &textures) const
 				if (isRiggedMeshFast())
 				{
 					// weighted attachment - 1 point for every 3 bytes
-					weighted_mesh = 1;
+					inputs.mWeightedMesh = true;
 				}
 			}
 			else
 			{
 				// something went wrong - user should know their content isn't render-free
-				return 0;
+				return false;
 			}
 		}
 		else
@@ -4039,20 +4094,22 @@ U32 LLVOVolume::getRenderCost(texture_cost_t &textures) const
 		}
 	}
 
-	if (isFlexibleFast())
-	{
-		flexi = 1;
-	}
+	inputs.mFlexi = isFlexibleFast();
+
 	if (isParticleSource())
 	{
-		particles = 1;
-	}
+		static const U32 ARC_PARTICLE_MAX = 2048; // default values
 
-	if (getIsLightFast())
-	{
-		produces_light = 1;
+		const LLPartSysData *part_sys_data = &(mPartSourcep->mPartSysData);
+		const LLPartData *part_data = &(part_sys_data->mPartData);
+		U32 num_particles = (U32)(part_sys_data->mBurstPartCount * llceil( part_data->mMaxAge / part_sys_data->mBurstRate));
+		inputs.mNumParticles = num_particles > ARC_PARTICLE_MAX ? ARC_PARTICLE_MAX : num_particles;
+		inputs.mParticleSize = (llmax(part_data->mStartScale[0], part_data->mEndScale[0]) + llmax(part_data->mStartScale[1], part_data->mEndScale[1])) / 2.f;
+		inputs.mParticles = true;
 	}
 
+	inputs.mProducesLight = getIsLightFast();
+
     {
         LL_PROFILE_ZONE_NAMED_CATEGORY_VOLUME("ARC - face list");
         for (S32 i = 0; i < num_faces; ++i)
@@ -4069,15 +4126,15 @@ U32 LLVOVolume::getRenderCost(texture_cost_t &textures) const
 
             if (face->isInAlphaPool())
             {
-                alpha = 1;
+                inputs.mAlpha = true;
             }
             else if (img && img->getPrimaryFormat() == GL_ALPHA)
             {
-                invisi = 1;
+                inputs.mInvisi = true;
             }
             if (face->hasMedia())
             {
-                media_faces++;
+                inputs.mMediaFaces++;
             }
 
             if (te)
@@ -4085,117 +4142,150 @@ U32 LLVOVolume::getRenderCost(texture_cost_t &textures) const
                 if (te->getBumpmap())
                 {
                     // bump is a multiplier, don't add per-face
-                    bump = 1;
+                    inputs.mBump = true;
                 }
                 if (te->getShiny())
                 {
                     // shiny is a multiplier, don't add per-face
-                    shiny = 1;
+                    inputs.mShiny = true;
                 }
                 if (te->getGlow() > 0.f)
                 {
                     // glow is a multiplier, don't add per-face
-                    glow = 1;
+                    inputs.mGlow = true;
                 }
                 if (face->mTextureMatrix != NULL)
                 {
-                    animtex = 1;
+                    inputs.mAnimTex = true;
                 }
                 if (te->getTexGen())
                 {
-                    planar = 1;
+                    inputs.mPlanar = true;
                 }
             }
         }
     }
 
+    inputs.mAnimatedRoot = isAnimatedObjectFast() && isRootEdit();
+    inputs.mValid = true;
+
+	return true;
+}
+
+// Cost of a volume from what getRenderCostInputs() gathered of it.  Touches
+// no viewer state, so it can be called from any thread.
+//static
+U32 LLVOVolume::getRenderCost(const RenderCostInputs& inputs)
+{
+    /*****************************************************************
+     * This calculation should not be modified by third party viewers,
+     * since it is used to limit rendering and should be uniform for
+     * everyone. If you have suggested improvements, submit them to
+     * the official viewer for consideration.
+     *****************************************************************/
+
+    if (!inputs.mValid)
+    {
+        return 0;
+    }
+
+	// per-prim costs
+	static const U32 ARC_PARTICLE_COST = 1; // determined experimentally
+	static const U32 ARC_LIGHT_COST = 500; // static cost for light-producing prims 
+	static const U32 ARC_MEDIA_FACE_COST = 1500; // static cost per media-enabled face 
+
+
+	// per-prim multipliers
+	static const F32 ARC_GLOW_MULT = 1.5f; // tested based on performance
+	static const F32 ARC_BUMP_MULT = 1.25f; // tested based on performance
+	static const F32 ARC_FLEXI_MULT = 5; // tested based on performance
+	static const F32 ARC_SHINY_MULT = 1.6f; // tested based on performance
+	static const F32 ARC_INVISI_COST = 1.2f; // tested based on performance
+	static const F32 ARC_WEIGHTED_MESH = 1.2f; // tested based on performance
+
+	static const F32 ARC_PLANAR_COST = 1.0f; // tested based on performance to have negligible impact
+	static const F32 ARC_ANIM_TEX_COST = 4.f; // tested based on performance
+	static const F32 ARC_ALPHA_COST = 4.f; // 4x max - based on performance
+
+	F32 shame = 0;
+
 	// shame currently has the "base" cost of 1 point per 15 triangles, min 2.
-	shame = num_triangles  * 5.f;
+	shame = inputs.mNumTriangles  * 5.f;
 	shame = shame < 2.f ? 2.f : shame;
 
 	// multiply by per-face modifiers
-	if (planar)
+	if (inputs.mPlanar)
 	{
-		shame *= planar * ARC_PLANAR_COST;
+		shame *= ARC_PLANAR_COST;
 	}
 
-	if (animtex)
+	if (inputs.mAnimTex)
 	{
-		shame *= animtex * ARC_ANIM_TEX_COST;
+		shame *= ARC_ANIM_TEX_COST;
 	}
 
-	if (alpha)
+	if (inputs.mAlpha)
 	{
-		shame *= alpha * ARC_ALPHA_COST;
+		shame *= ARC_ALPHA_COST;
 	}
 
-	if(invisi)
+	if (inputs.mInvisi)
 	{
-		shame *= invisi * ARC_INVISI_COST;
+		shame *= ARC_INVISI_COST;
 	}
 
-	if (glow)
+	if (inputs.mGlow)
 	{
-		shame *= glow * ARC_GLOW_MULT;
+		shame *= ARC_GLOW_MULT;
 	}
 
-	if (bump)
+	if (inputs.mBump)
 	{
-		shame *= bump * ARC_BUMP_MULT;
+		shame *= ARC_BUMP_MULT;
 	}
 
-	if (shiny)
+	if (inputs.mShiny)
 	{
-		shame *= shiny * ARC_SHINY_MULT;
+		shame *= ARC_SHINY_MULT;
 	}
 
 
 	// multiply shame by multipliers
-	if (weighted_mesh)
+	if (inputs.mWeightedMesh)
 	{
-		shame *= weighted_mesh * ARC_WEIGHTED_MESH;
+		shame *= ARC_WEIGHTED_MESH;
 	}
 
-	if (flexi)
+	if (inputs.mFlexi)
 	{
-		shame *= flexi * ARC_FLEXI_MULT;
+		shame *= ARC_FLEXI_MULT;
 	}
 
 
 	// add additional costs
-	if (particles)
+	if (inputs.mParticles)
 	{
-		const LLPartSysData *part_sys_data = &(mPartSourcep->mPartSysData);
-		const LLPartData *part_data = &(part_sys_data->mPartData);
-		U32 num_particles = (U32)(part_sys_data->mBurstPartCount * llceil( part_data->mMaxAge / part_sys_data->mBurstRate));
-		num_particles = num_particles > ARC_PARTICLE_MAX ? ARC_PARTICLE_MAX : num_particles;
-		F32 part_size = (llmax(part_data->mStartScale[0], part_data->mEndScale[0]) + llmax(part_data->mStartScale[1], part_data->mEndScale[1])) / 2.f;
-		shame += num_particles * part_size * ARC_PARTICLE_COST;
+		shame += inputs.mNumParticles * inputs.mParticleSize * ARC_PARTICLE_COST;
 	}
 
-	if (produces_light)
+	if (inputs.mProducesLight)
 	{
 		shame += ARC_LIGHT_COST;
 	}
 
-	if (media_faces)
+	if (inputs.mMediaFaces)
 	{
-		shame += media_faces * ARC_MEDIA_FACE_COST;
+		shame += inputs.mMediaFaces * ARC_MEDIA_FACE_COST;
 	}
 
     // Streaming cost for animated objects includes a fixed cost
     // per linkset. Add a corresponding charge here translated into
     // triangles, but not weighted by any graphics properties.
-    if (isAnimatedObjectFast() && isRootEdit())
+    if (inputs.mAnimatedRoot)
     {
         shame += (ANIMATED_OBJECT_BASE_COST/0.06) * 5.0f;
     }
 
-	if (shame > mRenderComplexity_current)
-	{
-		mRenderComplexity_current = (S32)shame;
-	}
-
 	return (U32)shame;
 }
 
@@ -4590,7 +4680,7 @@ BOOL LLVOVolume::lineSegmentIntersect(const LLVector4a& start, const LLVector4a&
 	{
 		if ((pick_rigged) || (getAvatar() && (getAvatar()->isSelf()) && (LLFloater::isVisible(gFloaterTools))))
 		{
-            updateRiggedVolume(true, LLRiggedVolume::DO_NOT_UPDATE_FACES);
+            updateRiggedVolume(true, LLRiggedVolume::UPDATE_BOUNDS);
 			volume = mRiggedVolume;
 			transform = false;
 		}
@@ -4670,9 +4760,24 @@ BOOL LLVOVolume::lineSegmentIntersect(const LLVector4a& start, const LLVector4a&
 				continue;
 			}
 
-            // This calculates the bounding box of the skinned mesh from scratch. It's actually quite expensive, but not nearly as expensive as building a full octree.
-            // rebuild_face_octrees = false because an octree for this face will be built later only if needed for narrow phase picking.
-            updateRiggedVolume(true, i, false);
+            if (!transform)
+            { // rigged
+                // Only skin the faces the ray gets near, going by the bounds
+                // from the UPDATE_BOUNDS pass above.  lineSegmentIntersect
+                // tests their triangles directly until an octree for the
+                // pose has been built in the background.
+                const LLVolumeFace& rigged_face = volume->getVolumeFace(i);
+                LLVector4a box_center;
+                box_center.setAdd(rigged_face.mExtents[0], rigged_face.mExtents[1]);
+                box_center.mul(0.5f);
+                LLVector4a box_size;
+                box_size.setSub(rigged_face.mExtents[1], rigged_face.mExtents[0]);
+                if (!LLLineSegmentBoxIntersect(local_start, local_end, box_center, box_size))
+                {
+                    continue;
+                }
+                updateRiggedVolume(true, i);
+            }
 			face_hit = volume->lineSegmentIntersect(local_start, local_end, i,
 													&p, &tc, &n, &tn);
 			
@@ -4769,6 +4874,12 @@ BOOL LLVOVolume::lineSegmentIntersect(const LLVector4a& start, const LLVector4a&
 				}
 			}
 		}
+
+		if (ret && transform)
+		{ // the cursor is likely to wander onto the other faces of this object next,
+		  // get their octrees built in the background
+			volume->prefetchOctrees();
+		}
 	}
 		
 	return ret;
@@ -4796,7 +4907,7 @@ void LLVOVolume::clearRiggedVolume()
 	}
 }
 
-void LLVOVolume::updateRiggedVolume(bool force_treat_as_rigged, LLRiggedVolume::FaceIndex face_index, bool rebuild_face_octrees)
+void LLVOVolume::updateRiggedVolume(bool force_treat_as_rigged, LLRiggedVolume::FaceIndex face_index)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
 	//Update mRiggedVolume to match current animation frame of avatar. 
@@ -4831,15 +4942,15 @@ void LLVOVolume::updateRiggedVolume(bool force_treat_as_rigged, LLRiggedVolume::
 		updateRelativeXform();
 	}
 
-    mRiggedVolume->update(skin, avatar, volume, face_index, rebuild_face_octrees);
+    volume->expandFaces();
+    mRiggedVolume->update(skin, avatar, volume, face_index);
 }
 
 void LLRiggedVolume::update(
     const LLMeshSkinInfo* skin,
     LLVOAvatar* avatar,
     const LLVolume* volume,
-    FaceIndex face_index,
-    bool rebuild_face_octrees)
+    FaceIndex face_index)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
 	bool copy = false;
@@ -4863,6 +4974,11 @@ void LLRiggedVolume::update(
 	if (copy)
 	{
 		copyVolumeFaces(volume);
+		mSkinWeights.clear();
+		for (S32 i = 0; i < getNumVolumeFaces(); ++i)
+		{
+			mVolumeFaces[i].destroyOctree();
+		}
 	}
     else
     {
@@ -4878,34 +4994,40 @@ void LLRiggedVolume::update(
     }
 
 
-	//build matrix palette
-	static const size_t kMaxJoints = LL_MAX_JOINTS_PER_MESH_OBJECT;
-
-	LLMatrix4a mat[kMaxJoints];
-	U32 maxJoints = LLSkinningUtil::getMeshJointCount(skin);
-    LLSkinningUtil::initSkinningMatrixPalette(mat, maxJoints, skin, avatar);
-    const LLMatrix4a bind_shape_matrix = skin->mBindShapeMatrix;
-
     S32 rigged_vert_count = 0;
     S32 rigged_face_count = 0;
     LLVector4a box_min, box_max;
+    box_min.clear();
+    box_max.clear();
     S32 face_begin;
     S32 face_end;
+    bool bounds_only = false;
     if (face_index == DO_NOT_UPDATE_FACES)
     {
         face_begin = 0;
         face_end = 0;
     }
-    else if (face_index == UPDATE_ALL_FACES)
+    else if (face_index == UPDATE_ALL_FACES || face_index == UPDATE_BOUNDS)
     {
         face_begin = 0;
         face_end = volume->getNumVolumeFaces();
+        bounds_only = face_index == UPDATE_BOUNDS;
     }
     else
     {
         face_begin = face_index;
         face_end = face_begin + 1;
     }
+
+    if (face_begin < face_end)
+    {
+        updatePalette(skin, avatar);
+    }
+    U32 num_joints = mPalette.size();
+    const LLMatrix4a* mat = mPalette.mArray;
+
+    mSkinWeights.resize(volume->getNumVolumeFaces());
+
     for (S32 i = face_begin; i < face_end; ++i)
 	{
 		const LLVolumeFace& vol_face = volume->getVolumeFace(i);
@@ -4920,69 +5042,65 @@ void LLRiggedVolume::update(
 
 			LLVector4a* pos = dst_face.mPositions;
 
-			if (pos && dst_face.mExtents)
+			if (pos && dst_face.mExtents && dst_face.mNumVertices > 0 && num_joints > 0)
 			{
-                U32 max_joints = LLSkinningUtil::getMaxJointCount();
                 rigged_vert_count += dst_face.mNumVertices;
                 rigged_face_count++;
 
-            #if USE_SEPARATE_JOINT_INDICES_AND_WEIGHTS
-                if (vol_face.mJointIndices) // fast path with preconditioned joint indices
+                SkinWeights& skin_weights = mSkinWeights[i];
+                if (skin_weights.mSourceStamp != vol_face.mWeightsStamp ||
+                    skin_weights.mNumJoints != num_joints ||
+                    skin_weights.mJointWeights.size() != (U32) dst_face.mNumVertices)
                 {
-                    LLMatrix4a src[4];
-                    U8* joint_indices_cursor = vol_face.mJointIndices;
-                    LLVector4a* just_weights = vol_face.mJustWeights;
-                    for (U32 j = 0; j < dst_face.mNumVertices; ++j)
-				    {
-					    LLMatrix4a final_mat;
-                        F32* w = just_weights[j].getF32ptr();
-                        LLSkinningUtil::getPerVertexSkinMatrixWithIndices(w, joint_indices_cursor, mat, final_mat, src);
-                        joint_indices_cursor += 4;
-
-					    LLVector4a& v = vol_face.mPositions[j];
-					    LLVector4a t;
-					    LLVector4a dst;
-					    bind_shape_matrix.affineTransform(v, t);
-					    final_mat.affineTransform(t, dst);
-					    pos[j] = dst;
-				    }
+                    skin_weights.mSourceStamp = vol_face.mWeightsStamp;
+                    skin_weights.mNumJoints = num_joints;
+                    skin_weights.mJointIndices.resize(dst_face.mNumVertices * 4);
+                    skin_weights.mJointWeights.resize(dst_face.mNumVertices);
+                    ll_decode_skin_weights(weight, dst_face.mNumVertices, num_joints,
+                                           skin_weights.mJointIndices.data(), skin_weights.mJointWeights.mArray);
+
+                    skin_weights.mBoundJoints.resize(num_joints);
+                    skin_weights.mJointBounds.resize(num_joints * 2);
+                    U32 num_bounds = ll_skin_joint_bounds(skin_weights.mJointIndices.data(), skin_weights.mJointWeights.mArray,
+                                                          vol_face.mPositions, dst_face.mNumVertices, num_joints,
+                                                          skin_weights.mBoundJoints.data(), skin_weights.mJointBounds.mArray);
+                    skin_weights.mBoundJoints.resize(num_bounds);
+                    skin_weights.mJointBounds.resize(num_bounds * 2);
+
+                    skin_weights.mSkinnedSerial = 0;
+                }
+
+				//update bounding box
+				// VFExtents change
+                if (skin_weights.mSkinnedSerial == mPaletteSerial)
+                { // pose hasn't changed since the positions were skinned,
+                  // they, their extents and any octree are still good
+                }
+                else if (bounds_only)
+                { // leave the positions be until a raycast needs them
+                    ll_skinned_extents(mat, skin_weights.mBoundJoints.data(), skin_weights.mJointBounds.mArray,
+                                       (U32) skin_weights.mBoundJoints.size(), dst_face.mExtents);
                 }
                 else
-            #endif
                 {
-				    for (U32 j = 0; j < dst_face.mNumVertices; ++j)
-				    {
-					    LLMatrix4a final_mat;
-                        LLSkinningUtil::getPerVertexSkinMatrix(weight[j].getF32ptr(), mat, false, final_mat, max_joints);
-				
-					    LLVector4a& v = vol_face.mPositions[j];
-					    LLVector4a t;
-					    LLVector4a dst;
-					    bind_shape_matrix.affineTransform(v, t);
-					    final_mat.affineTransform(t, dst);
-					    pos[j] = dst;
-				    }
+                    ll_skin_positions(mat, skin_weights.mJointIndices.data(), skin_weights.mJointWeights.mArray,
+                                      vol_face.mPositions, dst_face.mNumVertices, pos, dst_face.mExtents);
+                    skin_weights.mSkinnedSerial = mPaletteSerial;
+
+                    // positions moved, the old octree is stale; a new one
+                    // gets built in the background if this face keeps
+                    // getting raycast in this pose
+                    dst_face.destroyOctree();
                 }
 
-				//update bounding box
-				// VFExtents change
 				LLVector4a& min = dst_face.mExtents[0];
 				LLVector4a& max = dst_face.mExtents[1];
-
-				min = pos[0];
-				max = pos[1];
-                if (i==0)
+                if (rigged_face_count == 1)
                 {
                     box_min = min;
                     box_max = max;
                 }
 
-				for (U32 j = 1; j < dst_face.mNumVertices; ++j)
-				{
-					min.setMin(min, pos[j]);
-					max.setMax(max, pos[j]);
-				}
-
                 box_min.setMin(min,box_min);
                 box_max.setMax(max,box_max);
 
@@ -4990,12 +5108,6 @@ void LLRiggedVolume::update(
 				dst_face.mCenter->mul(0.5f);
 
 			}
-
-            if (rebuild_face_octrees)
-			{
-                dst_face.destroyOctree();
-                dst_face.createOctree();
-			}
 		}
 	}
     mExtraDebugText = llformat("rigged %d/%d - box (%f %f %f) (%f %f %f)",
@@ -5004,6 +5116,32 @@ void LLRiggedVolume::update(
                                box_max[0], box_max[1], box_max[2]);
 }
 
+void LLRiggedVolume::updatePalette(const LLMeshSkinInfo* skin, LLVOAvatar* avatar)
+{
+	static const size_t kMaxJoints = LL_MAX_JOINTS_PER_MESH_OBJECT;
+
+    // share the palette the avatar already keeps for this skin, and fold the
+    // bind shape matrix into it so vertices go through one matrix per joint
+    // instead of two
+    const LLMeshSkinInfo::matrix_list_t& palette = avatar->updateSkinInfoMatrixPalette(skin).mMatrixPalette;
+    U32 num_joints = llmin((U32) palette.size(), (U32) kMaxJoints);
+    const LLMatrix4a& bind_shape_matrix = skin->mBindShapeMatrix;
+
+	LLMatrix4a mat[kMaxJoints];
+    for (U32 j = 0; j < num_joints; ++j)
+    {
+        matMulUnsafe(bind_shape_matrix, palette[j], mat[j]);
+    }
+
+    if (num_joints != mPalette.size() ||
+        (num_joints && memcmp(mat, mPalette.mArray, num_joints * sizeof(LLMatrix4a))))
+    {
+        mPalette.resize(num_joints);
+        std::copy(mat, mat + num_joints, mPalette.mArray);
+        ++mPaletteSerial;
+    }
+}
+
 U32 LLVOVolume::getPartitionType() const
 {
 	if (isHUDAttachment())
@@ -5085,6 +5223,11 @@ void LLControlAVBridge::updateSpatialExtents()
 
 bool can_batch_texture(LLFace* facep)
 {
+	if (facep->isState(LLFace::INSTANCED))
+	{ //instanced faces get a draw of their own
+		return false;
+	}
+
 	if (facep->getTextureEntry()->getBumpmap())
 	{ //bump maps aren't worked into texture batching yet
 		return false;
@@ -5187,7 +5330,7 @@ void LLVolumeGeometryManager::freeFaces()
     }
 }
 
-void LLVolumeGeometryManager::registerFace(LLSpatialGroup* group, LLFace* facep, U32 type)
+void LLVolumeGeometryManager::registerFace(LLSpatialGroup* group, LLFace* facep, U32 type, const std::vector<LLFace*>* instances)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
 	if (   type == LLRenderPass::PASS_ALPHA 
@@ -5339,9 +5482,11 @@ void LLVolumeGeometryManager::registerFace(LLSpatialGroup* group, LLFace* facep,
 		}
 	}
 
-    LLDrawInfo* info = idx >= 0 ? draw_vec[idx] : nullptr;
+    LLDrawInfo* info = idx >= 0 && !instances ? draw_vec[idx] : nullptr;
 
 	if (info && 
+		info->mInstances.empty() &&
+		
 		info->mVertexBuffer == facep->getVertexBuffer() &&
 		info->mEnd == facep->getGeomIndex()-1 &&
 		(LLPipeline::sTextureBindTest || draw_vec[idx]->mTexture == tex || batchable) &&
@@ -5367,6 +5512,7 @@ void LLVolumeGeometryManager::registerFace(LLSpatialGroup* group, LLFace* facep,
 			info->mTextureList.resize(index+1);
 			info->mTextureList[index] = tex;
 		}
+		info->updateSortKey();
 		info->validate();
 	}
 	else
@@ -5405,6 +5551,26 @@ void LLVolumeGeometryManager::registerFace(LLSpatialGroup* group, LLFace* facep,
         draw_info->mAvatar = facep->mAvatar;
         draw_info->mSkinInfo = facep->mSkinInfo;
 
+        if (instances)
+        { //geometry was filled in object space scaled by the (shared) object scale,
+          //so each instance is its relative transform with the scale taken back out
+            draw_info->mInstances.reserve(instances->size());
+            for (LLFace* instance : *instances)
+            {
+                LLVOVolume* vobj = instance->getDrawable()->getVOVolume();
+                const LLVector3& scale = vobj->getScale();
+                LLMatrix4 mat = vobj->getRelativeXform();
+                for (U32 i = 0; i < 3; ++i)
+                {
+                    for (U32 j = 0; j < 3; ++j)
+                    {
+                        mat.mMatrix[i][j] /= scale.mV[i];
+                    }
+                }
+                draw_info->mInstances.push_back(mat);
+            }
+        }
+
         if (gltf_mat)
         {
             // just remember the material ID, render pools will reference the GLTF material
@@ -5454,6 +5620,7 @@ void LLVolumeGeometryManager::registerFace(LLSpatialGroup* group, LLFace* facep,
 			draw_info->mTextureList.resize(index+1);
 			draw_info->mTextureList[index] = tex;
 		}
+		draw_info->updateSortKey();
 		draw_info->validate();
 	}
 
@@ -5495,6 +5662,167 @@ static inline void add_face(T*** list, U32* count, T* face)
     }
 }
 
+// Once a static mesh has been copied into its vertex buffer its volume faces
+// are only read again on the next rebuild or when picked, so keep them in
+// their compact form in between.  Rigged, animated and selected objects read
+// their faces every frame and are left alone, and so is a volume shared with
+// other objects, which may be any of those.
+static void compact_volume_faces(LLDrawable* drawablep)
+{
+    static LLCachedControl<bool> compact_faces(gSavedSettings, "CompactVolumeFaces", true);
+    if (!compact_faces)
+    {
+        return;
+    }
+
+    LLVOVolume* vobj = drawablep->getVOVolume();
+    if (!vobj || vobj->isDead() || !vobj->isMesh() || vobj->isRiggedMesh() || vobj->isSelected()
+        || drawablep->isActive())
+    {
+        return;
+    }
+
+    LLVolume* volume = vobj->getVolume();
+    if (!volume || volume->isUnique() || !volume->isMeshAssetLoaded())
+    {
+        return;
+    }
+
+    LLVolumeLODGroup* lod_group = LLPrimitive::getVolumeManager()->getGroup(volume->getParams());
+    if (lod_group && lod_group->getNumLODRefs(volume) == 1)
+    {
+        volume->compactFaces();
+    }
+}
+
+namespace
+{
+    // Face geometry laid out by genDrawInfo, filled in by fill_face_geometry
+    // once all of a group's buffers are allocated.  Each face owns a
+    // disjoint range of its buffer's staging copy, so faces are filled in
+    // parallel on the General thread pool; allocation and upload stay on
+    // the main thread.
+    struct FaceGeometryBatch
+    {
+        struct Face
+        {
+            LLFace* mFace;
+            LLVolume* mVolume;
+            LLMatrix4 mMatVert;
+            LLMatrix3 mMatNormal;
+            S32 mTEIndex;
+            U16 mIndexOffset;
+        };
+
+        std::vector<Face> mFaces;
+        std::vector<LLPointer<LLVertexBuffer> > mBuffers;
+        U32 mVertexCount = 0;
+    };
+
+    // reused from group to group
+    FaceGeometryBatch sFaceGeometry;
+
+    FaceGeometryBatch& begin_face_geometry()
+    {
+        sFaceGeometry.mFaces.clear();
+        sFaceGeometry.mBuffers.clear();
+        sFaceGeometry.mVertexCount = 0;
+        return sFaceGeometry;
+    }
+
+    // Queue facep to have its geometry written at index_offset of the
+    // vertex buffer genDrawInfo assigned it.
+    void queue_face_geometry(LLFace* facep, U16 index_offset)
+    {
+        LLDrawable* drawablep = facep->getDrawable();
+        LLVOVolume* vobj = drawablep->getVOVolume();
+        LLVolume* volume = vobj->getVolume();
+        S32 te_idx = facep->getTEOffset();
+
+        if (drawablep->isState(LLDrawable::ANIMATED_CHILD))
+        {
+            vobj->updateRelativeXform(true);
+        }
+
+        if (facep->isState(LLFace::INSTANCED))
+        { // instanced faces are filled in object space, each instance
+          // supplies the rest of the transform at draw time
+            const LLVector3& scale = vobj->getScale();
+            LLMatrix4 mat_vert;
+            mat_vert.initScale(scale);
+            LLMatrix3 mat_normal;
+            for (U32 i = 0; i < 3; ++i)
+            {
+                mat_normal.mMatrix[i][i] = 1.f / scale.mV[i];
+            }
+            sFaceGeometry.mFaces.push_back({ facep, volume, mat_vert, mat_normal, te_idx, index_offset });
+        }
+        else
+        {
+            sFaceGeometry.mFaces.push_back({ facep, volume, vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), te_idx, index_offset });
+        }
+
+        if (drawablep->isState(LLDrawable::ANIMATED_CHILD))
+        {
+            vobj->updateRelativeXform(false);
+        }
+
+        // getGeometryVolume generates tangents on demand, which would race
+        // between faces sharing a volume, so generate them up front
+        if (te_idx >= 0 && te_idx < volume->getNumVolumeFaces() && !volume->getVolumeFace(te_idx).mTangents)
+        {
+            const LLTextureEntry* te = facep->getTextureEntry();
+            if (te->getBumpmap() ||
+                te->getTexGen() != LLTextureEntry::TEX_GEN_DEFAULT ||
+                facep->getVertexBuffer()->hasDataType(LLVertexBuffer::TYPE_TANGENT))
+            {
+                volume->genTangents(te_idx);
+            }
+        }
+
+        // registerFace runs before the geometry is filled in and reads the
+        // texture animation flag getGeometryVolume would have cleared
+        if (facep->isState(LLFace::TEXTURE_ANIM) && !vobj->mTexAnimMode)
+        {
+            facep->clearState(LLFace::TEXTURE_ANIM);
+        }
+
+        sFaceGeometry.mVertexCount += facep->getGeomCount();
+    }
+
+    // Fill in every queued face and upload the buffers
+    void fill_face_geometry()
+    {
+        LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+
+        FaceGeometryBatch& batch = sFaceGeometry;
+
+        // not worth waking the pool for a handful of small faces
+        const U32 MIN_PARALLEL_VERTICES = 4096;
+
+        static LLCachedControl<U32> geometry_jobs(gSavedSettings, "RenderParallelGeometryJobs", 3);
+        U32 helpers = batch.mVertexCount >= MIN_PARALLEL_VERTICES ? (U32) geometry_jobs : 0;
+        LL::parallelBatch((U32) batch.mFaces.size(), helpers, [&batch](U32 i)
+            {
+                FaceGeometryBatch::Face& face = batch.mFaces[i];
+                if (!face.mFace->getGeometryVolume(*face.mVolume, face.mTEIndex,
+                    face.mMatVert, face.mMatNormal, face.mIndexOffset, true))
+                {
+                    LL_WARNS() << "Failed to get geometry for face!" << LL_ENDL;
+                }
+            });
+
+        {
+            LL_PROFILE_ZONE_NAMED_CATEGORY_VOLUME("fill_face_geometry - upload");
+            for (LLVertexBuffer* buffer : batch.mBuffers)
+            {
+                buffer->unmapBuffer();
+            }
+            batch.mBuffers.clear();
+        }
+    }
+}
+
 void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
@@ -5626,6 +5954,9 @@ void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
 			{
 				const LLVector3& scale = vobj->getScale();
 				group->mSurfaceArea += volume->getSurfaceArea() * llmax(llmax(scale.mV[0], scale.mV[1]), scale.mV[2]);
+
+				// getGeometryVolume reads the full vertex arrays
+				volume->expandFaces();
 			}
 
             
@@ -5709,6 +6040,7 @@ void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
 				//ALWAYS null out vertex buffer on rebuild -- if the face lands in a render
 				// batch, it will recover its vertex buffer reference from the spatial group
 				facep->setVertexBuffer(NULL);
+				facep->clearState(LLFace::INSTANCED);
 			
 				//sum up face verts and indices
 				drawablep->updateFaceSize(i);
@@ -5970,6 +6302,8 @@ void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
 
 	U32 geometryBytes = 0;
 
+    begin_face_geometry();
+
     // generate render batches for static geometry
     U32 extra_mask = LLVertexBuffer::MAP_TEXTURE_INDEX;
     BOOL alpha_sort = TRUE;
@@ -5990,6 +6324,8 @@ void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
         rigged = TRUE;
     }
 
+    fill_face_geometry();
+
 	group->mGeometryBytes = geometryBytes;
 
 	{
@@ -6000,6 +6336,7 @@ void LLVolumeGeometryManager::rebuildGeom(LLSpatialGroup* group)
 			if(drawablep)
 			{
                 drawablep->clearState(LLDrawable::REBUILD_ALL);
+                compact_volume_faces(drawablep);
             }
         }
 	}
@@ -6024,6 +6361,7 @@ void LLVolumeGeometryManager::rebuildMesh(LLSpatialGroup* group)
 			LLVertexBuffer* locked_buffer[MAX_BUFFER_COUNT];
 
 			U32 buffer_count = 0;
+			bool instances_moved = false;
 
             for (LLSpatialGroup::element_iter drawable_iter = group->getDataBegin(); drawable_iter != group->getDataEnd(); ++drawable_iter)
 			{
@@ -6046,10 +6384,15 @@ void LLVolumeGeometryManager::rebuildMesh(LLSpatialGroup* group)
 
 					LLVolume* volume = vobj->getVolume();
 					if (!volume) continue;
+					volume->expandFaces();
 					for (S32 i = 0; i < drawablep->getNumFaces(); ++i)
 					{
 						LLFace* face = drawablep->getFace(i);
-						if (face)
+						if (face && face->isState(LLFace::INSTANCED))
+						{ //instance transforms live in the draw info
+							instances_moved = true;
+						}
+						else if (face)
 						{
 							LLVertexBuffer* buff = face->getVertexBuffer();
 							if (buff)
@@ -6081,6 +6424,12 @@ void LLVolumeGeometryManager::rebuildMesh(LLSpatialGroup* group)
 				}
 			}
 
+			if (instances_moved)
+			{ //rebuild the draw info with the new transforms
+				group->dirtyGeom();
+				gPipeline.markRebuild(group);
+			}
+
 			{
                 LL_PROFILE_ZONE_NAMED("rebuildMesh - flush");
 				for (LLVertexBuffer** iter = locked_buffer, ** end_iter = locked_buffer+buffer_count; iter != end_iter; ++iter)
@@ -6157,6 +6506,154 @@ struct CompareBatchBreakerRigged
     }
 };
 
+namespace
+{
+    typedef std::unordered_map<LLFace*, std::vector<LLFace*> > instance_map_t;
+
+    // model matrix registerFace will give facep's draw
+    const LLMatrix4* instance_model_matrix(LLFace* facep)
+    {
+        LLDrawable* drawable = facep->getDrawable();
+        return drawable->isActive() ? &drawable->getRenderMatrix() : &drawable->getRegion()->mRenderMatrix;
+    }
+
+    // true if facep can be drawn as an instance of a copy of itself, meaning
+    // genDrawInfo would register it in PASS_SIMPLE or PASS_GLTF_PBR alone
+    // and its geometry doesn't depend on anything but its volume and scale
+    bool can_instance_face(LLFace* facep)
+    {
+        LLDrawable* drawable = facep->getDrawable();
+        LLVOVolume* vobj = drawable->getVOVolume();
+        if (!vobj ||
+            !vobj->isMesh() ||
+            vobj->isSelected() ||
+            vobj->isVolumeGlobal() ||
+            vobj->mTexAnimMode ||
+            !vobj->getVolume() ||
+            vobj->getVolume()->isUnique() ||
+            drawable->isState(LLDrawable::ANIMATED_CHILD) ||
+            (LLPipeline::sBakeSunlight && drawable->isStatic()) ||
+            facep->isState(LLFace::TEXTURE_ANIM | LLFace::RIGGED) ||
+            facep->hasMedia() ||
+            facep->getTEOffset() < 0 ||
+            facep->getTEOffset() >= vobj->getVolume()->getNumVolumeFaces())
+        {
+            return false;
+        }
+
+        const LLTextureEntry* te = facep->getTextureEntry();
+        if (te->getGlow() > 0.f)
+        {
+            return false;
+        }
+
+        LLGLTFMaterial* gltf_mat = te->getGLTFRenderMaterial();
+        if (gltf_mat)
+        {
+            return gltf_mat->mAlphaMode == LLGLTFMaterial::ALPHA_MODE_OPAQUE;
+        }
+
+        LLViewerTexture* tex = facep->getTexture();
+        return te->getMaterialParams().isNull() &&
+            !te->getBumpmap() &&
+            !te->getShiny() &&
+            !te->getFullbright() &&
+            !facep->isState(LLFace::FULLBRIGHT) &&
+            te->getColor().mV[3] >= 0.999f &&
+            facep->getPoolType() != LLDrawPool::POOL_ALPHA &&
+            tex && tex->getPrimaryFormat() != GL_ALPHA;
+    }
+
+    // true if a and b would draw identically but for their transforms
+    bool same_instance(LLFace* a, LLFace* b)
+    {
+        const LLTextureEntry* a_te = a->getTextureEntry();
+        const LLTextureEntry* b_te = b->getTextureEntry();
+        LLGLTFMaterial* a_mat = a_te->getGLTFRenderMaterial();
+        LLGLTFMaterial* b_mat = b_te->getGLTFRenderMaterial();
+
+        return instance_model_matrix(a) == instance_model_matrix(b) &&
+            a->getViewerObject()->getScale() == b->getViewerObject()->getScale() &&
+            a->getTexture() == b->getTexture() &&
+            (a_mat == b_mat || (a_mat && b_mat && a_mat->getHash() == b_mat->getHash())) &&
+            *a_te == *b_te;
+    }
+
+    // Find faces in faces that are copies of the same mesh face (same mesh,
+    // LOD, texture entry and scale) and group them, up to MAX_INSTANCES per
+    // group.  Every face of a group is flagged INSTANCED, and all but the
+    // first are taken out of faces, keeping the order of the rest; the first
+    // carries the group's draw, which genDrawInfo then shares with the rest.
+    // Groups go in instances by their first face.
+    void gather_instances(LLFace** faces, U32& face_count, instance_map_t& instances)
+    {
+        LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
+
+        // candidates by the volume face they draw, the volume being unique
+        // to the mesh and LOD
+        std::unordered_map<const LLVolumeFace*, std::vector<std::vector<LLFace*> > > candidates;
+        for (U32 i = 0; i < face_count; ++i)
+        {
+            LLFace* facep = faces[i];
+            if (!can_instance_face(facep))
+            {
+                continue;
+            }
+
+            const LLVolumeFace* vf = &facep->getViewerObject()->getVolume()->getVolumeFace(facep->getTEOffset());
+            std::vector<std::vector<LLFace*> >& groups = candidates[vf];
+            bool found = false;
+            for (std::vector<LLFace*>& group : groups)
+            {
+                if (group.size() < LLGLSLShader::MAX_INSTANCES && same_instance(group[0], facep))
+                {
+                    group.push_back(facep);
+                    found = true;
+                    break;
+                }
+            }
+
+            if (!found)
+            {
+                groups.push_back({ facep });
+            }
+        }
+
+        for (auto& candidate : candidates)
+        {
+            for (std::vector<LLFace*>& group : candidate.second)
+            {
+                if (group.size() > 1)
+                {
+                    for (LLFace* facep : group)
+                    {
+                        facep->setState(LLFace::INSTANCED);
+                    }
+                    instances[group[0]].swap(group);
+                }
+            }
+        }
+
+        if (instances.empty())
+        {
+            return;
+        }
+
+        U32 count = 0;
+        for (U32 i = 0; i < face_count; ++i)
+        {
+            LLFace* facep = faces[i];
+            if (facep->isState(LLFace::INSTANCED) && instances.find(facep) == instances.end())
+            { // drawn by its group's first face
+                facep->setDrawInfo(NULL);
+                continue;
+            }
+            faces[count++] = facep;
+        }
+        face_count = count;
+    }
+}
+
 U32 LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, LLFace** faces, U32 face_count, BOOL distance_sort, BOOL batch_textures, BOOL rigged)
 {
     LL_PROFILE_ZONE_SCOPED_CATEGORY_VOLUME;
@@ -6192,6 +6689,14 @@ U32 LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, LLFace
 	}
 				
 	bool hud_group = group->isHUDGroup() ;
+
+	instance_map_t instances;
+	static LLCachedControl<bool> render_instancing(gSavedSettings, "RenderInstancing", true);
+	if (render_instancing && !rigged && !distance_sort && !hud_group)
+	{
+		gather_instances(faces, face_count, instances);
+	}
+
 	LLFace** face_iter = faces;
 	LLFace** end_faces = faces+face_count;
 	
@@ -6386,6 +6891,10 @@ U32 LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, LLFace
 		{
 			geometryBytes += buffer->getSize() + buffer->getIndicesSize();
 			buffer_map[mask][*face_iter].push_back(buffer);
+
+			// faces are filled in concurrently by fill_face_geometry
+			buffer->mapAll();
+			sFaceGeometry.mBuffers.push_back(buffer);
 		}
 
 		//add face geometry
@@ -6419,34 +6928,37 @@ U32 LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, LLFace
 				//for debugging, set last time face was updated vs moved
 				facep->updateRebuildFlags();
 
-				{ //copy face geometry into vertex buffer
-					LLDrawable* drawablep = facep->getDrawable();
-					LLVOVolume* vobj = drawablep->getVOVolume();
-					LLVolume* volume = vobj->getVolume();
-
-					if (drawablep->isState(LLDrawable::ANIMATED_CHILD))
-					{
-						vobj->updateRelativeXform(true);
-					}
-
-					U32 te_idx = facep->getTEOffset();
+				//copy face geometry into vertex buffer
+				queue_face_geometry(facep, index_offset);
+			}
 
-					if (!facep->getGeometryVolume(*volume, te_idx, 
-						vobj->getRelativeXform(), vobj->getRelativeXformInvTrans(), index_offset,true))
-					{
-						LL_WARNS() << "Failed to get geometry for face!" << LL_ENDL;
-					}
+			index_offset += facep->getGeomCount();
+			indices_index += facep->getIndicesCount();
 
-					if (drawablep->isState(LLDrawable::ANIMATED_CHILD))
+			if (!instances.empty())
+			{
+				instance_map_t::iterator instance_iter = instances.find(facep);
+				if (instance_iter != instances.end())
+				{ //one draw for the whole group, see can_instance_face
+					bool pbr = facep->getTextureEntry()->getGLTFRenderMaterial() != nullptr;
+					registerFace(group, facep, pbr ? LLRenderPass::PASS_GLTF_PBR : LLRenderPass::PASS_SIMPLE, &instance_iter->second);
+
+					// the rest of the group draw with it, from its geometry
+					for (LLFace* instance : instance_iter->second)
 					{
-						vobj->updateRelativeXform(false);
+						if (instance != facep)
+						{
+							instance->setIndicesIndex(facep->getIndicesStart());
+							instance->setGeomIndex(facep->getGeomIndex());
+							instance->setVertexBuffer(facep->getVertexBuffer());
+							instance->setDrawInfo(facep->mDrawInfo);
+						}
 					}
+					++face_iter;
+					continue;
 				}
 			}
 
-			index_offset += facep->getGeomCount();
-			indices_index += facep->getIndicesCount();
-
 			//append face to appropriate render batch
 
 			BOOL force_simple = facep->getPixelArea() < FORCE_SIMPLE_RENDER_AREA;
@@ -6787,11 +7299,6 @@ U32 LLVolumeGeometryManager::genDrawInfo(LLSpatialGroup* group, U32 mask, LLFace
 						
 			++face_iter;
 		}
-
-		if (buffer)
-		{
-			buffer->unmapBuffer();
-		}
 	}
 
 	group->mBufferMap[mask].clear();
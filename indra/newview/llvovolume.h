@@ -34,6 +34,8 @@
 #include "lllocalbitmaps.h"
 #include "m3math.h"		// LLMatrix3
 #include "m4math.h"		// LLMatrix4
+#include "llalignedarray.h"
+#include "llmatrix4a.h"
 #include <unordered_map>
 #include <unordered_set>
 
@@ -61,21 +63,50 @@ class LLRiggedVolume : public LLVolume
 {
 public:
 	LLRiggedVolume(const LLVolumeParams& params)
-		: LLVolume(params, 0.f)
+		: LLVolume(params, 0.f),
+		  mPaletteSerial(1)
 	{
+		// positions change with every pose, build raycast trees off thread
+		setDeferOctreeBuilds(true);
 	}
 
     using FaceIndex = S32;
     static const FaceIndex UPDATE_ALL_FACES = -1;
     static const FaceIndex DO_NOT_UPDATE_FACES = -2;
+    // update the extents of all faces without skinning their vertices
+    static const FaceIndex UPDATE_BOUNDS = -3;
     void update(
         const LLMeshSkinInfo* skin,
         LLVOAvatar* avatar,
         const LLVolume* src_volume,
-        FaceIndex face_index = UPDATE_ALL_FACES,
-        bool rebuild_face_octrees = true);
+        FaceIndex face_index = UPDATE_ALL_FACES);
 
     std::string mExtraDebugText;
+
+private:
+    // fold the bind shape into the avatar's palette for skin, bumping
+    // mPaletteSerial if the result differs from the last one
+    void updatePalette(const LLMeshSkinInfo* skin, LLVOAvatar* avatar);
+
+    // Joint indices and normalized weights of one face, decoded from the
+    // source face's packed weights the first time the face is updated, and
+    // the bounds of the vertices each joint moves
+    struct SkinWeights
+    {
+        U32 mSourceStamp = 0; // LLVolumeFace::mWeightsStamp of the source face
+        U32 mNumJoints = 0;
+        std::vector<U8> mJointIndices;
+        LLAlignedArray<LLVector4a, 64> mJointWeights;
+        std::vector<U8> mBoundJoints;
+        LLAlignedArray<LLVector4a, 64> mJointBounds;
+        // mPaletteSerial the positions were last skinned with
+        U32 mSkinnedSerial = 0;
+    };
+    std::vector<SkinWeights> mSkinWeights;
+
+    // bind shape matrix times the avatar's palette for the skin
+    LLAlignedArray<LLMatrix4a, 64> mPalette;
+    U32 mPaletteSerial;
 };
 
 // Base class for implementations of the volume - Primitive, Flexible Object, etc.
@@ -149,6 +180,31 @@ public:
 				typedef std::unordered_set<const LLViewerTexture*> texture_cost_t;
                 static S32 getTextureCost(const LLViewerTexture* img);
 				U32 	getRenderCost(texture_cost_t &textures) const;
+
+				// What getRenderCost() reads of a volume, for the cost to be
+				// worked out away from the objects.
+				struct RenderCostInputs
+				{
+					U32		mNumTriangles = 0;
+					U32		mMediaFaces = 0;
+					U32		mNumParticles = 0;
+					F32		mParticleSize = 0.f;
+					bool	mValid = false;			// false if the volume has no cost
+					bool	mPlanar = false;
+					bool	mAnimTex = false;
+					bool	mAlpha = false;
+					bool	mInvisi = false;
+					bool	mGlow = false;
+					bool	mBump = false;
+					bool	mShiny = false;
+					bool	mWeightedMesh = false;
+					bool	mFlexi = false;
+					bool	mParticles = false;
+					bool	mProducesLight = false;
+					bool	mAnimatedRoot = false;
+				};
+				bool	getRenderCostInputs(RenderCostInputs& inputs, texture_cost_t &textures) const;
+				static U32 getRenderCost(const RenderCostInputs& inputs);
     /*virtual*/	F32		getEstTrianglesMax() const override;
     /*virtual*/	F32		getEstTrianglesStreamingCost() const override;
     /* virtual*/ F32	getStreamingCost() const override;
@@ -401,11 +457,12 @@ public:
 	
 
     // Rigged volume update (for raycasting)
-    // By default, this updates the bounding boxes of all the faces and builds an octree for precise per-triangle raycasting
+    // By default, this skins all the faces and invalidates their octrees, which are rebuilt in the
+    // background for precise per-triangle raycasting.  UPDATE_BOUNDS only updates the bounding boxes,
+    // from per joint bounds without skinning any vertices.
     void updateRiggedVolume(
         bool force_treat_as_rigged,
-        LLRiggedVolume::FaceIndex face_index = LLRiggedVolume::UPDATE_ALL_FACES,
-        bool rebuild_face_octrees = true);
+        LLRiggedVolume::FaceIndex face_index = LLRiggedVolume::UPDATE_ALL_FACES);
 	LLRiggedVolume* getRiggedVolume();
 
 	//returns true if volume should be treated as a rigged volume
@@ -334,6 +334,7 @@ LLPipeline::LLPipeline() :
 	mBackfaceCull(false),
 	mMatrixOpCount(0),
 	mTextureMatrixOps(0),
+	mInstancedDrawsSaved(0),
 	mNumVisibleNodes(0),
 	mNumVisibleFaces(0),
 	mPoissonOffset(0),
@@ -1069,6 +1070,13 @@ void LLPipeline::releaseGLBuffers()
 		mTrueNoiseMap = 0;
 	}
 
+    if (mShadowUBO)
+    {
+        glDeleteBuffers(1, &mShadowUBO);
+        mShadowUBO = 0;
+        mShadowBlockValid = false;
+    }
+
 	releaseLUTBuffers();
 
 	mWaterDis.release();
@@ -2272,6 +2280,9 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result)
 
 	sCull->clear();
 
+	static std::vector<LLSpatialPartition*> partitions;
+	partitions.clear();
+
 	for (LLWorld::region_list_t::const_iterator iter = LLWorld::getInstance()->getRegionList().begin(); 
 			iter != LLWorld::getInstance()->getRegionList().end(); ++iter)
 	{
@@ -2284,10 +2295,20 @@ void LLPipeline::updateCull(LLCamera& camera, LLCullResult& result)
 			{
 				if (hasRenderType(part->mDrawableType))
 				{
-					part->cull(camera);
+					partitions.push_back(part);
 				}
 			}
 		}
+	}
+
+	// frustum culling of all partitions in one go so it can be spread over
+	// worker threads
+	LLSpatialPartition::cullPartitions(camera, partitions);
+
+	for (LLWorld::region_list_t::const_iterator iter = LLWorld::getInstance()->getRegionList().begin(); 
+			iter != LLWorld::getInstance()->getRegionList().end(); ++iter)
+	{
+		LLViewerRegion* region = *iter;
 
 		//scan the VO Cache tree
 		LLVOCachePartition* vo_part = region->getVOCachePartition();
@@ -2342,7 +2363,7 @@ void LLPipeline::markNotCulled(LLSpatialGroup* group, LLCamera& camera)
 		sCull->pushVisibleGroup(group);
 	}
 
-    if (group->needsUpdate() ||
+    if (group->needsOcclusionQuery() ||
         group->getVisible(LLViewerCamera::sCurCameraID) < LLDrawable::getCurrentFrame() - 1)
     {
         // include this group in occlusion groups, not because it is an occluder, but because we want to run
@@ -3412,6 +3433,12 @@ void LLPipeline::postSort(LLCamera &camera)
         }
     }
 
+    static LLCachedControl<bool> sort_draws(gSavedSettings, "RenderSortDrawInfo", true);
+    if (sort_draws)
+    { // group draws that share state so the pools change it less often
+        sCull->sortRenderMaps();
+    }
+
     /*bool use_transform_feedback = gTransformPositionProgram.mProgramObject && !mMeshDirtyGroup.empty();
 
     if (use_transform_feedback)
@@ -7464,6 +7491,51 @@ void LLPipeline::bindShadowMaps(LLGLSLShader& shader)
     }
 }
 
+void LLPipeline::updateShadowBlock()
+{
+    LL_PROFILE_ZONE_SCOPED_CATEGORY_PIPELINE;
+    static_assert(sizeof(ShadowBlock) == 432, "ShadowBlock must match the std140 layout of ShadowParams");
+
+    ShadowBlock block;
+    for (U32 i = 0; i < 6; ++i)
+    {
+        memcpy(block.mShadowMatrix[i], mSunShadowMatrix[i].m, sizeof(F32) * 16);
+    }
+
+    memcpy(block.mShadowClip, mSunClipPlanes.mV, sizeof(F32) * 4);
+
+    block.mShadowRes[0] = (F32) mRT->shadow[0].getWidth();
+    block.mShadowRes[1] = (F32) mRT->shadow[0].getHeight();
+    block.mProjShadowRes[0] = (F32) mSpotShadow[0].getWidth();
+    block.mProjShadowRes[1] = (F32) mSpotShadow[0].getHeight();
+
+    //F32 shadow_offset_error = 1.f + RenderShadowOffsetError * fabsf(LLViewerCamera::getInstance()->getOrigin().mV[2]);
+    F32 shadow_bias_error = RenderShadowBiasError * fabsf(LLViewerCamera::getInstance()->getOrigin().mV[2])/3000.f;
+    block.mShadowBias = RenderShadowBias + shadow_bias_error;
+    block.mShadowOffset = RenderShadowOffset; //*shadow_offset_error;
+    block.mSpotShadowBias = RenderSpotShadowBias;
+    block.mSpotShadowOffset = RenderSpotShadowOffset;
+
+    if (!mShadowUBO)
+    {
+        glGenBuffers(1, &mShadowUBO);
+        mShadowBlockValid = false;
+    }
+
+    if (!mShadowBlockValid || memcmp(&block, &mShadowBlock, sizeof(ShadowBlock)) != 0)
+    {
+        mShadowBlock = block;
+        mShadowBlockValid = true;
+
+        glBindBuffer(GL_UNIFORM_BUFFER, mShadowUBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(ShadowBlock), &mShadowBlock, GL_STREAM_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        ++mShadowBlockUploads;
+    }
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, LLGLSLShader::SHADOW_BLOCK_BINDING, mShadowUBO);
+}
+
 void LLPipeline::bindDeferredShaderFast(LLGLSLShader& shader)
 {
     if (shader.mCanBindFast)
@@ -7580,18 +7652,7 @@ void LLPipeline::bindDeferredShader(LLGLSLShader& shader, LLRenderTarget* light_
 
 	stop_glerror();
 
-	F32 mat[16*6];
-	for (U32 i = 0; i < 16; i++)
-	{
-		mat[i] = mSunShadowMatrix[0].m[i];
-		mat[i+16] = mSunShadowMatrix[1].m[i];
-		mat[i+32] = mSunShadowMatrix[2].m[i];
-		mat[i+48] = mSunShadowMatrix[3].m[i];
-		mat[i+64] = mSunShadowMatrix[4].m[i];
-		mat[i+80] = mSunShadowMatrix[5].m[i];
-	}
-
-	shader.uniformMatrix4fv(LLShaderMgr::DEFERRED_SHADOW_MATRIX, 6, FALSE, mat);
+    updateShadowBlock();
 
 	stop_glerror();
 
@@ -7647,14 +7708,6 @@ void LLPipeline::bindDeferredShader(LLGLSLShader& shader, LLRenderTarget* light_
         }
     }
 
-    /*if (gCubeSnapshot)
-    { // we only really care about the first two values, but the shader needs increasing separation between clip planes
-        shader.uniform4f(LLShaderMgr::DEFERRED_SHADOW_CLIP, 1.f, 64.f, 128.f, 256.f);
-    }
-    else*/
-    {
-        shader.uniform4fv(LLShaderMgr::DEFERRED_SHADOW_CLIP, 1, mSunClipPlanes.mV);
-    }
 	shader.uniform1f(LLShaderMgr::DEFERRED_SUN_WASH, RenderDeferredSunWash);
 	shader.uniform1f(LLShaderMgr::DEFERRED_SHADOW_NOISE, RenderShadowNoise);
 	shader.uniform1f(LLShaderMgr::DEFERRED_BLUR_SIZE, RenderShadowBlurSize);
@@ -7676,21 +7729,11 @@ void LLPipeline::bindDeferredShader(LLGLSLShader& shader, LLRenderTarget* light_
 								matrix_nondiag, matrix_nondiag, matrix_diag};
 	shader.uniformMatrix3fv(LLShaderMgr::DEFERRED_SSAO_EFFECT_MAT, 1, GL_FALSE, ssao_effect_mat);
 
-	//F32 shadow_offset_error = 1.f + RenderShadowOffsetError * fabsf(LLViewerCamera::getInstance()->getOrigin().mV[2]);
-	F32 shadow_bias_error = RenderShadowBiasError * fabsf(LLViewerCamera::getInstance()->getOrigin().mV[2])/3000.f;
-    F32 shadow_bias       = RenderShadowBias + shadow_bias_error;
-
     shader.uniform2f(LLShaderMgr::DEFERRED_SCREEN_RES, deferred_target->getWidth(), deferred_target->getHeight());
 	shader.uniform1f(LLShaderMgr::DEFERRED_NEAR_CLIP, LLViewerCamera::getInstance()->getNear()*2.f);
-	shader.uniform1f (LLShaderMgr::DEFERRED_SHADOW_OFFSET, RenderShadowOffset); //*shadow_offset_error);
-    shader.uniform1f(LLShaderMgr::DEFERRED_SHADOW_BIAS, shadow_bias);
-	shader.uniform1f(LLShaderMgr::DEFERRED_SPOT_SHADOW_OFFSET, RenderSpotShadowOffset);
-	shader.uniform1f(LLShaderMgr::DEFERRED_SPOT_SHADOW_BIAS, RenderSpotShadowBias);	
 
 	shader.uniform3fv(LLShaderMgr::DEFERRED_SUN_DIR, 1, mTransformedSunDir.mV);
     shader.uniform3fv(LLShaderMgr::DEFERRED_MOON_DIR, 1, mTransformedMoonDir.mV);
-	shader.uniform2f(LLShaderMgr::DEFERRED_SHADOW_RES, mRT->shadow[0].getWidth(), mRT->shadow[0].getHeight());
-	shader.uniform2f(LLShaderMgr::DEFERRED_PROJ_SHADOW_RES, mSpotShadow[0].getWidth(), mSpotShadow[0].getHeight());
 	shader.uniform1f(LLShaderMgr::DEFERRED_DEPTH_CUTOFF, RenderEdgeDepthCutoff);
 	shader.uniform1f(LLShaderMgr::DEFERRED_NORM_CUTOFF, RenderEdgeNormCutoff);
 	
@@ -307,6 +307,8 @@ public:
     void bindShadowMaps(LLGLSLShader& shader);
     void bindDeferredShaderFast(LLGLSLShader& shader);
 	void bindDeferredShader(LLGLSLShader& shader, LLRenderTarget* light_target = nullptr, LLRenderTarget* depth_target = nullptr);
+    // upload the ShadowParams uniform block if any of it changed since the last upload
+    void updateShadowBlock();
 	void setupSpotLight(LLGLSLShader& shader, LLDrawable* drawablep);
 
 	void unbindDeferredShader(LLGLSLShader& shader);
@@ -631,6 +633,7 @@ public:
 	bool					 mBackfaceCull;
 	S32						 mMatrixOpCount;
 	S32						 mTextureMatrixOps;
+	S32						 mInstancedDrawsSaved; // draw calls folded into instanced draws
 	S32						 mNumVisibleNodes;
 
 	S32						 mDebugTextureUploadCost;
@@ -749,6 +752,27 @@ public:
 
 	LLVector4				mSunClipPlanes;
 	LLVector4				mSunOrthoClipPlanes;
+
+    // CPU copy of the ShadowParams uniform block, std140 layout -- must match
+    // deferred/shadowUtil.glsl.  Shared by every shader with hasShadows, so
+    // shadow state is sent once per change instead of once per shader bind.
+    struct ShadowBlock
+    {
+        F32 mShadowMatrix[6][16];
+        F32 mShadowClip[4];
+        F32 mShadowRes[2];
+        F32 mProjShadowRes[2];
+        F32 mShadowBias;
+        F32 mShadowOffset;
+        F32 mSpotShadowBias;
+        F32 mSpotShadowOffset;
+    };
+
+    ShadowBlock             mShadowBlock;
+    U32                     mShadowUBO = 0;
+    bool                    mShadowBlockValid = false;
+    // uploads of mShadowBlock since the render info display last reset it
+    U32                     mShadowBlockUploads = 0;
 	LLVector2				mScreenScale;
 
 	//water distortion texture (refraction)
@@ -47,10 +47,13 @@ void LLViewerOctreeGroup::handleChildRemoval(const OctreeNode* parent, const Oct
 
 LLOcclusionCullingGroup::LLOcclusionCullingGroup(OctreeNode* node, LLViewerOctreePartition* part) :
     LLViewerOctreeGroup(node),
-    mSpatialPartition(part)
+    mSpatialPartition(part),
+    mBoundsIndex(-1)
 {
 }
 LLOcclusionCullingGroup::~LLOcclusionCullingGroup() = default;
+void LLOcclusionCullingGroup::rebound() {}
+void LLOcclusionCullingGroup::handleDestruction(const TreeNode* node) {}
 void LLOcclusionCullingGroup::doOcclusion(LLCamera* camera, const LLVector4a* shift) {}
 void LLOcclusionCullingGroup::setOcclusionState(U32 state, S32 mode) {}
 void LLOcclusionCullingGroup::clearOcclusionState(U32 state, S32 mode) {}
@@ -0,0 +1,49 @@
+/**
+ * @file   lltestbenchmark.h
+ * @date   2024-05-14
+ * @brief  Opt-in timing for unit tests
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Copyright (c) 2024, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+#if ! defined(LL_LLTESTBENCHMARK_H)
+#define LL_LLTESTBENCHMARK_H
+
+#include "llstring.h"
+#include "lltimer.h"
+
+#include <iostream>
+
+// Benchmarks are too slow and too noisy to run on every build. A benchmark
+// test skip()s unless LL_TEST_BENCHMARK is set in the environment:
+//
+//     if (! lltest_benchmark_enabled())
+//     {
+//         skip("set LL_TEST_BENCHMARK to run");
+//     }
+inline bool lltest_benchmark_enabled()
+{
+    return ! LLStringUtil::getenv("LL_TEST_BENCHMARK").empty();
+}
+
+// Mean milliseconds per call of func() over passes calls.
+template <typename FUNC>
+F64 lltest_benchmark_ms(U32 passes, FUNC func)
+{
+    LLTimer timer;
+    for (U32 pass = 0; pass < passes; ++pass)
+    {
+        func();
+    }
+    return timer.getElapsedTimeF64() * 1000.0 / passes;
+}
+
+// Benchmark results go to stdout, the test log is only shown on failure.
+inline std::ostream& lltest_benchmark_out()
+{
+    return std::cout << "benchmark: ";
+}
+
+#endif /* ! defined(LL_LLTESTBENCHMARK_H) */
@@ -0,0 +1,53 @@
+/**
+ * @file   lltestrandom.h
+ * @date   2024-05-14
+ * @brief  Deterministic pseudo-random numbers for unit tests
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Copyright (c) 2024, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+#if ! defined(LL_LLTESTRANDOM_H)
+#define LL_LLTESTRANDOM_H
+
+#include "stdtypes.h"
+
+// Linear congruential generator with a fixed seed, so a failing test
+// reproduces the same inputs on every run and platform.
+class LLTestRandom
+{
+public:
+    LLTestRandom(U32 seed = 12345):
+        mState(seed)
+    {}
+
+    U32 nextU32()
+    {
+        mState = mState * 1664525 + 1013904223;
+        return mState;
+    }
+
+    // top byte, which has the longest period
+    U8 nextU8()
+    {
+        return (U8) (nextU32() >> 24);
+    }
+
+    // in [0, 1)
+    F32 next()
+    {
+        return (F32) (nextU32() >> 8) / (F32) (1 << 24);
+    }
+
+    // in [low, high)
+    F32 range(F32 low, F32 high)
+    {
+        return low + (high - low) * next();
+    }
+
+private:
+    U32 mState;
+};
+
+#endif /* ! defined(LL_LLTESTRANDOM_H) */
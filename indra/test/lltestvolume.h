@@ -0,0 +1,29 @@
+/**
+ * @file   lltestvolume.h
+ * @date   2024-05-14
+ * @brief  Volume parameters for unit tests that generate prims
+ *
+ * $LicenseInfo:firstyear=2024&license=viewerlgpl$
+ * Copyright (c) 2024, Linden Research, Inc.
+ * $/LicenseInfo$
+ */
+
+#if ! defined(LL_LLTESTVOLUME_H)
+#define LL_LLTESTVOLUME_H
+
+#include "llvolume.h"
+
+// A full, unsheared, untapered prim of the given profile and path.
+inline LLVolumeParams lltest_volume_params(U8 profile, U8 path, F32 hollow)
+{
+    LLVolumeParams params;
+    params.setType(profile, path);
+    params.setBeginAndEndS(0.f, 1.f);
+    params.setBeginAndEndT(0.f, 1.f);
+    params.setRatio(1.f, 1.f);
+    params.setShear(0.f, 0.f);
+    params.setHollow(hollow);
+    return params;
+}
+
+#endif /* ! defined(LL_LLTESTVOLUME_H) */